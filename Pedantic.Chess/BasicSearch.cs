@@ -569,6 +569,10 @@ namespace Pedantic.Chess
                     }
                 }
 
+                // start the table lookup of the child's ProbeTb now so it overlaps with the
+                // work done before it
+                PrefetchTb(depth - 1);
+
 #if DEBUG
                 if (ply == 0)
                 {
@@ -784,7 +788,9 @@ namespace Pedantic.Chess
                 board.HalfMoveClock == 0 && board.Castling == CastlingRights.None &&
                 BitOps.PopCount(board.All) <= Syzygy.TbLargest)
             {
-                TbResult result = Syzygy.ProbeWdl(board.Units(Color.White), board.Units(Color.Black), 
+                // with SyzygyIoThreads set a probe that would wait for the disk comes back
+                // pending instead, and the I/O threads read the table for the next visit
+                TbResult result = Syzygy.ProbeWdlNonBlocking(board.Units(Color.White), board.Units(Color.Black), 
                     board.Pieces(Color.White, Piece.King)   | board.Pieces(Color.Black, Piece.King),
                     board.Pieces(Color.White, Piece.Queen)  | board.Pieces(Color.Black, Piece.Queen),
                     board.Pieces(Color.White, Piece.Rook)   | board.Pieces(Color.Black, Piece.Rook),
@@ -792,9 +798,9 @@ namespace Pedantic.Chess
                     board.Pieces(Color.White, Piece.Knight) | board.Pieces(Color.Black, Piece.Knight),
                     board.Pieces(Color.White, Piece.Pawn)   | board.Pieces(Color.Black, Piece.Pawn),
                     0, 0, (uint)(board.EnPassantValidated != Index.NONE ? board.EnPassantValidated : 0), 
-                    board.SideToMove == Color.White);
+                    board.SideToMove == Color.White, board.TbMaterialKey);
 
-                if (result == TbResult.TbFailure)
+                if (result == TbResult.TbFailure || result == TbResult.TbPending)
                 {
                     return false;
                 }
@@ -827,6 +833,24 @@ namespace Pedantic.Chess
             return false;
         }
 
+        private void PrefetchTb(int depth)
+        {
+            if (Syzygy.IsInitialized && depth >= UciOptions.SyzygyProbeDepth &&
+                board.HalfMoveClock == 0 && board.Castling == CastlingRights.None &&
+                BitOps.PopCount(board.All) <= Syzygy.TbLargest)
+            {
+                Syzygy.Prefetch(board.Units(Color.White), board.Units(Color.Black),
+                    board.Pieces(Color.White, Piece.King)   | board.Pieces(Color.Black, Piece.King),
+                    board.Pieces(Color.White, Piece.Queen)  | board.Pieces(Color.Black, Piece.Queen),
+                    board.Pieces(Color.White, Piece.Rook)   | board.Pieces(Color.Black, Piece.Rook),
+                    board.Pieces(Color.White, Piece.Bishop) | board.Pieces(Color.Black, Piece.Bishop),
+                    board.Pieces(Color.White, Piece.Knight) | board.Pieces(Color.Black, Piece.Knight),
+                    board.Pieces(Color.White, Piece.Pawn)   | board.Pieces(Color.Black, Piece.Pawn),
+                    (uint)(board.EnPassantValidated != Index.NONE ? board.EnPassantValidated : 0),
+                    board.SideToMove == Color.White, board.TbMaterialKey);
+            }
+        }
+
         private void ReportSearchResults(int score, TtFlag flag, ref ulong bestMove, ref ulong? ponderMove)
         {
             if (Depth > Constants.WINDOW_MIN_DEPTH)
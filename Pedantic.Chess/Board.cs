@@ -42,6 +42,7 @@ namespace Pedantic.Chess
         private readonly ulong[] units = new ulong[Constants.MAX_COLORS];
         private ulong all = 0ul;
         private short phase = 0;
+        private ulong tbKey = 0ul;
 
         #region Incrementally updated values used by Evaluation
 
@@ -86,6 +87,16 @@ namespace Pedantic.Chess
 
         private readonly ValueStack<BoardState> gameStack = new(Constants.MAX_GAME_LENGTH);
 
+        // Per-piece terms of the Syzygy material key, the PRIME_* constants of tbchess.c;
+        // the key of a position is their sum over all pieces.
+        private static readonly UnsafeArray<ulong> tbPieceKeys = new (Constants.MAX_COLORS * Constants.MAX_PIECES)
+        {
+            17008651141875982339ul, 15202887380319082783ul, 12311744257139811149ul,
+            10979190538029446137ul, 11811845319353239651ul, 0ul,
+            11695583624105689831ul, 13469005675588064321ul, 15394650811035483107ul,
+            18264461213049635989ul, 15484752644942473553ul, 0ul
+        };
+
         #region Constructors
 
         static Board()
@@ -120,6 +131,7 @@ namespace Pedantic.Chess
             Array.Copy(other.units, units, units.Length);
             all = other.all;
             phase = other.phase;
+            tbKey = other.tbKey;
             Array.Copy(other.material, material, material.Length);
             pawnHash = other.pawnHash;
             sideToMove = other.sideToMove;
@@ -165,6 +177,12 @@ namespace Pedantic.Chess
         public bool[] HasCastled => hasCastled;
         public short Phase => phase;
 
+        /// <summary>
+        /// The Syzygy material key of the position (see <c>Syzygy.MaterialKey</c>), kept up to
+        /// date as pieces are added and removed so probes need not recompute it.
+        /// </summary>
+        public ulong TbMaterialKey => tbKey;
+
         public short PieceMaterial(Color color)
         {
             short pieceMaterial = 0;
@@ -247,6 +265,7 @@ namespace Pedantic.Chess
             Array.Fill(hasCastled, false);
             pawnHash = 0;
             phase = 0;
+            tbKey = 0;
         }
 
         public bool IsLegalMove(ulong move)
@@ -2184,6 +2203,7 @@ namespace Pedantic.Chess
             units[(int)color] = BitOps.SetBit(units[(int)color], square);
             all = BitOps.SetBit(all, square);
             phase += piece.PhaseValue();
+            tbKey += tbPieceKeys[(int)color * Constants.MAX_PIECES + (int)piece];
             material[(int)color] += Evaluation.Weights.PieceValue(piece);
         }
 
@@ -2205,6 +2225,7 @@ namespace Pedantic.Chess
             units[(int)color] = BitOps.ResetBit(Units(color), square);
             all = BitOps.ResetBit(all, square);
             phase -= piece.PhaseValue();
+            tbKey -= tbPieceKeys[(int)color * Constants.MAX_PIECES + (int)piece];
             material[(int)color] -= Evaluation.Weights.PieceValue(piece);
         }
 
@@ -1147,6 +1147,93 @@ namespace Pedantic.Chess
             return false;
         }
 
+        private static bool ProbeRootDtm(Board board, out ulong[] pv, out int mateIn)
+        {
+            pv = Array.Empty<ulong>();
+            mateIn = 0;
+            if (!UciOptions.SyzygyProbeRoot || !Syzygy.IsInitialized || 
+                BitOps.PopCount(board.All) > Syzygy.TbLargestDtm)
+            {
+                return false;
+            }
+
+            TbRootMove[] rootMoves = Array.Empty<TbRootMove>();
+            int result = Syzygy.ProbeRootDtm(board.Units(Color.White), board.Units(Color.Black), 
+                board.Pieces(Color.White, Piece.King)   | board.Pieces(Color.Black, Piece.King),
+                board.Pieces(Color.White, Piece.Queen)  | board.Pieces(Color.Black, Piece.Queen),
+                board.Pieces(Color.White, Piece.Rook)   | board.Pieces(Color.Black, Piece.Rook),
+                board.Pieces(Color.White, Piece.Bishop) | board.Pieces(Color.Black, Piece.Bishop),
+                board.Pieces(Color.White, Piece.Knight) | board.Pieces(Color.Black, Piece.Knight),
+                board.Pieces(Color.White, Piece.Pawn)   | board.Pieces(Color.Black, Piece.Pawn),
+                (uint)board.HalfMoveClock, (uint)board.Castling, 
+                (uint)(board.EnPassantValidated != Index.NONE ? board.EnPassantValidated : 0), 
+                board.SideToMove == Color.White, false, true, ref rootMoves);
+
+            if (result == 0 || rootMoves.Length == 0)
+            {
+                return false;
+            }
+
+            int best = 0;
+            for (int n = 1; n < rootMoves.Length; n++)
+            {
+                if (rootMoves[n].tbRank > rootMoves[best].tbRank)
+                {
+                    best = n;
+                }
+            }
+
+            // draws are left to the DTZ path which also respects the 50-move rule
+            int score = rootMoves[best].tbScore;
+            if (score == 0)
+            {
+                return false;
+            }
+
+            // convert the mate PV into engine moves, playing it out on a copy of the board
+            TbMove[] tbPv = rootMoves[best].pv;
+            Board clone = board.Clone();
+            ulong[] moves = new ulong[tbPv.Length];
+            int count = 0;
+            foreach (TbMove tbMove in tbPv)
+            {
+                MoveList moveList = new();
+                clone.GenerateMoves(moveList);
+                Piece promote = (Piece)(5 - tbMove.Promotes);
+                promote = promote == Piece.King ? Piece.None : promote;
+                ulong move = 0;
+
+                for (int n = 0; n < moveList.Count; n++)
+                {
+                    ulong mv = moveList[n];
+                    if (Move.GetFrom(mv) == tbMove.From && Move.GetTo(mv) == tbMove.To && Move.GetPromote(mv) == promote)
+                    {
+                        if (clone.MakeMove(mv))
+                        {
+                            move = mv;
+                            break;
+                        }
+                    }
+                }
+
+                if (move == 0)
+                {
+                    break;
+                }
+                moves[count++] = move;
+            }
+
+            if (count == 0)
+            {
+                return false;
+            }
+
+            Array.Resize(ref moves, count);
+            pv = moves;
+            mateIn = score > 0 ? (Syzygy.TbValueMate - score + 1) / 2 : -(Syzygy.TbValueMate + score) / 2;
+            return true;
+        }
+
         public static void Bench(int depth, bool extend)
         {
             long totalNodes = 0;
@@ -1187,6 +1274,13 @@ namespace Pedantic.Chess
                 }
             }
 
+            if (ProbeRootDtm(Board, out ulong[] matePv, out int mateIn))
+            {
+                Uci.Default.InfoMate(1, 1, mateIn, matePv.Length, 0, matePv, TtTran.Default.Usage, matePv.Length);
+                Uci.Default.BestMove(matePv[0], null);
+                return;
+            }
+
             if (ProbeRootTb(Board, out ulong mv, out TbGameResult gameResult))
             {
                 Board clone = Board.Clone();
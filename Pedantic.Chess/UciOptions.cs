@@ -16,6 +16,19 @@ namespace Pedantic.Chess
         public const string DEFAULT_SYZYGY_PATH = "";
         public const bool DEFAULT_SYZYGY_PROBE_ROOT = true;
         public const int DEFAULT_SYZYGY_PROBE_DEPTH = 2;
+        public const int DEFAULT_SYZYGY_CACHE = 0;
+        public const int MAX_SYZYGY_CACHE = 1024;
+        public const int DEFAULT_SYZYGY_WARMUP = 0;
+        public const int DEFAULT_SYZYGY_WARMUP_BUDGET = 0;
+        public const int MAX_SYZYGY_WARMUP_BUDGET = 65536;
+        public const int DEFAULT_SYZYGY_MEMORY = 0;
+        public const int MAX_SYZYGY_MEMORY = 1048576;
+        public const int DEFAULT_SYZYGY_HUGE_PAGES = 0;
+        public const bool DEFAULT_SYZYGY_LOCK_PAGES = false;
+        public const int DEFAULT_SYZYGY_BITBASES = 0;
+        public const int DEFAULT_SYZYGY_IO_THREADS = 0;
+        public const int MAX_SYZYGY_IO_THREADS = 16;
+        public const int DEFAULT_SYZYGY_NUMA = 0;
         public const bool DEFAULT_ANALYSE_MODE = false;
         public const int DEFAULT_THREADS = 1;
         public const int DEFAULT_CONTEMPT = 0;
@@ -30,6 +43,15 @@ namespace Pedantic.Chess
             SyzygyPath = DEFAULT_SYZYGY_PATH;
             SyzygyProbeRoot = DEFAULT_SYZYGY_PROBE_ROOT;
             SyzygyProbeDepth = DEFAULT_SYZYGY_PROBE_DEPTH;
+            SyzygyCache = DEFAULT_SYZYGY_CACHE;
+            SyzygyWarmup = DEFAULT_SYZYGY_WARMUP;
+            SyzygyWarmupBudget = DEFAULT_SYZYGY_WARMUP_BUDGET;
+            SyzygyMemory = DEFAULT_SYZYGY_MEMORY;
+            SyzygyHugePages = DEFAULT_SYZYGY_HUGE_PAGES;
+            SyzygyLockPages = DEFAULT_SYZYGY_LOCK_PAGES;
+            SyzygyBitbases = DEFAULT_SYZYGY_BITBASES;
+            SyzygyIoThreads = DEFAULT_SYZYGY_IO_THREADS;
+            SyzygyNuma = DEFAULT_SYZYGY_NUMA;
             AnalyseMode = DEFAULT_ANALYSE_MODE;
             Threads = DEFAULT_THREADS;
             Contempt = DEFAULT_CONTEMPT;
@@ -57,6 +79,71 @@ namespace Pedantic.Chess
                 syzygyProbeDepth = Math.Clamp(value, 0, Constants.MAX_PLY - 1);
             }
         }
+        public static int SyzygyCache
+        {
+            get => syzygyCache;
+            set
+            {
+                syzygyCache = Math.Clamp(value, 0, MAX_SYZYGY_CACHE);
+            }
+        }
+        public static int SyzygyWarmup
+        {
+            get => syzygyWarmup;
+            set
+            {
+                syzygyWarmup = Math.Clamp(value, 0, 7);
+            }
+        }
+        public static int SyzygyWarmupBudget
+        {
+            get => syzygyWarmupBudget;
+            set
+            {
+                syzygyWarmupBudget = Math.Clamp(value, 0, MAX_SYZYGY_WARMUP_BUDGET);
+            }
+        }
+        public static int SyzygyMemory
+        {
+            get => syzygyMemory;
+            set
+            {
+                syzygyMemory = Math.Clamp(value, 0, MAX_SYZYGY_MEMORY);
+            }
+        }
+        public static int SyzygyHugePages
+        {
+            get => syzygyHugePages;
+            set
+            {
+                syzygyHugePages = Math.Clamp(value, 0, 7);
+            }
+        }
+        public static bool SyzygyLockPages { get; set; }
+        public static int SyzygyBitbases
+        {
+            get => syzygyBitbases;
+            set
+            {
+                syzygyBitbases = Math.Clamp(value, 0, 5);
+            }
+        }
+        public static int SyzygyIoThreads
+        {
+            get => syzygyIoThreads;
+            set
+            {
+                syzygyIoThreads = Math.Clamp(value, 0, MAX_SYZYGY_IO_THREADS);
+            }
+        }
+        public static int SyzygyNuma
+        {
+            get => syzygyNuma;
+            set
+            {
+                syzygyNuma = Math.Clamp(value, 0, 5);
+            }
+        }
         public static bool AnalyseMode { get; set; }
         public static int Threads 
         { 
@@ -71,6 +158,14 @@ namespace Pedantic.Chess
 
         private static int hash;
         private static int syzygyProbeDepth;
+        private static int syzygyCache;
+        private static int syzygyWarmup;
+        private static int syzygyWarmupBudget;
+        private static int syzygyMemory;
+        private static int syzygyHugePages;
+        private static int syzygyBitbases;
+        private static int syzygyIoThreads;
+        private static int syzygyNuma;
         private static int threads;
     }
 }
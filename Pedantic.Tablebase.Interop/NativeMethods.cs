@@ -0,0 +1,237 @@
+﻿// ***********************************************************************
+// Assembly         : Pedantic.Tablebase.Interop
+// Author           : JoAnn D. Peeler
+// Created          : 10-16-2026
+//
+// Last Modified By : JoAnn D. Peeler
+// Last Modified On : 10-16-2026
+// ***********************************************************************
+// <copyright file="NativeMethods.cs" company="Pedantic.Tablebase.Interop">
+//     Copyright (c) . All rights reserved.
+// </copyright>
+// <summary>
+//     Imports from the native prober library (libpedantictb) built by
+//     Pedantic.Tablebase/CMakeLists.txt. The probe functions called during
+//     search are bound once to unmanaged function pointers so that a probe
+//     costs no more than an indirect call.
+// </summary>
+// ***********************************************************************
+using System.Runtime.InteropServices;
+
+namespace Pedantic.Tablebase
+{
+    internal static unsafe partial class NativeMethods
+    {
+        public const string LIBRARY = "pedantictb";
+        public const int TB_MAX_MOVES = 192 + 1;
+        public const int TB_MAX_PLY = 256;
+        public const int TB_STATS_TIME_BUCKETS = 32;
+        public const int TB_STATS_DEPTHS = 8;
+        public const uint TB_RESULT_FAILED = 0xFFFFFFFF;
+        public const uint TB_RESULT_PENDING = 0xFFFFFFFE;
+        public const int TB_VALUE_MATE = 32000;
+
+        [StructLayout(LayoutKind.Sequential)]
+        public struct RootMove
+        {
+            public ushort move;
+            public fixed ushort pv[TB_MAX_PLY];
+            public uint pvSize;
+            public int tbScore, tbRank;
+        }
+
+        // struct TbRootMoves { unsigned size; struct TbRootMove moves[TB_MAX_MOVES]; }
+        // RootMove is 4-byte aligned, so the moves start right after the size.
+        public const int ROOT_MOVES_OFFSET = sizeof(uint);
+        public static readonly nuint ROOT_MOVES_SIZE = (nuint)(ROOT_MOVES_OFFSET + TB_MAX_MOVES * sizeof(RootMove));
+
+        [StructLayout(LayoutKind.Sequential)]
+        public struct WarmupStatus
+        {
+            public uint total;
+            public uint done;
+            public ulong bytes;
+            public byte running;
+            public byte cancelled;
+        }
+
+        [StructLayout(LayoutKind.Sequential)]
+        public struct TableStats
+        {
+            public fixed byte name[16];
+            public ulong key;
+            public fixed ulong probes[3];
+            public fixed ulong successes[3];
+            public fixed ulong failures[3];
+            public fixed ulong loads[3];
+            public fixed ulong decompress[TB_STATS_TIME_BUCKETS];
+            public fixed ulong depth[TB_STATS_DEPTHS];
+            public fixed ulong blockHits[3];
+            public fixed ulong blockMisses[3];
+        }
+
+        [StructLayout(LayoutKind.Sequential)]
+        public struct VerifyResult
+        {
+            public fixed byte name[16];
+            public uint status;
+            public uint checksummed;
+            public ulong bytes;
+            public ulong micros;
+        }
+
+        public static readonly delegate* unmanaged[Cdecl]<ulong, ulong, ulong, ulong, ulong, ulong, ulong, ulong, uint, byte, uint> ProbeWdl;
+        public static readonly delegate* unmanaged[Cdecl]<ulong, ulong, ulong, ulong, ulong, ulong, ulong, ulong, uint, byte, ulong, uint> ProbeWdlKey;
+        public static readonly delegate* unmanaged[Cdecl]<ulong, ulong, ulong, ulong, ulong, ulong, ulong, ulong, uint, byte, ulong, uint> ProbeWdlNonBlocking;
+        public static readonly delegate* unmanaged[Cdecl]<TbPosition*, uint*, nuint, nuint> ProbeWdlBatch;
+        public static readonly delegate* unmanaged[Cdecl]<ulong, ulong, ulong, ulong, ulong, ulong, ulong, ulong, uint, byte, void> Prefetch;
+        public static readonly delegate* unmanaged[Cdecl]<ulong, ulong, ulong, ulong, ulong, ulong, ulong, ulong, uint, byte, ulong, void> PrefetchKey;
+        public static readonly delegate* unmanaged[Cdecl]<nint, ulong, ulong, ulong, ulong, ulong, ulong, ulong, ulong, uint, byte, uint> ContextProbeWdl;
+        public static readonly uint* TbLargest;
+        public static readonly uint* TbLargestDtm;
+
+        static NativeMethods()
+        {
+            IntPtr library = NativeLibrary.Load(LIBRARY, typeof(NativeMethods).Assembly, null);
+            ProbeWdl = (delegate* unmanaged[Cdecl]<ulong, ulong, ulong, ulong, ulong, ulong, ulong, ulong, uint, byte, uint>)
+                NativeLibrary.GetExport(library, "tb_probe_wdl_impl");
+            ProbeWdlKey = (delegate* unmanaged[Cdecl]<ulong, ulong, ulong, ulong, ulong, ulong, ulong, ulong, uint, byte, ulong, uint>)
+                NativeLibrary.GetExport(library, "tb_probe_wdl_key_impl");
+            ProbeWdlNonBlocking = (delegate* unmanaged[Cdecl]<ulong, ulong, ulong, ulong, ulong, ulong, ulong, ulong, uint, byte, ulong, uint>)
+                NativeLibrary.GetExport(library, "tb_probe_wdl_nonblocking_impl");
+            ProbeWdlBatch = (delegate* unmanaged[Cdecl]<TbPosition*, uint*, nuint, nuint>)
+                NativeLibrary.GetExport(library, "tb_probe_wdl_batch");
+            Prefetch = (delegate* unmanaged[Cdecl]<ulong, ulong, ulong, ulong, ulong, ulong, ulong, ulong, uint, byte, void>)
+                NativeLibrary.GetExport(library, "tb_prefetch");
+            PrefetchKey = (delegate* unmanaged[Cdecl]<ulong, ulong, ulong, ulong, ulong, ulong, ulong, ulong, uint, byte, ulong, void>)
+                NativeLibrary.GetExport(library, "tb_prefetch_key");
+            ContextProbeWdl = (delegate* unmanaged[Cdecl]<nint, ulong, ulong, ulong, ulong, ulong, ulong, ulong, ulong, uint, byte, uint>)
+                NativeLibrary.GetExport(library, "tb_context_probe_wdl_impl");
+            TbLargest = (uint*)NativeLibrary.GetExport(library, "TB_LARGEST");
+            TbLargestDtm = (uint*)NativeLibrary.GetExport(library, "TB_LARGEST_DTM");
+        }
+
+        [LibraryImport(LIBRARY, StringMarshalling = StringMarshalling.Utf8)]
+        [return: MarshalAs(UnmanagedType.U1)]
+        public static partial bool tb_init(string path);
+
+        [LibraryImport(LIBRARY)]
+        public static partial void tb_free();
+
+        [LibraryImport(LIBRARY)]
+        public static partial ulong tb_material_key(ulong white, ulong black, ulong queens, ulong rooks,
+            ulong bishops, ulong knights, ulong pawns);
+
+        [LibraryImport(LIBRARY)]
+        [return: MarshalAs(UnmanagedType.U1)]
+        public static partial bool tb_set_wdl_cache(nuint sizeMb);
+
+        [LibraryImport(LIBRARY)]
+        public static partial void tb_clear_wdl_cache();
+
+        [LibraryImport(LIBRARY)]
+        [return: MarshalAs(UnmanagedType.U1)]
+        public static partial bool tb_warmup(uint pieces, nuint budgetMb);
+
+        [LibraryImport(LIBRARY)]
+        public static partial void tb_warmup_stop();
+
+        [LibraryImport(LIBRARY)]
+        public static partial void tb_warmup_status(WarmupStatus* status);
+
+        [LibraryImport(LIBRARY)]
+        public static partial void tb_init_info(TbInitInfo* info);
+
+        [LibraryImport(LIBRARY)]
+        public static partial void tb_set_residency_budget(nuint budgetMb);
+
+        [LibraryImport(LIBRARY)]
+        public static partial void tb_residency(TbResidency* residency);
+
+        [LibraryImport(LIBRARY)]
+        public static partial void tb_set_huge_pages(uint pieces, [MarshalAs(UnmanagedType.U1)] bool lockPages);
+
+        [LibraryImport(LIBRARY)]
+        public static partial void tb_set_bitbases(uint pieces, uint threads);
+
+        [LibraryImport(LIBRARY)]
+        public static partial uint tb_set_numa(uint pieces);
+
+        [LibraryImport(LIBRARY)]
+        public static partial void tb_numa_status(TbNumaStatus* status);
+
+        [LibraryImport(LIBRARY, StringMarshalling = StringMarshalling.Utf8)]
+        public static partial nuint tb_verify(string path, string? checksums, uint threads, VerifyResult* results, nuint size);
+
+        [LibraryImport(LIBRARY)]
+        [return: MarshalAs(UnmanagedType.U1)]
+        public static partial bool tb_set_io_threads(uint threads);
+
+        [LibraryImport(LIBRARY)]
+        public static partial void tb_io_status(TbIoStatus* status);
+
+        [LibraryImport(LIBRARY)]
+        public static partial nuint tb_get_stats(TableStats* stats, nuint size);
+
+        [LibraryImport(LIBRARY)]
+        public static partial void tb_reset_stats();
+
+        [LibraryImport(LIBRARY)]
+        [return: MarshalAs(UnmanagedType.U1)]
+        public static partial bool tb_stats_enabled();
+
+        [LibraryImport(LIBRARY)]
+        public static partial uint tb_probe_root_impl(ulong white, ulong black, ulong kings, ulong queens,
+            ulong rooks, ulong bishops, ulong knights, ulong pawns, uint rule50, uint ep,
+            [MarshalAs(UnmanagedType.U1)] bool turn, uint* results);
+
+        [LibraryImport(LIBRARY)]
+        public static partial int tb_probe_root_dtz(ulong white, ulong black, ulong kings, ulong queens,
+            ulong rooks, ulong bishops, ulong knights, ulong pawns, uint rule50, uint castling, uint ep,
+            [MarshalAs(UnmanagedType.U1)] bool turn, [MarshalAs(UnmanagedType.U1)] bool hasRepeated,
+            [MarshalAs(UnmanagedType.U1)] bool useRule50, void* results);
+
+        [LibraryImport(LIBRARY)]
+        public static partial int tb_probe_root_wdl(ulong white, ulong black, ulong kings, ulong queens,
+            ulong rooks, ulong bishops, ulong knights, ulong pawns, uint rule50, uint castling, uint ep,
+            [MarshalAs(UnmanagedType.U1)] bool turn, [MarshalAs(UnmanagedType.U1)] bool useRule50,
+            void* results);
+
+        [LibraryImport(LIBRARY)]
+        public static partial uint tb_probe_dtm_impl(ulong white, ulong black, ulong kings, ulong queens,
+            ulong rooks, ulong bishops, ulong knights, ulong pawns, uint ep,
+            [MarshalAs(UnmanagedType.U1)] bool turn, int* plies);
+
+        [LibraryImport(LIBRARY)]
+        public static partial int tb_probe_root_dtm(ulong white, ulong black, ulong kings, ulong queens,
+            ulong rooks, ulong bishops, ulong knights, ulong pawns, uint rule50, uint castling, uint ep,
+            [MarshalAs(UnmanagedType.U1)] bool turn, [MarshalAs(UnmanagedType.U1)] bool hasRepeated,
+            [MarshalAs(UnmanagedType.U1)] bool useRule50, void* results);
+
+        [LibraryImport(LIBRARY, StringMarshalling = StringMarshalling.Utf8)]
+        public static partial nint tb_context_create(string path);
+
+        [LibraryImport(LIBRARY)]
+        public static partial void tb_context_free(nint ctx);
+
+        [LibraryImport(LIBRARY)]
+        public static partial uint tb_context_largest(nint ctx);
+
+        [LibraryImport(LIBRARY)]
+        public static partial uint tb_context_probe_root_impl(nint ctx, ulong white, ulong black, ulong kings,
+            ulong queens, ulong rooks, ulong bishops, ulong knights, ulong pawns, uint rule50, uint ep,
+            [MarshalAs(UnmanagedType.U1)] bool turn, uint* results);
+
+        [LibraryImport(LIBRARY)]
+        public static partial int tb_context_probe_root_dtz(nint ctx, ulong white, ulong black, ulong kings,
+            ulong queens, ulong rooks, ulong bishops, ulong knights, ulong pawns, uint rule50, uint castling,
+            uint ep, [MarshalAs(UnmanagedType.U1)] bool turn, [MarshalAs(UnmanagedType.U1)] bool hasRepeated,
+            [MarshalAs(UnmanagedType.U1)] bool useRule50, void* results);
+
+        [LibraryImport(LIBRARY)]
+        public static partial int tb_context_probe_root_wdl(nint ctx, ulong white, ulong black, ulong kings,
+            ulong queens, ulong rooks, ulong bishops, ulong knights, ulong pawns, uint rule50, uint castling,
+            uint ep, [MarshalAs(UnmanagedType.U1)] bool turn, [MarshalAs(UnmanagedType.U1)] bool useRule50,
+            void* results);
+    }
+}
@@ -0,0 +1,1048 @@
+﻿// ***********************************************************************
+// Assembly         : Pedantic.Tablebase.Interop
+// Author           : JoAnn D. Peeler
+// Created          : 10-16-2026
+//
+// Last Modified By : JoAnn D. Peeler
+// Last Modified On : 10-16-2026
+// ***********************************************************************
+// <copyright file="Syzygy.cs" company="Pedantic.Tablebase.Interop">
+//     Copyright (c) . All rights reserved.
+// </copyright>
+// <summary>
+//     Syzygy tablebase access through the native prober library. This is
+//     the same surface as the C++/CLI Syzygy class in Pedantic.Tablebase
+//     and is used on platforms where that assembly is not available.
+// </summary>
+// ***********************************************************************
+using System.Runtime.InteropServices;
+
+namespace Pedantic.Tablebase
+{
+    public static unsafe class Syzygy
+    {
+        /// <summary>
+        /// Initialize the tablebase.
+        /// </summary>
+        /// <param name="path">The tablebase PATH string.</param>
+        /// <returns>
+        /// - true=success, false=failed. The <c>TbLargest</c> property will also
+        /// be initialized. If no tablebase files are found, then true is returned
+        /// and <c>TbLargest</c> is set to zero.
+        /// </returns>
+        /// <remarks>
+        ///     May be called again, with another path, while searches are probing. The new
+        ///     tables replace the old ones once they are found; probes already under way finish
+        ///     on the old tables, which are released when the last of them returns.
+        /// </remarks>
+        public static bool Initialize(string path)
+        {
+            initialized = NativeMethods.tb_init(path);
+            return initialized;
+        }
+
+        /// <summary>
+        /// Initialize the tablebase with a WDL result cache in front of the tables.
+        /// </summary>
+        /// <param name="path">The tablebase PATH string.</param>
+        /// <param name="cacheMb">
+        /// The size of the WDL result cache in megabytes. Zero disables the cache.
+        /// </param>
+        /// <returns>
+        /// - true=success, false=failed. Failing to allocate the cache is not an
+        /// error; the tablebase is then probed without one.
+        /// </returns>
+        /// <remarks>
+        ///     Safe to call while searches are probing: a cache of a new size replaces the old
+        ///     one, which is only freed once the probes using it are done.
+        /// </remarks>
+        public static bool Initialize(string path, int cacheMb)
+        {
+            NativeMethods.tb_set_wdl_cache((nuint)Math.Max(cacheMb, 0));
+            return Initialize(path);
+        }
+
+        /// <summary>
+        /// Clear the WDL result cache.
+        /// </summary>
+        public static void ClearCache()
+        {
+            NativeMethods.tb_clear_wdl_cache();
+        }
+
+        /// <summary>
+        /// Resize the WDL result cache without reloading the tables.
+        /// </summary>
+        /// <param name="cacheMb">
+        /// The size of the WDL result cache in megabytes. Zero disables the cache.
+        /// </param>
+        /// <returns>true=success, false=the cache could not be allocated and is disabled.</returns>
+        /// <remarks>
+        ///     Safe to call while searches are probing: the old cache is only freed once the
+        ///     probes using it are done.
+        /// </remarks>
+        public static bool SetCacheSize(int cacheMb)
+        {
+            return NativeMethods.tb_set_wdl_cache((nuint)Math.Max(cacheMb, 0));
+        }
+
+        /// <summary>
+        /// Load tables and fault them into memory on a background thread.
+        /// </summary>
+        /// <param name="pieces">Warm up the WDL and DTZ tables with at most this many pieces.</param>
+        /// <param name="budgetMb">
+        /// How many megabytes of compressed table data to fault in. Index and size tables
+        /// are always faulted in.
+        /// </param>
+        /// <returns>true=success, false=the warm-up thread could not be started.</returns>
+        public static bool Warmup(int pieces, int budgetMb)
+        {
+            return NativeMethods.tb_warmup((uint)Math.Max(pieces, 0), (nuint)Math.Max(budgetMb, 0));
+        }
+
+        /// <summary>
+        /// Stop a running warm-up.
+        /// </summary>
+        public static void StopWarmup()
+        {
+            NativeMethods.tb_warmup_stop();
+        }
+
+        /// <summary>
+        /// Progress of the last warm-up.
+        /// </summary>
+        public static TbWarmupStatus WarmupStatus
+        {
+            get
+            {
+                NativeMethods.WarmupStatus status;
+                NativeMethods.tb_warmup_status(&status);
+                return new TbWarmupStatus(status);
+            }
+        }
+
+        /// <summary>
+        /// The table files the last <c>Initialize</c> found, the directories it listed
+        /// to find them and how long it took.
+        /// </summary>
+        public static TbInitInfo InitInfo
+        {
+            get
+            {
+                TbInitInfo info;
+                NativeMethods.tb_init_info(&info);
+                return info;
+            }
+        }
+
+        /// <summary>
+        /// Limit the memory used by mapped tables. When the limit is exceeded the least
+        /// recently probed tables are unmapped and mapped again on demand.
+        /// </summary>
+        /// <param name="budgetMb">The budget in megabytes. Zero means no limit.</param>
+        public static void SetResidencyBudget(int budgetMb)
+        {
+            NativeMethods.tb_set_residency_budget((nuint)Math.Max(budgetMb, 0));
+        }
+
+        /// <summary>
+        /// Current residency of the mapped tables, including eviction and remap counts.
+        /// </summary>
+        public static TbResidency Residency
+        {
+            get
+            {
+                TbResidency residency;
+                NativeMethods.tb_residency(&residency);
+                return residency;
+            }
+        }
+
+        /// <summary>
+        /// Copy small WDL tables into huge-page backed memory when they are loaded, instead
+        /// of probing them through a file mapping. Call before <c>Initialize</c>.
+        /// </summary>
+        /// <param name="pieces">WDL tables with at most this many pieces are copied. Zero disables.</param>
+        /// <param name="lockPages">Also lock the copies in memory.</param>
+        public static void SetHugePages(int pieces, bool lockPages)
+        {
+            NativeMethods.tb_set_huge_pages((uint)Math.Max(pieces, 0), lockPages);
+        }
+
+        /// <summary>
+        /// Decompress small WDL tables into bitbases of 2 bits per position, using every core,
+        /// so that probing them needs no Huffman decode. Call before <c>Initialize</c>; the
+        /// memory taken is reported by <c>InitInfo</c>.
+        /// </summary>
+        /// <param name="pieces">WDL tables with at most this many pieces are expanded. Zero disables.</param>
+        public static void SetBitbases(int pieces)
+        {
+            NativeMethods.tb_set_bitbases((uint)Math.Max(pieces, 0), (uint)Environment.ProcessorCount);
+        }
+
+        /// <summary>
+        /// Keep a copy of small WDL tables on each NUMA node and probe the copy of the node
+        /// the calling thread runs on. Call before <c>Initialize</c>.
+        /// </summary>
+        /// <param name="pieces">WDL tables with at most this many pieces are copied. Zero disables.</param>
+        /// <returns>The number of NUMA nodes. With one node nothing is copied.</returns>
+        public static int SetNuma(int pieces)
+        {
+            return (int)NativeMethods.tb_set_numa((uint)Math.Max(pieces, 0));
+        }
+
+        /// <summary>
+        /// How many tables have a copy on each NUMA node and the memory the copies take.
+        /// </summary>
+        public static TbNumaStatus NumaStatus
+        {
+            get
+            {
+                TbNumaStatus status;
+                NativeMethods.tb_numa_status(&status);
+                return status;
+            }
+        }
+
+        /// <summary>
+        /// Check the table files under a path: every file is read through once, the header
+        /// and block tables are checked against the file and, for files on the checksum list,
+        /// the MD5 is compared. The tables loaded by <c>Initialize</c> are not touched.
+        /// </summary>
+        /// <param name="path">The tablebase path, as for <c>Initialize</c>.</param>
+        /// <param name="checksums">A file of MD5 checksums in the format of md5sum, or null.</param>
+        /// <param name="threads">The number of threads that read files, 0 for one per processor.</param>
+        /// <returns>The outcome for every table file found, then for every listed file that was not.</returns>
+        public static TbVerifyResult[] Verify(string path, string? checksums = null, int threads = 0)
+        {
+            uint numThreads = (uint)(threads > 0 ? threads : Environment.ProcessorCount);
+
+            // room for the complete 7-piece set, the files are read once more if there are more
+            NativeMethods.VerifyResult[] buffer = new NativeMethods.VerifyResult[4096];
+            int count = (int)Verify(path, checksums, numThreads, buffer);
+            if (count > buffer.Length)
+            {
+                buffer = new NativeMethods.VerifyResult[count];
+                count = Math.Min((int)Verify(path, checksums, numThreads, buffer), count);
+            }
+
+            TbVerifyResult[] results = new TbVerifyResult[count];
+            fixed (NativeMethods.VerifyResult* pBuffer = buffer)
+            {
+                for (int n = 0; n < count; n++)
+                {
+                    results[n] = new TbVerifyResult(&pBuffer[n]);
+                }
+            }
+            return results;
+        }
+
+        private static nuint Verify(string path, string? checksums, uint threads, NativeMethods.VerifyResult[] buffer)
+        {
+            fixed (NativeMethods.VerifyResult* pBuffer = buffer)
+            {
+                return NativeMethods.tb_verify(path, checksums, threads, pBuffer, (nuint)buffer.Length);
+            }
+        }
+
+        /// <summary>
+        /// Start or stop the threads that read the tables for <c>ProbeWdlNonBlocking</c>.
+        /// </summary>
+        /// <param name="threads">
+        ///     The number of threads, at most 16. Zero stops them, and <c>ProbeWdlNonBlocking</c>
+        ///     then blocks like <c>ProbeWdl</c>.
+        /// </param>
+        /// <returns>true=success, false=not all threads could be started.</returns>
+        public static bool SetIoThreads(int threads)
+        {
+            return NativeMethods.tb_set_io_threads((uint)Math.Max(threads, 0));
+        }
+
+        /// <summary>
+        /// How many non-blocking probes were left pending and how many positions the I/O
+        /// threads have read since.
+        /// </summary>
+        public static TbIoStatus IoStatus
+        {
+            get
+            {
+                TbIoStatus status;
+                NativeMethods.tb_io_status(&status);
+                return status;
+            }
+        }
+
+        /// <summary>
+        /// Get the probe statistics of every table that has been probed or loaded.
+        /// </summary>
+        /// <returns>
+        /// The statistics, or an empty array if the tablebase library was built without
+        /// <c>TB_STATS</c>.
+        /// </returns>
+        public static TbTableStatistics[] GetStatistics()
+        {
+            nuint count = NativeMethods.tb_get_stats(null, 0);
+            if (count == 0)
+            {
+                return Array.Empty<TbTableStatistics>();
+            }
+
+            // more tables may be probed while we copy
+            NativeMethods.TableStats[] buffer = new NativeMethods.TableStats[(int)count + 16];
+            fixed (NativeMethods.TableStats* pBuffer = buffer)
+            {
+                count = Math.Min(NativeMethods.tb_get_stats(pBuffer, (nuint)buffer.Length), (nuint)buffer.Length);
+                TbTableStatistics[] stats = new TbTableStatistics[(int)count];
+                for (int n = 0; n < stats.Length; n++)
+                {
+                    stats[n] = new TbTableStatistics(&pBuffer[n]);
+                }
+                return stats;
+            }
+        }
+
+        /// <summary>
+        /// Reset the probe statistics to zero.
+        /// </summary>
+        public static void ResetStatistics()
+        {
+            NativeMethods.tb_reset_stats();
+        }
+
+        /// <summary>
+        /// true if the tablebase library was built with <c>TB_STATS</c>.
+        /// </summary>
+        public static bool StatisticsEnabled => NativeMethods.tb_stats_enabled();
+
+        /// <summary>
+        /// Free any resources allocated by tb_init().
+        /// </summary>
+        public static void Uninitialize()
+        {
+            NativeMethods.tb_free();
+        }
+
+        /// <summary>
+        /// Probe the Win-Draw-Loss (WDL) table.
+        /// </summary>
+        /// <param name="white">The white piece bitboard</param>
+        /// <param name="black">The black piece bitboard</param>
+        /// <param name="kings">The kings bitboard</param>
+        /// <param name="queens">The queens bitboard</param>
+        /// <param name="rooks">The rooks bitboard</param>
+        /// <param name="bishops">The bishops bitboard</param>
+        /// <param name="knights">The knights bitboard</param>
+        /// <param name="pawns">The pawns bitboard</param>
+        /// <param name="rule50">The 50-move half-move clock.</param>
+        /// <param name="castling">The castling rights. Set to zero if no castling possible.</param>
+        /// <param name="ep">
+        ///     The en passant square (if exists). Set to zero if there is no en passant square.
+        /// </param>
+        /// <param name="wtm">
+        ///     White's turn to move flags. Set to true if it is the white pieces turn to move.
+        /// </param>
+        /// <returns>
+        /// Pedantic.Tablebase.TbResult - One of Wdl == { Loss, BlessedLoss, Draw, CursedWin, Win }, or
+        /// TbResult.Failure if the probe failed.
+        /// </returns>
+        /// <remarks>
+        ///     Engines should use this method during search. This method is thread-safe.
+        /// </remarks>
+        public static TbResult ProbeWdl(ulong white, ulong black, ulong kings, ulong queens, ulong rooks,
+            ulong bishops, ulong knights, ulong pawns, uint rule50, uint castling, uint ep, bool wtm)
+        {
+            TbResult tbResult;
+
+            if (castling != 0 || rule50 != 0)
+            {
+                tbResult.result = NativeMethods.TB_RESULT_FAILED;
+            }
+            else
+            {
+                tbResult.result = NativeMethods.ProbeWdl(white, black, kings, queens, rooks, bishops, knights,
+                    pawns, ep, wtm ? (byte)1 : (byte)0);
+            }
+            return tbResult;
+        }
+
+        /// <summary>
+        /// Probe the Win-Draw-Loss (WDL) table with a known material key.
+        /// </summary>
+        /// <param name="white">The white piece bitboard</param>
+        /// <param name="black">The black piece bitboard</param>
+        /// <param name="kings">The kings bitboard</param>
+        /// <param name="queens">The queens bitboard</param>
+        /// <param name="rooks">The rooks bitboard</param>
+        /// <param name="bishops">The bishops bitboard</param>
+        /// <param name="knights">The knights bitboard</param>
+        /// <param name="pawns">The pawns bitboard</param>
+        /// <param name="rule50">The 50-move half-move clock.</param>
+        /// <param name="castling">The castling rights. Set to zero if no castling possible.</param>
+        /// <param name="ep">
+        ///     The en passant square (if exists). Set to zero if there is no en passant square.
+        /// </param>
+        /// <param name="wtm">
+        ///     White's turn to move flags. Set to true if it is the white pieces turn to move.
+        /// </param>
+        /// <param name="materialKey">
+        ///     The material key of the position, as returned by <c>MaterialKey</c> or kept up
+        ///     to date incrementally by the caller.
+        /// </param>
+        /// <returns>As for the other <c>ProbeWdl</c> overload.</returns>
+        /// <remarks>
+        ///     Saves recomputing the key from the bitboards on every probe. A key that does
+        ///     not match the position gives wrong results. This method is thread-safe.
+        /// </remarks>
+        public static TbResult ProbeWdl(ulong white, ulong black, ulong kings, ulong queens, ulong rooks,
+            ulong bishops, ulong knights, ulong pawns, uint rule50, uint castling, uint ep, bool wtm,
+            ulong materialKey)
+        {
+            TbResult tbResult;
+
+            if (castling != 0 || rule50 != 0)
+            {
+                tbResult.result = NativeMethods.TB_RESULT_FAILED;
+            }
+            else
+            {
+                tbResult.result = NativeMethods.ProbeWdlKey(white, black, kings, queens, rooks, bishops, knights,
+                    pawns, ep, wtm ? (byte)1 : (byte)0, materialKey);
+            }
+            return tbResult;
+        }
+
+        /// <summary>
+        /// Probe the Win-Draw-Loss (WDL) table without waiting for the disk.
+        /// </summary>
+        /// <param name="white">The white piece bitboard</param>
+        /// <param name="black">The black piece bitboard</param>
+        /// <param name="kings">The kings bitboard</param>
+        /// <param name="queens">The queens bitboard</param>
+        /// <param name="rooks">The rooks bitboard</param>
+        /// <param name="bishops">The bishops bitboard</param>
+        /// <param name="knights">The knights bitboard</param>
+        /// <param name="pawns">The pawns bitboard</param>
+        /// <param name="rule50">The 50-move half-move clock.</param>
+        /// <param name="castling">The castling rights. Set to zero if no castling possible.</param>
+        /// <param name="ep">
+        ///     The en passant square (if exists). Set to zero if there is no en passant square.
+        /// </param>
+        /// <param name="wtm">
+        ///     White's turn to move flags. Set to true if it is the white pieces turn to move.
+        /// </param>
+        /// <param name="materialKey">
+        ///     The material key of the position, as returned by <c>MaterialKey</c> or kept up
+        ///     to date incrementally by the caller.
+        /// </param>
+        /// <returns>
+        ///     As for <c>ProbeWdl</c>, or TbResult.TbPending if the probe needs a table that is
+        ///     not mapped yet or a block that is not in memory.
+        /// </returns>
+        /// <remarks>
+        ///     A pending position is handed to the threads started by <c>SetIoThreads</c>, which
+        ///     read what it needs, so treat TbPending as a miss and probe again on the next
+        ///     visit. Without I/O threads this blocks like <c>ProbeWdl</c>. This method is
+        ///     thread-safe.
+        /// </remarks>
+        public static TbResult ProbeWdlNonBlocking(ulong white, ulong black, ulong kings, ulong queens,
+            ulong rooks, ulong bishops, ulong knights, ulong pawns, uint rule50, uint castling, uint ep,
+            bool wtm, ulong materialKey)
+        {
+            TbResult tbResult;
+
+            if (castling != 0 || rule50 != 0)
+            {
+                tbResult.result = NativeMethods.TB_RESULT_FAILED;
+            }
+            else
+            {
+                tbResult.result = NativeMethods.ProbeWdlNonBlocking(white, black, kings, queens, rooks, bishops,
+                    knights, pawns, ep, wtm ? (byte)1 : (byte)0, materialKey);
+            }
+            return tbResult;
+        }
+
+        /// <summary>
+        /// The material key of a position: the sum of a constant per piece, by color and
+        /// type, with kings counting zero.
+        /// </summary>
+        /// <param name="white">The white piece bitboard</param>
+        /// <param name="black">The black piece bitboard</param>
+        /// <param name="queens">The queens bitboard</param>
+        /// <param name="rooks">The rooks bitboard</param>
+        /// <param name="bishops">The bishops bitboard</param>
+        /// <param name="knights">The knights bitboard</param>
+        /// <param name="pawns">The pawns bitboard</param>
+        /// <returns>The key that <c>ProbeWdl</c> expects.</returns>
+        public static ulong MaterialKey(ulong white, ulong black, ulong queens, ulong rooks, ulong bishops,
+            ulong knights, ulong pawns)
+        {
+            return NativeMethods.tb_material_key(white, black, queens, rooks, bishops, knights, pawns);
+        }
+
+        /// <summary>
+        /// Start loading the memory that a later <c>ProbeWdl</c> of the same position will
+        /// touch, without probing.
+        /// </summary>
+        /// <param name="white">The white piece bitboard</param>
+        /// <param name="black">The black piece bitboard</param>
+        /// <param name="kings">The kings bitboard</param>
+        /// <param name="queens">The queens bitboard</param>
+        /// <param name="rooks">The rooks bitboard</param>
+        /// <param name="bishops">The bishops bitboard</param>
+        /// <param name="knights">The knights bitboard</param>
+        /// <param name="pawns">The pawns bitboard</param>
+        /// <param name="ep">
+        ///     The en passant square (if exists). Set to zero if there is no en passant square.
+        /// </param>
+        /// <param name="wtm">
+        ///     White's turn to move flags. Set to true if it is the white pieces turn to move.
+        /// </param>
+        /// <remarks>
+        ///     Call right after making a move so the cache misses overlap with the work done
+        ///     before the probe at the next node. Tables that are not loaded yet are left
+        ///     alone, so this never blocks. This method is thread-safe.
+        /// </remarks>
+        public static void Prefetch(ulong white, ulong black, ulong kings, ulong queens, ulong rooks,
+            ulong bishops, ulong knights, ulong pawns, uint ep, bool wtm)
+        {
+            NativeMethods.Prefetch(white, black, kings, queens, rooks, bishops, knights, pawns, ep,
+                wtm ? (byte)1 : (byte)0);
+        }
+
+        /// <summary>
+        /// Prefetch the memory a later <c>ProbeWdl</c> with a known material key will touch,
+        /// without probing.
+        /// </summary>
+        /// <param name="white">The white piece bitboard</param>
+        /// <param name="black">The black piece bitboard</param>
+        /// <param name="kings">The kings bitboard</param>
+        /// <param name="queens">The queens bitboard</param>
+        /// <param name="rooks">The rooks bitboard</param>
+        /// <param name="bishops">The bishops bitboard</param>
+        /// <param name="knights">The knights bitboard</param>
+        /// <param name="pawns">The pawns bitboard</param>
+        /// <param name="ep">
+        ///     The en passant square (if exists). Set to zero if there is no en passant square.
+        /// </param>
+        /// <param name="wtm">
+        ///     White's turn to move flags. Set to true if it is the white pieces turn to move.
+        /// </param>
+        /// <param name="materialKey">
+        ///     The material key of the position, as returned by <c>MaterialKey</c> or kept up
+        ///     to date incrementally by the caller.
+        /// </param>
+        /// <remarks>
+        ///     Saves recomputing the key from the bitboards. A key that does not match the
+        ///     position prefetches the wrong memory. This method is thread-safe.
+        /// </remarks>
+        public static void Prefetch(ulong white, ulong black, ulong kings, ulong queens, ulong rooks,
+            ulong bishops, ulong knights, ulong pawns, uint ep, bool wtm, ulong materialKey)
+        {
+            NativeMethods.PrefetchKey(white, black, kings, queens, rooks, bishops, knights, pawns, ep,
+                wtm ? (byte)1 : (byte)0, materialKey);
+        }
+
+        /// <summary>
+        /// Probe the Win-Draw-Loss (WDL) table for many positions in a single call.
+        /// </summary>
+        /// <param name="positions">The positions to probe.</param>
+        /// <param name="results">
+        ///     Receives one result per position, in the same order as <c>positions</c>. Must
+        ///     be at least as long as <c>positions</c>.
+        /// </param>
+        /// <returns>
+        ///     The number of successful probes. Each result is as returned by <c>ProbeWdl</c>.
+        /// </returns>
+        /// <remarks>
+        ///     Positions are grouped by material on the native side, so each table is looked up
+        ///     once per call rather than once per position. This method is thread-safe.
+        /// </remarks>
+        public static int ProbeWdlBatch(TbPosition[] positions, TbResult[] results)
+        {
+            return ProbeWdlBatch(positions, results, positions.Length);
+        }
+
+        /// <summary>
+        /// Probe the Win-Draw-Loss (WDL) table for the first <c>count</c> positions.
+        /// </summary>
+        /// <param name="positions">The positions to probe.</param>
+        /// <param name="results">Receives one result per position.</param>
+        /// <param name="count">The number of positions to probe.</param>
+        /// <returns>The number of successful probes.</returns>
+        public static int ProbeWdlBatch(TbPosition[] positions, TbResult[] results, int count)
+        {
+            if (count < 0 || count > positions.Length)
+            {
+                throw new ArgumentOutOfRangeException(nameof(count));
+            }
+            if (results.Length < count)
+            {
+                throw new ArgumentException("The results array is too small.", nameof(results));
+            }
+            if (count == 0)
+            {
+                return 0;
+            }
+
+            fixed (TbPosition* pPositions = positions)
+            fixed (TbResult* pResults = results)
+            {
+                return (int)NativeMethods.ProbeWdlBatch(pPositions, (uint*)pResults, (nuint)count);
+            }
+        }
+
+        /// <summary>
+        /// Probes the Distance-To-Zero (DTZ) table.
+        /// </summary>
+        /// <param name="white">The white piece bitboard</param>
+        /// <param name="black">The black piece bitboard</param>
+        /// <param name="kings">The kings bitboard</param>
+        /// <param name="queens">The queens bitboard</param>
+        /// <param name="rooks">The rooks bitboard</param>
+        /// <param name="bishops">The bishops bitboard</param>
+        /// <param name="knights">The knights bitboard</param>
+        /// <param name="pawns">The pawns bitboard</param>
+        /// <param name="rule50">The 50-move half-move clock.</param>
+        /// <param name="castling">The castling rights. Set to zero if no castling possible.</param>
+        /// <param name="ep">
+        ///     The en passant square (if exists). Set to zero if there is no en passant square.
+        /// </param>
+        /// <param name="wtm">
+        ///     White's turn to move flags. Set to true if it is the white pieces turn to move.
+        /// </param>
+        /// <param name="results">
+        ///     The results (OPTIONAL) - Receives a TbResult for each legal move, followed by
+        ///     TbResult.TbFailure if there is room. If alternative results are not desired
+        ///     then set results = null.
+        /// </param>
+        /// <returns>
+        ///     A TbResult value comprising the WDL value, the suggested move and the DTZ value,
+        ///     or TbResult.TbStalemate, TbResult.TbCheckmate or TbResult.TbFailure.
+        /// </returns>
+        /// <remarks>
+        ///     This method is thread-safe, so independent analyses may probe their roots
+        ///     concurrently.
+        /// </remarks>
+        public static TbResult ProbeRoot(ulong white, ulong black, ulong kings, ulong queens, ulong rooks,
+            ulong bishops, ulong knights, ulong pawns, uint rule50, uint castling, uint ep, bool wtm,
+            TbResult[]? results)
+        {
+            TbResult tbResult;
+
+            if (castling != 0)
+            {
+                tbResult.result = NativeMethods.TB_RESULT_FAILED;
+            }
+            else if (results == null)
+            {
+                tbResult.result = NativeMethods.tb_probe_root_impl(white, black, kings, queens, rooks, bishops,
+                    knights, pawns, rule50, ep, wtm, null);
+            }
+            else
+            {
+                uint* res = stackalloc uint[NativeMethods.TB_MAX_MOVES];
+                tbResult.result = NativeMethods.tb_probe_root_impl(white, black, kings, queens, rooks, bishops,
+                    knights, pawns, rule50, ep, wtm, res);
+                if (tbResult != TbResult.TbFailure)
+                {
+                    int n = 0;
+                    for (; n < results.Length && n < NativeMethods.TB_MAX_MOVES; n++)
+                    {
+                        results[n].result = res[n];
+                        if (res[n] == NativeMethods.TB_RESULT_FAILED)
+                        {
+                            break;
+                        }
+                    }
+                }
+            }
+            return tbResult;
+        }
+
+        /// <summary>
+        /// Use the DTZ tables to rank and score all root moves.
+        /// </summary>
+        /// <param name="white">The white piece bitboard</param>
+        /// <param name="black">The black piece bitboard</param>
+        /// <param name="kings">The kings bitboard</param>
+        /// <param name="queens">The queens bitboard</param>
+        /// <param name="rooks">The rooks bitboard</param>
+        /// <param name="bishops">The bishops bitboard</param>
+        /// <param name="knights">The knights bitboard</param>
+        /// <param name="pawns">The pawns bitboard</param>
+        /// <param name="rule50">The 50-move half-move clock.</param>
+        /// <param name="castling">The castling rights. Set to zero if no castling possible.</param>
+        /// <param name="ep">
+        ///     The en passant square (if exists). Set to zero if there is no en passant square.
+        /// </param>
+        /// <param name="wtm">
+        ///     White's turn to move flags. Set to true if it is the white pieces turn to move.
+        /// </param>
+        /// <param name="hasRepeated">
+        ///     If true indicates that the current position has already been repeated in the
+        ///     reversible lookback period.
+        /// </param>
+        /// <param name="useRule50">
+        ///     Helps to determine the border between winning and drawn positions.
+        /// </param>
+        /// <param name="rootMoves">
+        ///     If probe is success, this array will contain all of the legal root moves, their rank,
+        ///     score, and a predicted PV.
+        /// </param>
+        /// <returns>
+        ///     non-zero if ok, 0 means not all probes were successful
+        /// </returns>
+        public static int ProbeRootDtz(ulong white, ulong black, ulong kings, ulong queens, ulong rooks,
+            ulong bishops, ulong knights, ulong pawns, uint rule50, uint castling, uint ep, bool wtm,
+            bool hasRepeated, bool useRule50, ref TbRootMove[] rootMoves)
+        {
+            byte* pRootMoves = RootMovesScratch();
+            int result = NativeMethods.tb_probe_root_dtz(white, black, kings, queens, rooks, bishops, knights,
+                pawns, rule50, castling, ep, wtm, hasRepeated, useRule50, pRootMoves);
+            rootMoves = ToRootMoves(result, pRootMoves);
+            return result;
+        }
+
+        /// <summary>
+        /// Use the WDL tables to rank and score all root moves. This is a fallback for the
+        /// case that some or all DTZ tables are missing.
+        /// </summary>
+        /// <param name="white">The white piece bitboard</param>
+        /// <param name="black">The black piece bitboard</param>
+        /// <param name="kings">The kings bitboard</param>
+        /// <param name="queens">The queens bitboard</param>
+        /// <param name="rooks">The rooks bitboard</param>
+        /// <param name="bishops">The bishops bitboard</param>
+        /// <param name="knights">The knights bitboard</param>
+        /// <param name="pawns">The pawns bitboard</param>
+        /// <param name="rule50">The 50-move half-move clock.</param>
+        /// <param name="castling">The castling rights. Set to zero if no castling possible.</param>
+        /// <param name="ep">
+        ///     The en passant square (if exists). Set to zero if there is no en passant square.
+        /// </param>
+        /// <param name="wtm">
+        ///     White's turn to move flags. Set to true if it is the white pieces turn to move.
+        /// </param>
+        /// <param name="useRule50">
+        ///     Helps to determine the border between winning and drawn positions.
+        /// </param>
+        /// <param name="rootMoves">
+        ///     If probe is success, this array will contain all of the legal root moves, their rank,
+        ///     score, and a predicted PV.
+        /// </param>
+        /// <returns>
+        ///     non-zero if ok, 0 means not all probes were successful
+        /// </returns>
+        public static int ProbeRootWdl(ulong white, ulong black, ulong kings, ulong queens, ulong rooks,
+            ulong bishops, ulong knights, ulong pawns, uint rule50, uint castling, uint ep, bool wtm,
+            bool useRule50, ref TbRootMove[] rootMoves)
+        {
+            byte* pRootMoves = RootMovesScratch();
+            int result = NativeMethods.tb_probe_root_wdl(white, black, kings, queens, rooks, bishops, knights,
+                pawns, rule50, castling, ep, wtm, useRule50, pRootMoves);
+            rootMoves = ToRootMoves(result, pRootMoves);
+            return result;
+        }
+
+        /// <summary>
+        /// Use the DTZ tables to rank and score all root moves without allocating.
+        /// </summary>
+        /// <param name="white">The white piece bitboard</param>
+        /// <param name="black">The black piece bitboard</param>
+        /// <param name="kings">The kings bitboard</param>
+        /// <param name="queens">The queens bitboard</param>
+        /// <param name="rooks">The rooks bitboard</param>
+        /// <param name="bishops">The bishops bitboard</param>
+        /// <param name="knights">The knights bitboard</param>
+        /// <param name="pawns">The pawns bitboard</param>
+        /// <param name="rule50">The 50-move half-move clock.</param>
+        /// <param name="castling">The castling rights. Set to zero if no castling possible.</param>
+        /// <param name="ep">
+        ///     The en passant square (if exists). Set to zero if there is no en passant square.
+        /// </param>
+        /// <param name="wtm">
+        ///     White's turn to move flags. Set to true if it is the white pieces turn to move.
+        /// </param>
+        /// <param name="hasRepeated">
+        ///     If true indicates that the current position has already been repeated in the
+        ///     reversible lookback period.
+        /// </param>
+        /// <param name="useRule50">
+        ///     Helps to determine the border between winning and drawn positions.
+        /// </param>
+        /// <param name="rootMoves">
+        ///     Receives the legal root moves with their rank and score. Moves that do not fit
+        ///     are dropped; <c>TB_MAX_MOVES</c> (193) entries are always enough.
+        /// </param>
+        /// <param name="pv">
+        ///     Receives the predicted PVs of the root moves, one after the other. A PV that
+        ///     does not fit is truncated. May be empty if no PVs are wanted.
+        /// </param>
+        /// <param name="count">The number of entries written to <c>rootMoves</c>.</param>
+        /// <returns>
+        ///     non-zero if ok, 0 means not all probes were successful
+        /// </returns>
+        /// <remarks>
+        ///     The native results are kept in a per-thread scratch area, so once the buffers
+        ///     are allocated by the caller repeated calls do not allocate at all.
+        /// </remarks>
+        public static int ProbeRootDtz(ulong white, ulong black, ulong kings, ulong queens, ulong rooks,
+            ulong bishops, ulong knights, ulong pawns, uint rule50, uint castling, uint ep, bool wtm,
+            bool hasRepeated, bool useRule50, Span<TbRootMoveInfo> rootMoves, Span<TbMove> pv, out int count)
+        {
+            byte* pRootMoves = RootMovesScratch();
+            int result = NativeMethods.tb_probe_root_dtz(white, black, kings, queens, rooks, bishops, knights,
+                pawns, rule50, castling, ep, wtm, hasRepeated, useRule50, pRootMoves);
+            count = result != 0 ? CopyRootMoves(pRootMoves, rootMoves, pv) : 0;
+            return result;
+        }
+
+        /// <summary>
+        /// Use the DTZ tables to rank and score all root moves without allocating.
+        /// </summary>
+        /// <remarks>
+        ///     Same as the <c>Span</c> overload; <c>pv</c> may be null. This overload exists so that callers can be
+        ///     shared with the C++/CLI binding, which cannot take spans.
+        /// </remarks>
+        public static int ProbeRootDtz(ulong white, ulong black, ulong kings, ulong queens, ulong rooks,
+            ulong bishops, ulong knights, ulong pawns, uint rule50, uint castling, uint ep, bool wtm,
+            bool hasRepeated, bool useRule50, TbRootMoveInfo[] rootMoves, TbMove[]? pv, out int count)
+        {
+            return ProbeRootDtz(white, black, kings, queens, rooks, bishops, knights, pawns, rule50, castling,
+                ep, wtm, hasRepeated, useRule50, rootMoves.AsSpan(), pv.AsSpan(), out count);
+        }
+
+        /// <summary>
+        /// Use the WDL tables to rank and score all root moves without allocating. This is
+        /// a fallback for the case that some or all DTZ tables are missing.
+        /// </summary>
+        /// <param name="white">The white piece bitboard</param>
+        /// <param name="black">The black piece bitboard</param>
+        /// <param name="kings">The kings bitboard</param>
+        /// <param name="queens">The queens bitboard</param>
+        /// <param name="rooks">The rooks bitboard</param>
+        /// <param name="bishops">The bishops bitboard</param>
+        /// <param name="knights">The knights bitboard</param>
+        /// <param name="pawns">The pawns bitboard</param>
+        /// <param name="rule50">The 50-move half-move clock.</param>
+        /// <param name="castling">The castling rights. Set to zero if no castling possible.</param>
+        /// <param name="ep">
+        ///     The en passant square (if exists). Set to zero if there is no en passant square.
+        /// </param>
+        /// <param name="wtm">
+        ///     White's turn to move flags. Set to true if it is the white pieces turn to move.
+        /// </param>
+        /// <param name="useRule50">
+        ///     Helps to determine the border between winning and drawn positions.
+        /// </param>
+        /// <param name="rootMoves">Receives the legal root moves with their rank and score.</param>
+        /// <param name="pv">Receives the predicted PVs of the root moves. May be empty.</param>
+        /// <param name="count">The number of entries written to <c>rootMoves</c>.</param>
+        /// <returns>
+        ///     non-zero if ok, 0 means not all probes were successful
+        /// </returns>
+        public static int ProbeRootWdl(ulong white, ulong black, ulong kings, ulong queens, ulong rooks,
+            ulong bishops, ulong knights, ulong pawns, uint rule50, uint castling, uint ep, bool wtm,
+            bool useRule50, Span<TbRootMoveInfo> rootMoves, Span<TbMove> pv, out int count)
+        {
+            byte* pRootMoves = RootMovesScratch();
+            int result = NativeMethods.tb_probe_root_wdl(white, black, kings, queens, rooks, bishops, knights,
+                pawns, rule50, castling, ep, wtm, useRule50, pRootMoves);
+            count = result != 0 ? CopyRootMoves(pRootMoves, rootMoves, pv) : 0;
+            return result;
+        }
+
+        /// <summary>
+        /// Use the WDL tables to rank and score all root moves without allocating.
+        /// </summary>
+        /// <remarks>
+        ///     Same as the <c>Span</c> overload; <c>pv</c> may be null. This overload exists so that callers can be
+        ///     shared with the C++/CLI binding, which cannot take spans.
+        /// </remarks>
+        public static int ProbeRootWdl(ulong white, ulong black, ulong kings, ulong queens, ulong rooks,
+            ulong bishops, ulong knights, ulong pawns, uint rule50, uint castling, uint ep, bool wtm,
+            bool useRule50, TbRootMoveInfo[] rootMoves, TbMove[]? pv, out int count)
+        {
+            return ProbeRootWdl(white, black, kings, queens, rooks, bishops, knights, pawns, rule50, castling,
+                ep, wtm, useRule50, rootMoves.AsSpan(), pv.AsSpan(), out count);
+        }
+
+        /// <summary>
+        /// Probe the Distance-To-Mate (DTM) tables.
+        /// </summary>
+        /// <param name="white">The white piece bitboard</param>
+        /// <param name="black">The black piece bitboard</param>
+        /// <param name="kings">The kings bitboard</param>
+        /// <param name="queens">The queens bitboard</param>
+        /// <param name="rooks">The rooks bitboard</param>
+        /// <param name="bishops">The bishops bitboard</param>
+        /// <param name="knights">The knights bitboard</param>
+        /// <param name="pawns">The pawns bitboard</param>
+        /// <param name="rule50">The 50-move half-move clock. DTM does not depend on it.</param>
+        /// <param name="castling">The castling rights. Set to zero if no castling possible.</param>
+        /// <param name="ep">
+        ///     The en passant square (if exists). Set to zero if there is no en passant square.
+        /// </param>
+        /// <param name="wtm">
+        ///     White's turn to move flags. Set to true if it is the white pieces turn to move.
+        /// </param>
+        /// <param name="plies">
+        ///     Receives the number of plies to mate with best play: positive if the side to
+        ///     move mates, negative if it is mated, zero for a draw or a checkmate.
+        /// </param>
+        /// <returns>
+        /// The WDL value as <c>ProbeWdl</c> returns it for a zero 50-move clock, or
+        /// TbResult.TbFailure if a table that is needed is missing.
+        /// </returns>
+        /// <remarks>
+        ///     DTM ignores the 50-move rule, so the distance of a cursed win is to a mate
+        ///     that may not count. This method is thread-safe, but too slow for search.
+        /// </remarks>
+        public static TbResult ProbeDtm(ulong white, ulong black, ulong kings, ulong queens, ulong rooks,
+            ulong bishops, ulong knights, ulong pawns, uint rule50, uint castling, uint ep, bool wtm,
+            out int plies)
+        {
+            TbResult tbResult;
+            int nPlies = 0;
+
+            if (castling != 0)
+            {
+                tbResult.result = NativeMethods.TB_RESULT_FAILED;
+            }
+            else
+            {
+                tbResult.result = NativeMethods.tb_probe_dtm_impl(white, black, kings, queens, rooks, bishops,
+                    knights, pawns, ep, wtm, &nPlies);
+            }
+            plies = nPlies;
+            return tbResult;
+        }
+
+        /// <summary>
+        /// Use the DTM tables to rank and score all root moves by distance to mate.
+        /// </summary>
+        /// <param name="white">The white piece bitboard</param>
+        /// <param name="black">The black piece bitboard</param>
+        /// <param name="kings">The kings bitboard</param>
+        /// <param name="queens">The queens bitboard</param>
+        /// <param name="rooks">The rooks bitboard</param>
+        /// <param name="bishops">The bishops bitboard</param>
+        /// <param name="knights">The knights bitboard</param>
+        /// <param name="pawns">The pawns bitboard</param>
+        /// <param name="rule50">The 50-move half-move clock.</param>
+        /// <param name="castling">The castling rights. Set to zero if no castling possible.</param>
+        /// <param name="ep">
+        ///     The en passant square (if exists). Set to zero if there is no en passant square.
+        /// </param>
+        /// <param name="wtm">
+        ///     White's turn to move flags. Set to true if it is the white pieces turn to move.
+        /// </param>
+        /// <param name="hasRepeated">
+        ///     If true indicates that the current position has already been repeated in the
+        ///     reversible lookback period.
+        /// </param>
+        /// <param name="useRule50">
+        ///     Helps to determine the border between winning and drawn positions.
+        /// </param>
+        /// <param name="rootMoves">
+        ///     If probe is success, this array will contain all of the legal root moves. Winning
+        ///     and losing moves are scored <c>TbValueMate</c> - n and -<c>TbValueMate</c> + n for
+        ///     a mate in n plies, ranked by that score, and their PV runs up to the mate.
+        /// </param>
+        /// <returns>
+        ///     non-zero if ok, 0 means not all probes were successful
+        /// </returns>
+        public static int ProbeRootDtm(ulong white, ulong black, ulong kings, ulong queens, ulong rooks,
+            ulong bishops, ulong knights, ulong pawns, uint rule50, uint castling, uint ep, bool wtm,
+            bool hasRepeated, bool useRule50, ref TbRootMove[] rootMoves)
+        {
+            byte* pRootMoves = RootMovesScratch();
+            int result = NativeMethods.tb_probe_root_dtm(white, black, kings, queens, rooks, bishops, knights,
+                pawns, rule50, castling, ep, wtm, hasRepeated, useRule50, pRootMoves);
+            rootMoves = ToRootMoves(result, pRootMoves);
+            return result;
+        }
+
+        /// <summary>
+        /// The tablebase can be probed for any position where #pieces &lt;= TbLargest.
+        /// </summary>
+        public static uint TbLargest => *NativeMethods.TbLargest;
+
+        /// <summary>
+        /// The DTM tables cover positions where #pieces &lt;= TbLargestDtm, zero if there are none.
+        /// </summary>
+        public static uint TbLargestDtm => *NativeMethods.TbLargestDtm;
+
+        /// <summary>
+        /// The score of a mate in zero plies in the DTM root move scores.
+        /// </summary>
+        public const int TbValueMate = NativeMethods.TB_VALUE_MATE;
+
+        public static bool IsInitialized => initialized;
+
+        internal static byte* RootMovesScratch()
+        {
+            // TbRootMoves is about 100 KB, too big to put on the stack or to allocate per call.
+            // Each thread gets its own, so concurrent root probes never share one, and it is
+            // freed once the thread has exited and the buffer is collected.
+            if (rootMovesScratch == null)
+            {
+                rootMovesScratch = new RootMovesBuffer();
+            }
+            return rootMovesScratch.Pointer;
+        }
+
+        private sealed class RootMovesBuffer
+        {
+            public readonly byte* Pointer = (byte*)NativeMemory.Alloc(NativeMethods.ROOT_MOVES_SIZE);
+
+            ~RootMovesBuffer()
+            {
+                NativeMemory.Free(Pointer);
+            }
+        }
+
+        internal static int CopyRootMoves(byte* pRootMoves, Span<TbRootMoveInfo> rootMoves, Span<TbMove> pv)
+        {
+            int count = Math.Min((int)*(uint*)pRootMoves, rootMoves.Length);
+            NativeMethods.RootMove* pMoves = (NativeMethods.RootMove*)(pRootMoves + NativeMethods.ROOT_MOVES_OFFSET);
+            int pvStart = 0;
+            for (int n = 0; n < count; n++)
+            {
+                NativeMethods.RootMove* rm = &pMoves[n];
+                int pvLength = Math.Min((int)rm->pvSize, pv.Length - pvStart);
+                rootMoves[n].move.move = rm->move;
+                rootMoves[n].tbScore = rm->tbScore;
+                rootMoves[n].tbRank = rm->tbRank;
+                rootMoves[n].pvStart = pvStart;
+                rootMoves[n].pvLength = pvLength;
+                new ReadOnlySpan<TbMove>(rm->pv, pvLength).CopyTo(pv.Slice(pvStart));
+                pvStart += pvLength;
+            }
+            return count;
+        }
+
+        internal static TbRootMove[] ToRootMoves(int result, byte* pRootMoves)
+        {
+            if (result == 0)
+            {
+                return Array.Empty<TbRootMove>();
+            }
+
+            uint size = *(uint*)pRootMoves;
+            NativeMethods.RootMove* pMoves = (NativeMethods.RootMove*)(pRootMoves + NativeMethods.ROOT_MOVES_OFFSET);
+            TbRootMove[] rootMoves = new TbRootMove[size];
+            for (int n = 0; n < rootMoves.Length; n++)
+            {
+                rootMoves[n] = new TbRootMove(&pMoves[n]);
+            }
+            return rootMoves;
+        }
+
+        private static bool initialized = false;
+
+        [ThreadStatic]
+        private static RootMovesBuffer? rootMovesScratch;
+    }
+}
@@ -0,0 +1,242 @@
+﻿// ***********************************************************************
+// Assembly         : Pedantic.Tablebase.Interop
+// Author           : JoAnn D. Peeler
+// Created          : 10-16-2026
+//
+// Last Modified By : JoAnn D. Peeler
+// Last Modified On : 10-16-2026
+// ***********************************************************************
+// <copyright file="SyzygyContext.cs" company="Pedantic.Tablebase.Interop">
+//     Copyright (c) . All rights reserved.
+// </copyright>
+// <summary>
+//     An independent set of tablebase files with its own native context.
+//     This is the same surface as the C++/CLI SyzygyContext class in
+//     Pedantic.Tablebase.
+// </summary>
+// ***********************************************************************
+namespace Pedantic.Tablebase
+{
+    /// <summary>
+    /// An independent set of tablebase files, probed without touching the tables of
+    /// <c>Syzygy</c> or of any other context. Contexts that find the same file share
+    /// one mapping of it.
+    /// </summary>
+    /// <remarks>
+    ///     The probe methods are thread-safe and behave like their <c>Syzygy</c>
+    ///     counterparts. The WDL cache, the residency budget, the huge page and the bitbase
+    ///     settings of <c>Syzygy</c> apply to every context. A context must not be disposed
+    ///     while it is being probed.
+    /// </remarks>
+    public sealed unsafe class SyzygyContext : IDisposable
+    {
+        /// <summary>
+        /// Find the tablebase files of a new context.
+        /// </summary>
+        /// <param name="path">The tablebase PATH string.</param>
+        /// <remarks>
+        ///     If no tablebase files are found the context is still created, with
+        ///     <c>TbLargest</c> set to zero.
+        /// </remarks>
+        public SyzygyContext(string path)
+        {
+            ctx = NativeMethods.tb_context_create(path);
+            if (ctx == 0)
+            {
+                throw new OutOfMemoryException();
+            }
+        }
+
+        ~SyzygyContext()
+        {
+            Free();
+        }
+
+        public void Dispose()
+        {
+            Free();
+            GC.SuppressFinalize(this);
+        }
+
+        /// <summary>
+        /// The context can be probed for any position where #pieces &lt;= TbLargest.
+        /// </summary>
+        public uint TbLargest
+        {
+            get
+            {
+                uint largest = NativeMethods.tb_context_largest(Context);
+                GC.KeepAlive(this);
+                return largest;
+            }
+        }
+
+        /// <summary>
+        /// Probe the Win-Draw-Loss (WDL) table of this context. See <c>Syzygy.ProbeWdl</c>.
+        /// </summary>
+        public TbResult ProbeWdl(ulong white, ulong black, ulong kings, ulong queens, ulong rooks,
+            ulong bishops, ulong knights, ulong pawns, uint rule50, uint castling, uint ep, bool wtm)
+        {
+            TbResult tbResult;
+
+            if (castling != 0 || rule50 != 0)
+            {
+                tbResult.result = NativeMethods.TB_RESULT_FAILED;
+            }
+            else
+            {
+                tbResult.result = NativeMethods.ContextProbeWdl(Context, white, black, kings, queens, rooks,
+                    bishops, knights, pawns, ep, wtm ? (byte)1 : (byte)0);
+                GC.KeepAlive(this);
+            }
+            return tbResult;
+        }
+
+        /// <summary>
+        /// Probe the Distance-To-Zero (DTZ) table of this context. See <c>Syzygy.ProbeRoot</c>.
+        /// </summary>
+        public TbResult ProbeRoot(ulong white, ulong black, ulong kings, ulong queens, ulong rooks,
+            ulong bishops, ulong knights, ulong pawns, uint rule50, uint castling, uint ep, bool wtm,
+            TbResult[]? results)
+        {
+            TbResult tbResult;
+
+            if (castling != 0)
+            {
+                tbResult.result = NativeMethods.TB_RESULT_FAILED;
+                return tbResult;
+            }
+
+            uint* res = stackalloc uint[NativeMethods.TB_MAX_MOVES];
+            tbResult.result = NativeMethods.tb_context_probe_root_impl(Context, white, black, kings, queens,
+                rooks, bishops, knights, pawns, rule50, ep, wtm, results == null ? null : res);
+            GC.KeepAlive(this);
+            if (results != null && tbResult != TbResult.TbFailure)
+            {
+                for (int n = 0; n < results.Length && n < NativeMethods.TB_MAX_MOVES; n++)
+                {
+                    results[n].result = res[n];
+                    if (res[n] == NativeMethods.TB_RESULT_FAILED)
+                    {
+                        break;
+                    }
+                }
+            }
+            return tbResult;
+        }
+
+        /// <summary>
+        /// Use the DTZ tables of this context to rank and score all root moves. See
+        /// <c>Syzygy.ProbeRootDtz</c>.
+        /// </summary>
+        public int ProbeRootDtz(ulong white, ulong black, ulong kings, ulong queens, ulong rooks,
+            ulong bishops, ulong knights, ulong pawns, uint rule50, uint castling, uint ep, bool wtm,
+            bool hasRepeated, bool useRule50, ref TbRootMove[] rootMoves)
+        {
+            byte* pRootMoves = Syzygy.RootMovesScratch();
+            int result = NativeMethods.tb_context_probe_root_dtz(Context, white, black, kings, queens, rooks,
+                bishops, knights, pawns, rule50, castling, ep, wtm, hasRepeated, useRule50, pRootMoves);
+            GC.KeepAlive(this);
+            rootMoves = Syzygy.ToRootMoves(result, pRootMoves);
+            return result;
+        }
+
+        /// <summary>
+        /// Use the WDL tables of this context to rank and score all root moves. See
+        /// <c>Syzygy.ProbeRootWdl</c>.
+        /// </summary>
+        public int ProbeRootWdl(ulong white, ulong black, ulong kings, ulong queens, ulong rooks,
+            ulong bishops, ulong knights, ulong pawns, uint rule50, uint castling, uint ep, bool wtm,
+            bool useRule50, ref TbRootMove[] rootMoves)
+        {
+            byte* pRootMoves = Syzygy.RootMovesScratch();
+            int result = NativeMethods.tb_context_probe_root_wdl(Context, white, black, kings, queens, rooks,
+                bishops, knights, pawns, rule50, castling, ep, wtm, useRule50, pRootMoves);
+            GC.KeepAlive(this);
+            rootMoves = Syzygy.ToRootMoves(result, pRootMoves);
+            return result;
+        }
+
+        /// <summary>
+        /// Use the DTZ tables of this context to rank and score all root moves without
+        /// allocating. See <c>Syzygy.ProbeRootDtz</c>.
+        /// </summary>
+        public int ProbeRootDtz(ulong white, ulong black, ulong kings, ulong queens, ulong rooks,
+            ulong bishops, ulong knights, ulong pawns, uint rule50, uint castling, uint ep, bool wtm,
+            bool hasRepeated, bool useRule50, Span<TbRootMoveInfo> rootMoves, Span<TbMove> pv, out int count)
+        {
+            byte* pRootMoves = Syzygy.RootMovesScratch();
+            int result = NativeMethods.tb_context_probe_root_dtz(Context, white, black, kings, queens, rooks,
+                bishops, knights, pawns, rule50, castling, ep, wtm, hasRepeated, useRule50, pRootMoves);
+            GC.KeepAlive(this);
+            count = result != 0 ? Syzygy.CopyRootMoves(pRootMoves, rootMoves, pv) : 0;
+            return result;
+        }
+
+        /// <summary>
+        /// Use the DTZ tables of this context to rank and score all root moves without
+        /// allocating.
+        /// </summary>
+        /// <remarks>
+        ///     Same as the <c>Span</c> overload; <c>pv</c> may be null.
+        /// </remarks>
+        public int ProbeRootDtz(ulong white, ulong black, ulong kings, ulong queens, ulong rooks,
+            ulong bishops, ulong knights, ulong pawns, uint rule50, uint castling, uint ep, bool wtm,
+            bool hasRepeated, bool useRule50, TbRootMoveInfo[] rootMoves, TbMove[]? pv, out int count)
+        {
+            return ProbeRootDtz(white, black, kings, queens, rooks, bishops, knights, pawns, rule50, castling,
+                ep, wtm, hasRepeated, useRule50, rootMoves.AsSpan(), pv.AsSpan(), out count);
+        }
+
+        /// <summary>
+        /// Use the WDL tables of this context to rank and score all root moves without
+        /// allocating. See <c>Syzygy.ProbeRootWdl</c>.
+        /// </summary>
+        public int ProbeRootWdl(ulong white, ulong black, ulong kings, ulong queens, ulong rooks,
+            ulong bishops, ulong knights, ulong pawns, uint rule50, uint castling, uint ep, bool wtm,
+            bool useRule50, Span<TbRootMoveInfo> rootMoves, Span<TbMove> pv, out int count)
+        {
+            byte* pRootMoves = Syzygy.RootMovesScratch();
+            int result = NativeMethods.tb_context_probe_root_wdl(Context, white, black, kings, queens, rooks,
+                bishops, knights, pawns, rule50, castling, ep, wtm, useRule50, pRootMoves);
+            GC.KeepAlive(this);
+            count = result != 0 ? Syzygy.CopyRootMoves(pRootMoves, rootMoves, pv) : 0;
+            return result;
+        }
+
+        /// <summary>
+        /// Use the WDL tables of this context to rank and score all root moves without
+        /// allocating.
+        /// </summary>
+        /// <remarks>
+        ///     Same as the <c>Span</c> overload; <c>pv</c> may be null.
+        /// </remarks>
+        public int ProbeRootWdl(ulong white, ulong black, ulong kings, ulong queens, ulong rooks,
+            ulong bishops, ulong knights, ulong pawns, uint rule50, uint castling, uint ep, bool wtm,
+            bool useRule50, TbRootMoveInfo[] rootMoves, TbMove[]? pv, out int count)
+        {
+            return ProbeRootWdl(white, black, kings, queens, rooks, bishops, knights, pawns, rule50, castling,
+                ep, wtm, useRule50, rootMoves.AsSpan(), pv.AsSpan(), out count);
+        }
+
+        private nint Context
+        {
+            get
+            {
+                ObjectDisposedException.ThrowIf(ctx == 0, this);
+                return ctx;
+            }
+        }
+
+        private void Free()
+        {
+            if (ctx != 0)
+            {
+                NativeMethods.tb_context_free(ctx);
+                ctx = 0;
+            }
+        }
+
+        private nint ctx;
+    }
+}
@@ -0,0 +1,323 @@
+﻿// ***********************************************************************
+// Assembly         : Pedantic.Tablebase.Interop
+// Author           : JoAnn D. Peeler
+// Created          : 10-16-2026
+//
+// Last Modified By : JoAnn D. Peeler
+// Last Modified On : 10-16-2026
+// ***********************************************************************
+// <copyright file="TbTypes.cs" company="Pedantic.Tablebase.Interop">
+//     Copyright (c) . All rights reserved.
+// </copyright>
+// <summary>
+//     Value types of the Syzygy tablebase API. These mirror the types
+//     declared in Pedantic.Tablebase.h so that engine code compiles
+//     unchanged against either binding.
+// </summary>
+// ***********************************************************************
+using System.Runtime.InteropServices;
+
+namespace Pedantic.Tablebase
+{
+    public enum TbGameResult : sbyte
+    {
+        Loss = 0, BlessedLoss, Draw, CursedWin, Win
+    }
+
+    public enum TbPromotes : sbyte
+    {
+        None = 0, Queen, Rook, Bishop, Knight
+    }
+
+    public enum TbVerifyStatus : uint
+    {
+        Ok = 0, Unreadable, Magic, Header, Truncated, Blocks, Checksum
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    public struct TbResult : IEquatable<TbResult>
+    {
+        private const uint WDL_MASK = 0x0000000F;
+        private const uint TO_MASK = 0x000003F0;
+        private const uint FROM_MASK = 0x0000FC00;
+        private const uint PROMOTES_MASK = 0x00070000;
+        private const uint EP_MASK = 0x00080000;
+        private const uint DTZ_MASK = 0xFFF00000;
+        private const int WDL_SHIFT = 0;
+        private const int TO_SHIFT = 4;
+        private const int FROM_SHIFT = 10;
+        private const int PROMOTES_SHIFT = 16;
+        private const int EP_SHIFT = 19;
+        private const int DTZ_SHIFT = 20;
+
+        public uint result;
+
+        public TbGameResult Wdl
+        {
+            get => (TbGameResult)Get(WDL_MASK, WDL_SHIFT);
+            set => Set(WDL_MASK, WDL_SHIFT, (uint)value);
+        }
+
+        public uint From
+        {
+            get => Get(FROM_MASK, FROM_SHIFT);
+            set => Set(FROM_MASK, FROM_SHIFT, value);
+        }
+
+        public uint To
+        {
+            get => Get(TO_MASK, TO_SHIFT);
+            set => Set(TO_MASK, TO_SHIFT, value);
+        }
+
+        public uint Promotes
+        {
+            get => Get(PROMOTES_MASK, PROMOTES_SHIFT);
+            set => Set(PROMOTES_MASK, PROMOTES_SHIFT, value);
+        }
+
+        public bool Ep
+        {
+            get => Get(EP_MASK, EP_SHIFT) != 0;
+            set => Set(EP_MASK, EP_SHIFT, value ? 1u : 0u);
+        }
+
+        public uint Dtz
+        {
+            get => Get(DTZ_MASK, DTZ_SHIFT);
+            set => Set(DTZ_MASK, DTZ_SHIFT, value);
+        }
+
+        public static readonly TbResult TbCheckmate = new() { result = (uint)TbGameResult.Win << WDL_SHIFT };
+        public static readonly TbResult TbStalemate = new() { result = (uint)TbGameResult.Draw << WDL_SHIFT };
+        public static readonly TbResult TbFailure = new() { result = 0xFFFFFFFF };
+        public static readonly TbResult TbPending = new() { result = 0xFFFFFFFE };
+
+        public static bool operator ==(TbResult res1, TbResult res2) => res1.result == res2.result;
+        public static bool operator !=(TbResult res1, TbResult res2) => res1.result != res2.result;
+
+        public readonly bool Equals(TbResult other) => result == other.result;
+        public override readonly bool Equals(object? obj) => obj is TbResult other && Equals(other);
+        public override readonly int GetHashCode() => result.GetHashCode();
+
+        private readonly uint Get(uint mask, int shift) => (result & mask) >> shift;
+
+        private void Set(uint mask, int shift, uint value)
+        {
+            result = (result & ~mask) | ((value << shift) & mask);
+        }
+    }
+
+    [StructLayout(LayoutKind.Sequential)]
+    public struct TbMove
+    {
+        public ushort move;
+
+        public readonly ushort From => (ushort)((move >> 6) & 0x3F);
+        public readonly ushort To => (ushort)(move & 0x3F);
+        public readonly ushort Promotes => (ushort)((move >> 12) & 0x7);
+    }
+
+    public struct TbRootMove
+    {
+        public TbMove move;
+        public TbMove[] pv;
+        public int tbScore, tbRank;
+
+        internal unsafe TbRootMove(NativeMethods.RootMove* rm)
+        {
+            move.move = rm->move;
+            pv = new TbMove[rm->pvSize];
+            for (int n = 0; n < pv.Length; n++)
+            {
+                pv[n].move = rm->pv[n];
+            }
+            tbScore = rm->tbScore;
+            tbRank = rm->tbRank;
+        }
+    }
+
+    /// <summary>
+    /// A ranked root move for the allocation-free root probe methods. The predicted
+    /// PV is not stored here but in a caller-provided buffer, <c>pvLength</c> moves
+    /// starting at <c>pvStart</c>.
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    public struct TbRootMoveInfo
+    {
+        public TbMove move;
+        public int tbScore, tbRank;
+        public int pvStart, pvLength;
+    }
+
+    /// <summary>
+    /// A position for the batched probe methods. The layout matches the native
+    /// <c>TbPosition</c> struct so that arrays can be handed over without conversion.
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    public struct TbPosition
+    {
+        public ulong white;
+        public ulong black;
+        public ulong kings;
+        public ulong queens;
+        public ulong rooks;
+        public ulong bishops;
+        public ulong knights;
+        public ulong pawns;
+        public uint rule50;
+        public uint castling;
+        public uint ep;
+        public uint turn;
+
+        public TbPosition(ulong white, ulong black, ulong kings, ulong queens, ulong rooks, ulong bishops,
+            ulong knights, ulong pawns, uint rule50, uint castling, uint ep, bool wtm)
+        {
+            this.white = white;
+            this.black = black;
+            this.kings = kings;
+            this.queens = queens;
+            this.rooks = rooks;
+            this.bishops = bishops;
+            this.knights = knights;
+            this.pawns = pawns;
+            this.rule50 = rule50;
+            this.castling = castling;
+            this.ep = ep;
+            turn = wtm ? 1u : 0u;
+        }
+    }
+
+    /// <summary>
+    /// Progress of a warm-up started by <c>Syzygy.Warmup</c>.
+    /// </summary>
+    public struct TbWarmupStatus
+    {
+        public uint total;
+        public uint done;
+        public ulong bytes;
+        public bool running;
+        public bool cancelled;
+
+        internal TbWarmupStatus(in NativeMethods.WarmupStatus status)
+        {
+            total = status.total;
+            done = status.done;
+            bytes = status.bytes;
+            running = status.running != 0;
+            cancelled = status.cancelled != 0;
+        }
+    }
+
+    /// <summary>
+    /// What the last <c>Syzygy.Initialize</c> found, see <c>Syzygy.InitInfo</c>.
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    public struct TbInitInfo
+    {
+        public uint wdl;
+        public uint dtm;
+        public uint dtz;
+        public uint dirs;
+        public uint files;
+        public ulong micros;
+        public uint bitbases;
+        public ulong bitbaseBytes;
+    }
+
+    /// <summary>
+    /// Memory residency of the mapped tables, see <c>Syzygy.Residency</c>.
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    public struct TbResidency
+    {
+        public ulong budget;
+        public ulong resident;
+        public uint tables;
+        public ulong loads;
+        public ulong evictions;
+        public ulong remaps;
+    }
+
+    /// <summary>
+    /// Activity of the I/O threads of <c>Syzygy.ProbeWdlNonBlocking</c>, see
+    /// <c>Syzygy.IoStatus</c>.
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    public struct TbIoStatus
+    {
+        public uint threads;
+        public ulong pending;
+        public ulong reads;
+        public ulong dropped;
+    }
+
+    /// <summary>
+    /// The copies of small WDL tables kept on each NUMA node, see <c>Syzygy.NumaStatus</c>.
+    /// </summary>
+    [StructLayout(LayoutKind.Sequential)]
+    public struct TbNumaStatus
+    {
+        public uint nodes;
+        public uint tables;
+        public ulong bytes;
+    }
+
+    /// <summary>
+    /// Probe statistics for one table, see <c>Syzygy.GetStatistics</c>. Arrays indexed
+    /// by table type are in the order WDL, DTM, DTZ.
+    /// </summary>
+    public struct TbTableStatistics
+    {
+        public string name;
+        public ulong key;
+        public ulong[] probes;
+        public ulong[] successes;
+        public ulong[] failures;
+        public ulong[] loads;
+        public ulong[] decompress;
+        public ulong[] depth;
+        public ulong[] blockHits;
+        public ulong[] blockMisses;
+
+        internal unsafe TbTableStatistics(NativeMethods.TableStats* stats)
+        {
+            name = new string((sbyte*)stats->name);
+            key = stats->key;
+            probes = ToArray(stats->probes, 3);
+            successes = ToArray(stats->successes, 3);
+            failures = ToArray(stats->failures, 3);
+            loads = ToArray(stats->loads, 3);
+            decompress = ToArray(stats->decompress, NativeMethods.TB_STATS_TIME_BUCKETS);
+            depth = ToArray(stats->depth, NativeMethods.TB_STATS_DEPTHS);
+            blockHits = ToArray(stats->blockHits, 3);
+            blockMisses = ToArray(stats->blockMisses, 3);
+        }
+
+        private static unsafe ulong[] ToArray(ulong* values, int length)
+        {
+            return new ReadOnlySpan<ulong>(values, length).ToArray();
+        }
+    }
+
+    /// <summary>
+    /// The outcome of checking one table file, see <c>Syzygy.Verify</c>.
+    /// </summary>
+    public struct TbVerifyResult
+    {
+        public string name;
+        public TbVerifyStatus status;
+        public bool checksummed;
+        public ulong bytes;
+        public ulong micros;
+
+        internal unsafe TbVerifyResult(NativeMethods.VerifyResult* result)
+        {
+            name = new string((sbyte*)result->name);
+            status = (TbVerifyStatus)result->status;
+            checksummed = result->checksummed != 0;
+            bytes = result->bytes;
+            micros = result->micros;
+        }
+    }
+}
@@ -17,6 +17,11 @@ namespace Pedantic
             None = 0, Queen, Rook, Bishop, Knight
         };
 
+        public enum class TbVerifyStatus : System::UInt32
+        {
+            Ok = 0, Unreadable, Magic, Header, Truncated, Blocks, Checksum
+        };
+
         public value struct TbResult
         {
         public:
@@ -28,6 +33,7 @@ namespace Pedantic
                 TbCheckmate.result = TB_SET_WDL(0, static_cast<unsigned int>(TbGameResult::Win));
                 TbStalemate.result = TB_SET_WDL(0, static_cast<unsigned int>(TbGameResult::Draw));
                 TbFailure.result = TB_RESULT_FAILED;
+                TbPending.result = TB_RESULT_PENDING;
             }
 
             static bool operator == (TbResult res1, TbResult res2)
@@ -108,6 +114,7 @@ namespace Pedantic
             initonly static TbResult TbCheckmate;
             initonly static TbResult TbStalemate;
             initonly static TbResult TbFailure;
+            initonly static TbResult TbPending;
         };
 
         public value struct TbMove
@@ -160,6 +167,250 @@ namespace Pedantic
             }
         };
 
+        /// <summary>
+        /// A ranked root move for the allocation-free root probe methods. The predicted
+        /// PV is not stored here but in a caller-provided buffer, <c>pvLength</c> moves
+        /// starting at <c>pvStart</c>.
+        /// </summary>
+        [System::Runtime::InteropServices::StructLayout(System::Runtime::InteropServices::LayoutKind::Sequential)]
+        public value struct TbRootMoveInfo
+        {
+        public:
+            TbMove move;
+            int tbScore, tbRank;
+            int pvStart, pvLength;
+        };
+
+        /// <summary>
+        /// A position for the batched probe methods. The layout matches the native
+        /// <c>TbPosition</c> struct so that arrays can be handed over without conversion.
+        /// </summary>
+        [System::Runtime::InteropServices::StructLayout(System::Runtime::InteropServices::LayoutKind::Sequential)]
+        public value struct TbPosition
+        {
+        public:
+            unsigned long long white;
+            unsigned long long black;
+            unsigned long long kings;
+            unsigned long long queens;
+            unsigned long long rooks;
+            unsigned long long bishops;
+            unsigned long long knights;
+            unsigned long long pawns;
+            unsigned int rule50;
+            unsigned int castling;
+            unsigned int ep;
+            unsigned int turn;
+
+            TbPosition(
+                unsigned long long white,
+                unsigned long long black,
+                unsigned long long kings,
+                unsigned long long queens,
+                unsigned long long rooks,
+                unsigned long long bishops,
+                unsigned long long knights,
+                unsigned long long pawns,
+                unsigned int rule50,
+                unsigned int castling,
+                unsigned int ep,
+                bool wtm
+            )
+            {
+                this->white = white;
+                this->black = black;
+                this->kings = kings;
+                this->queens = queens;
+                this->rooks = rooks;
+                this->bishops = bishops;
+                this->knights = knights;
+                this->pawns = pawns;
+                this->rule50 = rule50;
+                this->castling = castling;
+                this->ep = ep;
+                this->turn = wtm ? 1 : 0;
+            }
+        };
+
+        /// <summary>
+        /// Progress of a warm-up started by <c>Syzygy::Warmup</c>.
+        /// </summary>
+        public value struct TbWarmupStatus
+        {
+        public:
+            unsigned int total;
+            unsigned int done;
+            unsigned long long bytes;
+            bool running;
+            bool cancelled;
+
+            TbWarmupStatus(const ::TbWarmupStatus& status)
+            {
+                total = status.total;
+                done = status.done;
+                bytes = status.bytes;
+                running = status.running;
+                cancelled = status.cancelled;
+            }
+        };
+
+        /// <summary>
+        /// What the last <c>Syzygy::Initialize</c> found, see <c>Syzygy::InitInfo</c>.
+        /// </summary>
+        public value struct TbInitInfo
+        {
+        public:
+            unsigned int wdl;
+            unsigned int dtm;
+            unsigned int dtz;
+            unsigned int dirs;
+            unsigned int files;
+            unsigned long long micros;
+            unsigned int bitbases;
+            unsigned long long bitbaseBytes;
+
+            TbInitInfo(const ::TbInitInfo& info)
+            {
+                wdl = info.wdl;
+                dtm = info.dtm;
+                dtz = info.dtz;
+                dirs = info.dirs;
+                files = info.files;
+                micros = info.micros;
+                bitbases = info.bitbases;
+                bitbaseBytes = info.bitbaseBytes;
+            }
+        };
+
+        /// <summary>
+        /// Activity of the I/O threads of <c>Syzygy::ProbeWdlNonBlocking</c>, see
+        /// <c>Syzygy::IoStatus</c>.
+        /// </summary>
+        public value struct TbIoStatus
+        {
+        public:
+            unsigned int threads;
+            unsigned long long pending;
+            unsigned long long reads;
+            unsigned long long dropped;
+
+            TbIoStatus(const ::TbIoStatus& status)
+            {
+                threads = status.threads;
+                pending = status.pending;
+                reads = status.reads;
+                dropped = status.dropped;
+            }
+        };
+
+        /// <summary>
+        /// The copies of small WDL tables kept on each NUMA node, see <c>Syzygy::NumaStatus</c>.
+        /// </summary>
+        public value struct TbNumaStatus
+        {
+        public:
+            unsigned int nodes;
+            unsigned int tables;
+            unsigned long long bytes;
+
+            TbNumaStatus(const ::TbNumaStatus& status)
+            {
+                nodes = status.nodes;
+                tables = status.tables;
+                bytes = status.bytes;
+            }
+        };
+
+        /// <summary>
+        /// The outcome of checking one table file, see <c>Syzygy::Verify</c>.
+        /// </summary>
+        public value struct TbVerifyResult
+        {
+        public:
+            String^ name;
+            TbVerifyStatus status;
+            bool checksummed;
+            unsigned long long bytes;
+            unsigned long long micros;
+
+            TbVerifyResult(const ::TbVerifyResult& result)
+            {
+                name = gcnew String(result.name);
+                status = static_cast<TbVerifyStatus>(result.status);
+                checksummed = result.checksummed != 0;
+                bytes = result.bytes;
+                micros = result.micros;
+            }
+        };
+
+        /// <summary>
+        /// Memory residency of the mapped tables, see <c>Syzygy::Residency</c>.
+        /// </summary>
+        public value struct TbResidency
+        {
+        public:
+            unsigned long long budget;
+            unsigned long long resident;
+            unsigned int tables;
+            unsigned long long loads;
+            unsigned long long evictions;
+            unsigned long long remaps;
+
+            TbResidency(const ::TbResidency& residency)
+            {
+                budget = residency.budget;
+                resident = residency.resident;
+                tables = residency.tables;
+                loads = residency.loads;
+                evictions = residency.evictions;
+                remaps = residency.remaps;
+            }
+        };
+
+        /// <summary>
+        /// Probe statistics for one table, see <c>Syzygy::GetStatistics</c>. Arrays indexed
+        /// by table type are in the order WDL, DTM, DTZ.
+        /// </summary>
+        public value struct TbTableStatistics
+        {
+        public:
+            String^ name;
+            unsigned long long key;
+            array<unsigned long long>^ probes;
+            array<unsigned long long>^ successes;
+            array<unsigned long long>^ failures;
+            array<unsigned long long>^ loads;
+            array<unsigned long long>^ decompress;
+            array<unsigned long long>^ depth;
+            array<unsigned long long>^ blockHits;
+            array<unsigned long long>^ blockMisses;
+
+            TbTableStatistics(const ::TbTableStats& stats)
+            {
+                name = gcnew String(stats.name);
+                key = stats.key;
+                probes = ToArray(stats.probes, 3);
+                successes = ToArray(stats.successes, 3);
+                failures = ToArray(stats.failures, 3);
+                loads = ToArray(stats.loads, 3);
+                decompress = ToArray(stats.decompress, TB_STATS_TIME_BUCKETS);
+                depth = ToArray(stats.depth, TB_STATS_DEPTHS);
+                blockHits = ToArray(stats.blockHits, 3);
+                blockMisses = ToArray(stats.blockMisses, 3);
+            }
+
+        private:
+            static array<unsigned long long>^ ToArray(const uint64_t* values, int length)
+            {
+                array<unsigned long long>^ result = gcnew array<unsigned long long>(length);
+                for (int n = 0; n < length; ++n)
+                {
+                    result[n] = values[n];
+                }
+                return result;
+            }
+        };
+
 	    public ref class Syzygy abstract sealed
 	    {
         public:
@@ -178,6 +429,11 @@ namespace Pedantic
             /// be initialized. If no tablebase files are found, then true is returned
             /// and <c>TbLargest</c> is set to zero.
             /// </returns>
+            /// <remarks>
+            ///     May be called again, with another path, while searches are probing. The new
+            ///     tables replace the old ones once they are found; probes already under way finish
+            ///     on the old tables, which are released when the last of them returns.
+            /// </remarks>
             static bool Initialize(String^ path)
             {
                 IntPtr p = System::Runtime::InteropServices::Marshal::StringToHGlobalAnsi(path);
@@ -187,6 +443,296 @@ namespace Pedantic
                 return _initialized;
             }
             
+            /// <summary>
+            /// Initialize the tablebase with a WDL result cache in front of the tables.
+            /// </summary>
+            /// <param name="path">The tablebase PATH string.</param>
+            /// <param name="cacheMb">
+            /// The size of the WDL result cache in megabytes. Zero disables the cache.
+            /// </param>
+            /// <returns>
+            /// - true=success, false=failed. Failing to allocate the cache is not an
+            /// error; the tablebase is then probed without one.
+            /// </returns>
+            /// <remarks>
+            ///     Safe to call while searches are probing: a cache of a new size replaces the old
+            ///     one, which is only freed once the probes using it are done.
+            /// </remarks>
+            static bool Initialize(String^ path, int cacheMb)
+            {
+                ::tb_set_wdl_cache(static_cast<size_t>(Math::Max(cacheMb, 0)));
+                return Initialize(path);
+            }
+
+            /// <summary>
+            /// Clear the WDL result cache.
+            /// </summary>
+            static void ClearCache()
+            {
+                ::tb_clear_wdl_cache();
+            }
+
+            /// <summary>
+            /// Resize the WDL result cache without reloading the tables.
+            /// </summary>
+            /// <param name="cacheMb">
+            /// The size of the WDL result cache in megabytes. Zero disables the cache.
+            /// </param>
+            /// <returns>true=success, false=the cache could not be allocated and is disabled.</returns>
+            /// <remarks>
+            ///     Safe to call while searches are probing: the old cache is only freed once the
+            ///     probes using it are done.
+            /// </remarks>
+            static bool SetCacheSize(int cacheMb)
+            {
+                return ::tb_set_wdl_cache(static_cast<size_t>(Math::Max(cacheMb, 0)));
+            }
+
+            /// <summary>
+            /// Load tables and fault them into memory on a background thread.
+            /// </summary>
+            /// <param name="pieces">Warm up the WDL and DTZ tables with at most this many pieces.</param>
+            /// <param name="budgetMb">
+            /// How many megabytes of compressed table data to fault in. Index and size tables
+            /// are always faulted in.
+            /// </param>
+            /// <returns>true=success, false=the warm-up thread could not be started.</returns>
+            /// <remarks>
+            /// The method returns immediately. Use <c>WarmupStatus</c> to follow the progress.
+            /// </remarks>
+            static bool Warmup(int pieces, int budgetMb)
+            {
+                return ::tb_warmup(static_cast<unsigned int>(Math::Max(pieces, 0)), 
+                    static_cast<size_t>(Math::Max(budgetMb, 0)));
+            }
+
+            /// <summary>
+            /// Stop a running warm-up.
+            /// </summary>
+            static void StopWarmup()
+            {
+                ::tb_warmup_stop();
+            }
+
+            /// <summary>
+            /// Progress of the last warm-up.
+            /// </summary>
+            static property TbWarmupStatus WarmupStatus
+            {
+                TbWarmupStatus get()
+                {
+                    ::TbWarmupStatus status;
+                    ::tb_warmup_status(&status);
+                    return TbWarmupStatus(status);
+                }
+            }
+
+            /// <summary>
+            /// The table files the last <c>Initialize</c> found, the directories it listed
+            /// to find them and how long it took.
+            /// </summary>
+            static property TbInitInfo InitInfo
+            {
+                TbInitInfo get()
+                {
+                    ::TbInitInfo info;
+                    ::tb_init_info(&info);
+                    return TbInitInfo(info);
+                }
+            }
+
+            /// <summary>
+            /// Limit the memory used by mapped tables. When the limit is exceeded the least
+            /// recently probed tables are unmapped and mapped again on demand.
+            /// </summary>
+            /// <param name="budgetMb">The budget in megabytes. Zero means no limit.</param>
+            static void SetResidencyBudget(int budgetMb)
+            {
+                ::tb_set_residency_budget(static_cast<size_t>(Math::Max(budgetMb, 0)));
+            }
+
+            /// <summary>
+            /// Current residency of the mapped tables, including eviction and remap counts.
+            /// </summary>
+            static property TbResidency Residency
+            {
+                TbResidency get()
+                {
+                    ::TbResidency residency;
+                    ::tb_residency(&residency);
+                    return TbResidency(residency);
+                }
+            }
+
+            /// <summary>
+            /// Copy small WDL tables into huge-page backed memory when they are loaded, instead
+            /// of probing them through a file mapping. Call before <c>Initialize</c>.
+            /// </summary>
+            /// <param name="pieces">WDL tables with at most this many pieces are copied. Zero disables.</param>
+            /// <param name="lockPages">Also lock the copies in memory.</param>
+            static void SetHugePages(int pieces, bool lockPages)
+            {
+                ::tb_set_huge_pages(static_cast<unsigned int>(Math::Max(pieces, 0)), lockPages);
+            }
+
+            /// <summary>
+            /// Decompress small WDL tables into bitbases of 2 bits per position, using every core,
+            /// so that probing them needs no Huffman decode. Call before <c>Initialize</c>; the
+            /// memory taken is reported by <c>InitInfo</c>.
+            /// </summary>
+            /// <param name="pieces">WDL tables with at most this many pieces are expanded. Zero disables.</param>
+            static void SetBitbases(int pieces)
+            {
+                ::tb_set_bitbases(static_cast<unsigned int>(Math::Max(pieces, 0)),
+                    static_cast<unsigned int>(Environment::ProcessorCount));
+            }
+
+            /// <summary>
+            /// Keep a copy of small WDL tables on each NUMA node and probe the copy of the node
+            /// the calling thread runs on. Call before <c>Initialize</c>.
+            /// </summary>
+            /// <param name="pieces">WDL tables with at most this many pieces are copied. Zero disables.</param>
+            /// <returns>The number of NUMA nodes. With one node nothing is copied.</returns>
+            static int SetNuma(int pieces)
+            {
+                return static_cast<int>(::tb_set_numa(static_cast<unsigned int>(Math::Max(pieces, 0))));
+            }
+
+            /// <summary>
+            /// How many tables have a copy on each NUMA node and the memory the copies take.
+            /// </summary>
+            static property TbNumaStatus NumaStatus
+            {
+                TbNumaStatus get()
+                {
+                    ::TbNumaStatus status;
+                    ::tb_numa_status(&status);
+                    return TbNumaStatus(status);
+                }
+            }
+
+            /// <summary>
+            /// Check the table files under a path: every file is read through once, the header
+            /// and block tables are checked against the file and, for files on the checksum list,
+            /// the MD5 is compared. The tables loaded by <c>Initialize</c> are not touched.
+            /// </summary>
+            /// <param name="path">The tablebase path, as for <c>Initialize</c>.</param>
+            /// <param name="checksums">A file of MD5 checksums in the format of md5sum, or nullptr.</param>
+            /// <param name="threads">The number of threads that read files, 0 for one per processor.</param>
+            /// <returns>The outcome for every table file found, then for every listed file that was not.</returns>
+            static array<TbVerifyResult>^ Verify(String^ path, String^ checksums, int threads)
+            {
+                IntPtr p = System::Runtime::InteropServices::Marshal::StringToHGlobalAnsi(path);
+                IntPtr c = checksums != nullptr ? System::Runtime::InteropServices::Marshal::StringToHGlobalAnsi(checksums) : IntPtr::Zero;
+                const char *pPath = static_cast<const char*>(p.ToPointer());
+                const char *pChecksums = static_cast<const char*>(c.ToPointer());
+                unsigned int numThreads = static_cast<unsigned int>(threads > 0 ? threads : Environment::ProcessorCount);
+
+                // room for the complete 7-piece set, the files are read once more if there are more
+                size_t size = 4096;
+                ::TbVerifyResult* pResults = new ::TbVerifyResult[size];
+                size_t count = ::tb_verify(pPath, pChecksums, numThreads, pResults, size);
+                if (count > size)
+                {
+                    delete[] pResults;
+                    size = count;
+                    pResults = new ::TbVerifyResult[size];
+                    count = Math::Min(::tb_verify(pPath, pChecksums, numThreads, pResults, size), size);
+                }
+                System::Runtime::InteropServices::Marshal::FreeHGlobal(p);
+                if (c != IntPtr::Zero)
+                {
+                    System::Runtime::InteropServices::Marshal::FreeHGlobal(c);
+                }
+
+                array<TbVerifyResult>^ results = gcnew array<TbVerifyResult>(static_cast<int>(count));
+                for (size_t n = 0; n < count; ++n)
+                {
+                    results[static_cast<int>(n)] = TbVerifyResult(pResults[n]);
+                }
+                delete[] pResults;
+                return results;
+            }
+
+            static array<TbVerifyResult>^ Verify(String^ path)
+            {
+                return Verify(path, nullptr, 0);
+            }
+
+            /// <summary>
+            /// Start or stop the threads that read the tables for <c>ProbeWdlNonBlocking</c>.
+            /// </summary>
+            /// <param name="threads">
+            ///     The number of threads, at most 16. Zero stops them, and <c>ProbeWdlNonBlocking</c>
+            ///     then blocks like <c>ProbeWdl</c>.
+            /// </param>
+            /// <returns>true=success, false=not all threads could be started.</returns>
+            static bool SetIoThreads(int threads)
+            {
+                return ::tb_set_io_threads(static_cast<unsigned int>(Math::Max(threads, 0)));
+            }
+
+            /// <summary>
+            /// How many non-blocking probes were left pending and how many positions the I/O
+            /// threads have read since.
+            /// </summary>
+            static property TbIoStatus IoStatus
+            {
+                TbIoStatus get()
+                {
+                    ::TbIoStatus status;
+                    ::tb_io_status(&status);
+                    return TbIoStatus(status);
+                }
+            }
+
+            /// <summary>
+            /// Get the probe statistics of every table that has been probed or loaded.
+            /// </summary>
+            /// <returns>
+            /// The statistics, or an empty array if the tablebase library was built without
+            /// <c>TB_STATS</c>.
+            /// </returns>
+            static array<TbTableStatistics>^ GetStatistics()
+            {
+                size_t count = ::tb_get_stats(nullptr, 0);
+                if (count == 0)
+                {
+                    return gcnew array<TbTableStatistics>(0);
+                }
+
+                // more tables may be probed while we copy
+                size_t size = count + 16;
+                ::TbTableStats* pStats = new ::TbTableStats[size];
+                count = Math::Min(::tb_get_stats(pStats, size), size);
+                array<TbTableStatistics>^ stats = gcnew array<TbTableStatistics>(static_cast<int>(count));
+                for (size_t n = 0; n < count; ++n)
+                {
+                    stats[static_cast<int>(n)] = TbTableStatistics(pStats[n]);
+                }
+                delete[] pStats;
+                return stats;
+            }
+
+            /// <summary>
+            /// Reset the probe statistics to zero.
+            /// </summary>
+            static void ResetStatistics()
+            {
+                ::tb_reset_stats();
+            }
+
+            /// <summary>
+            /// true if the tablebase library was built with <c>TB_STATS</c>.
+            /// </summary>
+            static property bool StatisticsEnabled
+            {
+                bool get()
+                {
+                    return ::tb_stats_enabled();
+                }
+            }
+
             /// <summary>
             /// Free any resources allocated by tb_init().
             /// </summary>
@@ -245,7 +791,7 @@ namespace Pedantic
             }
             
             /// <summary>
-            /// Probes the Distance-To-Zero (DTZ) table.
+            /// Probe the Win-Draw-Loss (WDL) table with a known material key.
             /// </summary>
             /// <param name="white">The white piece bitboard</param>
             /// <param name="black">The black piece bitboard</param>
@@ -263,44 +809,314 @@ namespace Pedantic
             /// <param name="wtm">
             ///     White's turn to move flags. Set to true if it is the white pieces turn to move.
             /// </param>
-            /// <param name="results">
-            ///     The results (OPTIONAL) - Alternative results, one for each
-            ///     possible legal moves. If alternative results are not desired then set results = null.
+            /// <param name="materialKey">
+            ///     The material key of the position, as returned by <c>MaterialKey</c> or kept up
+            ///     to date incrementally by the caller.
             /// </param>
-            /// <returns>
-            ///     A TbResult value comprising:
-            ///     <ol>
-            ///         <li>The WDL value</li>
-            ///         <li>The suggested move</li>
-            ///         <li>The DTZ value
-            ///     </ol>
-            ///     The suggested move is guaranteed to preserve the WDL value.
-            ///     
-            ///     Otherwise:
-            ///     <ol>
-            ///         <li>TbResult.Stalemate is returned if the position is in stalemate.</li>
-            ///         <li>TbResult.Checkmate is returned if the position is in checkmate.</li>
-            ///         <li>TbResult.Failure is returned if the probe failed.
-            ///     </ol>
-            /// 
-            ///     If results != null, then a TbResult for each legal move will be generated and
-            ///     stored in the results array.
-            /// </returns>
+            /// <returns>As for the other <c>ProbeWdl</c> overload.</returns>
             /// <remarks>
-            ///     NOTES:
-            ///     <ul>
-            ///         <li>
-            ///             Engines can use this method to probe at the root. This method should not 
-            ///             be used during search.
-            ///         </li>
+            ///     Saves recomputing the key from the bitboards on every probe. A key that does
+            ///     not match the position gives wrong results. This method is thread-safe.
+            /// </remarks>
+            static TbResult ProbeWdl(
+                unsigned long long white,
+                unsigned long long black,
+                unsigned long long kings,
+                unsigned long long queens,
+                unsigned long long rooks,
+                unsigned long long bishops,
+                unsigned long long knights,
+                unsigned long long pawns,
+                unsigned int rule50,
+                unsigned int castling,
+                unsigned int ep,
+                bool wtm,
+                unsigned long long materialKey
+            )
+            {
+                TbResult tbResult;
+
+                tbResult.result = ::tb_probe_wdl_key(
+                    white, black, kings, queens, rooks, bishops, knights, pawns, rule50, castling, ep, wtm,
+                    materialKey
+                );
+                return tbResult;
+            }
+
+            /// <summary>
+            /// Probe the Win-Draw-Loss (WDL) table without waiting for the disk.
+            /// </summary>
+            /// <param name="white">The white piece bitboard</param>
+            /// <param name="black">The black piece bitboard</param>
+            /// <param name="kings">The kings bitboard</param>
+            /// <param name="queens">The queens bitboard</param>
+            /// <param name="rooks">The rooks bitboard</param>
+            /// <param name="bishops">The bishops bitboard</param>
+            /// <param name="knights">The knights bitboard</param>
+            /// <param name="pawns">The pawns bitboard</param>
+            /// <param name="rule50">The 50-move half-move clock.</param>
+            /// <param name="castling">The castling rights. Set to zero if no castling possible.</param>
+            /// <param name="ep">
+            ///     The en passant square (if exists). Set to zero if there is no en passant square.
+            /// </param>
+            /// <param name="wtm">
+            ///     White's turn to move flags. Set to true if it is the white pieces turn to move.
+            /// </param>
+            /// <param name="materialKey">
+            ///     The material key of the position, as returned by <c>MaterialKey</c> or kept up
+            ///     to date incrementally by the caller.
+            /// </param>
+            /// <returns>
+            ///     As for <c>ProbeWdl</c>, or TbResult.TbPending if the probe needs a table that is
+            ///     not mapped yet or a block that is not in memory.
+            /// </returns>
+            /// <remarks>
+            ///     A pending position is handed to the threads started by <c>SetIoThreads</c>, which
+            ///     read what it needs, so treat TbPending as a miss and probe again on the next
+            ///     visit. Without I/O threads this blocks like <c>ProbeWdl</c>. This method is
+            ///     thread-safe.
+            /// </remarks>
+            static TbResult ProbeWdlNonBlocking(
+                unsigned long long white,
+                unsigned long long black,
+                unsigned long long kings,
+                unsigned long long queens,
+                unsigned long long rooks,
+                unsigned long long bishops,
+                unsigned long long knights,
+                unsigned long long pawns,
+                unsigned int rule50,
+                unsigned int castling,
+                unsigned int ep,
+                bool wtm,
+                unsigned long long materialKey
+            )
+            {
+                TbResult tbResult;
+
+                tbResult.result = ::tb_probe_wdl_nonblocking(
+                    white, black, kings, queens, rooks, bishops, knights, pawns, rule50, castling, ep, wtm,
+                    materialKey
+                );
+                return tbResult;
+            }
+
+            /// <summary>
+            /// The material key of a position: the sum of a constant per piece, by color and
+            /// type, with kings counting zero.
+            /// </summary>
+            /// <param name="white">The white piece bitboard</param>
+            /// <param name="black">The black piece bitboard</param>
+            /// <param name="queens">The queens bitboard</param>
+            /// <param name="rooks">The rooks bitboard</param>
+            /// <param name="bishops">The bishops bitboard</param>
+            /// <param name="knights">The knights bitboard</param>
+            /// <param name="pawns">The pawns bitboard</param>
+            /// <returns>The key that <c>ProbeWdl</c> expects.</returns>
+            static unsigned long long MaterialKey(
+                unsigned long long white,
+                unsigned long long black,
+                unsigned long long queens,
+                unsigned long long rooks,
+                unsigned long long bishops,
+                unsigned long long knights,
+                unsigned long long pawns
+            )
+            {
+                return ::tb_material_key(white, black, queens, rooks, bishops, knights, pawns);
+            }
+
+            /// <summary>
+            /// Start loading the memory that a later <c>ProbeWdl</c> of the same position will
+            /// touch, without probing.
+            /// </summary>
+            /// <param name="white">The white piece bitboard</param>
+            /// <param name="black">The black piece bitboard</param>
+            /// <param name="kings">The kings bitboard</param>
+            /// <param name="queens">The queens bitboard</param>
+            /// <param name="rooks">The rooks bitboard</param>
+            /// <param name="bishops">The bishops bitboard</param>
+            /// <param name="knights">The knights bitboard</param>
+            /// <param name="pawns">The pawns bitboard</param>
+            /// <param name="ep">
+            ///     The en passant square (if exists). Set to zero if there is no en passant square.
+            /// </param>
+            /// <param name="wtm">
+            ///     White's turn to move flags. Set to true if it is the white pieces turn to move.
+            /// </param>
+            /// <remarks>
+            ///     Call right after making a move so the cache misses overlap with the work done
+            ///     before the probe at the next node. Tables that are not loaded yet are left
+            ///     alone, so this never blocks. This method is thread-safe.
+            /// </remarks>
+            static void Prefetch(
+                unsigned long long white,
+                unsigned long long black,
+                unsigned long long kings,
+                unsigned long long queens,
+                unsigned long long rooks,
+                unsigned long long bishops,
+                unsigned long long knights,
+                unsigned long long pawns,
+                unsigned int ep,
+                bool wtm
+            )
+            {
+                ::tb_prefetch(white, black, kings, queens, rooks, bishops, knights, pawns, ep, wtm);
+            }
+
+            /// <summary>
+            /// Prefetch the memory a later <c>ProbeWdl</c> with a known material key will touch,
+            /// without probing.
+            /// </summary>
+            /// <param name="white">The white piece bitboard</param>
+            /// <param name="black">The black piece bitboard</param>
+            /// <param name="kings">The kings bitboard</param>
+            /// <param name="queens">The queens bitboard</param>
+            /// <param name="rooks">The rooks bitboard</param>
+            /// <param name="bishops">The bishops bitboard</param>
+            /// <param name="knights">The knights bitboard</param>
+            /// <param name="pawns">The pawns bitboard</param>
+            /// <param name="ep">
+            ///     The en passant square (if exists). Set to zero if there is no en passant square.
+            /// </param>
+            /// <param name="wtm">
+            ///     White's turn to move flags. Set to true if it is the white pieces turn to move.
+            /// </param>
+            /// <param name="materialKey">
+            ///     The material key of the position, as returned by <c>MaterialKey</c> or kept up
+            ///     to date incrementally by the caller.
+            /// </param>
+            /// <remarks>
+            ///     Saves recomputing the key from the bitboards. A key that does not match the
+            ///     position prefetches the wrong memory. This method is thread-safe.
+            /// </remarks>
+            static void Prefetch(
+                unsigned long long white,
+                unsigned long long black,
+                unsigned long long kings,
+                unsigned long long queens,
+                unsigned long long rooks,
+                unsigned long long bishops,
+                unsigned long long knights,
+                unsigned long long pawns,
+                unsigned int ep,
+                bool wtm,
+                unsigned long long materialKey
+            )
+            {
+                ::tb_prefetch_key(white, black, kings, queens, rooks, bishops, knights, pawns, ep, wtm,
+                    materialKey);
+            }
+
+            /// <summary>
+            /// Probe the Win-Draw-Loss (WDL) table for many positions in a single call.
+            /// </summary>
+            /// <param name="positions">The positions to probe.</param>
+            /// <param name="results">
+            ///     Receives one result per position, in the same order as <c>positions</c>. Must
+            ///     be at least as long as <c>positions</c>.
+            /// </param>
+            /// <returns>
+            ///     The number of successful probes. Each result is as returned by <c>ProbeWdl</c>.
+            /// </returns>
+            /// <remarks>
+            ///     Positions are grouped by material on the native side, so each table is looked up
+            ///     once per call rather than once per position. This method is thread-safe.
+            /// </remarks>
+            static int ProbeWdlBatch(array<TbPosition>^ positions, array<TbResult>^ results)
+            {
+                return ProbeWdlBatch(positions, results, positions->Length);
+            }
+
+            /// <summary>
+            /// Probe the Win-Draw-Loss (WDL) table for the first <c>count</c> positions.
+            /// </summary>
+            /// <param name="positions">The positions to probe.</param>
+            /// <param name="results">Receives one result per position.</param>
+            /// <param name="count">The number of positions to probe.</param>
+            /// <returns>The number of successful probes.</returns>
+            static int ProbeWdlBatch(array<TbPosition>^ positions, array<TbResult>^ results, int count)
+            {
+                if (count < 0 || count > positions->Length)
+                {
+                    throw gcnew ArgumentOutOfRangeException("count");
+                }
+                if (results->Length < count)
+                {
+                    throw gcnew ArgumentException("The results array is too small.", "results");
+                }
+                if (count == 0)
+                {
+                    return 0;
+                }
+
+                pin_ptr<TbPosition> pPositions = &positions[0];
+                pin_ptr<TbResult> pResults = &results[0];
+                return static_cast<int>(::tb_probe_wdl_batch(
+                    reinterpret_cast<const ::TbPosition*>(pPositions),
+                    reinterpret_cast<unsigned int*>(pResults),
+                    static_cast<size_t>(count)
+                ));
+            }
+
+            /// <summary>
+            /// Probes the Distance-To-Zero (DTZ) table.
+            /// </summary>
+            /// <param name="white">The white piece bitboard</param>
+            /// <param name="black">The black piece bitboard</param>
+            /// <param name="kings">The kings bitboard</param>
+            /// <param name="queens">The queens bitboard</param>
+            /// <param name="rooks">The rooks bitboard</param>
+            /// <param name="bishops">The bishops bitboard</param>
+            /// <param name="knights">The knights bitboard</param>
+            /// <param name="pawns">The pawns bitboard</param>
+            /// <param name="rule50">The 50-move half-move clock.</param>
+            /// <param name="castling">The castling rights. Set to zero if no castling possible.</param>
+            /// <param name="ep">
+            ///     The en passant square (if exists). Set to zero if there is no en passant square.
+            /// </param>
+            /// <param name="wtm">
+            ///     White's turn to move flags. Set to true if it is the white pieces turn to move.
+            /// </param>
+            /// <param name="results">
+            ///     The results (OPTIONAL) - Alternative results, one for each
+            ///     possible legal moves. If alternative results are not desired then set results = null.
+            /// </param>
+            /// <returns>
+            ///     A TbResult value comprising:
+            ///     <ol>
+            ///         <li>The WDL value</li>
+            ///         <li>The suggested move</li>
+            ///         <li>The DTZ value
+            ///     </ol>
+            ///     The suggested move is guaranteed to preserve the WDL value.
+            ///     
+            ///     Otherwise:
+            ///     <ol>
+            ///         <li>TbResult.Stalemate is returned if the position is in stalemate.</li>
+            ///         <li>TbResult.Checkmate is returned if the position is in checkmate.</li>
+            ///         <li>TbResult.Failure is returned if the probe failed.
+            ///     </ol>
+            /// 
+            ///     If results != null, then a TbResult for each legal move will be generated and
+            ///     stored in the results array.
+            /// </returns>
+            /// <remarks>
+            ///     NOTES:
+            ///     <ul>
+            ///         <li>
+            ///             Engines can use this method to probe at the root. This method should not 
+            ///             be used during search.
+            ///         </li>
             ///         <li>
             ///             DTZ tablebases can suggest unnatural moves, especially for losing positions.
             ///             Engines may prefer to traditional search combined with WDL move filtering
             ///             using the alternative results array.
             ///         </li>
             ///         <li>
-            ///             This method is NOT thread-safe. For engines this method should only be 
-            ///             called once at the root per search.
+            ///             This method is thread-safe, so independent analyses may probe their
+            ///             roots concurrently.
             ///         </li>
             ///     </ul>
             /// </remarks>
@@ -403,7 +1219,7 @@ namespace Pedantic
                 array<TbRootMove>^% rootMoves
             )
             {
-                ::TbRootMoves* pRootMoves = new ::TbRootMoves;
+                ::TbRootMoves* pRootMoves = RootMovesScratch();
                 int result = ::tb_probe_root_dtz(
                     white, black, kings, queens, rooks, bishops, knights, pawns, rule50, castling, ep, wtm, 
                     hasRepeated, useRule50, pRootMoves
@@ -422,7 +1238,6 @@ namespace Pedantic
                 {
                     rootMoves = gcnew array<TbRootMove>(0);
                 }
-                delete pRootMoves;
                 return result;
             }
             
@@ -473,7 +1288,7 @@ namespace Pedantic
                 array<TbRootMove>^% rootMoves
             )
             {
-                ::TbRootMoves* pRootMoves = new ::TbRootMoves;
+                ::TbRootMoves* pRootMoves = RootMovesScratch();
                 int result = ::tb_probe_root_wdl(
                     white, black, kings, queens, rooks, bishops, knights, pawns, rule50, castling, ep, wtm, 
                     useRule50, pRootMoves
@@ -492,31 +1307,632 @@ namespace Pedantic
                 {
                     rootMoves = gcnew array<TbRootMove>(0);
                 }
-                delete pRootMoves;
                 return result;
             }
-            
-            /// <summary>
-            /// The tablebase can be probed for any position where #pieces <= TbLargest.
-            /// </summary>
-            static property unsigned int TbLargest
-            {
-                unsigned int get()
-                {
-                    return TB_LARGEST;
-                }
-            }
 
-            static property bool IsInitialized
-            {
-                bool get()
-                {
-                    return _initialized;
-                }
-            }
 
-        private:
-            static bool _initialized;
-	    };
+            /// <summary>
+            /// Use the DTZ tables to rank and score all root moves without allocating.
+            /// </summary>
+            /// <param name="white">The white piece bitboard</param>
+            /// <param name="black">The black piece bitboard</param>
+            /// <param name="kings">The kings bitboard</param>
+            /// <param name="queens">The queens bitboard</param>
+            /// <param name="rooks">The rooks bitboard</param>
+            /// <param name="bishops">The bishops bitboard</param>
+            /// <param name="knights">The knights bitboard</param>
+            /// <param name="pawns">The pawns bitboard</param>
+            /// <param name="rule50">The 50-move half-move clock.</param>
+            /// <param name="castling">The castling rights. Set to zero if no castling possible.</param>
+            /// <param name="ep">
+            ///     The en passant square (if exists). Set to zero if there is no en passant square.
+            /// </param>
+            /// <param name="wtm">
+            ///     White's turn to move flags. Set to true if it is the white pieces turn to move.
+            /// </param>
+            /// <param name="hasRepeated">
+            ///     If true indicates that the current position has already been repeated in the 
+            ///     reversible lookback period.
+            /// </param>
+            /// <param name="useRule50">
+            ///     Helps to determine the border between winning and drawn positions.
+            /// </param>
+            /// <param name="rootMoves">
+            ///     Receives the legal root moves with their rank and score. Moves that do not fit
+            ///     are dropped; <c>TB_MAX_MOVES</c> (193) entries are always enough.
+            /// </param>
+            /// <param name="pv">
+            ///     Receives the predicted PVs of the root moves, one after the other. A PV that
+            ///     does not fit is truncated. May be null if no PVs are wanted.
+            /// </param>
+            /// <param name="count">The number of entries written to <c>rootMoves</c>.</param>
+            /// <returns>
+            ///     non-zero if ok, 0 means not all probes were successful
+            /// </returns>
+            /// <remarks>
+            ///     The native results are kept in a per-thread scratch area, so once the buffers
+            ///     are allocated by the caller repeated calls do not allocate at all.
+            /// </remarks>
+            static int ProbeRootDtz(
+                unsigned long long white,
+                unsigned long long black,
+                unsigned long long kings,
+                unsigned long long queens,
+                unsigned long long rooks,
+                unsigned long long bishops,
+                unsigned long long knights,
+                unsigned long long pawns,
+                unsigned int rule50,
+                unsigned int castling,
+                unsigned int ep,
+                bool wtm,
+                bool hasRepeated,
+                bool useRule50,
+                array<TbRootMoveInfo>^ rootMoves,
+                array<TbMove>^ pv,
+                [System::Runtime::InteropServices::Out] int% count
+            )
+            {
+                ::TbRootMoves* pRootMoves = RootMovesScratch();
+                int result = ::tb_probe_root_dtz(
+                    white, black, kings, queens, rooks, bishops, knights, pawns, rule50, castling, ep, wtm, 
+                    hasRepeated, useRule50, pRootMoves
+                );
+                count = result != 0 ? CopyRootMoves(pRootMoves, rootMoves, pv) : 0;
+                return result;
+            }
+
+            /// <summary>
+            /// Use the WDL tables to rank and score all root moves without allocating. This is
+            /// a fallback for the case that some or all DTZ tables are missing.
+            /// </summary>
+            /// <param name="white">The white piece bitboard</param>
+            /// <param name="black">The black piece bitboard</param>
+            /// <param name="kings">The kings bitboard</param>
+            /// <param name="queens">The queens bitboard</param>
+            /// <param name="rooks">The rooks bitboard</param>
+            /// <param name="bishops">The bishops bitboard</param>
+            /// <param name="knights">The knights bitboard</param>
+            /// <param name="pawns">The pawns bitboard</param>
+            /// <param name="rule50">The 50-move half-move clock.</param>
+            /// <param name="castling">The castling rights. Set to zero if no castling possible.</param>
+            /// <param name="ep">
+            ///     The en passant square (if exists). Set to zero if there is no en passant square.
+            /// </param>
+            /// <param name="wtm">
+            ///     White's turn to move flags. Set to true if it is the white pieces turn to move.
+            /// </param>
+            /// <param name="useRule50">
+            ///     Helps to determine the border between winning and drawn positions.
+            /// </param>
+            /// <param name="rootMoves">Receives the legal root moves with their rank and score.</param>
+            /// <param name="pv">Receives the predicted PVs of the root moves. May be null.</param>
+            /// <param name="count">The number of entries written to <c>rootMoves</c>.</param>
+            /// <returns>
+            ///     non-zero if ok, 0 means not all probes were successful
+            /// </returns>
+            static int ProbeRootWdl(
+                unsigned long long white,
+                unsigned long long black,
+                unsigned long long kings,
+                unsigned long long queens,
+                unsigned long long rooks,
+                unsigned long long bishops,
+                unsigned long long knights,
+                unsigned long long pawns,
+                unsigned int rule50,
+                unsigned int castling,
+                unsigned int ep,
+                bool wtm,
+                bool useRule50,
+                array<TbRootMoveInfo>^ rootMoves,
+                array<TbMove>^ pv,
+                [System::Runtime::InteropServices::Out] int% count
+            )
+            {
+                ::TbRootMoves* pRootMoves = RootMovesScratch();
+                int result = ::tb_probe_root_wdl(
+                    white, black, kings, queens, rooks, bishops, knights, pawns, rule50, castling, ep, wtm, 
+                    useRule50, pRootMoves
+                );
+                count = result != 0 ? CopyRootMoves(pRootMoves, rootMoves, pv) : 0;
+                return result;
+            }
+
+            /// <summary>
+            /// Probe the Distance-To-Mate (DTM) tables.
+            /// </summary>
+            /// <param name="white">The white piece bitboard</param>
+            /// <param name="black">The black piece bitboard</param>
+            /// <param name="kings">The kings bitboard</param>
+            /// <param name="queens">The queens bitboard</param>
+            /// <param name="rooks">The rooks bitboard</param>
+            /// <param name="bishops">The bishops bitboard</param>
+            /// <param name="knights">The knights bitboard</param>
+            /// <param name="pawns">The pawns bitboard</param>
+            /// <param name="rule50">The 50-move half-move clock. DTM does not depend on it.</param>
+            /// <param name="castling">The castling rights. Set to zero if no castling possible.</param>
+            /// <param name="ep">
+            ///     The en passant square (if exists). Set to zero if there is no en passant square.
+            /// </param>
+            /// <param name="wtm">
+            ///     White's turn to move flags. Set to true if it is the white pieces turn to move.
+            /// </param>
+            /// <param name="plies">
+            ///     Receives the number of plies to mate with best play: positive if the side to
+            ///     move mates, negative if it is mated, zero for a draw or a checkmate.
+            /// </param>
+            /// <returns>
+            /// The WDL value as <c>ProbeWdl</c> returns it for a zero 50-move clock, or
+            /// TbResult.TbFailure if a table that is needed is missing.
+            /// </returns>
+            /// <remarks>
+            ///     DTM ignores the 50-move rule, so the distance of a cursed win is to a mate
+            ///     that may not count. This method is thread-safe, but too slow for search.
+            /// </remarks>
+            static TbResult ProbeDtm(
+                unsigned long long white,
+                unsigned long long black,
+                unsigned long long kings,
+                unsigned long long queens,
+                unsigned long long rooks,
+                unsigned long long bishops,
+                unsigned long long knights,
+                unsigned long long pawns,
+                unsigned int rule50,
+                unsigned int castling,
+                unsigned int ep,
+                bool wtm,
+                [System::Runtime::InteropServices::Out] int% plies
+            )
+            {
+                TbResult tbResult;
+                int nPlies;
+
+                tbResult.result = ::tb_probe_dtm(
+                    white, black, kings, queens, rooks, bishops, knights, pawns, rule50, castling, ep, wtm, &nPlies
+                );
+                plies = nPlies;
+                return tbResult;
+            }
+
+            /// <summary>
+            /// Use the DTM tables to rank and score all root moves by distance to mate.
+            /// </summary>
+            /// <param name="white">The white piece bitboard</param>
+            /// <param name="black">The black piece bitboard</param>
+            /// <param name="kings">The kings bitboard</param>
+            /// <param name="queens">The queens bitboard</param>
+            /// <param name="rooks">The rooks bitboard</param>
+            /// <param name="bishops">The bishops bitboard</param>
+            /// <param name="knights">The knights bitboard</param>
+            /// <param name="pawns">The pawns bitboard</param>
+            /// <param name="rule50">The 50-move half-move clock.</param>
+            /// <param name="castling">The castling rights. Set to zero if no castling possible.</param>
+            /// <param name="ep">
+            ///     The en passant square (if exists). Set to zero if there is no en passant square.
+            /// </param>
+            /// <param name="wtm">
+            ///     White's turn to move flags. Set to true if it is the white pieces turn to move.
+            /// </param>
+            /// <param name="hasRepeated">
+            ///     If true indicates that the current position has already been repeated in the 
+            ///     reversible lookback period.
+            /// </param>
+            /// <param name="useRule50">
+            ///     Helps to determine the border between winning and drawn positions.
+            /// </param>
+            /// <param name="rootMoves">
+            ///     If probe is success, this array will contain all of the legal root moves. Winning
+            ///     and losing moves are scored <c>TbValueMate</c> - n and -<c>TbValueMate</c> + n for
+            ///     a mate in n plies, ranked by that score, and their PV runs up to the mate.
+            /// </param>
+            /// <returns>
+            ///     non-zero if ok, 0 means not all probes were successful
+            /// </returns>
+            static int ProbeRootDtm(
+                unsigned long long white,
+                unsigned long long black,
+                unsigned long long kings,
+                unsigned long long queens,
+                unsigned long long rooks,
+                unsigned long long bishops,
+                unsigned long long knights,
+                unsigned long long pawns,
+                unsigned int rule50,
+                unsigned int castling,
+                unsigned int ep,
+                bool wtm,
+                bool hasRepeated,
+                bool useRule50,
+                array<TbRootMove>^% rootMoves
+            )
+            {
+                ::TbRootMoves* pRootMoves = RootMovesScratch();
+                int result = ::tb_probe_root_dtm(
+                    white, black, kings, queens, rooks, bishops, knights, pawns, rule50, castling, ep, wtm, 
+                    hasRepeated, useRule50, pRootMoves
+                );
+                rootMoves = ToRootMoves(result, pRootMoves);
+                return result;
+            }
+
+            /// <summary>
+            /// The tablebase can be probed for any position where #pieces <= TbLargest.
+            /// </summary>
+            static property unsigned int TbLargest
+            {
+                unsigned int get()
+                {
+                    return TB_LARGEST;
+                }
+            }
+
+            /// <summary>
+            /// The DTM tables cover positions where #pieces <= TbLargestDtm, zero if there are none.
+            /// </summary>
+            static property unsigned int TbLargestDtm
+            {
+                unsigned int get()
+                {
+                    return TB_LARGEST_DTM;
+                }
+            }
+
+            /// <summary>
+            /// The score of a mate in zero plies in the DTM root move scores.
+            /// </summary>
+            literal int TbValueMate = TB_VALUE_MATE;
+
+            static property bool IsInitialized
+            {
+                bool get()
+                {
+                    return _initialized;
+                }
+            }
+
+        internal:
+            static ::TbRootMoves* RootMovesScratch()
+            {
+                // TbRootMoves is about 100 KB, too big to put on the stack or to allocate per call.
+                // Each thread gets its own, so concurrent root probes never share one, and it is
+                // freed once the thread has exited and the buffer is collected.
+                if (_rootMoves == nullptr)
+                {
+                    _rootMoves = gcnew RootMovesBuffer();
+                }
+                return _rootMoves->Moves;
+            }
+
+            static int CopyRootMoves(const ::TbRootMoves* pRootMoves, array<TbRootMoveInfo>^ rootMoves,
+                array<TbMove>^ pv)
+            {
+                int count = Math::Min(static_cast<int>(pRootMoves->size), rootMoves->Length);
+                int pvStart = 0;
+                for (int n = 0; n < count; ++n)
+                {
+                    const ::TbRootMove& rm = pRootMoves->moves[n];
+                    int pvLength = pv == nullptr ? 0 : Math::Min(static_cast<int>(rm.pvSize), pv->Length - pvStart);
+                    rootMoves[n].move.move = rm.move;
+                    rootMoves[n].tbScore = rm.tbScore;
+                    rootMoves[n].tbRank = rm.tbRank;
+                    rootMoves[n].pvStart = pvStart;
+                    rootMoves[n].pvLength = pvLength;
+                    for (int i = 0; i < pvLength; ++i)
+                    {
+                        pv[pvStart + i].move = rm.pv[i];
+                    }
+                    pvStart += pvLength;
+                }
+                return count;
+            }
+
+            static array<TbRootMove>^ ToRootMoves(int result, const ::TbRootMoves* pRootMoves)
+            {
+                if (result == 0)
+                {
+                    return gcnew array<TbRootMove>(0);
+                }
+
+                array<TbRootMove>^ rootMoves = gcnew array<TbRootMove>(pRootMoves->size);
+                for (unsigned int n = 0; n < pRootMoves->size; ++n)
+                {
+                    rootMoves[n] = TbRootMove(pRootMoves->moves[n]);
+                }
+                return rootMoves;
+            }
+
+        private:
+            ref class RootMovesBuffer sealed
+            {
+            public:
+                RootMovesBuffer() : Moves(new ::TbRootMoves) { }
+
+                ~RootMovesBuffer()
+                {
+                    this->!RootMovesBuffer();
+                }
+
+                !RootMovesBuffer()
+                {
+                    delete Moves;
+                    Moves = nullptr;
+                }
+
+                ::TbRootMoves* Moves;
+            };
+
+            static bool _initialized;
+
+            [ThreadStatic]
+            static RootMovesBuffer^ _rootMoves;
+	    };
+
+        /// <summary>
+        /// An independent set of tablebase files, probed without touching the tables of
+        /// <c>Syzygy</c> or of any other context. Contexts that find the same file share
+        /// one mapping of it.
+        /// </summary>
+        /// <remarks>
+        ///     The probe methods are thread-safe and behave like their <c>Syzygy</c>
+        ///     counterparts. The WDL cache, the residency budget, the huge page and the bitbase
+        ///     settings of <c>Syzygy</c> apply to every context. A context must not be disposed
+        ///     while it is being probed.
+        /// </remarks>
+        public ref class SyzygyContext sealed
+        {
+        public:
+            /// <summary>
+            /// Find the tablebase files of a new context.
+            /// </summary>
+            /// <param name="path">The tablebase PATH string.</param>
+            /// <remarks>
+            ///     If no tablebase files are found the context is still created, with
+            ///     <c>TbLargest</c> set to zero.
+            /// </remarks>
+            SyzygyContext(String^ path)
+            {
+                IntPtr p = System::Runtime::InteropServices::Marshal::StringToHGlobalAnsi(path);
+                _ctx = ::tb_context_create(static_cast<char*>(p.ToPointer()));
+                System::Runtime::InteropServices::Marshal::FreeHGlobal(p);
+                if (_ctx == nullptr)
+                {
+                    throw gcnew OutOfMemoryException();
+                }
+            }
+
+            ~SyzygyContext()
+            {
+                this->!SyzygyContext();
+            }
+
+            !SyzygyContext()
+            {
+                ::tb_context_free(_ctx);
+                _ctx = nullptr;
+            }
+
+            /// <summary>
+            /// The context can be probed for any position where #pieces <= TbLargest.
+            /// </summary>
+            property unsigned int TbLargest
+            {
+                unsigned int get()
+                {
+                    return ::tb_context_largest(Context());
+                }
+            }
+
+            /// <summary>
+            /// Probe the Win-Draw-Loss (WDL) table of this context. See <c>Syzygy::ProbeWdl</c>.
+            /// </summary>
+            TbResult ProbeWdl(
+                unsigned long long white,
+                unsigned long long black,
+                unsigned long long kings,
+                unsigned long long queens,
+                unsigned long long rooks,
+                unsigned long long bishops,
+                unsigned long long knights,
+                unsigned long long pawns,
+                unsigned int rule50,
+                unsigned int castling,
+                unsigned int ep,
+                bool wtm
+            )
+            {
+                TbResult tbResult;
+
+                tbResult.result = ::tb_context_probe_wdl(
+                    Context(), white, black, kings, queens, rooks, bishops, knights, pawns, rule50, castling, ep, wtm
+                );
+                GC::KeepAlive(this);
+                return tbResult;
+            }
+
+            /// <summary>
+            /// Probe the Distance-To-Zero (DTZ) table of this context. See <c>Syzygy::ProbeRoot</c>.
+            /// </summary>
+            TbResult ProbeRoot(
+                unsigned long long white,
+                unsigned long long black,
+                unsigned long long kings,
+                unsigned long long queens,
+                unsigned long long rooks,
+                unsigned long long bishops,
+                unsigned long long knights,
+                unsigned long long pawns,
+                unsigned int rule50,
+                unsigned int castling,
+                unsigned int ep,
+                bool wtm,
+                array<TbResult>^ results
+            )
+            {
+                unsigned int res[TB_MAX_MOVES];
+                TbResult tbResult;
+
+                tbResult.result = ::tb_context_probe_root(
+                    Context(), white, black, kings, queens, rooks, bishops, knights, pawns, rule50, castling, ep, wtm,
+                    results == nullptr ? __nullptr : res
+                );
+                GC::KeepAlive(this);
+                if (results != nullptr && tbResult != TbResult::TbFailure)
+                {
+                    for (int n = 0; n < results->Length && n < TB_MAX_MOVES; ++n)
+                    {
+                        results[n].result = res[n];
+                        if (res[n] == TB_RESULT_FAILED)
+                        {
+                            break;
+                        }
+                    }
+                }
+                return tbResult;
+            }
+
+            /// <summary>
+            /// Use the DTZ tables of this context to rank and score all root moves. See
+            /// <c>Syzygy::ProbeRootDtz</c>.
+            /// </summary>
+            int ProbeRootDtz(
+                unsigned long long white,
+                unsigned long long black,
+                unsigned long long kings,
+                unsigned long long queens,
+                unsigned long long rooks,
+                unsigned long long bishops,
+                unsigned long long knights,
+                unsigned long long pawns,
+                unsigned int rule50,
+                unsigned int castling,
+                unsigned int ep,
+                bool wtm,
+                bool hasRepeated,
+                bool useRule50,
+                array<TbRootMove>^% rootMoves
+            )
+            {
+                ::TbRootMoves* pRootMoves = Syzygy::RootMovesScratch();
+                int result = ::tb_context_probe_root_dtz(
+                    Context(), white, black, kings, queens, rooks, bishops, knights, pawns, rule50, castling, ep,
+                    wtm, hasRepeated, useRule50, pRootMoves
+                );
+                GC::KeepAlive(this);
+                rootMoves = Syzygy::ToRootMoves(result, pRootMoves);
+                return result;
+            }
+
+            /// <summary>
+            /// Use the WDL tables of this context to rank and score all root moves. See
+            /// <c>Syzygy::ProbeRootWdl</c>.
+            /// </summary>
+            int ProbeRootWdl(
+                unsigned long long white,
+                unsigned long long black,
+                unsigned long long kings,
+                unsigned long long queens,
+                unsigned long long rooks,
+                unsigned long long bishops,
+                unsigned long long knights,
+                unsigned long long pawns,
+                unsigned int rule50,
+                unsigned int castling,
+                unsigned int ep,
+                bool wtm,
+                bool useRule50,
+                array<TbRootMove>^% rootMoves
+            )
+            {
+                ::TbRootMoves* pRootMoves = Syzygy::RootMovesScratch();
+                int result = ::tb_context_probe_root_wdl(
+                    Context(), white, black, kings, queens, rooks, bishops, knights, pawns, rule50, castling, ep,
+                    wtm, useRule50, pRootMoves
+                );
+                GC::KeepAlive(this);
+                rootMoves = Syzygy::ToRootMoves(result, pRootMoves);
+                return result;
+            }
+
+            /// <summary>
+            /// Use the DTZ tables of this context to rank and score all root moves without
+            /// allocating. See <c>Syzygy::ProbeRootDtz</c>.
+            /// </summary>
+            int ProbeRootDtz(
+                unsigned long long white,
+                unsigned long long black,
+                unsigned long long kings,
+                unsigned long long queens,
+                unsigned long long rooks,
+                unsigned long long bishops,
+                unsigned long long knights,
+                unsigned long long pawns,
+                unsigned int rule50,
+                unsigned int castling,
+                unsigned int ep,
+                bool wtm,
+                bool hasRepeated,
+                bool useRule50,
+                array<TbRootMoveInfo>^ rootMoves,
+                array<TbMove>^ pv,
+                [System::Runtime::InteropServices::Out] int% count
+            )
+            {
+                ::TbRootMoves* pRootMoves = Syzygy::RootMovesScratch();
+                int result = ::tb_context_probe_root_dtz(
+                    Context(), white, black, kings, queens, rooks, bishops, knights, pawns, rule50, castling, ep,
+                    wtm, hasRepeated, useRule50, pRootMoves
+                );
+                GC::KeepAlive(this);
+                count = result != 0 ? Syzygy::CopyRootMoves(pRootMoves, rootMoves, pv) : 0;
+                return result;
+            }
+
+            /// <summary>
+            /// Use the WDL tables of this context to rank and score all root moves without
+            /// allocating. See <c>Syzygy::ProbeRootWdl</c>.
+            /// </summary>
+            int ProbeRootWdl(
+                unsigned long long white,
+                unsigned long long black,
+                unsigned long long kings,
+                unsigned long long queens,
+                unsigned long long rooks,
+                unsigned long long bishops,
+                unsigned long long knights,
+                unsigned long long pawns,
+                unsigned int rule50,
+                unsigned int castling,
+                unsigned int ep,
+                bool wtm,
+                bool useRule50,
+                array<TbRootMoveInfo>^ rootMoves,
+                array<TbMove>^ pv,
+                [System::Runtime::InteropServices::Out] int% count
+            )
+            {
+                ::TbRootMoves* pRootMoves = Syzygy::RootMovesScratch();
+                int result = ::tb_context_probe_root_wdl(
+                    Context(), white, black, kings, queens, rooks, bishops, knights, pawns, rule50, castling, ep,
+                    wtm, useRule50, pRootMoves
+                );
+                GC::KeepAlive(this);
+                count = result != 0 ? Syzygy::CopyRootMoves(pRootMoves, rootMoves, pv) : 0;
+                return result;
+            }
+
+        private:
+            ::TbContext* Context()
+            {
+                if (_ctx == nullptr)
+                {
+                    throw gcnew ObjectDisposedException("SyzygyContext");
+                }
+                return _ctx;
+            }
+
+            ::TbContext* _ctx;
+        };
     }
 }
@@ -0,0 +1,406 @@
+/*
+ * tbattacks.c
+ * Sliding piece attacks for the prober: PEXT (BMI2) lookups when the CPU has
+ * them and they measure faster, black magic bitboards otherwise.  These are
+ * the kernels the engine itself uses (BoardPext.cs and BoardFancy.cs), with
+ * the same magics and the same run-time choice between the two.
+ *
+ * This file is #included by tbchess.c when TB_FAST_SLIDERS is defined, in
+ * which case tbconfig.h points the TB_ROOK_ATTACKS, TB_BISHOP_ATTACKS,
+ * TB_QUEEN_ATTACKS and TB_ATTACKS_INIT hooks here.  Define TB_NO_PEXT to
+ * always use the magics.
+ */
+
+#include <time.h>
+
+#if !defined(TB_NO_PEXT) && (defined(__x86_64__) || defined(_M_X64))
+#define TB_PEXT
+#include <immintrin.h>
+#if defined(__BMI2__)
+#define TB_PEXT_ALWAYS          // the whole build targets BMI2
+#define TB_PEXT_TARGET
+#elif defined(__GNUC__)
+#define TB_PEXT_TARGET          __attribute__((target("bmi2")))
+#else
+#include <intrin.h>
+#define TB_PEXT_TARGET
+#endif
+#endif
+
+#define ROOK_MAGIC_BITS         12
+#define BISHOP_MAGIC_BITS       9
+#define MAGIC_TABLE_SIZE        88507
+#define PEXT_TABLE_SIZE         107648
+
+struct Magic {
+  uint32_t offset;
+  uint64_t mask;                // complement of the relevant occupancy
+  uint64_t hash;
+};
+
+static const struct Magic bishopMagics[64] = {
+  { 66157, 0xFFBFDFEFF7FBFDFFull, 0x107AC08050500BFFull },
+  { 71730, 0xFFFFBFDFEFF7FBFFull, 0x7FFFDFDFD823FFFDull },
+  { 37781, 0xFFFFFFBFDFEFF5FFull, 0x0400C00FE8000200ull },
+  { 21015, 0xFFFFFFFFBFDDEBFFull, 0x103F802004000000ull },
+  { 47590, 0xFFFFFFFFFDBBD7FFull, 0xC03FE00100000000ull },
+  {   835, 0xFFFFFFFDFBF7AFFFull, 0x24C00BFFFF400000ull },
+  { 23592, 0xFFFFFDFBF7EFDFFFull, 0x0808101F40007F04ull },
+  { 30599, 0xFFFDFBF7EFDFBFFFull, 0x100808201EC00080ull },
+  { 68776, 0xFFDFEFF7FBFDFFFFull, 0xFFA2FEFFBFEFB7FFull },
+  { 19959, 0xFFBFDFEFF7FBFFFFull, 0x083E3EE040080801ull },
+  { 21783, 0xFFFFBFDFEFF5FFFFull, 0x040180BFF7E80080ull },
+  { 64836, 0xFFFFFFBFDDEBFFFFull, 0x0440007FE0031000ull },
+  { 23417, 0xFFFFFFFDBBD7FFFFull, 0x2010007FFC000000ull },
+  { 66724, 0xFFFFFDFBF7AFFFFFull, 0x1079FFE000FF8000ull },
+  { 74542, 0xFFFDFBF7EFDFFFFFull, 0x7F83FFDFC03FFF80ull },
+  { 67266, 0xFFFBF7EFDFBFFFFFull, 0x080614080FA00040ull },
+  { 26575, 0xFFEFF7FBFDFFFDFFull, 0x7FFE7FFF817FCFF9ull },
+  { 67543, 0xFFDFEFF7FBFFFBFFull, 0x7FFEBFFFA01027FDull },
+  { 24409, 0xFFBFDFEFF5FFF5FFull, 0x20018000C00F3C01ull },
+  { 30779, 0xFFFFBFDDEBFFEBFFull, 0x407E0001000FFB8Aull },
+  { 17384, 0xFFFFFDBBD7FFD7FFull, 0x201FE000FFF80010ull },
+  { 18778, 0xFFFDFBF7AFFFAFFFull, 0xFFDFEFFFDE39FFEFull },
+  { 65109, 0xFFFBF7EFDFFFDFFFull, 0x7FFFF800203FBFFFull },
+  { 20184, 0xFFF7EFDFBFFFBFFFull, 0x7FF7FBFFF8203FFFull },
+  { 38240, 0xFFF7FBFDFFFDFBFFull, 0x000000FE04004070ull },
+  { 16459, 0xFFEFF7FBFFFBF7FFull, 0x7FFF7F9FFFC0EFF9ull },
+  { 17432, 0xFFDFEFF5FFF5EFFFull, 0x7FFEFF7F7F01F7FDull },
+  { 81040, 0xFFBFDDEBFFEBDDFFull, 0x3F6EFBBF9EFBFFFFull },
+  { 84946, 0xFFFDBBD7FFD7BBFFull, 0x0410008F01003FFDull },
+  { 18276, 0xFFFBF7AFFFAFF7FFull, 0x20002038001C8010ull },
+  {  8512, 0xFFF7EFDFFFDFEFFFull, 0x087FF038000FC001ull },
+  { 78544, 0xFFEFDFBFFFBFDFFFull, 0x00080C0C00083007ull },
+  { 19974, 0xFFFBFDFFFDFBF7FFull, 0x00000080FC82C040ull },
+  { 23850, 0xFFF7FBFFFBF7EFFFull, 0x000000407E416020ull },
+  { 11056, 0xFFEFF5FFF5EFDFFFull, 0x00600203F8008020ull },
+  { 68019, 0xFFDDEBFFEBDDBFFFull, 0xD003FEFE04404080ull },
+  { 85965, 0xFFBBD7FFD7BBFDFFull, 0x100020801800304Aull },
+  { 80524, 0xFFF7AFFFAFF7FBFFull, 0x7FBFFE700BFFE800ull },
+  { 38221, 0xFFEFDFFFDFEFF7FFull, 0x107FF00FE4000F90ull },
+  { 64647, 0xFFDFBFFFBFDFEFFFull, 0x7F8FFFCFF1D007F8ull },
+  { 61320, 0xFFFDFFFDFBF7EFFFull, 0x0000004100F88080ull },
+  { 67281, 0xFFFBFFFBF7EFDFFFull, 0x00000020807C4040ull },
+  { 79076, 0xFFF5FFF5EFDFBFFFull, 0x00000041018700C0ull },
+  { 17115, 0xFFEBFFEBDDBFFFFFull, 0x0010000080FC4080ull },
+  { 50718, 0xFFD7FFD7BBFDFFFFull, 0x1000003C80180030ull },
+  { 24659, 0xFFAFFFAFF7FBFDFFull, 0x2006001CF00C0018ull },
+  { 38291, 0xFFDFFFDFEFF7FBFFull, 0xFFFFFFBFEFF80FDCull },
+  { 30605, 0xFFBFFFBFDFEFF7FFull, 0x000000101003F812ull },
+  { 37759, 0xFFFFFDFBF7EFDFFFull, 0x0800001F40808200ull },
+  {  4639, 0xFFFFFBF7EFDFBFFFull, 0x084000101F3FD208ull },
+  { 21759, 0xFFFFF5EFDFBFFFFFull, 0x080000000F808081ull },
+  { 67799, 0xFFFFEBDDBFFFFFFFull, 0x0004000008003F80ull },
+  { 22841, 0xFFFFD7BBFDFFFFFFull, 0x08000001001FE040ull },
+  { 66689, 0xFFFFAFF7FBFDFFFFull, 0x085F7D8000200A00ull },
+  { 62548, 0xFFFFDFEFF7FBFDFFull, 0xFFFFFEFFBFEFF81Dull },
+  { 66597, 0xFFFFBFDFEFF7FBFFull, 0xFFBFFFEFEFDFF70Full },
+  { 86749, 0xFFFDFBF7EFDFBFFFull, 0x100000101EC10082ull },
+  { 69558, 0xFFFBF7EFDFBFFFFFull, 0x7FBAFFFFEFE0C02Full },
+  { 61589, 0xFFF5EFDFBFFFFFFFull, 0x7F83FFFFFFF07F7Full },
+  { 62533, 0xFFEBDDBFFFFFFFFFull, 0xFFF1FFFFFFF7FFC1ull },
+  { 64387, 0xFFD7BBFDFFFFFFFFull, 0x0878040000FFE01Full },
+  { 26581, 0xFFAFF7FBFDFFFFFFull, 0x005D00000120200Aull },
+  { 76355, 0xFFDFEFF7FBFDFFFFull, 0x0840800080200FDAull },
+  { 11140, 0xFFBFDFEFF7FBFDFFull, 0x100000C05F582008ull },
+};
+
+static const struct Magic rookMagics[64] = {
+  { 10890, 0xFFFEFEFEFEFEFE81ull, 0x80280013FF84FFFFull },
+  { 56054, 0xFFFDFDFDFDFDFD83ull, 0x5FFBFEFDFEF67FFFull },
+  { 67495, 0xFFFBFBFBFBFBFB85ull, 0xFFEFFAFFEFFDFFFFull },
+  { 72797, 0xFFF7F7F7F7F7F789ull, 0x003000900300008Aull },
+  { 17179, 0xFFEFEFEFEFEFEF91ull, 0x0030018003500030ull },
+  { 63978, 0xFFDFDFDFDFDFDFA1ull, 0x0020012120A00020ull },
+  { 56650, 0xFFBFBFBFBFBFBFC1ull, 0x0030006000C00030ull },
+  { 15929, 0xFF7F7F7F7F7F7F81ull, 0xFFA8008DFF09FFF8ull },
+  { 55905, 0xFFFEFEFEFEFE81FFull, 0x7FBFF7FBFBEAFFFCull },
+  { 26301, 0xFFFDFDFDFDFD83FFull, 0x0000140081050002ull },
+  { 78100, 0xFFFBFBFBFBFB85FFull, 0x0000180043800048ull },
+  { 86245, 0xFFF7F7F7F7F789FFull, 0x7FFFE800021FFFB8ull },
+  { 75228, 0xFFEFEFEFEFEF91FFull, 0xFFFFCFFE7FCFFFAFull },
+  { 31661, 0xFFDFDFDFDFDFA1FFull, 0x00001800C0180060ull },
+  { 38053, 0xFFBFBFBFBFBFC1FFull, 0xFFFFE7FF8FBFFFE8ull },
+  { 37433, 0xFF7F7F7F7F7F81FFull, 0x0000180030620018ull },
+  { 74747, 0xFFFEFEFEFE81FEFFull, 0x00300018010C0003ull },
+  { 53847, 0xFFFDFDFDFD83FDFFull, 0x0003000C0085FFFFull },
+  { 70952, 0xFFFBFBFBFB85FBFFull, 0xFFFDFFF7FBFEFFF7ull },
+  { 49447, 0xFFF7F7F7F789F7FFull, 0x7FC1FFDFFC001FFFull },
+  { 62629, 0xFFEFEFEFEF91EFFFull, 0xFFFEFFDFFDFFDFFFull },
+  { 58996, 0xFFDFDFDFDFA1DFFFull, 0x7C108007BEFFF81Full },
+  { 36009, 0xFFBFBFBFBFC1BFFFull, 0x20408007BFE00810ull },
+  { 21230, 0xFF7F7F7F7F817FFFull, 0x0400800558604100ull },
+  { 51882, 0xFFFEFEFE81FEFEFFull, 0x0040200010080008ull },
+  { 11841, 0xFFFDFDFD83FDFDFFull, 0x0010020008040004ull },
+  { 25794, 0xFFFBFBFB85FBFBFFull, 0xFFFDFEFFF7FBFFF7ull },
+  { 49689, 0xFFF7F7F789F7F7FFull, 0xFEBF7DFFF8FEFFF9ull },
+  { 63400, 0xFFEFEFEF91EFEFFFull, 0xC00000FFE001FFE0ull },
+  { 33958, 0xFFDFDFDFA1DFDFFFull, 0x2008208007004007ull },
+  { 21991, 0xFFBFBFBFC1BFBFFFull, 0xBFFBFAFFFB683F7Full },
+  { 45618, 0xFF7F7F7F817F7FFFull, 0x0807F67FFA102040ull },
+  { 70134, 0xFFFEFE81FEFEFEFFull, 0x200008E800300030ull },
+  { 75944, 0xFFFDFD83FDFDFDFFull, 0x0000008780180018ull },
+  { 68392, 0xFFFBFB85FBFBFBFFull, 0x0000010300180018ull },
+  { 66472, 0xFFF7F789F7F7F7FFull, 0x4000008180180018ull },
+  { 23236, 0xFFEFEF91EFEFEFFFull, 0x008080310005FFFAull },
+  { 19067, 0xFFDFDFA1DFDFDFFFull, 0x4000188100060006ull },
+  {     0, 0xFFBFBFC1BFBFBFFFull, 0xFFFFFF7FFFBFBFFFull },
+  { 43566, 0xFF7F7F817F7F7FFFull, 0x0000802000200040ull },
+  { 29810, 0xFFFE81FEFEFEFEFFull, 0x20000202EC002800ull },
+  { 65558, 0xFFFD83FDFDFDFDFFull, 0xFFFFF9FF7CFFF3FFull },
+  { 77684, 0xFFFB85FBFBFBFBFFull, 0x000000404B801800ull },
+  { 73350, 0xFFF789F7F7F7F7FFull, 0x2000002FE03FD000ull },
+  { 61765, 0xFFEF91EFEFEFEFFFull, 0xFFFFFF6FFE7FCFFDull },
+  { 49282, 0xFFDFA1DFDFDFDFFFull, 0xBFF7EFFFBFC00FFFull },
+  { 78840, 0xFFBFC1BFBFBFBFFFull, 0x000000100800A804ull },
+  { 82904, 0xFF7F817F7F7F7FFFull, 0xFFFBFFEFA7FFA7FEull },
+  { 24594, 0xFF81FEFEFEFEFEFFull, 0x0000052800140028ull },
+  {  9513, 0xFF83FDFDFDFDFDFFull, 0x00000085008A0014ull },
+  { 29012, 0xFF85FBFBFBFBFBFFull, 0x8000002B00408028ull },
+  { 27684, 0xFF89F7F7F7F7F7FFull, 0x4000002040790028ull },
+  { 27901, 0xFF91EFEFEFEFEFFFull, 0x7800002010288028ull },
+  { 61477, 0xFFA1DFDFDFDFDFFFull, 0x0000001800E08018ull },
+  { 25719, 0xFFC1BFBFBFBFBFFFull, 0x1890000810580050ull },
+  { 50020, 0xFF817F7F7F7F7FFFull, 0x2003D80000500028ull },
+  { 41547, 0x81FEFEFEFEFEFEFFull, 0xFFFFF37EEFEFDFBEull },
+  {  4750, 0x83FDFDFDFDFDFDFFull, 0x40000280090013C1ull },
+  {  6014, 0x85FBFBFBFBFBFBFFull, 0xBF7FFEFFBFFAF71Full },
+  { 41529, 0x89F7F7F7F7F7F7FFull, 0xFFFDFFFF777B7D6Eull },
+  { 84192, 0x91EFEFEFEFEFEFFFull, 0xEEFFFFEFF0080BFEull },
+  { 33433, 0xA1DFDFDFDFDFDFFFull, 0xAFE0000FFF780402ull },
+  {  8555, 0xC1BFBFBFBFBFBFFFull, 0xEE73FFFBFFBB77FEull },
+  {  1009, 0x817F7F7F7F7F7FFFull, 0x0002000308482882ull },
+};
+
+static uint64_t magicTable[MAGIC_TABLE_SIZE];
+
+static inline uint64_t rook_attacks_magic(unsigned sq, uint64_t occ)
+{
+  const struct Magic *m = &rookMagics[sq];
+  return magicTable[m->offset + (((occ | m->mask) * m->hash) >> (64 - ROOK_MAGIC_BITS))];
+}
+
+static inline uint64_t bishop_attacks_magic(unsigned sq, uint64_t occ)
+{
+  const struct Magic *m = &bishopMagics[sq];
+  return magicTable[m->offset + (((occ | m->mask) * m->hash) >> (64 - BISHOP_MAGIC_BITS))];
+}
+
+static inline uint64_t queen_attacks_magic(unsigned sq, uint64_t occ)
+{
+  return rook_attacks_magic(sq, occ) | bishop_attacks_magic(sq, occ);
+}
+
+#ifdef TB_PEXT
+struct PextEntry {
+  const uint64_t *rook, *bishop;
+  uint64_t rookMask, bishopMask;
+};
+
+static uint64_t pextTable[PEXT_TABLE_SIZE];
+static struct PextEntry pextEntries[64];
+static bool usePext = false;
+
+static TB_PEXT_TARGET inline uint64_t rook_attacks_pext(unsigned sq, uint64_t occ)
+{
+  const struct PextEntry *e = &pextEntries[sq];
+  return e->rook[_pext_u64(occ, e->rookMask)];
+}
+
+static TB_PEXT_TARGET inline uint64_t bishop_attacks_pext(unsigned sq, uint64_t occ)
+{
+  const struct PextEntry *e = &pextEntries[sq];
+  return e->bishop[_pext_u64(occ, e->bishopMask)];
+}
+
+static TB_PEXT_TARGET uint64_t queen_attacks_pext(unsigned sq, uint64_t occ)
+{
+  const struct PextEntry *e = &pextEntries[sq];
+  return e->rook[_pext_u64(occ, e->rookMask)] |
+         e->bishop[_pext_u64(occ, e->bishopMask)];
+}
+#endif
+
+static inline uint64_t fast_rook_attacks(unsigned sq, uint64_t occ)
+{
+#if defined(TB_PEXT_ALWAYS)
+  return rook_attacks_pext(sq, occ);
+#else
+#ifdef TB_PEXT
+  if (usePext)
+    return rook_attacks_pext(sq, occ);
+#endif
+  return rook_attacks_magic(sq, occ);
+#endif
+}
+
+static inline uint64_t fast_bishop_attacks(unsigned sq, uint64_t occ)
+{
+#if defined(TB_PEXT_ALWAYS)
+  return bishop_attacks_pext(sq, occ);
+#else
+#ifdef TB_PEXT
+  if (usePext)
+    return bishop_attacks_pext(sq, occ);
+#endif
+  return bishop_attacks_magic(sq, occ);
+#endif
+}
+
+static inline uint64_t fast_queen_attacks(unsigned sq, uint64_t occ)
+{
+#if defined(TB_PEXT_ALWAYS)
+  return queen_attacks_pext(sq, occ);
+#else
+#ifdef TB_PEXT
+  if (usePext)
+    return queen_attacks_pext(sq, occ);
+#endif
+  return queen_attacks_magic(sq, occ);
+#endif
+}
+
+static const int rookDirs[4][2] = { { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 } };
+static const int bishopDirs[4][2] = { { 1, 1 }, { 1, -1 }, { -1, 1 }, { -1, -1 } };
+
+// Attacks by walking the rays, used to fill the tables.
+static uint64_t slide_attacks(unsigned sq, uint64_t occ, const int dirs[4][2])
+{
+  uint64_t att = 0;
+  for (int d = 0; d < 4; d++) {
+    int f = (int)(sq & 7) + dirs[d][0], r = (int)(sq >> 3) + dirs[d][1];
+    for (; f >= 0 && f < 8 && r >= 0 && r < 8; f += dirs[d][0], r += dirs[d][1]) {
+      att |= 1ULL << (8 * r + f);
+      if (occ & (1ULL << (8 * r + f)))
+        break;
+    }
+  }
+  return att;
+}
+
+// The squares whose occupancy matters: the rays without their last square.
+static uint64_t relevant_mask(unsigned sq, const int dirs[4][2])
+{
+  uint64_t mask = 0;
+  for (int d = 0; d < 4; d++) {
+    int f = (int)(sq & 7) + dirs[d][0], r = (int)(sq >> 3) + dirs[d][1];
+    for (; f + dirs[d][0] >= 0 && f + dirs[d][0] < 8 &&
+           r + dirs[d][1] >= 0 && r + dirs[d][1] < 8;
+         f += dirs[d][0], r += dirs[d][1])
+      mask |= 1ULL << (8 * r + f);
+  }
+  return mask;
+}
+
+static void magic_attacks_init(void)
+{
+  for (unsigned sq = 0; sq < 64; sq++) {
+    uint64_t mask = relevant_mask(sq, rookDirs), occ = 0;
+    do {
+      const struct Magic *m = &rookMagics[sq];
+      magicTable[m->offset + (((occ | m->mask) * m->hash) >> (64 - ROOK_MAGIC_BITS))] =
+          slide_attacks(sq, occ, rookDirs);
+      occ = (occ - mask) & mask;
+    } while (occ);
+
+    mask = relevant_mask(sq, bishopDirs);
+    do {
+      const struct Magic *m = &bishopMagics[sq];
+      magicTable[m->offset + (((occ | m->mask) * m->hash) >> (64 - BISHOP_MAGIC_BITS))] =
+          slide_attacks(sq, occ, bishopDirs);
+      occ = (occ - mask) & mask;
+    } while (occ);
+  }
+}
+
+#ifdef TB_PEXT
+// The subsets of a mask are enumerated in the order of their PEXT index, so
+// the tables can be filled without using the instruction.
+static void pext_attacks_init(void)
+{
+  uint64_t *p = pextTable;
+  for (unsigned sq = 0; sq < 64; sq++) {
+    struct PextEntry *e = &pextEntries[sq];
+    e->rookMask = relevant_mask(sq, rookDirs);
+    e->rook = p;
+    uint64_t occ = 0;
+    do {
+      *p++ = slide_attacks(sq, occ, rookDirs);
+      occ = (occ - e->rookMask) & e->rookMask;
+    } while (occ);
+
+    e->bishopMask = relevant_mask(sq, bishopDirs);
+    e->bishop = p;
+    do {
+      *p++ = slide_attacks(sq, occ, bishopDirs);
+      occ = (occ - e->bishopMask) & e->bishopMask;
+    } while (occ);
+  }
+  assert(p == pextTable + PEXT_TABLE_SIZE);
+}
+
+static bool cpu_has_bmi2(void)
+{
+#if defined(TB_PEXT_ALWAYS)
+  return true;
+#elif defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 0);
+  if (info[0] < 7)
+    return false;
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 8)) != 0;
+#else
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("bmi2") != 0;
+#endif
+}
+
+#ifndef TB_PEXT_ALWAYS
+static volatile uint64_t attacksSink;
+
+static double attacks_time(uint64_t (*attacks)(unsigned, uint64_t))
+{
+  uint64_t seed = 0x9e3779b97f4a7c15ULL, sum = 0;
+  struct timespec t0, t1;
+  timespec_get(&t0, TIME_UTC);
+  for (int i = 0; i < 4096; i++) {
+    seed ^= seed >> 12;
+    seed ^= seed << 25;
+    seed ^= seed >> 27;
+    uint64_t r = seed * 0x2545f4914f6cdd1dULL;
+    sum += attacks((unsigned)(r >> 58), r & (r << 13) & (r >> 7));
+  }
+  timespec_get(&t1, TIME_UTC);
+  attacksSink = sum;
+  return (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+}
+#endif
+#endif
+
+// Fill the tables and pick the faster kernel.  PEXT is microcoded and slow
+// on some CPUs that support it (AMD before Zen 3), hence the timing rather
+// than trusting the CPUID bit alone.
+static void tb_attacks_init(void)
+{
+  magic_attacks_init();
+#ifdef TB_PEXT
+  if (!cpu_has_bmi2())
+    return;
+  pext_attacks_init();
+#ifndef TB_PEXT_ALWAYS
+  double magicTime = 0, pextTime = 0;
+  for (int n = 0; n < 5; n++) {
+    double m = attacks_time(queen_attacks_magic);
+    double p = attacks_time(queen_attacks_pext);
+    if (n > 0) {
+      magicTime += m;
+      pextTime += p;
+    }
+  }
+  usePext = pextTime < magicTime;
+#else
+  usePext = true;
+#endif
+#endif
+}
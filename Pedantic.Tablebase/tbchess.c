@@ -106,6 +106,8 @@ typedef struct Pos
     uint8_t rule50;
     uint8_t ep;
     bool turn;
+    uint64_t key;       // calc_key(pos, false), kept up to date by do_move()
+    struct TbContext *ctx;  // the tables to probe, copied by do_move()
 } Pos;
 
 static inline uint64_t pieces_by_type(const Pos *pos, Color c, PieceType p) {
@@ -229,6 +231,10 @@ static void knight_attacks_init(void)
 
 #endif      /* TB_KNIGHT_ATTACKS */
 
+#ifdef TB_FAST_SLIDERS
+#include "tbattacks.c"
+#endif
+
 #ifdef TB_BISHOP_ATTACKS
 #define bishop_attacks(s, occ)  TB_BISHOP_ATTACKS(s, occ)
 #define bishop_attacks_init()   /* NOP */
@@ -611,6 +617,24 @@ static uint64_t calc_key_from_pieces(uint8_t *piece, int num)
     return key;
 }
 
+// The part of the material key contributed by the piece on sq, if any.
+static uint64_t square_key(const Pos *pos, unsigned sq)
+{
+    static const uint64_t keys[2][8] = {
+        {0, PRIME_BLACK_PAWN, PRIME_BLACK_KNIGHT, PRIME_BLACK_BISHOP,
+         PRIME_BLACK_ROOK, PRIME_BLACK_QUEEN, 0, 0},
+        {0, PRIME_WHITE_PAWN, PRIME_WHITE_KNIGHT, PRIME_WHITE_BISHOP,
+         PRIME_WHITE_ROOK, PRIME_WHITE_QUEEN, 0, 0}
+    };
+    uint64_t b = board(sq);
+    int type = (pos->pawns & b)   ? TB_PAWN :
+               (pos->knights & b) ? TB_KNIGHT :
+               (pos->bishops & b) ? TB_BISHOP :
+               (pos->rooks & b)   ? TB_ROOK :
+               (pos->queens & b)  ? TB_QUEEN : 0;
+    return keys[(pos->white & b) != 0][type];
+}
+
 #define make_move(promote, from, to)                                    \
     ((((promote) & 0x7) << 12) | (((from) & 0x3F) << 6) | ((to) & 0x3F))
 #define move_from(move)                                                 \
@@ -961,8 +985,11 @@ static bool do_move(Pos *pos, const Pos *pos0, TbMove move)
     pos->knights = do_bb_move(pos0->knights, from, to);  
     pos->pawns = do_bb_move(pos0->pawns, from, to);
     pos->ep = 0;
+    pos->ctx = pos0->ctx;
+    pos->key = pos0->key - square_key(pos0, to);
     if (promotes != TB_PROMOTES_NONE) 
     {  
+        pos->key -= square_key(pos0, from);
         pos->pawns &= ~board(to);       // Promotion
         switch (promotes)
         { 
@@ -975,6 +1002,7 @@ static bool do_move(Pos *pos, const Pos *pos0, TbMove move)
             case TB_PROMOTES_KNIGHT:  
                 pos->knights |= board(to); break;  
         }
+        pos->key += square_key(pos, to);
         pos->rule50 = 0;
     }
     else if ((board(from) & pos0->pawns) != 0)
@@ -990,6 +1018,7 @@ static bool do_move(Pos *pos, const Pos *pos0, TbMove move)
         {
             unsigned ep_to = (pos0->turn? to-8: to+8);
             uint64_t ep_mask = ~board(ep_to);
+            pos->key -= square_key(pos0, ep_to);
             pos->white &= ep_mask;
             pos->black &= ep_mask;
             pos->pawns &= ep_mask;
@@ -78,6 +78,31 @@
  */
 /* #define TB_NO_HW_POP_COUNT */
 
+/*
+ * Define TB_NO_DECODE_LUT to decode the Huffman codes of a table with the
+ * plain code length scan instead of the per-table lookup table.  The lookup
+ * table costs 4 << TB_DECODE_LUT_BITS bytes for each loaded table part.
+ */
+/* #define TB_NO_DECODE_LUT */
+/* #define TB_DECODE_LUT_BITS 10 */
+
+/*
+ * Each probing thread keeps the Huffman codes of the last blocks it decoded,
+ * so that probes of nearby positions skip the decode.  The cache costs about
+ * TB_BLOCK_CACHE_SLOTS * 4 * TB_BLOCK_CACHE_CODES bytes per thread; blocks
+ * with more codes than that are always decoded.  Define
+ * TB_BLOCK_CACHE_SLOTS as 0 to turn the cache off.
+ */
+/* #define TB_BLOCK_CACHE_SLOTS 16 */
+/* #define TB_BLOCK_CACHE_CODES 256 */
+
+/*
+ * tb_probe_wdl_nonblocking queues the positions it cannot probe without a
+ * page fault for its I/O threads.  When TB_IO_QUEUE positions are waiting,
+ * further ones are dropped (and probed again on their next visit).
+ */
+/* #define TB_IO_QUEUE 256 */
+
 /***************************************************************************/
 /* SCORING CONSTANTS                                                       */
 /***************************************************************************/
@@ -147,4 +172,22 @@
  */
 /* #define TB_PAWN_ATTACKS(square, color)   <DEFINITION> */
 
+/*
+ * Define TB_ATTACKS_INIT() to set up whatever the attack hooks above need.
+ * It is called once, from the first tb_init.
+ */
+/* #define TB_ATTACKS_INIT()                <DEFINITION> */
+
+/*
+ * Define TB_FAST_SLIDERS to use the slider attacks in tbattacks.c: PEXT
+ * lookups where BMI2 is available and faster, magic bitboards otherwise.
+ * Define TB_NO_PEXT as well to use the magics only.
+ */
+#ifdef TB_FAST_SLIDERS
+#define TB_ROOK_ATTACKS(square, occ)     fast_rook_attacks((square), (occ))
+#define TB_BISHOP_ATTACKS(square, occ)   fast_bishop_attacks((square), (occ))
+#define TB_QUEEN_ATTACKS(square, occ)    fast_queen_attacks((square), (occ))
+#define TB_ATTACKS_INIT()                tb_attacks_init()
+#endif
+
 #endif
@@ -22,6 +22,10 @@ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 SOFTWARE.
 */
 
+#if !defined(_WIN32) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE // MAP_ANONYMOUS and madvise() in strict C modes
+#endif
+
 #include "pch.h"
 #pragma unmanaged
 
@@ -34,11 +38,16 @@ SOFTWARE.
 #define TB_MAX_SYMS  4096
 
 #ifndef _WIN32
+#include <errno.h>
 #include <fcntl.h>
 #include <pthread.h>
 #include <unistd.h>
+#include <dirent.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
 #define SEP_CHAR ':'
 #define FD int
 #define FD_ERR -1
@@ -48,11 +57,13 @@ typedef size_t map_t;
 #define NOMINMAX
 #endif
 #include <windows.h>
+#include <psapi.h>
 #define SEP_CHAR ';'
 #define FD HANDLE
 #define FD_ERR INVALID_HANDLE_VALUE
 typedef HANDLE map_t;
 #endif
+#include <time.h>
 
 // This must be after the inclusion of Windows headers, because otherwise
 // std::byte conflicts with "byte" in rpcndr.h . The error occurs if C++
@@ -63,39 +74,116 @@ using namespace std;
 
 #define DECOMP64
 
-// Threading support
+// The decode lookup table is only implemented for 64-bit decompression.
+#ifndef DECOMP64
+#define TB_NO_DECODE_LUT
+#endif
+#ifndef TB_DECODE_LUT_BITS
+#define TB_DECODE_LUT_BITS 10
+#endif
+
+// Decoded-block cache, see cached_block(). Set TB_BLOCK_CACHE_SLOTS to 0 to
+// leave it out. It is only implemented for 64-bit decompression.
+#ifndef TB_BLOCK_CACHE_SLOTS
+#define TB_BLOCK_CACHE_SLOTS 16       // per thread, a power of two
+#endif
+#ifndef TB_BLOCK_CACHE_CODES
+#define TB_BLOCK_CACHE_CODES 256      // blocks with more are not cached
+#endif
+#ifndef DECOMP64
+#undef TB_BLOCK_CACHE_SLOTS
+#define TB_BLOCK_CACHE_SLOTS 0
+#endif
+
+// Non-blocking probes, see tb_probe_wdl_nonblocking().
+#ifndef TB_IO_QUEUE
+#define TB_IO_QUEUE 256               // positions waiting for the I/O threads
+#endif
+#define TB_IO_MAX_THREADS 16
+#define TB_RESIDENT_PAGES 32          // per thread, a power of two
+#define TB_NUMA_NODES 16              // copies of a table at most
+#define TB_NUMA_RECHECK 256           // probes between node lookups
+
+// Background threads
+#ifndef TB_NO_THREADS
+#ifndef _WIN32
+#define THREAD_T pthread_t
+#define THREAD_FUNC(name) static void *name(void *arg)
+#define THREAD_RETURN return NULL
+#define THREAD_CREATE(t, f) (pthread_create(&(t), NULL, f, NULL) == 0)
+#define THREAD_JOIN(t) pthread_join(t, NULL)
+#else
+#define THREAD_T HANDLE
+#define THREAD_FUNC(name) static DWORD WINAPI name(LPVOID arg)
+#define THREAD_RETURN return 0
+#define THREAD_CREATE(t, f) (((t) = CreateThread(NULL, 0, f, NULL, 0, NULL)) != NULL)
+#define THREAD_JOIN(t) do { WaitForSingleObject(t, INFINITE); CloseHandle(t); } while (0)
+#endif
+#endif
+
+// Thread-local storage
 #ifndef TB_NO_THREADS
-#if defined(__cplusplus) && (__cplusplus >= 201103L)
+#if defined(__cplusplus)
+#define TB_TLS thread_local
+#elif defined(_MSC_VER)
+#define TB_TLS __declspec(thread)
+#else
+#define TB_TLS _Thread_local
+#endif
+#else
+#define TB_TLS          /* NOP */
+#endif
 
-#include <mutex>
-#define LOCK_T std::mutex
-#define LOCK_INIT(x)
-#define LOCK_DESTROY(x)
-#define LOCK(x) x.lock()
-#define UNLOCK(x) x.unlock()
+// Time stamps for the probe statistics
+#ifdef TB_STATS
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define TB_TIMESTAMP() __rdtsc()
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define TB_TIMESTAMP() __rdtsc()
+#else
+#include <time.h>
+static inline uint64_t tb_timestamp(void)
+{
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+#define TB_TIMESTAMP() tb_timestamp()
+#endif
+#endif
 
+// Force inlining where specializing a function by its constant arguments
+// is the point.
+#if defined(_MSC_VER)
+#define TB_FORCE_INLINE __forceinline
+#elif defined(__GNUC__)
+#define TB_FORCE_INLINE inline __attribute__((always_inline))
 #else
+#define TB_FORCE_INLINE inline
+#endif
+
+// Give up the rest of the time slice while spinning on a lock.
+#ifndef TB_NO_THREADS
 #ifndef _WIN32
-#define LOCK_T pthread_mutex_t
-#define LOCK_INIT(x) pthread_mutex_init(&(x), NULL)
-#define LOCK_DESTROY(x) pthread_mutex_destroy(&(x))
-#define LOCK(x) pthread_mutex_lock(&(x))
-#define UNLOCK(x) pthread_mutex_unlock(&(x))
+#include <sched.h>
+#define TB_YIELD() sched_yield()
 #else
-#define LOCK_T HANDLE
-#define LOCK_INIT(x) do { x = CreateMutex(NULL, FALSE, NULL); } while (0)
-#define LOCK_DESTROY(x) CloseHandle(x)
-#define LOCK(x) WaitForSingleObject(x, INFINITE)
-#define UNLOCK(x) ReleaseMutex(x)
+#define TB_YIELD() SwitchToThread()
 #endif
-
+#else
+#define TB_YIELD()      /* NOP */
 #endif
-#else /* TB_NO_THREADS */
-#define LOCK_T          int
-#define LOCK_INIT(x)    /* NOP */
-#define LOCK_DESTROY(x) /* NOP */
-#define LOCK(x)         /* NOP */
-#define UNLOCK(x)       /* NOP */
+
+// Bring a cache line in ahead of a probe.
+#if defined(__GNUC__) || defined(__clang__)
+#define TB_PREFETCH(p) __builtin_prefetch((p))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#define TB_PREFETCH(p) _mm_prefetch((const char *)(p), _MM_HINT_T0)
+#else
+#define TB_PREFETCH(p)  /* NOP */
 #endif
 
 // population count implementation
@@ -274,21 +362,160 @@ static size_t file_size(FD fd) {
 #endif
 }
 
-#ifndef TB_NO_THREADS
-static LOCK_T tbMutex;
-#endif
 static int initialized = 0;
-static int numPaths = 0;
-static char *pathString = NULL;
-static char **paths = NULL;
 
-static FD open_tb(const char *str, const char *suffix)
+// The table files in the directories of a path, listed once when the path
+// is loaded so that looking for the tables of every material combination
+// needs no system calls. Directories that cannot be listed are not
+// indexed, open_tb() looks for their files by name.
+struct TbFile {
+  char name[16];      // table name and suffix, e.g. "KQvK.rtbw"
+  int dir;            // the first directory that holds the file
+  uint64_t size;
+};
+
+struct TbDirIndex {
+  bool *listed;       // per directory
+  struct TbFile *files;
+  unsigned mask;      // size of files - 1, a power of two, or 0 if empty
+  unsigned count;
+  unsigned dirs;      // directories listed
+};
+
+static uint32_t file_hash(const char *name)
+{
+  uint32_t h = 2166136261u;
+  while (*name)
+    h = (h ^ (uint8_t)*name++) * 16777619u;
+  return h;
+}
+
+static const struct TbFile *find_file(const struct TbDirIndex *index,
+    const char *str, const char *suffix)
+{
+  char name[sizeof(index->files->name)];
+  if (!index->mask || strlen(str) + strlen(suffix) >= sizeof(name))
+    return NULL;
+  strcpy(name, str);
+  strcat(name, suffix);
+  for (uint32_t i = file_hash(name);; i++) {
+    const struct TbFile *f = &index->files[i & index->mask];
+    if (!f->name[0])
+      return NULL;
+    if (!strcmp(f->name, name))
+      return f;
+  }
+}
+
+static void insert_file(struct TbFile *files, unsigned mask,
+    const struct TbFile *file)
+{
+  uint32_t i = file_hash(file->name);
+  while (files[i & mask].name[0])
+    i++;
+  files[i & mask] = *file;
+}
+
+// Add a file, unless a directory listed before has it already.
+static void add_file(struct TbDirIndex *index, const char *name, int dir,
+    uint64_t size)
+{
+  size_t len = strlen(name);
+  if (len < 5 || len >= sizeof(index->files->name)
+      || strncmp(name + len - 5, ".rtb", 4) || !strchr("wmz", name[len - 1]))
+    return;
+
+  struct TbFile file;
+  strcpy(file.name, name);
+  file.dir = dir;
+  file.size = size;
+  if (find_file(index, name, ""))
+    return;
+
+  // Keep the table at most half full.
+  if (2 * (index->count + 1) > index->mask + 1) {
+    unsigned mask = index->mask ? 2 * index->mask + 1 : 255;
+    struct TbFile *files = (struct TbFile *)calloc(mask + 1, sizeof(*files));
+    if (!files)
+      return;
+    for (unsigned i = 0; index->mask && i <= index->mask; i++)
+      if (index->files[i].name[0])
+        insert_file(files, mask, &index->files[i]);
+    free(index->files);
+    index->files = files;
+    index->mask = mask;
+  }
+  insert_file(index->files, index->mask, &file);
+  index->count++;
+}
+
+// List the table files of a directory. Returns false if it cannot be read.
+static bool index_dir(struct TbDirIndex *index, const char *path, int dir)
+{
+#ifndef _WIN32
+  DIR *d = opendir(path);
+  if (!d)
+    return false;
+  struct dirent *e;
+  while ((e = readdir(d))) {
+    struct stat st;
+    if (!strstr(e->d_name, ".rtb")
+        || fstatat(dirfd(d), e->d_name, &st, 0) || !S_ISREG(st.st_mode))
+      continue;
+    add_file(index, e->d_name, dir, (uint64_t)st.st_size);
+  }
+  closedir(d);
+  return true;
+#else
+  char *pattern = (char*)malloc(strlen(path) + 8);
+  strcpy(pattern, path);
+  strcat(pattern, "\\*.rtb?");
+  WIN32_FIND_DATAA data;
+  HANDLE h = FindFirstFileA(pattern, &data);
+  DWORD error = h == INVALID_HANDLE_VALUE ? GetLastError() : 0;
+  free(pattern);
+  if (h == INVALID_HANDLE_VALUE)
+    return error == ERROR_FILE_NOT_FOUND;
+  do {
+    if (!(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+      add_file(index, data.cFileName, dir,
+          (uint64_t)data.nFileSizeHigh << 32 | data.nFileSizeLow);
+  } while (FindNextFileA(h, &data));
+  FindClose(h);
+  return true;
+#endif
+}
+
+static void index_dirs(struct TbDirIndex *index, char **paths, int numPaths)
+{
+  index->listed = (bool*)calloc(numPaths, sizeof(*index->listed));
+  if (!index->listed)
+    return;
+  for (int i = 0; i < numPaths; i++)
+    if ((index->listed[i] = index_dir(index, paths[i], i)))
+      index->dirs++;
+}
+
+static void free_dir_index(struct TbDirIndex *index)
+{
+  free(index->listed);
+  free(index->files);
+  memset(index, 0, sizeof(*index));
+}
+
+// Open a table file, trying the directories in order but skipping the ones
+// that were listed and do not have it.
+static FD open_tb(char **paths, int numPaths, const struct TbDirIndex *index,
+    const char *str, const char *suffix)
 {
   int i;
   FD fd;
   char *file;
+  const struct TbFile *f = find_file(index, str, suffix);
 
   for (i = 0; i < numPaths; i++) {
+    if (index->listed && index->listed[i] && (!f || f->dir != i))
+      continue;
     file = (char*)malloc(strlen(paths[i]) + strlen(str) +
                          strlen(suffix) + 2);
     strcpy(file, paths[i]);
@@ -333,7 +560,7 @@ static void close_tb(FD fd)
 #endif
 }
 
-static void *map_file(FD fd, map_t *mapping)
+static void *map_file(FD fd, map_t *mapping, size_t *size)
 {
 #ifndef _WIN32
   struct stat statbuf;
@@ -343,6 +570,7 @@ static void *map_file(FD fd, map_t *mapping)
     return NULL;
   }
   *mapping = statbuf.st_size;
+  *size = statbuf.st_size;
   void *data = mmap(NULL, statbuf.st_size, PROT_READ,
 			      MAP_SHARED, fd, 0);
   if (data == MAP_FAILED) {
@@ -365,6 +593,7 @@ static void *map_file(FD fd, map_t *mapping)
     return NULL;
   }
   *mapping = (map_t)map;
+  *size = (size_t)(((uint64_t)size_high << 32) | size_low);
   void *data = (void *)MapViewOfFile(map, FILE_MAP_READ, 0, 0, 0);
   if (data == NULL) {
     fprintf(stderr,"MapViewOfFile() failed, error = %lu.\n", GetLastError());
@@ -394,14 +623,96 @@ static void unmap_file(void *data, map_t mapping)
 }
 #endif
 
+// Tables loaded into anonymous memory instead of being mapped from file,
+// see tb_set_huge_pages().
+#define TB_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+static unsigned hugePieces = 0;
+static bool hugeLock = false;
+
+static void *alloc_anon(size_t size, map_t *mapping)
+{
+#ifndef _WIN32
+  size_t len = (size + TB_HUGE_PAGE_SIZE - 1) & ~(size_t)(TB_HUGE_PAGE_SIZE - 1);
+  void *data = MAP_FAILED;
+#ifdef MAP_HUGETLB
+  // Explicit huge pages, if any have been reserved.
+  data = mmap(NULL, len, PROT_READ | PROT_WRITE,
+              MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+  if (data == MAP_FAILED) {
+    // Otherwise transparent huge pages, which need a 2 MB aligned range.
+    uint8_t *raw = (uint8_t *)mmap(NULL, len + TB_HUGE_PAGE_SIZE,
+        PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) {
+      perror("mmap");
+      return NULL;
+    }
+    uint8_t *aligned = (uint8_t *)(((uintptr_t)raw + TB_HUGE_PAGE_SIZE - 1)
+                                   & ~(uintptr_t)(TB_HUGE_PAGE_SIZE - 1));
+    if (aligned > raw)
+      munmap(raw, aligned - raw);
+    if (aligned + len < raw + len + TB_HUGE_PAGE_SIZE)
+      munmap(aligned + len, raw + TB_HUGE_PAGE_SIZE - aligned);
+    data = aligned;
+#ifdef MADV_HUGEPAGE
+    madvise(data, len, MADV_HUGEPAGE);
+#endif
+  }
+  if (hugeLock && mlock(data, len) != 0)
+    perror("mlock");
+  *mapping = len;
+#else
+  void *data = NULL;
+  SIZE_T large = GetLargePageMinimum();
+  if (large) {
+    // Large pages need the "Lock pages in memory" privilege and are never
+    // paged out.
+    SIZE_T len = (size + large - 1) & ~(large - 1);
+    data = VirtualAlloc(NULL, len, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES,
+                        PAGE_READWRITE);
+  }
+  if (!data) {
+    data = VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    if (!data) {
+      fprintf(stderr, "VirtualAlloc() failed, error = %lu.\n", GetLastError());
+      return NULL;
+    }
+    if (hugeLock && !VirtualLock(data, size))
+      fprintf(stderr, "VirtualLock() failed, error = %lu.\n", GetLastError());
+  }
+  *mapping = NULL;
+#endif
+  return data;
+}
+
+static void free_anon(void *data, map_t mapping)
+{
+#ifndef _WIN32
+  if (munmap(data, mapping) != 0)
+    perror("munmap");
+#else
+  (void)mapping;
+  if (!VirtualFree(data, 0, MEM_RELEASE))
+    fprintf(stderr, "VirtualFree() failed, error = %lu.\n", GetLastError());
+#endif
+}
+
+void tb_set_huge_pages(unsigned pieces, bool lock)
+{
+  hugePieces = pieces;
+  hugeLock = lock;
+}
+
 #define poplsb(x)               ((x) & ((x) - 1))
 
 int TB_MaxCardinality = 0, TB_MaxCardinalityDTM = 0;
 unsigned TB_LARGEST = 0;
+unsigned TB_LARGEST_DTM = 0;
 //extern int TB_CardinalityDTM;
 
 static const char *tbSuffix[] = { ".rtbw", ".rtbm", ".rtbz" };
-static uint32_t tbMagic[] = { 0x5d23e871, 0x88ac504b, 0xa50c66d7 };
+static const uint32_t tbMagic[] = { 0x5d23e871, 0x88ac504b, 0xa50c66d7 };
 
 enum { WDL, DTM, DTZ };
 enum { PIECE_ENC, FILE_ENC, RANK_ENC };
@@ -416,29 +727,56 @@ struct PairsData {
   uint16_t *offset;
   uint8_t *symLen;
   uint8_t *symPat;
+#ifndef TB_NO_DECODE_LUT
+  uint32_t *lut;
+#endif
   uint8_t blockSize;
   uint8_t idxBits;
   uint8_t minLen;
   uint8_t constValue[2];
+  size_t tbSize;  // values in the table
+  size_t size[3]; // bytes in indexTable, sizeTable and data
+  size_t bytes;   // allocated, with base[], the LUT and symLen
   uint64_t base[1];
 };
 
+struct EncInfo;
+struct BaseEntry;
+
+// Computes the index of the squares in p; see encode().
+typedef size_t (*encode_func)(int *p, struct EncInfo *ei, struct BaseEntry *be);
+
 struct EncInfo {
   struct PairsData *precomp;
+  uint8_t *bitbase;   // WDL only, see build_bitbases()
+  encode_func encode;
   size_t factor[TB_PIECES];
   uint8_t pieces[TB_PIECES];
   uint8_t norm[TB_PIECES];
 };
 
+struct TbMapping;
+struct NumaCopy;
+
 struct BaseEntry {
   uint64_t key;
+  struct TbContext *ctx;
   uint8_t *data[3];
-  map_t mapping[3];
+  struct TbMapping *map[3];
 #ifdef __cplusplus
   atomic<bool> ready[3];
 #else
   atomic_bool ready[3];
 #endif
+  atomic_flag lock;
+#ifdef __cplusplus
+  atomic<uint32_t> lastUse;
+#else
+  _Atomic uint32_t lastUse;
+#endif
+  bool evicted[3];
+  uint32_t evictPass;
+  char name[16];
   uint8_t num;
   bool symmetric, hasPawns, hasDtm, hasDtz;
   union {
@@ -446,8 +784,354 @@ struct BaseEntry {
     uint8_t pawns[2];
   };
   bool dtmLossOnly;
+  bool hasBitbase;
+  int8_t bitbaseWdl[4]; // the WDL value of each 2-bit code
+  struct NumaCopy *numa; // WDL only, see replicate_table()
+};
+
+// Locks for rare and short critical sections: waiting threads simply spin
+// and yield.
+static void spin_lock(atomic_flag *lock)
+{
+  while (atomic_flag_test_and_set_explicit(lock, memory_order_acquire))
+    TB_YIELD();
+}
+
+static void spin_unlock(atomic_flag *lock)
+{
+  atomic_flag_clear_explicit(lock, memory_order_release);
+}
+
+// Lock held while one of the tables of an entry is being loaded. Loading
+// can take long (huge page copies, lookup tables, NUMA copies), so threads
+// waiting for it sleep on a condition variable shared by all entries
+// instead of spinning.
+#ifndef TB_NO_THREADS
+#ifndef _WIN32
+static pthread_mutex_t loadLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t loadDone = PTHREAD_COND_INITIALIZER;
+#else
+static SRWLOCK loadLock = SRWLOCK_INIT;
+static CONDITION_VARIABLE loadDone = CONDITION_VARIABLE_INIT;
+#endif
+#endif
+
+static void lock_entry(struct BaseEntry *be)
+{
+#ifndef TB_NO_THREADS
+  if (!atomic_flag_test_and_set_explicit(&be->lock, memory_order_acquire))
+    return;
+#ifndef _WIN32
+  pthread_mutex_lock(&loadLock);
+  while (atomic_flag_test_and_set_explicit(&be->lock, memory_order_acquire))
+    pthread_cond_wait(&loadDone, &loadLock);
+  pthread_mutex_unlock(&loadLock);
+#else
+  AcquireSRWLockExclusive(&loadLock);
+  while (atomic_flag_test_and_set_explicit(&be->lock, memory_order_acquire))
+    SleepConditionVariableSRW(&loadDone, &loadLock, INFINITE, 0);
+  ReleaseSRWLockExclusive(&loadLock);
+#endif
+#else
+  spin_lock(&be->lock);
+#endif
+}
+
+// Taking loadLock before waking the waiters makes sure none of them is
+// between its failed test and its wait.
+static void unlock_entry(struct BaseEntry *be)
+{
+  spin_unlock(&be->lock);
+#ifndef TB_NO_THREADS
+#ifndef _WIN32
+  pthread_mutex_lock(&loadLock);
+  pthread_cond_broadcast(&loadDone);
+  pthread_mutex_unlock(&loadLock);
+#else
+  AcquireSRWLockExclusive(&loadLock);
+  WakeAllConditionVariable(&loadDone);
+  ReleaseSRWLockExclusive(&loadLock);
+#endif
+#endif
+}
+
+// Each thread keeps the blocks it decoded last in a small direct-mapped
+// cache: the symbol of every Huffman code decoded so far and the index of
+// the last value the code stands for. A probe of a cached block is then a
+// binary search and a walk down the symbol's pairs, or a decode that
+// carries on where the last one stopped. Slots are keyed by the
+// table's PairsData and the block number; blockEpoch moves whenever a table
+// is unloaded, since its PairsData may then be reused for another table.
+#if TB_BLOCK_CACHE_SLOTS > 0
+struct BlockSlot {
+  const struct PairsData *d;
+  uint32_t block;
+  uint16_t codes;             // decoded so far
+  uint16_t sym[TB_BLOCK_CACHE_CODES];
+  uint16_t last[TB_BLOCK_CACHE_CODES];
+  uint64_t code;              // where decode_block() goes on
+  uint32_t bitCnt;
+  uint32_t words;
+};
+
+struct BlockCache {
+  uint32_t epoch;
+  struct BlockSlot slot[TB_BLOCK_CACHE_SLOTS];
+};
+
+#ifdef __cplusplus
+static atomic<uint32_t> blockEpoch(0);
+#else
+static _Atomic uint32_t blockEpoch = 0;
+#endif
+#endif
+
+// Hazard slots. A thread publishes each entry it is about to probe in a
+// slot of its own record before it checks that the table is loaded. A
+// table is only unmapped after its ready flag has been cleared and no slot
+// refers to it, so probes never need a lock. Records stay on the list for
+// the lifetime of the process, but when a thread exits its caches are
+// freed and its record is handed to the next new thread, so the list is
+// only as long as the most threads that ever probed at once.
+#define TB_HAZARDS 4
+
+struct ThreadRecord {
+#ifdef __cplusplus
+  atomic<struct BaseEntry *> hazard[TB_HAZARDS];
+  atomic<struct TbContext *> context; // see enter_default()
+  atomic<bool> unused;                // the thread has exited
+  atomic<struct WdlCache *> wdlCache; // see enter_wdl_cache()
+#else
+  struct BaseEntry *_Atomic hazard[TB_HAZARDS];
+  struct TbContext *_Atomic context;
+  _Atomic bool unused;
+  struct WdlCache *_Atomic wdlCache;
+#endif
+  int depth;
+  int contextDepth;
+  int wdlCacheDepth;
+#if TB_BLOCK_CACHE_SLOTS > 0
+  struct BlockCache *blocks;  // allocated on first use
+#endif
+#ifdef TB_STATS
+  struct TbTableStats *stats; // indexed by entry_index(), under statsLock
+  unsigned statsEpoch;        // stats are stale unless this is statsEpoch
+#endif
+  bool noWait;                // in tb_probe_wdl_nonblocking()
+  bool ioPending;             // a probe stopped short of a page fault
+  uintptr_t residentPages[TB_RESIDENT_PAGES]; // see pages_resident()
+  int node;                   // see thread_node()
+  unsigned nodeAge;
+  struct ThreadRecord *next;
 };
 
+#ifdef __cplusplus
+static atomic<struct ThreadRecord *> threadRecords(NULL);
+#else
+static struct ThreadRecord *_Atomic threadRecords = NULL;
+#endif
+static TB_TLS struct ThreadRecord *threadRecord = NULL;
+
+#ifdef TB_STATS
+// The counts of threads that have exited, see thread_exit(). statsLock
+// keeps tb_get_stats() from reading the copy of a thread while it goes.
+static struct TbTableStats *retiredStats = NULL;
+static unsigned retiredEpoch = 0;
+static atomic_flag statsLock = ATOMIC_FLAG_INIT;
+static void retire_stats(struct ThreadRecord *tr);
+#endif
+
+static void thread_exit(struct ThreadRecord *tr)
+{
+#if TB_BLOCK_CACHE_SLOTS > 0
+  free(tr->blocks);
+  tr->blocks = NULL;
+#endif
+#ifdef TB_STATS
+  while (atomic_flag_test_and_set(&statsLock))
+    ;
+  retire_stats(tr);
+  free(tr->stats);
+  tr->stats = NULL;
+  atomic_flag_clear(&statsLock);
+#endif
+  threadRecord = NULL;
+  atomic_store_explicit(&tr->unused, true, memory_order_release);
+}
+
+// A destructor for the thread record, run when its thread exits.
+#ifndef TB_NO_THREADS
+#ifndef _WIN32
+static pthread_key_t threadKey;
+static pthread_once_t threadKeyOnce = PTHREAD_ONCE_INIT;
+
+static void thread_key_exit(void *tr)
+{
+  thread_exit((struct ThreadRecord *)tr);
+}
+
+static void thread_key_create(void)
+{
+  pthread_key_create(&threadKey, thread_key_exit);
+}
+
+static void thread_key_set(struct ThreadRecord *tr)
+{
+  pthread_once(&threadKeyOnce, thread_key_create);
+  pthread_setspecific(threadKey, tr);
+}
+#else
+static DWORD threadKey = FLS_OUT_OF_INDEXES;
+static INIT_ONCE threadKeyOnce = INIT_ONCE_STATIC_INIT;
+
+static VOID WINAPI thread_key_exit(PVOID tr)
+{
+  if (tr)
+    thread_exit((struct ThreadRecord *)tr);
+}
+
+static BOOL CALLBACK thread_key_create(PINIT_ONCE once, PVOID param,
+    PVOID *context)
+{
+  (void)once; (void)param; (void)context;
+  threadKey = FlsAlloc(thread_key_exit);
+  return TRUE;
+}
+
+static void thread_key_set(struct ThreadRecord *tr)
+{
+  InitOnceExecuteOnce(&threadKeyOnce, thread_key_create, NULL, NULL);
+  if (threadKey != FLS_OUT_OF_INDEXES)
+    FlsSetValue(threadKey, tr);
+}
+#endif
+#else
+#define thread_key_set(tr) ((void)(tr))
+#endif
+
+// Take over the record of a thread that has exited, or add a new one.
+static struct ThreadRecord *reuse_thread_record(void)
+{
+  for (struct ThreadRecord *tr = atomic_load(&threadRecords); tr; tr = tr->next) {
+    bool unused = true;
+    if (atomic_load_explicit(&tr->unused, memory_order_relaxed)
+        && atomic_compare_exchange_strong(&tr->unused, &unused, false))
+      return tr;
+  }
+
+  struct ThreadRecord *tr = (struct ThreadRecord *)malloc(sizeof(struct ThreadRecord));
+  if (!tr) {
+    fprintf(stderr, "Could not allocate thread record.\n");
+    exit(EXIT_FAILURE);
+  }
+  for (int i = 0; i < TB_HAZARDS; i++)
+    atomic_init(&tr->hazard[i], (struct BaseEntry *)NULL);
+  atomic_init(&tr->context, (struct TbContext *)NULL);
+  atomic_init(&tr->unused, false);
+  atomic_init(&tr->wdlCache, (struct WdlCache *)NULL);
+#if TB_BLOCK_CACHE_SLOTS > 0
+  tr->blocks = NULL;
+#endif
+#ifdef TB_STATS
+  tr->stats = NULL;
+#endif
+  tr->next = atomic_load(&threadRecords);
+  while (!atomic_compare_exchange_weak(&threadRecords, &tr->next, tr))
+    ;
+  return tr;
+}
+
+static struct ThreadRecord *thread_record(void)
+{
+  struct ThreadRecord *tr = threadRecord;
+  if (!tr) {
+    tr = reuse_thread_record();
+    tr->depth = 0;
+    tr->contextDepth = 0;
+    tr->wdlCacheDepth = 0;
+    tr->noWait = false;
+    tr->ioPending = false;
+    memset(tr->residentPages, 0, sizeof(tr->residentPages));
+    tr->node = 0;
+    tr->nodeAge = 0;
+#ifdef TB_STATS
+    struct TbTableStats *stats = (struct TbTableStats *)calloc(
+        TB_MAX_PIECE + TB_MAX_PAWN, sizeof(struct TbTableStats));
+    if (!stats) {
+      fprintf(stderr, "Could not allocate thread record.\n");
+      exit(EXIT_FAILURE);
+    }
+    while (atomic_flag_test_and_set(&statsLock))
+      ;
+    tr->stats = stats;
+    tr->statsEpoch = 0;
+    atomic_flag_clear(&statsLock);
+#endif
+    threadRecord = tr;
+    thread_key_set(tr);
+  }
+  return tr;
+}
+
+// Fails if all the slots of the thread are taken. Probes do not nest that
+// deep, but the caller then fails its probe rather than overrun the slots.
+static bool acquire_entry(struct BaseEntry *be)
+{
+  struct ThreadRecord *tr = thread_record();
+  if (tr->depth >= TB_HAZARDS)
+    return false;
+  atomic_store(&tr->hazard[tr->depth++], be);
+  return true;
+}
+
+static void release_entry(void)
+{
+  struct ThreadRecord *tr = threadRecord;
+  atomic_store_explicit(&tr->hazard[--tr->depth], (struct BaseEntry *)NULL,
+                        memory_order_release);
+}
+
+static bool entry_in_use(const struct BaseEntry *be)
+{
+  for (struct ThreadRecord *tr = atomic_load(&threadRecords); tr; tr = tr->next)
+    for (int i = 0; i < TB_HAZARDS; i++)
+      if (atomic_load(&tr->hazard[i]) == be)
+        return true;
+  return false;
+}
+
+// Residency accounting. clock advances each time a table is mapped and
+// entries remember the clock value of their last probe, which gives an
+// approximate LRU order without writing to shared memory on every probe.
+static struct {
+#ifdef __cplusplus
+  atomic<uint64_t> budget;
+  atomic<uint64_t> bytes;
+  atomic<uint64_t> loads;
+  atomic<uint64_t> evictions;
+  atomic<uint64_t> remaps;
+  atomic<uint32_t> tables;
+  atomic<uint32_t> clock;
+#else
+  _Atomic uint64_t budget;
+  _Atomic uint64_t bytes;
+  _Atomic uint64_t loads;
+  _Atomic uint64_t evictions;
+  _Atomic uint64_t remaps;
+  _Atomic uint32_t tables;
+  _Atomic uint32_t clock;
+#endif
+  atomic_flag evicting;
+  uint32_t pass;
+} residency;
+
+static void touch_entry(struct BaseEntry *be)
+{
+  uint32_t now = atomic_load_explicit(&residency.clock, memory_order_relaxed);
+  if (atomic_load_explicit(&be->lastUse, memory_order_relaxed) != now)
+    atomic_store_explicit(&be->lastUse, now, memory_order_relaxed);
+}
+
 struct PieceEntry {
   struct BaseEntry be;
   struct EncInfo ei[5]; // 2 + 2 + 1
@@ -474,37 +1158,390 @@ struct TbHashEntry {
   struct BaseEntry *ptr;
 };
 
-static int tbNumPiece, tbNumPawn;
-static int numWdl, numDtm, numDtz;
-
-static struct PieceEntry *pieceEntry;
-static struct PawnEntry *pawnEntry;
-static struct TbHashEntry tbHash[1 << TB_HASHBITS];
+// The tables found under one path. tb_init() and the rest of the static
+// API work on the default context, tb_context_create() makes further
+// contexts. Contexts that find the same file share its mapping, see map_tb().
+struct TbContext {
+  char *pathString;
+  char **paths;
+  int numPaths;
+  struct TbDirIndex index;
+  int tbNumPiece, tbNumPawn;
+  int numWdl, numDtm, numDtz;
+  unsigned numBitbases;
+  uint64_t bitbaseBytes;
+  int maxCardinality, maxCardinalityDTM;
+  unsigned largest;
+  bool anySize;       // list incomplete files too, for tb_verify()
+  uint64_t id;        // never reused, keeps contexts apart in the WDL cache
+  struct PieceEntry *pieceEntry;
+  struct PawnEntry *pawnEntry;
+  struct TbContext *next;
+  struct TbHashEntry tbHash[1 << TB_HASHBITS];
+};
 
-static void init_indices(void);
+// The default context is the one tb_init() published last. tb_init()
+// builds a new context off to the side and swaps it in while other threads
+// may still be probing the old one; each thread publishes the context it
+// is probing in its thread record, and the old context is freed once no
+// record refers to it any more. emptyContext stands in when no path is set.
+static struct TbContext emptyContext;
+#ifdef __cplusplus
+static atomic<struct TbContext *> defaultContext(&emptyContext);
+#else
+static struct TbContext *_Atomic defaultContext = &emptyContext;
+#endif
+static atomic_flag initLock = ATOMIC_FLAG_INIT;
 
-// Forward declarations. These functions without the tb_
-// prefix take a pos structure as input.
-static int probe_wdl(Pos *pos, int *success);
-static int probe_dtz(Pos *pos, int *success);
-static int root_probe_wdl(const Pos *pos, bool useRule50, struct TbRootMoves *rm);
-static int root_probe_dtz(const Pos *pos, bool hasRepeated, bool useRule50, struct TbRootMoves *rm);
-static uint16_t probe_root(Pos *pos, int *score, unsigned *results);
+// All live contexts, for eviction.
+static struct TbContext *contexts = NULL;
+static atomic_flag contextsLock = ATOMIC_FLAG_INIT;
 
-unsigned tb_probe_wdl_impl(
-    uint64_t white,
-    uint64_t black,
-    uint64_t kings,
-    uint64_t queens,
-    uint64_t rooks,
-    uint64_t bishops,
-    uint64_t knights,
-    uint64_t pawns,
-    unsigned ep,
-    bool turn)
+// Pin the default context for the calling thread until leave_default().
+// Calls nest, the outermost one decides the context.
+static struct TbContext *enter_default(void)
 {
-    Pos pos =
-    {
+  struct ThreadRecord *tr = thread_record();
+  if (tr->contextDepth++)
+    return atomic_load_explicit(&tr->context, memory_order_relaxed);
+
+  // Publish before checking that the context is still the default one, so
+  // that tb_init() either sees the record or we see its new context.
+  struct TbContext *ctx = atomic_load(&defaultContext);
+  for (;;) {
+    atomic_store(&tr->context, ctx);
+    struct TbContext *now = atomic_load(&defaultContext);
+    if (now == ctx)
+      return ctx;
+    ctx = now;
+  }
+}
+
+static void leave_default(void)
+{
+  struct ThreadRecord *tr = threadRecord;
+  if (--tr->contextDepth == 0)
+    atomic_store_explicit(&tr->context, (struct TbContext *)NULL,
+                          memory_order_release);
+}
+
+static bool context_in_use(const struct TbContext *ctx)
+{
+  for (struct ThreadRecord *tr = atomic_load(&threadRecords); tr; tr = tr->next)
+    if (atomic_load(&tr->context) == ctx)
+      return true;
+  return false;
+}
+
+static struct BaseEntry *context_entry(struct TbContext *ctx, int i)
+{
+  return i < ctx->tbNumPiece ? &ctx->pieceEntry[i].be
+                             : &ctx->pawnEntry[i - ctx->tbNumPiece].be;
+}
+
+// Probe statistics. Every thread counts into its own copy of the table
+// statistics, hung off its thread record, so counting needs neither
+// locks nor atomics. tb_get_stats() adds the copies up.
+#ifdef TB_STATS
+static TB_TLS int statsDepth = 0; // capture resolution depth
+#define STATS_ENTER() (statsDepth++)
+#define STATS_LEAVE() (statsDepth--)
+
+static int entry_index(const struct BaseEntry *be)
+{
+  return be->hasPawns
+         ? TB_MAX_PIECE + (int)((const struct PawnEntry *)be - be->ctx->pawnEntry)
+         : (int)((const struct PieceEntry *)be - be->ctx->pieceEntry);
+}
+
+// Only the tables of the default context are counted, the others count
+// into a scratch copy that is never reported. The counts are indexed by
+// the position of the entry in its context, so they are only good for
+// the context they were counted in: tb_init() and tb_reset_stats() move
+// on to a new epoch, and each thread clears its own copy once it sees
+// that. Until then tb_get_stats() leaves the copy out.
+static TB_TLS struct TbTableStats statsSink;
+#ifdef __cplusplus
+static atomic<unsigned> statsEpoch(0);
+#else
+static atomic_uint statsEpoch = 0;
+#endif
+
+static struct TbTableStats *entry_stats(const struct BaseEntry *be)
+{
+  if (be->ctx != atomic_load_explicit(&defaultContext, memory_order_relaxed))
+    return &statsSink;
+  struct ThreadRecord *tr = thread_record();
+  unsigned epoch = atomic_load_explicit(&statsEpoch, memory_order_relaxed);
+  if (tr->statsEpoch != epoch) {
+    memset(tr->stats, 0, (TB_MAX_PIECE + TB_MAX_PAWN) * sizeof(struct TbTableStats));
+    tr->statsEpoch = epoch;
+  }
+  return &tr->stats[entry_index(be)];
+}
+
+// cached is what decompress_pairs() told about the block cache.
+static void stats_time(const struct BaseEntry *be, int type, uint64_t ticks,
+    int cached)
+{
+  int bucket = 0;
+  while ((ticks >>= 1) && bucket < TB_STATS_TIME_BUCKETS - 1)
+    bucket++;
+  struct TbTableStats *ts = entry_stats(be);
+  ts->decompress[bucket]++;
+  if (cached > 0)
+    ts->blockHits[type]++;
+  else if (cached == 0)
+    ts->blockMisses[type]++;
+}
+#else
+#define STATS_ENTER()   /* NOP */
+#define STATS_LEAVE()   /* NOP */
+#endif
+
+static void init_indices(void);
+static void build_bitbases(struct TbContext *ctx);
+
+// Forward declarations. These functions without the tb_
+// prefix take a pos structure as input.
+static int probe_wdl(Pos *pos, int *success);
+static int probe_dtz(Pos *pos, int *success);
+static int root_probe_wdl(const Pos *pos, bool useRule50, struct TbRootMoves *rm);
+static int root_probe_dtz(const Pos *pos, bool hasRepeated, bool useRule50, struct TbRootMoves *rm);
+static int root_probe_dtm(const Pos *pos, struct TbRootMoves *rm);
+static Value TB_probe_dtm(const Pos *pos, int wdl, int *success);
+static void tb_expand_mate(Pos *pos, struct TbRootMove *move, Value moveScore, unsigned cardinalityDTM);
+static uint16_t probe_root(Pos *pos, int *score, unsigned *results);
+
+// WDL result cache. Each entry stores (hash ^ data) next to data, so an
+// entry torn by two threads writing at once fails validation and reads as
+// a miss. No locking is needed on either the probe or the store path.
+#define WDL_CACHE_VALID 0x8ULL
+
+struct WdlCacheEntry {
+#ifdef __cplusplus
+  atomic<uint64_t> hash;
+  atomic<uint64_t> data;
+#else
+  _Atomic uint64_t hash;
+  _Atomic uint64_t data;
+#endif
+};
+
+// tb_set_wdl_cache() replaces the cache as tb_init() does the default
+// context: probes pin the cache they use in their thread record, and the
+// old one is freed once no record refers to it.
+struct WdlCache {
+  size_t mask;
+  struct WdlCacheEntry *entry;
+};
+
+#ifdef __cplusplus
+static atomic<struct WdlCache *> wdlCache(NULL);
+#else
+static struct WdlCache *_Atomic wdlCache = NULL;
+#endif
+static atomic_flag wdlCacheLock = ATOMIC_FLAG_INIT;
+
+// Pin the cache for the calling thread until leave_wdl_cache(). Calls
+// nest, the outermost one decides the cache, which may be NULL.
+static struct WdlCache *enter_wdl_cache(void)
+{
+  struct ThreadRecord *tr = thread_record();
+  if (tr->wdlCacheDepth++)
+    return atomic_load_explicit(&tr->wdlCache, memory_order_relaxed);
+
+  struct WdlCache *c = atomic_load(&wdlCache);
+  for (;;) {
+    atomic_store(&tr->wdlCache, c);
+    struct WdlCache *now = atomic_load(&wdlCache);
+    if (now == c)
+      return c;
+    c = now;
+  }
+}
+
+static void leave_wdl_cache(void)
+{
+  struct ThreadRecord *tr = threadRecord;
+  if (--tr->wdlCacheDepth == 0)
+    atomic_store_explicit(&tr->wdlCache, (struct WdlCache *)NULL,
+                          memory_order_release);
+}
+
+static bool wdl_cache_in_use(const struct WdlCache *c)
+{
+  for (struct ThreadRecord *tr = atomic_load(&threadRecords); tr; tr = tr->next)
+    if (atomic_load(&tr->wdlCache) == c)
+      return true;
+  return false;
+}
+
+static inline uint64_t wdl_cache_mix(uint64_t h, uint64_t x)
+{
+  h = (h ^ x) * 0x9e3779b97f4a7c15ULL;
+  return h ^ (h >> 29);
+}
+
+// Hash of the full position and the context it is probed in, so that
+// contexts with different tables never see each other's results. Castling
+// rights and the 50-move counter are not part of it since only positions
+// with neither are ever probed.
+static uint64_t wdl_cache_hash(const Pos *pos)
+{
+  uint64_t h = pos->turn ? 0x2545f4914f6cdd1dULL : 0x9e6c63d0676a9a99ULL;
+  h = wdl_cache_mix(h, pos->ctx ? pos->ctx->id : 0);
+  h = wdl_cache_mix(h, pos->white);
+  h = wdl_cache_mix(h, pos->black);
+  h = wdl_cache_mix(h, pos->kings);
+  h = wdl_cache_mix(h, pos->queens);
+  h = wdl_cache_mix(h, pos->rooks);
+  h = wdl_cache_mix(h, pos->bishops);
+  h = wdl_cache_mix(h, pos->knights);
+  h = wdl_cache_mix(h, pos->pawns);
+  return wdl_cache_mix(h, pos->ep);
+}
+
+static bool wdl_cache_probe(struct WdlCache *c, uint64_t hash, int *v)
+{
+  struct WdlCacheEntry *e = &c->entry[hash & c->mask];
+  uint64_t data = atomic_load_explicit(&e->data, memory_order_relaxed);
+  uint64_t check = atomic_load_explicit(&e->hash, memory_order_relaxed);
+  if (!(data & WDL_CACHE_VALID) || (check ^ data) != hash)
+    return false;
+  *v = (int)(data & 0x7) - 2;
+  return true;
+}
+
+static void wdl_cache_store(struct WdlCache *c, uint64_t hash, int v)
+{
+  struct WdlCacheEntry *e = &c->entry[hash & c->mask];
+  uint64_t data = (uint64_t)(v + 2) | WDL_CACHE_VALID;
+  atomic_store_explicit(&e->data, data, memory_order_relaxed);
+  atomic_store_explicit(&e->hash, hash ^ data, memory_order_relaxed);
+}
+
+// probe_wdl() with the result cache in front of it.
+static int probe_wdl_cached(Pos *pos, int *success)
+{
+  // No need to pin a cache that is not there.
+  if (!atomic_load_explicit(&wdlCache, memory_order_relaxed))
+    return probe_wdl(pos, success);
+
+  struct WdlCache *c = enter_wdl_cache();
+  if (!c) {
+    leave_wdl_cache();
+    return probe_wdl(pos, success);
+  }
+  int v;
+  uint64_t hash = wdl_cache_hash(pos);
+  if (wdl_cache_probe(c, hash, &v)) {
+    leave_wdl_cache();
+    *success = 1;
+    return v;
+  }
+  v = probe_wdl(pos, success);
+  if (*success != 0)
+    wdl_cache_store(c, hash, v);
+  leave_wdl_cache();
+  return v;
+}
+
+void tb_clear_wdl_cache(void)
+{
+  struct WdlCache *c = enter_wdl_cache();
+  for (size_t i = 0; c && i <= c->mask; i++) {
+    atomic_store_explicit(&c->entry[i].hash, (uint64_t)0, memory_order_relaxed);
+    atomic_store_explicit(&c->entry[i].data, (uint64_t)0, memory_order_relaxed);
+  }
+  leave_wdl_cache();
+}
+
+bool tb_set_wdl_cache(size_t size_mb)
+{
+  // Largest power of two number of entries that fits in the given size.
+  size_t bytes = size_mb * 1024 * 1024;
+  size_t num = 1;
+  while (num * 2 * sizeof(struct WdlCacheEntry) <= bytes)
+    num *= 2;
+
+  spin_lock(&wdlCacheLock);
+  struct WdlCache *old = atomic_load(&wdlCache);
+
+  // Keep a cache of the right size.
+  if (size_mb != 0 && old && old->mask == num - 1) {
+    tb_clear_wdl_cache();
+    spin_unlock(&wdlCacheLock);
+    return true;
+  }
+
+  struct WdlCache *cache = NULL;
+  if (size_mb != 0) {
+    cache = (struct WdlCache *)malloc(sizeof(struct WdlCache)
+                                      + num * sizeof(struct WdlCacheEntry));
+    if (cache) {
+      cache->mask = num - 1;
+      cache->entry = (struct WdlCacheEntry *)(cache + 1);
+      for (size_t i = 0; i < num; i++) {
+        atomic_init(&cache->entry[i].hash, (uint64_t)0);
+        atomic_init(&cache->entry[i].data, (uint64_t)0);
+      }
+    }
+  }
+
+  // Probes that pinned the old cache finish with it.
+  atomic_store(&wdlCache, cache);
+  while (old && wdl_cache_in_use(old))
+    TB_YIELD();
+  free(old);
+  spin_unlock(&wdlCacheLock);
+  return size_mb == 0 || cache != NULL;
+}
+
+uint64_t tb_material_key(
+    uint64_t white,
+    uint64_t black,
+    uint64_t queens,
+    uint64_t rooks,
+    uint64_t bishops,
+    uint64_t knights,
+    uint64_t pawns)
+{
+    Pos pos =
+    {
+        white,
+        black,
+        0,
+        queens,
+        rooks,
+        bishops,
+        knights,
+        pawns,
+        0,
+        0,
+        true,
+        0,
+        NULL
+    };
+    return calc_key(&pos, false);
+}
+
+static unsigned probe_wdl_key(
+    struct TbContext *ctx,
+    uint64_t white,
+    uint64_t black,
+    uint64_t kings,
+    uint64_t queens,
+    uint64_t rooks,
+    uint64_t bishops,
+    uint64_t knights,
+    uint64_t pawns,
+    unsigned ep,
+    bool turn,
+    uint64_t key)
+{
+    Pos pos =
+    {
         white,
         black,
         kings,
@@ -515,15 +1552,73 @@ unsigned tb_probe_wdl_impl(
         pawns,
         0,
         (uint8_t)ep,
-        turn
+        turn,
+        key,
+        ctx
     };
     int success;
-    int v = probe_wdl(&pos, &success);
+    int v = probe_wdl_cached(&pos, &success);
     if (success == 0)
         return TB_RESULT_FAILED;
     return (unsigned)(v + 2);
 }
 
+unsigned tb_probe_wdl_impl(
+    uint64_t white,
+    uint64_t black,
+    uint64_t kings,
+    uint64_t queens,
+    uint64_t rooks,
+    uint64_t bishops,
+    uint64_t knights,
+    uint64_t pawns,
+    unsigned ep,
+    bool turn)
+{
+    unsigned result = tb_context_probe_wdl_impl(enter_default(), white,
+        black, kings, queens, rooks, bishops, knights, pawns, ep, turn);
+    leave_default();
+    return result;
+}
+
+unsigned tb_probe_wdl_key_impl(
+    uint64_t white,
+    uint64_t black,
+    uint64_t kings,
+    uint64_t queens,
+    uint64_t rooks,
+    uint64_t bishops,
+    uint64_t knights,
+    uint64_t pawns,
+    unsigned ep,
+    bool turn,
+    uint64_t key)
+{
+    unsigned result = probe_wdl_key(enter_default(), white, black, kings,
+        queens, rooks, bishops, knights, pawns, ep, turn, key);
+    leave_default();
+    return result;
+}
+
+unsigned tb_context_probe_wdl_impl(
+    struct TbContext *ctx,
+    uint64_t white,
+    uint64_t black,
+    uint64_t kings,
+    uint64_t queens,
+    uint64_t rooks,
+    uint64_t bishops,
+    uint64_t knights,
+    uint64_t pawns,
+    unsigned ep,
+    bool turn)
+{
+    uint64_t key = tb_material_key(white, black, queens, rooks, bishops,
+        knights, pawns);
+    return probe_wdl_key(ctx, white, black, kings, queens, rooks, bishops,
+        knights, pawns, ep, turn, key);
+}
+
 static unsigned dtz_to_wdl(int cnt50, int dtz)
 {
     int wdl = 0;
@@ -534,7 +1629,8 @@ static unsigned dtz_to_wdl(int cnt50, int dtz)
     return wdl + 2;
 }
 
-unsigned tb_probe_root_impl(
+unsigned tb_context_probe_root_impl(
+    struct TbContext *ctx,
     uint64_t white,
     uint64_t black,
     uint64_t kings,
@@ -560,8 +1656,11 @@ unsigned tb_probe_root_impl(
         pawns,
         (uint8_t)rule50,
         (uint8_t)ep,
-        turn
+        turn,
+        0,
+        ctx
     };
+    pos.key = calc_key(&pos, false);
     int dtz;
     if (!is_valid(&pos))
         return TB_RESULT_FAILED;
@@ -582,7 +1681,29 @@ unsigned tb_probe_root_impl(
     return res;
 }
 
-int tb_probe_root_dtz(
+unsigned tb_probe_root_impl(
+    uint64_t white,
+    uint64_t black,
+    uint64_t kings,
+    uint64_t queens,
+    uint64_t rooks,
+    uint64_t bishops,
+    uint64_t knights,
+    uint64_t pawns,
+    unsigned rule50,
+    unsigned ep,
+    bool turn,
+    unsigned *results)
+{
+    unsigned result = tb_context_probe_root_impl(enter_default(), white,
+        black, kings, queens, rooks, bishops, knights, pawns, rule50, ep, turn,
+        results);
+    leave_default();
+    return result;
+}
+
+int tb_context_probe_root_dtz(
+    struct TbContext *ctx,
     uint64_t white,
     uint64_t black,
     uint64_t kings,
@@ -610,13 +1731,40 @@ int tb_probe_root_dtz(
         pawns,
         (uint8_t)rule50,
         (uint8_t)ep,
-        turn
+        turn,
+        0,
+        ctx
     };
+    pos.key = calc_key(&pos, false);
     if (castling != 0) return 0;
     return root_probe_dtz(&pos, hasRepeated, useRule50, results);
 }
 
-int tb_probe_root_wdl(
+int tb_probe_root_dtz(
+    uint64_t white,
+    uint64_t black,
+    uint64_t kings,
+    uint64_t queens,
+    uint64_t rooks,
+    uint64_t bishops,
+    uint64_t knights,
+    uint64_t pawns,
+    unsigned rule50,
+    unsigned castling,
+    unsigned ep,
+    bool     turn,
+    bool     hasRepeated,
+    bool     useRule50,
+    struct TbRootMoves *results) {
+    int result = tb_context_probe_root_dtz(enter_default(), white, black,
+        kings, queens, rooks, bishops, knights, pawns, rule50, castling, ep,
+        turn, hasRepeated, useRule50, results);
+    leave_default();
+    return result;
+}
+
+int tb_context_probe_root_wdl(
+    struct TbContext *ctx,
     uint64_t white,
     uint64_t black,
     uint64_t kings,
@@ -643,80 +1791,342 @@ int tb_probe_root_wdl(
         pawns,
         (uint8_t)rule50,
         (uint8_t)ep,
-        turn
+        turn,
+        0,
+        ctx
     };
+    pos.key = calc_key(&pos, false);
     if (castling != 0) return 0;
     return root_probe_wdl(&pos, useRule50, results);
 }
 
-// Given a position, produce a text string of the form KQPvKRP, where
-// "KQP" represents the white pieces if flip == false and the black pieces
-// if flip == true.
-static void prt_str(const Pos *pos, char *str, bool flip)
-{
-  int color = flip ? BLACK : WHITE;
-
-  for (int pt = KING; pt >= PAWN; pt--)
-    for (int i = popcount(pieces_by_type(pos, (Color)color, (PieceType)pt)); i > 0; i--)
-      *str++ = piece_to_char[pt];
-  *str++ = 'v';
-  color ^= 1;
-  for (int pt = KING; pt >= PAWN; pt--)
-    for (int i = popcount(pieces_by_type(pos, (Color)color, (PieceType)pt)); i > 0; i--)
-      *str++ = piece_to_char[pt];
-  *str++ = 0;
-}
-
-static bool test_tb(const char *str, const char *suffix)
-{
-  FD fd = open_tb(str, suffix);
-  if (fd != FD_ERR) {
-    size_t size = file_size(fd);
-    close_tb(fd);
-    if ((size & 63) != 16) {
-      fprintf(stderr, "Incomplete tablebase file %s.%s\n", str, suffix);
-      printf("info string Incomplete tablebase file %s.%s\n", str, suffix);
-      fd = FD_ERR;
-    }
-  }
-  return fd != FD_ERR;
+int tb_probe_root_wdl(
+    uint64_t white,
+    uint64_t black,
+    uint64_t kings,
+    uint64_t queens,
+    uint64_t rooks,
+    uint64_t bishops,
+    uint64_t knights,
+    uint64_t pawns,
+    unsigned rule50,
+    unsigned castling,
+    unsigned ep,
+    bool     turn,
+    bool     useRule50,
+    struct TbRootMoves *results) {
+    int result = tb_context_probe_root_wdl(enter_default(), white, black,
+        kings, queens, rooks, bishops, knights, pawns, rule50, castling, ep,
+        turn, useRule50, results);
+    leave_default();
+    return result;
 }
 
-static void *map_tb(const char *name, const char *suffix, map_t *mapping)
+static unsigned probe_dtm_plies(Pos *pos, int *plies)
 {
-  FD fd = open_tb(name, suffix);
-  if (fd == FD_ERR)
-    return NULL;
+    *plies = 0;
 
-  void *data = map_file(fd, mapping);
-  if (data == NULL) {
-    fprintf(stderr, "Could not map %s%s into memory.\n", name, suffix);
-    exit(EXIT_FAILURE);
-  }
-
-  close_tb(fd);
+    TbMove moves[TB_MAX_MOVES];
+    if (gen_legal(pos, moves) == moves)
+        return is_check(pos) ? TB_LOSS : TB_DRAW;
 
-  return data;
+    int success;
+    int wdl = probe_wdl(pos, &success);
+    if (!success)
+        return TB_RESULT_FAILED;
+    if (wdl != 0) {
+        Value v = TB_probe_dtm(pos, wdl, &success);
+        if (!success || (v > 0) != (wdl > 0) || v > TB_VALUE_MATE || v < -TB_VALUE_MATE)
+            return TB_RESULT_FAILED;
+        *plies = wdl > 0 ? TB_VALUE_MATE - v : -(TB_VALUE_MATE + v);
+    }
+    return (unsigned)(wdl + 2);
 }
 
-static void add_to_hash(struct BaseEntry *ptr, uint64_t key)
-{
-  int idx;
-
-  idx = key >> (64 - TB_HASHBITS);
-  while (tbHash[idx].ptr)
+unsigned tb_probe_dtm_impl(
+    uint64_t white,
+    uint64_t black,
+    uint64_t kings,
+    uint64_t queens,
+    uint64_t rooks,
+    uint64_t bishops,
+    uint64_t knights,
+    uint64_t pawns,
+    unsigned ep,
+    bool     turn,
+    int     *plies)
+{
+    Pos pos =
+    {
+        white,
+        black,
+        kings,
+        queens,
+        rooks,
+        bishops,
+        knights,
+        pawns,
+        0,
+        (uint8_t)ep,
+        turn,
+        0,
+        enter_default()
+    };
+    pos.key = calc_key(&pos, false);
+    unsigned result = probe_dtm_plies(&pos, plies);
+    leave_default();
+    return result;
+}
+
+int tb_probe_root_dtm(
+    uint64_t white,
+    uint64_t black,
+    uint64_t kings,
+    uint64_t queens,
+    uint64_t rooks,
+    uint64_t bishops,
+    uint64_t knights,
+    uint64_t pawns,
+    unsigned rule50,
+    unsigned castling,
+    unsigned ep,
+    bool     turn,
+    bool     hasRepeated,
+    bool     useRule50,
+    struct TbRootMoves *results)
+{
+    Pos pos =
+    {
+        white,
+        black,
+        kings,
+        queens,
+        rooks,
+        bishops,
+        knights,
+        pawns,
+        (uint8_t)rule50,
+        (uint8_t)ep,
+        turn,
+        0,
+        NULL
+    };
+    if (castling != 0) return 0;
+    pos.ctx = enter_default();
+    pos.key = calc_key(&pos, false);
+
+    // root_probe_dtm() needs to know which moves win, draw or lose.
+    int result = (root_probe_dtz(&pos, hasRepeated, useRule50, results)
+                  || root_probe_wdl(&pos, useRule50, results))
+                 && root_probe_dtm(&pos, results);
+
+    for (unsigned i = 0; result && i < results->size; i++) {
+        struct TbRootMove *m = &results->moves[i];
+        if (m->tbScore != TB_VALUE_DRAW)
+            tb_expand_mate(&pos, m, m->tbScore,
+                (unsigned)pos.ctx->maxCardinalityDTM);
+    }
+    leave_default();
+    return result;
+}
+
+// Whether the table file str + suffix (e.g. "KQPvKRP" ".rtbw") exists under
+// the context's paths and, unless anySize is set, has the size of a
+// complete table.
+static bool test_tb(struct TbContext *ctx, const char *str, const char *suffix)
+{
+  // The index answers unless a directory that could not be listed comes
+  // first; then the file has to be looked for by name.
+  uint64_t size;
+  const struct TbFile *f = find_file(&ctx->index, str, suffix);
+  int dir = 0;
+  if (f)
+    while (dir < f->dir && ctx->index.listed[dir])
+      dir++;
+  if (f && dir == f->dir)
+    size = f->size;
+  else {
+    FD fd = open_tb(ctx->paths, ctx->numPaths, &ctx->index, str, suffix);
+    if (fd == FD_ERR)
+      return false;
+    size = file_size(fd);
+    close_tb(fd);
+  }
+  if ((size & 63) != 16 && !ctx->anySize) {
+    fprintf(stderr, "Incomplete tablebase file %s%s\n", str, suffix);
+    printf("info string Incomplete tablebase file %s%s\n", str, suffix);
+    return false;
+  }
+  return true;
+}
+
+// A table file mapped into memory. Contexts that find the same file share
+// its mapping, which goes away with its last user.
+struct TbMapping {
+  uint64_t id[2]; // device or volume, and file number
+  uint8_t *data;
+  map_t mapping;
+  size_t size;
+  bool anon;
+  int refs;
+  struct TbMapping *next;
+};
+
+static struct TbMapping *mappings = NULL;
+static atomic_flag mappingsLock = ATOMIC_FLAG_INIT;
+
+static bool file_id(FD fd, uint64_t id[2])
+{
+#ifndef _WIN32
+  struct stat statbuf;
+  if (fstat(fd, &statbuf))
+    return false;
+  id[0] = (uint64_t)statbuf.st_dev;
+  id[1] = (uint64_t)statbuf.st_ino;
+#else
+  BY_HANDLE_FILE_INFORMATION info;
+  if (!GetFileInformationByHandle(fd, &info))
+    return false;
+  id[0] = info.dwVolumeSerialNumber;
+  id[1] = ((uint64_t)info.nFileIndexHigh << 32) | info.nFileIndexLow;
+#endif
+  return true;
+}
+
+static struct TbMapping *find_mapping(const uint64_t id[2])
+{
+  for (struct TbMapping *m = mappings; m; m = m->next)
+    if (m->id[0] == id[0] && m->id[1] == id[1])
+      return m;
+  return NULL;
+}
+
+static void free_mapping(struct TbMapping *m)
+{
+  if (m->anon)
+    free_anon((void*)m->data, m->mapping);
+  else
+    unmap_file((void*)m->data, m->mapping);
+  atomic_fetch_sub(&residency.bytes, (uint64_t)m->size);
+  atomic_fetch_sub(&residency.tables, (uint32_t)1);
+  free(m);
+}
+
+// Replace the file mapping by a copy in anonymous memory. If the memory
+// cannot be allocated the file stays mapped.
+static void load_anon(struct TbMapping *m)
+{
+  map_t mapping;
+  uint8_t *copy = (uint8_t *)alloc_anon(m->size, &mapping);
+  if (!copy)
+    return;
+
+#ifdef POSIX_MADV_SEQUENTIAL
+  posix_madvise(m->data, m->size, POSIX_MADV_SEQUENTIAL);
+#endif
+  memcpy(copy, m->data, m->size);
+  unmap_file((void*)m->data, m->mapping);
+  m->data = copy;
+  m->mapping = mapping;
+  m->anon = true;
+}
+
+// Map a table file, or take another reference to the mapping of a context
+// that found the same file. anon asks for a copy in anonymous memory, see
+// tb_set_huge_pages(), but a shared mapping is used as it is. Returns NULL
+// if the file is not found.
+static struct TbMapping *map_tb(struct TbContext *ctx, const char *name,
+    const char *suffix, bool anon)
+{
+  FD fd = open_tb(ctx->paths, ctx->numPaths, &ctx->index, name, suffix);
+  if (fd == FD_ERR)
+    return NULL;
+
+  uint64_t id[2] = { 0, 0 };
+  bool known = file_id(fd, id);
+  struct TbMapping *m = NULL;
+  if (known) {
+    spin_lock(&mappingsLock);
+    if ((m = find_mapping(id)))
+      m->refs++;
+    spin_unlock(&mappingsLock);
+    if (m) {
+      close_tb(fd);
+      return m;
+    }
+  }
+
+  m = (struct TbMapping *)malloc(sizeof(*m));
+  if (m)
+    m->data = (uint8_t *)map_file(fd, &m->mapping, &m->size);
+  if (!m || !m->data) {
+    fprintf(stderr, "Could not map %s%s into memory.\n", name, suffix);
+    exit(EXIT_FAILURE);
+  }
+  close_tb(fd);
+
+  m->anon = false;
+  if (anon)
+    load_anon(m);
+  m->refs = 1;
+  m->next = NULL;
+  atomic_fetch_add(&residency.bytes, (uint64_t)m->size);
+  atomic_fetch_add(&residency.tables, (uint32_t)1);
+  if (!known)
+    return m;
+
+  // Another context may have mapped the file in the meantime.
+  m->id[0] = id[0];
+  m->id[1] = id[1];
+  spin_lock(&mappingsLock);
+  struct TbMapping *other = find_mapping(id);
+  if (other) {
+    other->refs++;
+  } else {
+    m->next = mappings;
+    mappings = m;
+  }
+  spin_unlock(&mappingsLock);
+  if (other) {
+    free_mapping(m);
+    return other;
+  }
+  return m;
+}
+
+static void release_mapping(struct TbMapping *m)
+{
+  spin_lock(&mappingsLock);
+  bool last = --m->refs == 0;
+  if (last)
+    for (struct TbMapping **p = &mappings; *p; p = &(*p)->next)
+      if (*p == m) {
+        *p = m->next;
+        break;
+      }
+  spin_unlock(&mappingsLock);
+  if (last)
+    free_mapping(m);
+}
+
+static void add_to_hash(struct TbContext *ctx, struct BaseEntry *ptr, uint64_t key)
+{
+  int idx;
+
+  idx = key >> (64 - TB_HASHBITS);
+  while (ctx->tbHash[idx].ptr)
     idx = (idx + 1) & ((1 << TB_HASHBITS) - 1);
 
-  tbHash[idx].key = key;
-  tbHash[idx].ptr = ptr;
+  ctx->tbHash[idx].key = key;
+  ctx->tbHash[idx].ptr = ptr;
 }
 
 #define pchr(i) piece_to_char[QUEEN - (i)]
 #define Swap(a,b) {int tmp=a;a=b;b=tmp;}
 
-static void init_tb(char *str)
+static void init_tb(struct TbContext *ctx, char *str)
 {
-  if (!test_tb(str, tbSuffix[WDL]))
+  if (!test_tb(ctx, str, tbSuffix[WDL]))
     return;
 
   int pcs[16];
@@ -739,29 +2149,39 @@ static void init_tb(char *str)
 
   bool hasPawns = pcs[W_PAWN] || pcs[B_PAWN];
 
-  struct BaseEntry *be = hasPawns ? &pawnEntry[tbNumPawn++].be
-                                  : &pieceEntry[tbNumPiece++].be;
+  struct BaseEntry *be = hasPawns ? &ctx->pawnEntry[ctx->tbNumPawn++].be
+                                  : &ctx->pieceEntry[ctx->tbNumPiece++].be;
   be->hasPawns = hasPawns;
   be->key = key;
+  be->ctx = ctx;
+  strcpy(be->name, str);
   be->symmetric = key == key2;
   be->num = 0;
   for (int i = 0; i < 16; i++)
     be->num += pcs[i];
 
-  numWdl++;
-  numDtm += be->hasDtm = test_tb(str, tbSuffix[DTM]);
-  numDtz += be->hasDtz = test_tb(str, tbSuffix[DTZ]);
+  ctx->numWdl++;
+  ctx->numDtm += be->hasDtm = test_tb(ctx, str, tbSuffix[DTM]);
+  ctx->numDtz += be->hasDtz = test_tb(ctx, str, tbSuffix[DTZ]);
 
-  if (be->num > TB_MaxCardinality) {
-    TB_MaxCardinality = be->num;
+  if (be->num > ctx->maxCardinality) {
+    ctx->maxCardinality = be->num;
   }
   if (be->hasDtm)
-    if (be->num > TB_MaxCardinalityDTM) {
-      TB_MaxCardinalityDTM = be->num;
+    if (be->num > ctx->maxCardinalityDTM) {
+      ctx->maxCardinalityDTM = be->num;
     }
 
-  for (int type = 0; type < 3; type++)
+  for (int type = 0; type < 3; type++) {
     atomic_init(&be->ready[type], false);
+    be->map[type] = NULL;
+    be->evicted[type] = false;
+  }
+  atomic_flag_clear(&be->lock);
+  atomic_init(&be->lastUse, (uint32_t)0);
+  be->evictPass = 0;
+  be->hasBitbase = false;
+  be->numa = NULL;
 
   if (!be->hasPawns) {
     int j = 0;
@@ -775,9 +2195,9 @@ static void init_tb(char *str)
       Swap(be->pawns[0], be->pawns[1]);
   }
 
-  add_to_hash(be, key);
+  add_to_hash(ctx, be, key);
   if (key != key2)
-    add_to_hash(be, key2);
+    add_to_hash(ctx, be, key2);
 }
 
 #define PIECE(x) ((struct PieceEntry *)(x))
@@ -795,62 +2215,289 @@ struct EncInfo *first_ei(struct BaseEntry *be, const int type)
         : &PIECE(be)->ei[type == WDL ? 0 : type == DTM ? 2 : 4];
 }
 
-static void free_tb_entry(struct BaseEntry *be)
+// Copies of small WDL tables on each NUMA node, see tb_set_numa(). A copy
+// holds the table file followed by its pairs data, so that a probe from a
+// thread on that node touches no memory of another node.
+struct NumaCopy {
+  uint8_t *data;
+  map_t mapping;
+  size_t size;
+  struct PairsData *pairs[8]; // indexed like first_ei(be, WDL)
+};
+
+static unsigned numaPieces = 0;
+static unsigned numaNodes = 0;  // found by the first tb_set_numa()
+#ifdef __cplusplus
+static atomic<uint32_t> numaTables(0);
+static atomic<uint64_t> numaBytes(0);
+#else
+static _Atomic uint32_t numaTables = 0;
+static _Atomic uint64_t numaBytes = 0;
+#endif
+
+static unsigned count_nodes(void)
 {
-  for (int type = 0; type < 3; type++) {
-    if (atomic_load_explicit(&be->ready[type], memory_order_relaxed)) {
-      unmap_file((void*)(be->data[type]), be->mapping[type]);
-      int num = num_tables(be, type);
-      struct EncInfo *ei = first_ei(be, type);
-      for (int t = 0; t < num; t++) {
-        free(ei[t].precomp);
-        if (type != DTZ)
-          free(ei[num + t].precomp);
+  unsigned nodes = 1;
+#if defined(__linux__)
+  // The online nodes, e.g. "0-1" or "0,2-3".
+  FILE *f = fopen("/sys/devices/system/node/online", "r");
+  if (f) {
+    char list[256];
+    if (fgets(list, sizeof(list), f)) {
+      char *p = list;
+      while (*p) {
+        unsigned long n = strtoul(p, &p, 10);
+        if (n + 1 > nodes)
+          nodes = (unsigned)n + 1;
+        if (*p == '-' || *p == ',')
+          p++;
+        else
+          break;
       }
-      atomic_store_explicit(&be->ready[type], false, memory_order_relaxed);
     }
+    fclose(f);
   }
+#elif defined(_WIN32)
+  ULONG highest;
+  if (GetNumaHighestNodeNumber(&highest))
+    nodes = highest + 1;
+#endif
+  return nodes < TB_NUMA_NODES ? nodes : TB_NUMA_NODES;
 }
 
-bool tb_init(const char *path)
+static int current_node(void)
+{
+#if defined(__linux__) && defined(SYS_getcpu)
+  unsigned cpu, node;
+  if (syscall(SYS_getcpu, &cpu, &node, NULL) == 0)
+    return (int)node;
+#elif defined(_WIN32)
+  PROCESSOR_NUMBER pn;
+  USHORT node;
+  GetCurrentProcessorNumberEx(&pn);
+  if (GetNumaProcessorNodeEx(&pn, &node))
+    return node;
+#endif
+  return 0;
+}
+
+// The node the calling thread runs on. A thread that is moved to another
+// node probes its old node's copies for at most TB_NUMA_RECHECK probes.
+static int thread_node(void)
+{
+  struct ThreadRecord *tr = thread_record();
+  if ((tr->nodeAge++ & (TB_NUMA_RECHECK - 1)) == 0)
+    tr->node = current_node();
+  return tr->node;
+}
+
+// Anonymous memory on the given node. Where the memory cannot be bound to
+// the node it is placed wherever the copying thread runs.
+static void *alloc_node(size_t size, unsigned node, map_t *mapping)
+{
+#ifdef _WIN32
+  void *data = VirtualAllocExNuma(GetCurrentProcess(), NULL, size,
+      MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE, node);
+  if (!data)
+    return alloc_anon(size, mapping);
+  if (hugeLock && !VirtualLock(data, size))
+    fprintf(stderr, "VirtualLock() failed, error = %lu.\n", GetLastError());
+  *mapping = NULL;
+  return data;
+#else
+  void *data = alloc_anon(size, mapping);
+#if defined(__linux__) && defined(SYS_mbind)
+  // mbind(MPOL_BIND, MPOL_MF_MOVE), as <numaif.h> is not always installed.
+  unsigned long mask = 1UL << node;
+  if (data)
+    syscall(SYS_mbind, data, (unsigned long)*mapping, 2, &mask,
+            8 * sizeof(mask), 2);
+#else
+  (void)node;
+#endif
+  return data;
+#endif
+}
+
+static void free_numa(struct BaseEntry *be)
+{
+  struct NumaCopy *copies = be->numa;
+  if (!copies)
+    return;
+  be->numa = NULL;
+  for (unsigned n = 0; n < numaNodes; n++) {
+    free_anon(copies[n].data, copies[n].mapping);
+    atomic_fetch_sub(&numaBytes, (uint64_t)copies[n].size);
+  }
+  free(copies);
+  atomic_fetch_sub(&numaTables, (uint32_t)1);
+}
+
+static uint8_t *rebase(const void *ptr, ptrdiff_t delta)
+{
+  return (uint8_t *)ptr + delta;
+}
+
+// Copy the WDL table of be to every node. The pointers of each copy of the
+// pairs data are moved into the copy of the file, or into the copy itself
+// for the LUT and symLen. If a node gets no memory there are no copies.
+static void replicate_table(struct BaseEntry *be)
 {
-  if (!initialized) {
-    init_indices();
-    king_attacks_init();
-    knight_attacks_init();
-    bishop_attacks_init();
-    rook_attacks_init();
-    pawn_attacks_init();
-    initialized = 1;
+  struct TbMapping *map = be->map[WDL];
+  int num = 2 * num_tables(be, WDL);
+  struct EncInfo *ei = first_ei(be, WDL);
+  size_t fileSize = (map->size + 63) & ~(size_t)63;
+  size_t size = fileSize;
+  for (int t = 0; t < num; t++)
+    if (ei[t].precomp)
+      size += (ei[t].precomp->bytes + 63) & ~(size_t)63;
+
+  struct NumaCopy *copies = (struct NumaCopy *)calloc(numaNodes, sizeof(*copies));
+  if (!copies)
+    return;
+  for (unsigned n = 0; n < numaNodes; n++) {
+    uint8_t *data = (uint8_t *)alloc_node(size, n, &copies[n].mapping);
+    if (!data) {
+      while (n--)
+        free_anon(copies[n].data, copies[n].mapping);
+      free(copies);
+      return;
+    }
+    copies[n].data = data;
+    memcpy(data, be->data[WDL], map->size);
+    ptrdiff_t delta = data - be->data[WDL];
+
+    uint8_t *p = data + fileSize;
+    for (int t = 0; t < num; t++) {
+      const struct PairsData *d = ei[t].precomp;
+      if (!d)
+        continue;
+      struct PairsData *c = (struct PairsData *)p;
+      memcpy(c, d, d->bytes);
+      if (d->idxBits) {
+        c->indexTable = rebase(d->indexTable, delta);
+        c->sizeTable = (uint16_t *)rebase(d->sizeTable, delta);
+        c->data = rebase(d->data, delta);
+        c->offset = (uint16_t *)rebase(d->offset, delta);
+        c->symPat = rebase(d->symPat, delta);
+        c->symLen = rebase(d->symLen, (uint8_t *)c - (uint8_t *)d);
+#ifndef TB_NO_DECODE_LUT
+        c->lut = (uint32_t *)rebase(d->lut, (uint8_t *)c - (uint8_t *)d);
+#endif
+      }
+      copies[n].pairs[t] = c;
+      p += (d->bytes + 63) & ~(size_t)63;
+    }
+    copies[n].size = size;
   }
+  // only now, since a failed copy above gives back those made before it
+  atomic_fetch_add(&numaBytes, (uint64_t)size * numaNodes);
+  be->numa = copies;
+  atomic_fetch_add(&numaTables, (uint32_t)1);
+}
+
+// The pairs data of ei on the given node.
+static struct PairsData *numa_pairs(struct BaseEntry *be, struct EncInfo *ei,
+    int node)
+{
+  if ((unsigned)node >= numaNodes)
+    return ei->precomp;
+  return be->numa[node].pairs[ei - first_ei(be, WDL)];
+}
 
-  // if pathString is set, we need to clean up first.
-  if (pathString) {
-    free(pathString);
-    free(paths);
+unsigned tb_set_numa(unsigned pieces)
+{
+  if (!numaNodes)
+    numaNodes = count_nodes();
+  numaPieces = pieces;
+  return numaNodes;
+}
 
-    for (int i = 0; i < tbNumPiece; i++)
-      free_tb_entry((struct BaseEntry *)&pieceEntry[i]);
-    for (int i = 0; i < tbNumPawn; i++)
-      free_tb_entry((struct BaseEntry *)&pawnEntry[i]);
+void tb_numa_status(struct TbNumaStatus *status)
+{
+  status->nodes = numaNodes ? numaNodes : count_nodes();
+  status->tables = atomic_load(&numaTables);
+  status->bytes = atomic_load(&numaBytes);
+}
 
-    LOCK_DESTROY(tbMutex);
+static void unload_table(struct BaseEntry *be, int type)
+{
+#if TB_BLOCK_CACHE_SLOTS > 0
+  atomic_fetch_add(&blockEpoch, 1u);
+#endif
+  if (type == WDL)
+    free_numa(be);
+  release_mapping(be->map[type]);
+  be->map[type] = NULL;
+  int num = num_tables(be, type);
+  struct EncInfo *ei = first_ei(be, type);
+  for (int t = 0; t < num; t++) {
+    free(ei[t].precomp);
+    if (type != DTZ)
+      free(ei[num + t].precomp);
+  }
+  atomic_store_explicit(&be->ready[type], false, memory_order_relaxed);
+}
 
-    pathString = NULL;
-    numWdl = numDtm = numDtz = 0;
+static void free_tb_entry(struct BaseEntry *be)
+{
+  for (int type = 0; type < 3; type++)
+    if (atomic_load_explicit(&be->ready[type], memory_order_relaxed))
+      unload_table(be, type);
+  if (be->hasBitbase) {
+    struct EncInfo *ei = first_ei(be, WDL);
+    for (int t = 0; t < 2 * num_tables(be, WDL); t++)
+      free(ei[t].bitbase);
+    be->hasBitbase = false;
   }
+}
+
+// Unload the tables of a context and forget its paths.
+static void context_clear(struct TbContext *ctx)
+{
+  if (!ctx->pathString)
+    return;
 
-  TB_LARGEST = 0;
+  // Keep enforce_budget() away while the entries go.
+  spin_lock(&contextsLock);
+  for (int i = 0; i < ctx->tbNumPiece + ctx->tbNumPawn; i++)
+    free_tb_entry(context_entry(ctx, i));
+  ctx->tbNumPiece = ctx->tbNumPawn = 0;
+  spin_unlock(&contextsLock);
+
+  free(ctx->pathString);
+  free(ctx->paths);
+  free_dir_index(&ctx->index);
+  ctx->pathString = NULL;
+  ctx->paths = NULL;
+  ctx->numPaths = 0;
+  ctx->numWdl = ctx->numDtm = ctx->numDtz = 0;
+  ctx->numBitbases = 0;
+  ctx->bitbaseBytes = 0;
+  ctx->maxCardinality = ctx->maxCardinalityDTM = 0;
+  ctx->largest = 0;
+}
+
+// Find the tables under path, a list of directories separated by SEP_CHAR.
+static void context_load(struct TbContext *ctx, const char *path)
+{
+#ifdef __cplusplus
+  static atomic<uint64_t> lastId(0);
+#else
+  static _Atomic uint64_t lastId = 0;
+#endif
+  ctx->id = atomic_fetch_add(&lastId, (uint64_t)1) + 1;
 
   // if path is an empty string or equals "<empty>", we are done.
   const char *p = path;
   if (strlen(p) == 0 || !strcmp(p, "<empty>")) {
-    return true;
+    return;
   }
 
-  pathString = (char*)malloc(strlen(p) + 1);
-  strcpy(pathString, p);
-  numPaths = 0;
+  ctx->pathString = (char*)malloc(strlen(p) + 1);
+  strcpy(ctx->pathString, p);
+  char *pathString = ctx->pathString;
+  int numPaths = 0;
   for (int i = 0;; i++) {
     if (pathString[i] != SEP_CHAR)
       numPaths++;
@@ -859,30 +2506,30 @@ bool tb_init(const char *path)
     if (!pathString[i]) break;
     pathString[i] = 0;
   }
-  paths = (char**)malloc(numPaths * sizeof(*paths));
+  ctx->paths = (char**)malloc(numPaths * sizeof(*ctx->paths));
   for (int i = 0, j = 0; i < numPaths; i++) {
     while (!pathString[j]) j++;
-    paths[i] = &pathString[j];
+    ctx->paths[i] = &pathString[j];
     while (pathString[j]) j++;
   }
+  ctx->numPaths = numPaths;
+  index_dirs(&ctx->index, ctx->paths, numPaths);
 
-  LOCK_INIT(tbMutex);
+  ctx->tbNumPiece = ctx->tbNumPawn = 0;
+  ctx->maxCardinality = ctx->maxCardinalityDTM = 0;
 
-  tbNumPiece = tbNumPawn = 0;
-  TB_MaxCardinality = TB_MaxCardinalityDTM = 0;
-
-  if (!pieceEntry) {
-    pieceEntry = (struct PieceEntry*)malloc(TB_MAX_PIECE * sizeof(*pieceEntry));
-    pawnEntry = (struct PawnEntry*)malloc(TB_MAX_PAWN * sizeof(*pawnEntry));
-    if (!pieceEntry || !pawnEntry) {
+  if (!ctx->pieceEntry) {
+    ctx->pieceEntry = (struct PieceEntry*)malloc(TB_MAX_PIECE * sizeof(*ctx->pieceEntry));
+    ctx->pawnEntry = (struct PawnEntry*)malloc(TB_MAX_PAWN * sizeof(*ctx->pawnEntry));
+    if (!ctx->pieceEntry || !ctx->pawnEntry) {
       fprintf(stderr, "Out of memory.\n");
       exit(EXIT_FAILURE);
     }
   }
 
   for (int i = 0; i < (1 << TB_HASHBITS); i++) {
-    tbHash[i].key = 0;
-    tbHash[i].ptr = NULL;
+    ctx->tbHash[i].key = 0;
+    ctx->tbHash[i].ptr = NULL;
   }
 
   char str[16];
@@ -890,33 +2537,33 @@ bool tb_init(const char *path)
 
   for (i = 0; i < 5; i++) {
     snprintf(str, 16, "K%cvK", pchr(i));
-    init_tb(str);
+    init_tb(ctx, str);
   }
 
   for (i = 0; i < 5; i++)
     for (j = i; j < 5; j++) {
       snprintf(str, 16, "K%cvK%c", pchr(i), pchr(j));
-      init_tb(str);
+      init_tb(ctx, str);
     }
 
   for (i = 0; i < 5; i++)
     for (j = i; j < 5; j++) {
       snprintf(str, 16, "K%c%cvK", pchr(i), pchr(j));
-      init_tb(str);
+      init_tb(ctx, str);
     }
 
   for (i = 0; i < 5; i++)
     for (j = i; j < 5; j++)
       for (k = 0; k < 5; k++) {
         snprintf(str, 16, "K%c%cvK%c", pchr(i), pchr(j), pchr(k));
-        init_tb(str);
+        init_tb(ctx, str);
       }
 
   for (i = 0; i < 5; i++)
     for (j = i; j < 5; j++)
       for (k = j; k < 5; k++) {
         snprintf(str, 16, "K%c%c%cvK", pchr(i), pchr(j), pchr(k));
-        init_tb(str);
+        init_tb(ctx, str);
       }
 
   // 6- and 7-piece TBs make sense only with a 64-bit address space
@@ -928,7 +2575,7 @@ bool tb_init(const char *path)
       for (k = i; k < 5; k++)
         for (l = (i == k) ? j : k; l < 5; l++) {
           snprintf(str, 16, "K%c%cvK%c%c", pchr(i), pchr(j), pchr(k), pchr(l));
-          init_tb(str);
+          init_tb(ctx, str);
         }
 
   for (i = 0; i < 5; i++)
@@ -936,7 +2583,7 @@ bool tb_init(const char *path)
       for (k = j; k < 5; k++)
         for (l = 0; l < 5; l++) {
           snprintf(str, 16, "K%c%c%cvK%c", pchr(i), pchr(j), pchr(k), pchr(l));
-          init_tb(str);
+          init_tb(ctx, str);
         }
 
   for (i = 0; i < 5; i++)
@@ -944,7 +2591,7 @@ bool tb_init(const char *path)
       for (k = j; k < 5; k++)
         for (l = k; l < 5; l++) {
           snprintf(str, 16, "K%c%c%c%cvK", pchr(i), pchr(j), pchr(k), pchr(l));
-          init_tb(str);
+          init_tb(ctx, str);
         }
 
   if (TB_PIECES < 7)
@@ -956,7 +2603,7 @@ bool tb_init(const char *path)
         for (l = k; l < 5; l++)
           for (m = l; m < 5; m++) {
             snprintf(str, 16, "K%c%c%c%c%cvK", pchr(i), pchr(j), pchr(k), pchr(l), pchr(m));
-            init_tb(str);
+            init_tb(ctx, str);
           }
 
   for (i = 0; i < 5; i++)
@@ -965,7 +2612,7 @@ bool tb_init(const char *path)
         for (l = k; l < 5; l++)
           for (m = 0; m < 5; m++) {
             snprintf(str, 16, "K%c%c%c%cvK%c", pchr(i), pchr(j), pchr(k), pchr(l), pchr(m));
-            init_tb(str);
+            init_tb(ctx, str);
           }
 
   for (i = 0; i < 5; i++)
@@ -974,28 +2621,142 @@ bool tb_init(const char *path)
         for (l = 0; l < 5; l++)
           for (m = l; m < 5; m++) {
             snprintf(str, 16, "K%c%c%cvK%c%c", pchr(i), pchr(j), pchr(k), pchr(l), pchr(m));
-            init_tb(str);
+            init_tb(ctx, str);
           }
 
 finished:
   /* TBD - assumes UCI
   printf("info string Found %d WDL, %d DTM and %d DTZ tablebase files.\n",
-      numWdl, numDtm, numDtz);
+      ctx->numWdl, ctx->numDtm, ctx->numDtz);
   fflush(stdout);
   */
-  // Set TB_LARGEST, for backward compatibility with pre-7-man Fathom
-  TB_LARGEST = (unsigned)TB_MaxCardinality;
-  if ((unsigned)TB_MaxCardinalityDTM > TB_LARGEST) {
-    TB_LARGEST = TB_MaxCardinalityDTM;
+  ctx->largest = (unsigned)ctx->maxCardinality;
+  if ((unsigned)ctx->maxCardinalityDTM > ctx->largest) {
+    ctx->largest = ctx->maxCardinalityDTM;
+  }
+}
+
+static void init_once(void)
+{
+  if (initialized)
+    return;
+  init_indices();
+  king_attacks_init();
+  knight_attacks_init();
+  bishop_attacks_init();
+  rook_attacks_init();
+  pawn_attacks_init();
+#ifdef TB_ATTACKS_INIT
+  TB_ATTACKS_INIT();
+#endif
+  initialized = 1;
+}
+
+static struct TbInitInfo initInfo;
+
+static uint64_t now_micros(void)
+{
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+bool tb_init(const char *path)
+{
+  uint64_t start = now_micros();
+  init_once();
+
+  // The warm-up thread must not keep loading tables that are replaced.
+  tb_warmup_stop();
+
+  // Find the new tables while probes go on with the old ones.
+  struct TbContext *ctx = &emptyContext;
+  if (strlen(path) != 0 && strcmp(path, "<empty>") != 0) {
+    ctx = tb_context_create(path);
+    if (!ctx)
+      return false;
   }
+
+  spin_lock(&initLock);
+  struct TbContext *old = atomic_exchange(&defaultContext, ctx);
+  tb_reset_stats();
+
+  // Set TB_LARGEST, for backward compatibility with pre-7-man Fathom
+  TB_MaxCardinality = ctx->maxCardinality;
+  TB_MaxCardinalityDTM = ctx->maxCardinalityDTM;
+  TB_LARGEST = ctx->largest;
+  TB_LARGEST_DTM = (unsigned)ctx->maxCardinalityDTM;
+
+  initInfo.wdl = ctx->numWdl;
+  initInfo.dtm = ctx->numDtm;
+  initInfo.dtz = ctx->numDtz;
+  initInfo.dirs = ctx->index.dirs;
+  initInfo.files = ctx->index.count;
+  initInfo.bitbases = ctx->numBitbases;
+  initInfo.bitbaseBytes = ctx->bitbaseBytes;
+  initInfo.micros = now_micros() - start;
+  spin_unlock(&initLock);
+
+  // Probes that started before the swap finish on the old tables.
+  while (context_in_use(old))
+    TB_YIELD();
+  tb_context_free(old);
+
+  // Cached results may belong to tables that are no longer available.
+  tb_clear_wdl_cache();
   return true;
 }
 
+void tb_init_info(struct TbInitInfo *info)
+{
+  *info = initInfo;
+}
+
 void tb_free(void)
 {
   tb_init("");
-  free(pieceEntry);
-  free(pawnEntry);
+  tb_set_wdl_cache(0);
+}
+
+struct TbContext *tb_context_create(const char *path)
+{
+  init_once();
+
+  struct TbContext *ctx = (struct TbContext *)calloc(1, sizeof(*ctx));
+  if (!ctx)
+    return NULL;
+  context_load(ctx, path);
+  build_bitbases(ctx);
+
+  spin_lock(&contextsLock);
+  ctx->next = contexts;
+  contexts = ctx;
+  spin_unlock(&contextsLock);
+  return ctx;
+}
+
+void tb_context_free(struct TbContext *ctx)
+{
+  if (!ctx || ctx == &emptyContext)
+    return;
+
+  spin_lock(&contextsLock);
+  for (struct TbContext **p = &contexts; *p; p = &(*p)->next)
+    if (*p == ctx) {
+      *p = ctx->next;
+      break;
+    }
+  spin_unlock(&contextsLock);
+
+  context_clear(ctx);
+  free(ctx->pieceEntry);
+  free(ctx->pawnEntry);
+  free(ctx);
+}
+
+unsigned tb_context_largest(const struct TbContext *ctx)
+{
+  return ctx->largest;
 }
 
 static const int8_t OffDiag[] = {
@@ -1233,10 +2994,13 @@ int leading_pawn(int *p, struct BaseEntry *be, const int enc)
   return enc == FILE_ENC ? FileToFile[p[0] & 7] : (p[0] - 8) >> 3;
 }
 
-size_t encode(int *p, struct EncInfo *ei, struct BaseEntry *be,
-    const int enc)
+// The index computation for n pieces. Forced inline so that each of the
+// encoders stamped out below gets a copy with enc and n as constants, which
+// lets the compiler unroll the loops over the pieces and drop the branches
+// on the encoding type.
+static TB_FORCE_INLINE size_t encode_impl(int *p, struct EncInfo *ei,
+    struct BaseEntry *be, const int enc, const int n)
 {
-  int n = be->num;
   size_t idx;
   int k;
 
@@ -1326,20 +3090,35 @@ size_t encode(int *p, struct EncInfo *ei, struct BaseEntry *be,
   return idx;
 }
 
-static size_t encode_piece(int *p, struct EncInfo *ei, struct BaseEntry *be)
+size_t encode(int *p, struct EncInfo *ei, struct BaseEntry *be,
+    const int enc)
 {
-  return encode(p, ei, be, PIECE_ENC);
+  return encode_impl(p, ei, be, enc, be->num);
 }
 
-static size_t encode_pawn_f(int *p, struct EncInfo *ei, struct BaseEntry *be)
-{
-  return encode(p, ei, be, FILE_ENC);
-}
+#define ENCODER(name, enc, n)                                               \
+  static size_t name(int *p, struct EncInfo *ei, struct BaseEntry *be)      \
+  {                                                                         \
+    return encode_impl(p, ei, be, enc, n);                                  \
+  }
 
-static size_t encode_pawn_r(int *p, struct EncInfo *ei, struct BaseEntry *be)
-{
-  return encode(p, ei, be, RANK_ENC);
-}
+#define ENCODERS(n)                                                         \
+  ENCODER(encode_piece_##n, PIECE_ENC, n)                                   \
+  ENCODER(encode_file_##n, FILE_ENC, n)                                     \
+  ENCODER(encode_rank_##n, RANK_ENC, n)
+
+ENCODERS(3)
+ENCODERS(4)
+ENCODERS(5)
+ENCODERS(6)
+ENCODERS(7)
+
+// Encoders[enc][num - 3] for tables of 3 to 7 pieces
+static const encode_func Encoders[3][5] = {
+  { encode_piece_3, encode_piece_4, encode_piece_5, encode_piece_6, encode_piece_7 },
+  { encode_file_3, encode_file_4, encode_file_5, encode_file_6, encode_file_7 },
+  { encode_rank_3, encode_rank_4, encode_rank_5, encode_rank_6, encode_rank_7 },
+};
 
 // Count number of placements of k like pieces on n squares
 static size_t subfactor(size_t k, size_t n)
@@ -1359,6 +3138,7 @@ static size_t init_enc_info(struct EncInfo *ei, struct BaseEntry *be,
 {
   bool morePawns = enc != PIECE_ENC && be->pawns[1] > 0;
 
+  ei->encode = Encoders[enc][be->num - 3];
   for (int i = 0; i < be->num; i++) {
     ei->pieces[i] = (tb[i + 1 + morePawns] >> shift) & 0x0f;
     ei->norm[i] = 0;
@@ -1417,20 +3197,78 @@ static void calc_symLen(struct PairsData *d, uint32_t s, char *tmp)
   tmp[s] = 1;
 }
 
-static struct PairsData *setup_pairs(uint8_t **ptr, size_t tb_size,
-    size_t *size, uint8_t *flags, int type)
+#ifndef TB_NO_DECODE_LUT
+// Decode lookup table, indexed by the top TB_DECODE_LUT_BITS bits of the
+// code.  An entry holds
+//
+//   bits  0-5   code length, or the length to start the scan at
+//   bits  6-7   number of symbols decoded (0, 1 or 2)
+//   bits  8-19  first symbol
+//   bits 20-31  second symbol
+//
+// If the first code is no longer than the index it is decoded completely,
+// and if the code after it also fits, so is that one; the length is then
+// the sum of both.  Otherwise the entry holds the shortest length any code
+// with this prefix can have, so the scan starts there.
+#define LUT_LEN(e)    ((e) & 0x3f)
+#define LUT_SYMS(e)   (((e) >> 6) & 0x3)
+#define LUT_SYM1(e)   (((e) >> 8) & 0xfff)
+#define LUT_SYM2(e)   ((e) >> 20)
+
+static int code_len(const struct PairsData *d, uint64_t code, int maxLen)
 {
-  struct PairsData *d;
-  uint8_t *data = *ptr;
+  const uint64_t *base = d->base - d->minLen;
+  int l = d->minLen;
+  while (l < maxLen && code < base[l]) l++;
+  return l;
+}
 
-  *flags = data[0];
-  if (data[0] & 0x80) {
+static uint32_t code_sym(const struct PairsData *d, uint64_t code, int l)
+{
+  const uint64_t *base = d->base - d->minLen;
+  return from_le_u16(d->offset[l]) + (uint32_t)((code - base[l]) >> (64 - l));
+}
+
+static void setup_lut(struct PairsData *d, int maxLen)
+{
+  const int bits = TB_DECODE_LUT_BITS;
+  const uint64_t rest = UINT64_MAX >> bits;
+
+  for (uint32_t i = 0; i < (1u << bits); i++) {
+    uint64_t lo = (uint64_t)i << (64 - bits), hi = lo | rest;
+    int l1 = code_len(d, hi, maxLen);
+    if (l1 > bits) {
+      d->lut[i] = (uint32_t)l1;
+      continue;
+    }
+    uint32_t e = (uint32_t)l1 | (1u << 6) | (code_sym(d, lo, l1) << 8);
+    uint64_t lo2 = lo << l1, hi2 = (hi << l1) | (UINT64_MAX >> (64 - l1));
+    int l2 = code_len(d, hi2, maxLen);
+    if (l1 + l2 <= bits)
+      e = (uint32_t)(l1 + l2) | (2u << 6) | (code_sym(d, lo, l1) << 8)
+        | (code_sym(d, lo2, l2) << 20);
+    d->lut[i] = e;
+  }
+}
+#endif
+
+static struct PairsData *setup_pairs(uint8_t **ptr, size_t tb_size,
+    size_t *size, uint8_t *flags, int type)
+{
+  struct PairsData *d;
+  uint8_t *data = *ptr;
+
+  *flags = data[0];
+  if (data[0] & 0x80) {
     d = (struct PairsData*)malloc(sizeof(struct PairsData));
+    d->bytes = sizeof(struct PairsData);
     d->idxBits = 0;
     d->constValue[0] = type == WDL ? data[1] : 0;
     d->constValue[1] = 0;
+    d->tbSize = tb_size;
     *ptr = data + 2;
     size[0] = size[1] = size[2] = 0;
+    d->size[0] = d->size[1] = d->size[2] = 0;
     return d;
   }
 
@@ -1442,19 +3280,32 @@ static struct PairsData *setup_pairs(uint8_t **ptr, size_t tb_size,
   int minLen = data[9];
   int h = maxLen - minLen + 1;
   uint32_t numSyms = (uint32_t)read_le_u16(data + 10 + 2 * h);
-  d = (struct PairsData*)malloc(sizeof(struct PairsData) + h * sizeof(uint64_t) + numSyms);
+#ifndef TB_NO_DECODE_LUT
+  size_t lutSize = sizeof(uint32_t) << TB_DECODE_LUT_BITS;
+#else
+  size_t lutSize = 0;
+#endif
+  d = (struct PairsData*)malloc(sizeof(struct PairsData) + h * sizeof(uint64_t) + lutSize + numSyms);
+  d->bytes = sizeof(struct PairsData) + h * sizeof(uint64_t) + lutSize + numSyms;
   d->blockSize = blockSize;
   d->idxBits = idxBits;
   d->offset = (uint16_t *)(&data[10]);
-  d->symLen = (uint8_t *)d + sizeof(struct PairsData) + h * sizeof(uint64_t);
+#ifndef TB_NO_DECODE_LUT
+  d->lut = (uint32_t *)((uint8_t *)d + sizeof(struct PairsData) + h * sizeof(uint64_t));
+#endif
+  d->symLen = (uint8_t *)d + sizeof(struct PairsData) + h * sizeof(uint64_t) + lutSize;
   d->symPat = &data[12 + 2 * h];
   d->minLen = minLen;
+  d->tbSize = tb_size;
   *ptr = &data[12 + 2 * h + 3 * numSyms + (numSyms & 1)];
 
   size_t num_indices = (tb_size + (1ULL << idxBits) - 1) >> idxBits;
   size[0] = 6ULL * num_indices;
   size[1] = 2ULL * numBlocks;
   size[2] = (size_t)realNumBlocks << blockSize;
+  d->size[0] = size[0];
+  d->size[1] = size[1];
+  d->size[2] = size[2];
 
   assert(numSyms < TB_MAX_SYMS);
   char tmp[TB_MAX_SYMS];
@@ -1475,20 +3326,27 @@ static struct PairsData *setup_pairs(uint8_t **ptr, size_t tb_size,
 #endif
   d->offset -= d->minLen;
 
+#ifndef TB_NO_DECODE_LUT
+  setup_lut(d, maxLen);
+#endif
+
   return d;
 }
 
 static bool init_table(struct BaseEntry *be, const char *str, int type)
 {
-  uint8_t *data = (uint8_t*)map_tb(str, tbSuffix[type], &be->mapping[type]);
-  if (!data) return false;
+  struct TbMapping *map = map_tb(be->ctx, str, tbSuffix[type],
+                                 type == WDL && be->num <= hugePieces);
+  if (!map) return false;
 
+  uint8_t *data = map->data;
   if (read_le_u32(data) != tbMagic[type]) {
     fprintf(stderr, "Corrupted table.\n");
-    unmap_file((void*)data, be->mapping[type]);
+    release_mapping(map);
     return false;
   }
 
+  be->map[type] = map;
   be->data[type] = data;
 
   bool split = type != DTZ && (data[4] & 0x01);
@@ -1607,156 +3465,1872 @@ static bool init_table(struct BaseEntry *be, const char *str, int type)
   return true;
 }
 
-static uint8_t *decompress_pairs(struct PairsData *d, size_t idx)
+// The block that holds value idx, and the position of the value in it.
+static uint32_t find_block(const struct PairsData *d, size_t idx, int *litIdxOut)
 {
-  if (!d->idxBits)
-    return d->constValue;
-
   uint32_t mainIdx = (uint32_t)(idx >> d->idxBits);
   int litIdx = (idx & (((size_t)1 << d->idxBits) - 1)) - ((size_t)1 << (d->idxBits - 1));
   uint32_t block;
   memcpy(&block, d->indexTable + 6 * mainIdx, sizeof(block));
   block = from_le_u32(block);
 
-  uint16_t idxOffset = *(uint16_t *)(d->indexTable + 6 * mainIdx + 4);
-  litIdx += from_le_u16(idxOffset);
+  uint16_t idxOffset = *(uint16_t *)(d->indexTable + 6 * mainIdx + 4);
+  litIdx += from_le_u16(idxOffset);
+
+  if (litIdx < 0)
+    while (litIdx < 0)
+      litIdx += d->sizeTable[--block] + 1;
+  else
+    while (litIdx > d->sizeTable[block])
+      litIdx -= d->sizeTable[block++] + 1;
+
+  *litIdxOut = litIdx;
+  return block;
+}
+
+// Decode a block up to the value at litIdx.
+// Value litIdx of the values symbol sym stands for.
+static uint8_t *pair_value(const struct PairsData *d, uint32_t sym, int litIdx)
+{
+  uint8_t *symLen = d->symLen;
+  uint8_t *symPat = d->symPat;
+  while (symLen[sym] != 0) {
+    uint8_t *w = symPat + (3 * sym);
+    int s1 = ((w[1] & 0xf) << 8) | w[0];
+    if (litIdx < (int)symLen[s1] + 1)
+      sym = s1;
+    else {
+      litIdx -= (int)symLen[s1] + 1;
+      sym = (w[2] << 4) | (w[1] >> 4);
+    }
+  }
+
+  return &symPat[3 * sym];
+}
+
+static uint8_t *decode_pairs(const struct PairsData *d, uint32_t block, int litIdx)
+{
+  uint32_t *ptr = (uint32_t *)(d->data + ((size_t)block << d->blockSize));
+
+  int m = d->minLen;
+  uint16_t *offset = d->offset;
+  const uint64_t *base = d->base - m;
+  uint8_t *symLen = d->symLen;
+  uint32_t sym, bitCnt;
+
+#ifdef DECOMP64
+  uint64_t code = from_be_u64(*(uint64_t *)ptr);
+
+  ptr += 2;
+  bitCnt = 0; // number of "empty bits" in code
+  for (;;) {
+#ifndef TB_NO_DECODE_LUT
+    uint32_t e = d->lut[code >> (64 - TB_DECODE_LUT_BITS)];
+    int l = LUT_LEN(e);
+    if (LUT_SYMS(e)) {
+      sym = LUT_SYM1(e);
+      if (litIdx < (int)symLen[sym] + 1) break;
+      litIdx -= (int)symLen[sym] + 1;
+      if (LUT_SYMS(e) == 2) {
+        sym = LUT_SYM2(e);
+        if (litIdx < (int)symLen[sym] + 1) break;
+        litIdx -= (int)symLen[sym] + 1;
+      }
+    } else {
+      while (code < base[l]) l++;
+      sym = from_le_u16(offset[l]);
+      sym += (uint32_t)((code - base[l]) >> (64 - l));
+      if (litIdx < (int)symLen[sym] + 1) break;
+      litIdx -= (int)symLen[sym] + 1;
+    }
+#else
+    int l = m;
+    while (code < base[l]) l++;
+    sym = from_le_u16(offset[l]);
+    sym += (uint32_t)((code - base[l]) >> (64 - l));
+    if (litIdx < (int)symLen[sym] + 1) break;
+    litIdx -= (int)symLen[sym] + 1;
+#endif
+    code <<= l;
+    bitCnt += l;
+    if (bitCnt >= 32) {
+      bitCnt -= 32;
+      uint32_t tmp = from_be_u32(*ptr++);
+      code |= (uint64_t)tmp << bitCnt;
+    }
+  }
+#else
+  uint32_t next = 0;
+  uint32_t data = *ptr++;
+  uint32_t code = from_be_u32(data);
+  bitCnt = 0; // number of bits in next
+  for (;;) {
+    int l = m;
+    while (code < base[l]) l++;
+    sym = offset[l] + ((code - base[l]) >> (32 - l));
+    if (litIdx < (int)symLen[sym] + 1) break;
+    litIdx -= (int)symLen[sym] + 1;
+    code <<= l;
+    if (bitCnt < l) {
+      if (bitCnt) {
+	code |= (next >> (32 - l));
+	l -= bitCnt;
+      }
+      data = *ptr++;
+      next = from_be_u32(data);
+      bitCnt = 32;
+    }
+    code |= (next >> (32 - l));
+    next <<= l;
+    bitCnt -= l;
+  }
+#endif
+  return pair_value(d, sym, litIdx);
+}
+
+#if TB_BLOCK_CACHE_SLOTS > 0
+// Continue decoding the codes of a slot's block until the code of value
+// litIdx, recording the symbol of each code and the index of the last value
+// it stands for. Returns false if the block has more than
+// TB_BLOCK_CACHE_CODES codes.
+static bool decode_block(const struct PairsData *d, struct BlockSlot *slot,
+    int litIdx)
+{
+  const uint32_t *ptr = (const uint32_t *)(d->data + ((size_t)slot->block << d->blockSize));
+  int m = d->minLen;
+  const uint16_t *offset = d->offset;
+  const uint64_t *base = d->base - m;
+  const uint8_t *symLen = d->symLen;
+  int last = d->sizeTable[slot->block];
+
+  uint64_t code = slot->code;
+  uint32_t bitCnt = slot->bitCnt, words = slot->words;
+  int n = slot->codes;
+  int lit = n ? slot->last[n - 1] : -1;
+  uint16_t *sym = slot->sym, *lastIdx = slot->last;
+  while (lit < litIdx) {
+    uint32_t syms[2] = { 0, 0 };
+    int numSyms = 1;
+#ifndef TB_NO_DECODE_LUT
+    uint32_t e = d->lut[code >> (64 - TB_DECODE_LUT_BITS)];
+    int l = LUT_LEN(e);
+    if (LUT_SYMS(e)) {
+      numSyms = (int)LUT_SYMS(e);
+      syms[0] = LUT_SYM1(e);
+      syms[1] = LUT_SYM2(e);
+    } else {
+      while (code < base[l]) l++;
+      syms[0] = from_le_u16(offset[l]) + (uint32_t)((code - base[l]) >> (64 - l));
+    }
+#else
+    int l = m;
+    while (code < base[l]) l++;
+    syms[0] = from_le_u16(offset[l]) + (uint32_t)((code - base[l]) >> (64 - l));
+#endif
+    if (n + numSyms > TB_BLOCK_CACHE_CODES)
+      return false;
+    for (int i = 0; i < numSyms && lit < last; i++) {
+      lit += symLen[syms[i]] + 1;
+      sym[n] = (uint16_t)syms[i];
+      lastIdx[n++] = (uint16_t)(lit < last ? lit : last);
+    }
+    // Stop before reading past the last code of the block.
+    if (lit >= last)
+      break;
+    code <<= l;
+    bitCnt += l;
+    if (bitCnt >= 32) {
+      bitCnt -= 32;
+      uint32_t tmp = from_be_u32(ptr[2 + words++]);
+      code |= (uint64_t)tmp << bitCnt;
+    }
+  }
+  slot->codes = (uint16_t)n;
+  slot->code = code;
+  slot->bitCnt = bitCnt;
+  slot->words = words;
+  return true;
+}
+
+// The calling thread's cache slot of a block, decoded at least as far as
+// value litIdx. Returns NULL if the block cannot be cached. *hit tells
+// whether the block was in the cache.
+static const struct BlockSlot *cached_block(const struct PairsData *d,
+    uint32_t block, int litIdx, bool *hit)
+{
+  *hit = false;
+  struct ThreadRecord *tr = thread_record();
+  struct BlockCache *bc = tr->blocks;
+  if (!bc) {
+    bc = tr->blocks = (struct BlockCache *)calloc(1, sizeof(*bc));
+    if (!bc)
+      return NULL;
+  }
+
+  // Another thread unloaded a table; a slot may name its PairsData.
+  uint32_t epoch = atomic_load_explicit(&blockEpoch, memory_order_acquire);
+  if (bc->epoch != epoch) {
+    for (int i = 0; i < TB_BLOCK_CACHE_SLOTS; i++)
+      bc->slot[i].d = NULL;
+    bc->epoch = epoch;
+  }
+
+  uint32_t h = ((uint32_t)((uintptr_t)d >> 4) ^ block) * 2654435761u;
+  struct BlockSlot *slot = &bc->slot[(h >> 16) & (TB_BLOCK_CACHE_SLOTS - 1)];
+  if (slot->d == d && slot->block == block) {
+    *hit = true;
+  } else {
+    const uint8_t *data = d->data + ((size_t)block << d->blockSize);
+    slot->d = d;
+    slot->block = block;
+    slot->codes = 0;
+    slot->code = from_be_u64(*(const uint64_t *)data);
+    slot->bitCnt = 0;
+    slot->words = 0;
+  }
+
+  if (!decode_block(d, slot, litIdx)) {
+    slot->d = NULL;
+    return NULL;
+  }
+  return slot;
+}
+
+// Value litIdx of a cached block.
+static uint8_t *slot_value(const struct PairsData *d,
+    const struct BlockSlot *slot, int litIdx)
+{
+  int lo = 0, hi = slot->codes - 1;
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (slot->last[mid] < litIdx)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  int first = lo ? slot->last[lo - 1] + 1 : 0;
+  return pair_value(d, slot->sym[lo], litIdx - first);
+}
+#endif
+
+// The symbol of value idx, through the decoded-block cache where possible.
+// *cached is 1 for a cache hit, 0 for a miss and -1 if the table has a
+// single value and needs no decoding.
+static uint8_t *decompress_pairs(struct PairsData *d, size_t idx, int *cached)
+{
+  *cached = -1;
+  if (!d->idxBits)
+    return d->constValue;
+
+  int litIdx;
+  uint32_t block = find_block(d, idx, &litIdx);
+#if TB_BLOCK_CACHE_SLOTS > 0
+  bool hit;
+  const struct BlockSlot *slot = cached_block(d, block, litIdx, &hit);
+  *cached = hit;
+  if (slot)
+    return slot_value(d, slot, litIdx);
+#else
+  *cached = 0;
+#endif
+  return decode_pairs(d, block, litIdx);
+}
+
+// p[i] is to contain the square 0-63 (A1-H8) for a piece of type
+// pc[i] ^ flip, where 1 = white pawn, ..., 14 = black king and pc ^ flip
+// flips between white and black if flip == true.
+// Pieces of the same type are guaranteed to be consecutive.
+inline static int fill_squares(const Pos *pos, uint8_t *pc, bool flip, int mirror, int *p,
+    int i)
+{
+  Color color = ColorOfPiece(pc[i]);
+  if (flip) color = (Color)(!(int)color);
+  uint64_t bb = pieces_by_type(pos, color, TypeOfPiece(pc[i]));
+  unsigned sq;
+  do {
+    sq = lsb(bb);
+    p[i++] = sq ^ mirror;
+    bb = poplsb(bb);
+  } while (bb);
+  return i;
+}
+
+// Unmap the tables of an entry unless a thread is probing it. Returns
+// true if the entry was evicted.
+static bool evict_entry(struct BaseEntry *be)
+{
+  // An entry that is being loaded is not a candidate.
+  if (atomic_flag_test_and_set_explicit(&be->lock, memory_order_acquire))
+    return false;
+
+  // Clearing the ready flags before looking at the hazard slots pairs with
+  // acquire_entry() followed by load_table() on the probing side: either
+  // the prober sees the cleared flag and waits for the lock, or we see its
+  // hazard and back off.
+  bool ready[3];
+  for (int type = 0; type < 3; type++) {
+    ready[type] = atomic_load_explicit(&be->ready[type], memory_order_relaxed);
+    if (ready[type])
+      atomic_store(&be->ready[type], false);
+  }
+
+  bool inUse = entry_in_use(be);
+  for (int type = 0; type < 3; type++) {
+    if (!ready[type])
+      continue;
+    if (inUse) {
+      atomic_store_explicit(&be->ready[type], true, memory_order_release);
+    } else {
+      unload_table(be, type);
+      be->evicted[type] = true;
+    }
+  }
+
+  unlock_entry(be);
+  if (!inUse)
+    atomic_fetch_add(&residency.evictions, (uint64_t)1);
+  return !inUse;
+}
+
+static bool entry_resident(struct BaseEntry *be)
+{
+  for (int type = 0; type < 3; type++)
+    if (atomic_load_explicit(&be->ready[type], memory_order_relaxed))
+      return true;
+  return false;
+}
+
+// Evict the least recently probed entries of all contexts until the
+// mapped tables fit in the budget. Only one thread evicts at a time. A
+// mapping shared by several contexts goes once all of them let go of it.
+static void enforce_budget(void)
+{
+  uint64_t budget = atomic_load(&residency.budget);
+  if (budget == 0 || atomic_load(&residency.bytes) <= budget)
+    return;
+  if (atomic_flag_test_and_set(&residency.evicting))
+    return;
+
+  spin_lock(&contextsLock);
+  uint32_t pass = ++residency.pass;
+  uint32_t now = atomic_load(&residency.clock);
+  while (atomic_load(&residency.bytes) > budget) {
+    struct BaseEntry *victim = NULL;
+    uint32_t victimAge = 0;
+    for (struct TbContext *ctx = contexts; ctx; ctx = ctx->next)
+      for (int i = 0; i < ctx->tbNumPiece + ctx->tbNumPawn; i++) {
+        struct BaseEntry *be = context_entry(ctx, i);
+        if (be->evictPass == pass || !entry_resident(be))
+          continue;
+        uint32_t age = now - atomic_load_explicit(&be->lastUse, memory_order_relaxed);
+        if (!victim || age > victimAge) {
+          victim = be;
+          victimAge = age;
+        }
+      }
+    if (!victim)
+      break;
+    victim->evictPass = pass;
+    evict_entry(victim);
+  }
+  spin_unlock(&contextsLock);
+
+  atomic_flag_clear(&residency.evicting);
+}
+
+// Make sure a table of the given type is loaded. The caller must hold a
+// hazard slot for the entry.
+static bool load_table(struct BaseEntry *be, const int type)
+{
+  // Use double-checked locking to reduce locking overhead. The lock is
+  // per table, so loading one table never stalls probes of another.
+  if (!atomic_load(&be->ready[type])) {
+    lock_entry(be);
+    if (!atomic_load_explicit(&be->ready[type], memory_order_relaxed)) {
+      if (!init_table(be, be->name, type)) {
+        unlock_entry(be);
+        return false;
+      }
+      if (type == WDL && be->num <= numaPieces && numaNodes > 1)
+        replicate_table(be);
+      atomic_fetch_add(&residency.loads, (uint64_t)1);
+#ifdef TB_STATS
+      entry_stats(be)->loads[type]++;
+#endif
+      if (be->evicted[type]) {
+        atomic_fetch_add(&residency.remaps, (uint64_t)1);
+        be->evicted[type] = false;
+      }
+      atomic_store_explicit(&be->lastUse,
+          atomic_fetch_add(&residency.clock, (uint32_t)1) + 1, memory_order_relaxed);
+      atomic_store_explicit(&be->ready[type], true, memory_order_release);
+    }
+    unlock_entry(be);
+    enforce_budget();
+  }
+  return true;
+}
+
+// Find the table of the given type for a material-signature key, loading
+// it on first use. Returns NULL if there is no such table or it could not
+// be loaded. Otherwise the entry is returned with a hazard slot held, which
+// must be given back with release_entry() once probing is done.
+static struct BaseEntry *lookup_table(struct TbContext *ctx, uint64_t key,
+    const int type)
+{
+  struct TbHashEntry *tbHash = ctx->tbHash;
+  int hashIdx = key >> (64 - TB_HASHBITS);
+  while (tbHash[hashIdx].key && tbHash[hashIdx].key != key)
+    hashIdx = (hashIdx + 1) & ((1 << TB_HASHBITS) - 1);
+  if (!tbHash[hashIdx].ptr)
+    return NULL;
+
+  struct BaseEntry *be = tbHash[hashIdx].ptr;
+  if ((type == DTM && !be->hasDtm) || (type == DTZ && !be->hasDtz))
+    return NULL;
+
+  if (!acquire_entry(be))
+    return NULL;
+  // A bitbase lives as long as its context and needs no table.
+  if (type == WDL && be->hasBitbase)
+    return be;
+  // Mapping a table reads from its file, leave that to the I/O threads.
+  if (threadRecord->noWait && !atomic_load(&be->ready[type])) {
+    release_entry();
+    threadRecord->ioPending = true;
+    return NULL;
+  }
+  // The entry stays: a table that was evicted may fail to map again for
+  // a while, and a later probe retries it.
+  if (!load_table(be, type)) {
+    release_entry();
+    return NULL;
+  }
+  touch_entry(be);
+
+  return be;
+}
+
+void tb_set_residency_budget(size_t budget_mb)
+{
+  atomic_store(&residency.budget, (uint64_t)budget_mb * 1024 * 1024);
+  enforce_budget();
+}
+
+void tb_residency(struct TbResidency *status)
+{
+  status->budget = atomic_load(&residency.budget);
+  status->resident = atomic_load(&residency.bytes);
+  status->tables = atomic_load(&residency.tables);
+  status->loads = atomic_load(&residency.loads);
+  status->evictions = atomic_load(&residency.evictions);
+  status->remaps = atomic_load(&residency.remaps);
+}
+
+#ifdef TB_STATS
+static void stats_add(struct TbTableStats *sum, const struct TbTableStats *ts)
+{
+  for (int type = 0; type < 3; type++) {
+    sum->probes[type] += ts->probes[type];
+    sum->successes[type] += ts->successes[type];
+    sum->failures[type] += ts->failures[type];
+    sum->loads[type] += ts->loads[type];
+    sum->blockHits[type] += ts->blockHits[type];
+    sum->blockMisses[type] += ts->blockMisses[type];
+  }
+  for (int i = 0; i < TB_STATS_TIME_BUCKETS; i++)
+    sum->decompress[i] += ts->decompress[i];
+  for (int i = 0; i < TB_STATS_DEPTHS; i++)
+    sum->depth[i] += ts->depth[i];
+}
+
+// Keep the counts of an exiting thread, under statsLock.
+static void retire_stats(struct ThreadRecord *tr)
+{
+  const size_t n = TB_MAX_PIECE + TB_MAX_PAWN;
+  unsigned epoch = atomic_load(&statsEpoch);
+  if (tr->statsEpoch != epoch)
+    return;
+  if (!retiredStats) {
+    retiredStats = (struct TbTableStats *)calloc(n, sizeof(struct TbTableStats));
+    if (!retiredStats)
+      return;
+    retiredEpoch = epoch;
+  }
+  if (retiredEpoch != epoch) {
+    memset(retiredStats, 0, n * sizeof(struct TbTableStats));
+    retiredEpoch = epoch;
+  }
+  for (size_t i = 0; i < n; i++)
+    stats_add(&retiredStats[i], &tr->stats[i]);
+}
+#endif
+
+size_t tb_get_stats(struct TbTableStats *stats, size_t size)
+{
+  size_t n = 0;
+#ifdef TB_STATS
+  struct TbContext *ctx = enter_default();
+  while (atomic_flag_test_and_set(&statsLock))
+    ;
+  unsigned epoch = atomic_load(&statsEpoch);
+  for (int i = 0; i < ctx->tbNumPiece + ctx->tbNumPawn; i++) {
+    struct BaseEntry *be = context_entry(ctx, i);
+    struct TbTableStats sum;
+    memset(&sum, 0, sizeof(sum));
+    for (struct ThreadRecord *tr = atomic_load(&threadRecords); tr; tr = tr->next)
+      if (tr->stats && tr->statsEpoch == epoch)
+        stats_add(&sum, &tr->stats[entry_index(be)]);
+    if (retiredStats && retiredEpoch == epoch)
+      stats_add(&sum, &retiredStats[entry_index(be)]);
+
+    bool used = false;
+    for (int type = 0; type < 3; type++)
+      used = used || sum.probes[type] || sum.loads[type];
+    if (!used)
+      continue;
+
+    strcpy(sum.name, be->name);
+    sum.key = be->key;
+    if (n < size)
+      stats[n] = sum;
+    n++;
+  }
+  atomic_flag_clear(&statsLock);
+  leave_default();
+#else
+  (void)stats;
+  (void)size;
+#endif
+  return n;
+}
+
+void tb_reset_stats(void)
+{
+#ifdef TB_STATS
+  atomic_fetch_add(&statsEpoch, 1u);
+#endif
+}
+
+bool tb_stats_enabled(void)
+{
+#ifdef TB_STATS
+  return true;
+#else
+  return false;
+#endif
+}
+
+// Background warm-up. Tables are loaded and their pages faulted in ahead
+// of the search so that the first probe of a table does not have to wait
+// for the disk.
+#ifdef __cplusplus
+static atomic<bool> warmupRunning(false);
+static atomic<bool> warmupCancel(false);
+static atomic<bool> warmupCancelled(false);
+static atomic<unsigned> warmupTotal(0);
+static atomic<unsigned> warmupDone(0);
+static atomic<uint64_t> warmupBytes(0);
+#else
+static atomic_bool warmupRunning = false;
+static atomic_bool warmupCancel = false;
+static atomic_bool warmupCancelled = false;
+static atomic_uint warmupTotal = 0;
+static atomic_uint warmupDone = 0;
+static _Atomic uint64_t warmupBytes = 0;
+#endif
+static unsigned warmupPieces;
+static size_t warmupBudget;
+#ifndef TB_NO_THREADS
+static THREAD_T warmupThread;
+static bool warmupStarted = false;
+#endif
+
+// Fault in the pages of a range of a mapped table and return its size.
+static size_t prefault(const uint8_t *ptr, size_t size)
+{
+  if (!ptr || !size)
+    return 0;
+#if !defined(_WIN32) && defined(POSIX_MADV_WILLNEED)
+  // Let the kernel start reading the whole range before it is touched.
+  long pageSize = sysconf(_SC_PAGESIZE);
+  uintptr_t start = (uintptr_t)ptr & ~((uintptr_t)pageSize - 1);
+  posix_madvise((void *)start, (uintptr_t)ptr + size - start, POSIX_MADV_WILLNEED);
+#endif
+  volatile uint8_t sink = 0;
+  for (size_t i = 0; i < size; i += 4096)
+    sink ^= ptr[i];
+  sink ^= ptr[size - 1];
+  (void)sink;
+  return size;
+}
+
+static uint64_t warmup_table(struct BaseEntry *be, int type, size_t *budget)
+{
+  uint64_t bytes = 0;
+  int num = num_tables(be, type);
+  struct EncInfo *ei = first_ei(be, type);
+  for (int t = 0; t < (type != DTZ ? 2 * num : num); t++) {
+    struct PairsData *d = ei[t].precomp;
+    if (!d || !d->idxBits)
+      continue;
+    bytes += prefault(d->indexTable, d->size[0]);
+    bytes += prefault((const uint8_t *)d->sizeTable, d->size[1]);
+    if (d->size[2] <= *budget) {
+      bytes += prefault(d->data, d->size[2]);
+      *budget -= d->size[2];
+    }
+  }
+  return bytes;
+}
+
+static bool warmup_type(const struct BaseEntry *be, int type)
+{
+  // DTM tables are not used for probing during search, and WDL tables with
+  // a bitbase are not probed at all.
+  return be->num <= warmupPieces
+         && ((type == WDL && !be->hasBitbase) || (type == DTZ && be->hasDtz));
+}
+
+static void warmup_run(void)
+{
+  size_t budget = warmupBudget;
+  struct TbContext *ctx = enter_default();
+  for (int i = 0; i < ctx->tbNumPiece + ctx->tbNumPawn; i++) {
+    struct BaseEntry *be = context_entry(ctx, i);
+    for (int type = 0; type < 3; type++) {
+      if (!warmup_type(be, type))
+        continue;
+      if (atomic_load_explicit(&warmupCancel, memory_order_relaxed)) {
+        // before warmupRunning goes false, so no one sees a finished run
+        atomic_store(&warmupCancelled, true);
+        goto done;
+      }
+      if (acquire_entry(be)) {
+        if (load_table(be, type))
+          atomic_fetch_add(&warmupBytes, warmup_table(be, type, &budget));
+        release_entry();
+      }
+      atomic_fetch_add(&warmupDone, 1u);
+    }
+  }
+done:
+  leave_default();
+}
+
+#ifndef TB_NO_THREADS
+THREAD_FUNC(warmup_thread)
+{
+  (void)arg;
+  warmup_run();
+  atomic_store(&warmupRunning, false);
+  THREAD_RETURN;
+}
+#endif
+
+void tb_warmup_stop(void)
+{
+  atomic_store(&warmupCancel, true);
+#ifndef TB_NO_THREADS
+  if (warmupStarted) {
+    THREAD_JOIN(warmupThread);
+    warmupStarted = false;
+  }
+#endif
+  atomic_store(&warmupRunning, false);
+}
+
+bool tb_warmup(unsigned pieces, size_t budget_mb)
+{
+  tb_warmup_stop();
+
+  warmupPieces = pieces;
+  warmupBudget = budget_mb * 1024 * 1024;
+  unsigned total = 0;
+  struct TbContext *ctx = enter_default();
+  for (int i = 0; i < ctx->tbNumPiece + ctx->tbNumPawn; i++)
+    for (int type = 0; type < 3; type++)
+      total += warmup_type(context_entry(ctx, i), type);
+  leave_default();
+  atomic_store(&warmupTotal, total);
+  atomic_store(&warmupDone, 0u);
+  atomic_store(&warmupBytes, (uint64_t)0);
+  atomic_store(&warmupCancel, false);
+  atomic_store(&warmupCancelled, false);
+
+  if (total == 0)
+    return true;
+
+#ifndef TB_NO_THREADS
+  atomic_store(&warmupRunning, true);
+  if (!THREAD_CREATE(warmupThread, warmup_thread)) {
+    atomic_store(&warmupRunning, false);
+    return false;
+  }
+  warmupStarted = true;
+#else
+  warmup_run();
+#endif
+  return true;
+}
+
+void tb_warmup_status(struct TbWarmupStatus *status)
+{
+  status->total = atomic_load(&warmupTotal);
+  status->done = atomic_load(&warmupDone);
+  status->bytes = atomic_load(&warmupBytes);
+  status->running = atomic_load(&warmupRunning);
+  status->cancelled = atomic_load(&warmupCancelled);
+}
+
+// Bitbases. WDL tables with at most bitbasePieces pieces are decompressed
+// when a context finds them, into arrays of 2 bits per position that
+// probe_entry_impl() reads with a shift and a mask. A WDL value takes one
+// of five values, so each entry maps the ones its table uses onto the four
+// codes; a table that uses all five stays compressed. The table file is
+// unmapped again once its bitbase is built.
+static unsigned bitbasePieces = 0;
+static unsigned bitbaseThreads = 1;
+
+// The context whose bitbases are being built, and the next entry to build.
+static struct TbContext *bitbaseCtx;
+#ifdef __cplusplus
+static atomic<int> bitbaseNext(0);
+static atomic<unsigned> bitbasesBuilt(0);
+static atomic<uint64_t> bitbaseBytes(0);
+#else
+static atomic_int bitbaseNext = 0;
+static atomic_uint bitbasesBuilt = 0;
+static _Atomic uint64_t bitbaseBytes = 0;
+#endif
+static atomic_flag bitbaseLock = ATOMIC_FLAG_INIT;
+
+void tb_set_bitbases(unsigned pieces, unsigned threads)
+{
+  bitbasePieces = pieces;
+  bitbaseThreads = threads ? threads : 1;
+}
+
+// The code of a WDL byte (0-4) in the bitbase of be, assigned on first
+// use. Returns -1 if the four codes are taken.
+static int bitbase_code(struct BaseEntry *be, int8_t *codes, int *numCodes,
+    int value)
+{
+  if (codes[value] < 0) {
+    if (*numCodes == 4)
+      return -1;
+    be->bitbaseWdl[*numCodes] = (int8_t)(value - 2);
+    codes[value] = (int8_t)(*numCodes)++;
+  }
+  return codes[value];
+}
+
+// Decode every value of d into bits, block by block. Returns false if the
+// table uses a fifth value.
+static bool expand_wdl(struct BaseEntry *be, const struct PairsData *d,
+    uint8_t *bits, int8_t *codes, int *numCodes)
+{
+  if (!d->idxBits) {
+    int c = bitbase_code(be, codes, numCodes, d->constValue[0]);
+    if (c < 0)
+      return false;
+    memset(bits, c * 0x55, (d->tbSize + 3) / 4);
+    return true;
+  }
+
+  int m = d->minLen;
+  const uint64_t *base = d->base - m;
+  size_t idx = 0;
+  for (uint32_t block = 0; idx < d->tbSize; block++) {
+    const uint32_t *ptr = (const uint32_t *)(d->data + ((size_t)block << d->blockSize));
+    size_t end = idx + d->sizeTable[block] + 1;
+    if (end > d->tbSize)
+      end = d->tbSize;
+
+    uint64_t code = from_be_u64(*(const uint64_t *)ptr);
+    ptr += 2;
+    uint32_t bitCnt = 0;
+    for (;;) {
+      int l = m;
+      while (code < base[l]) l++;
+      uint32_t sym = from_le_u16(d->offset[l]);
+      sym += (uint32_t)((code - base[l]) >> (64 - l));
+
+      // The pairs of sym form a binary tree at most 256 values wide; walk
+      // it left to right.
+      uint16_t stack[256];
+      int sp = 0;
+      stack[sp++] = (uint16_t)sym;
+      while (sp > 0 && idx < end) {
+        uint32_t s = stack[--sp];
+        if (d->symLen[s] == 0) {
+          int c = bitbase_code(be, codes, numCodes, d->symPat[3 * s]);
+          if (c < 0)
+            return false;
+          bits[idx >> 2] |= (uint8_t)(c << (2 * (idx & 3)));
+          idx++;
+          continue;
+        }
+        const uint8_t *w = d->symPat + 3 * s;
+        stack[sp++] = (uint16_t)((w[2] << 4) | (w[1] >> 4));
+        stack[sp++] = (uint16_t)(((w[1] & 0xf) << 8) | w[0]);
+      }
+      // Stop before reading past the last code of the block.
+      if (idx >= end)
+        break;
+      code <<= l;
+      bitCnt += l;
+      if (bitCnt >= 32) {
+        bitCnt -= 32;
+        uint32_t tmp = from_be_u32(*ptr++);
+        code |= (uint64_t)tmp << bitCnt;
+      }
+    }
+  }
+  return true;
+}
+
+// Build the bitbase of one entry. The context is not visible to other
+// threads yet, so the table is loaded and unloaded without the hazard
+// slots and the residency accounting of load_table().
+static void build_bitbase(struct BaseEntry *be)
+{
+  if (be->num > bitbasePieces || !init_table(be, be->name, WDL))
+    return;
+
+  int num = 2 * num_tables(be, WDL);
+  struct EncInfo *ei = first_ei(be, WDL);
+  int8_t codes[5] = { -1, -1, -1, -1, -1 };
+  int numCodes = 0;
+  uint64_t bytes = 0;
+  bool ok = true;
+  for (int t = 0; t < num; t++) {
+    ei[t].bitbase = NULL;
+    struct PairsData *d = ei[t].precomp;
+    if (!d || !ok)
+      continue;
+    size_t size = (d->tbSize + 3) / 4;
+    ei[t].bitbase = (uint8_t *)calloc(size, 1);
+    ok = ei[t].bitbase && expand_wdl(be, d, ei[t].bitbase, codes, &numCodes);
+    bytes += size;
+  }
+  unload_table(be, WDL);
+
+  if (!ok) {
+    for (int t = 0; t < num; t++) {
+      free(ei[t].bitbase);
+      ei[t].bitbase = NULL;
+    }
+    return;
+  }
+  be->hasBitbase = true;
+  atomic_fetch_add(&bitbasesBuilt, 1u);
+  atomic_fetch_add(&bitbaseBytes, bytes);
+}
+
+static void bitbase_run(void)
+{
+  struct TbContext *ctx = bitbaseCtx;
+  int i;
+  while ((i = atomic_fetch_add(&bitbaseNext, 1)) < ctx->tbNumPiece + ctx->tbNumPawn)
+    build_bitbase(context_entry(ctx, i));
+}
+
+#ifndef TB_NO_THREADS
+THREAD_FUNC(bitbase_thread)
+{
+  (void)arg;
+  bitbase_run();
+  THREAD_RETURN;
+}
+#endif
+
+static void build_bitbases(struct TbContext *ctx)
+{
+  if (bitbasePieces < 3 || ctx->tbNumPiece + ctx->tbNumPawn == 0)
+    return;
+
+  spin_lock(&bitbaseLock);
+  bitbaseCtx = ctx;
+  atomic_store(&bitbaseNext, 0);
+  atomic_store(&bitbasesBuilt, 0u);
+  atomic_store(&bitbaseBytes, (uint64_t)0);
+
+  // The calling thread builds as well.
+#ifndef TB_NO_THREADS
+  THREAD_T threads[64];
+  unsigned started = 0;
+  while (started + 1 < bitbaseThreads && started < 64
+         && THREAD_CREATE(threads[started], bitbase_thread))
+    started++;
+  bitbase_run();
+  for (unsigned i = 0; i < started; i++)
+    THREAD_JOIN(threads[i]);
+#else
+  bitbase_run();
+#endif
+
+  ctx->numBitbases = atomic_load(&bitbasesBuilt);
+  ctx->bitbaseBytes = atomic_load(&bitbaseBytes);
+  spin_unlock(&bitbaseLock);
+}
+
+// Non-blocking probes. tb_probe_wdl_nonblocking() probes with noWait set in
+// its thread record: a WDL table that is not mapped yet, or a block whose
+// pages are not in memory, stops the probe instead of faulting. The
+// position is then queued for the I/O threads, which probe it the blocking
+// way; that maps the tables and pulls the pages into the page cache, and
+// stores the result in the WDL cache if there is one. A later probe of the
+// position finds everything in memory.
+static unsigned ioPageSize = 4096;
+
+// Whether the pages of a range are in memory. Each thread remembers the
+// pages it found resident last, which saves the system call for the index
+// and size tables of the tables it probes most. A page that was paged out
+// since is only found out by a fault.
+static bool pages_resident(const void *ptr, size_t size)
+{
+  struct ThreadRecord *tr = threadRecord;
+  uintptr_t page = (uintptr_t)ptr & ~((uintptr_t)ioPageSize - 1);
+  for (; page < (uintptr_t)ptr + size; page += ioPageSize) {
+    uintptr_t *seen = &tr->residentPages[(page / ioPageSize) & (TB_RESIDENT_PAGES - 1)];
+    if (*seen == page)
+      continue;
+#ifndef _WIN32
+#if defined(__APPLE__) || defined(__FreeBSD__) || defined(__OpenBSD__)
+    char vec = 0;
+#else
+    unsigned char vec = 0;
+#endif
+    // If the kernel cannot tell, the probe goes ahead and may fault.
+    if (mincore((void *)page, ioPageSize, &vec) == 0 && !(vec & 1))
+      return false;
+#else
+    // Pages on the standby list count as not resident, taking them back
+    // costs a soft fault that the I/O threads take instead.
+    PSAPI_WORKING_SET_EX_INFORMATION info;
+    info.VirtualAddress = (PVOID)page;
+    if (QueryWorkingSetEx(GetCurrentProcess(), &info, sizeof(info))
+        && !info.VirtualAttributes.Valid)
+      return false;
+#endif
+    *seen = page;
+  }
+  return true;
+}
+
+// Whether decompress_pairs(d, idx) can run without a page fault. Only the
+// size table entry the index points at is checked, the few entries either
+// side that find_block() may step over are nearly always on the same page.
+static bool pairs_resident(const struct PairsData *d, size_t idx)
+{
+  if (!d->idxBits)
+    return true;
+  const uint8_t *indexEntry = d->indexTable + 6 * (idx >> d->idxBits);
+  if (!pages_resident(indexEntry, 6))
+    return false;
+  uint32_t block;
+  memcpy(&block, indexEntry, sizeof(block));
+  block = from_le_u32(block);
+  if (!pages_resident(&d->sizeTable[block], sizeof(d->sizeTable[0])))
+    return false;
+  int litIdx;
+  block = find_block(d, idx, &litIdx);
+  return pages_resident(d->data + ((size_t)block << d->blockSize),
+                        (size_t)1 << d->blockSize);
+}
+
+#ifdef __cplusplus
+static atomic<unsigned> ioThreads(0);
+static atomic<uint64_t> ioPendingProbes(0);
+static atomic<uint64_t> ioReads(0);
+static atomic<uint64_t> ioDropped(0);
+#else
+static atomic_uint ioThreads = 0;
+static _Atomic uint64_t ioPendingProbes = 0;
+static _Atomic uint64_t ioReads = 0;
+static _Atomic uint64_t ioDropped = 0;
+#endif
+
+#ifndef TB_NO_THREADS
+// The positions waiting for the I/O threads, and the hashes of the ones
+// queued lately so that a position probed again before it is read is not
+// queued twice. Positions go in and out under ioLock.
+static Pos ioQueue[TB_IO_QUEUE];
+static unsigned ioHead = 0, ioTail = 0;
+static atomic_flag ioLock = ATOMIC_FLAG_INIT;
+#ifdef __cplusplus
+static atomic<uint64_t> ioQueuedHash[TB_IO_QUEUE];
+static atomic<bool> ioStop(false);
+#else
+static _Atomic uint64_t ioQueuedHash[TB_IO_QUEUE];
+static atomic_bool ioStop = false;
+#endif
+
+// A counting semaphore, one count per queued position or thread to stop.
+#ifndef _WIN32
+static struct {
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  unsigned count;
+} ioSignal;
+
+static void io_signal_init(void)
+{
+  pthread_mutex_init(&ioSignal.lock, NULL);
+  pthread_cond_init(&ioSignal.cond, NULL);
+  ioSignal.count = 0;
+}
+
+static void io_signal_post(void)
+{
+  pthread_mutex_lock(&ioSignal.lock);
+  ioSignal.count++;
+  pthread_cond_signal(&ioSignal.cond);
+  pthread_mutex_unlock(&ioSignal.lock);
+}
+
+static void io_signal_wait(void)
+{
+  pthread_mutex_lock(&ioSignal.lock);
+  while (ioSignal.count == 0)
+    pthread_cond_wait(&ioSignal.cond, &ioSignal.lock);
+  ioSignal.count--;
+  pthread_mutex_unlock(&ioSignal.lock);
+}
+#else
+static HANDLE ioSignal;
+
+static void io_signal_init(void)
+{
+  ioSignal = CreateSemaphore(NULL, 0, MAXLONG, NULL);
+}
+
+static void io_signal_post(void)
+{
+  ReleaseSemaphore(ioSignal, 1, NULL);
+}
+
+static void io_signal_wait(void)
+{
+  WaitForSingleObject(ioSignal, INFINITE);
+}
+#endif
+
+static THREAD_T ioThread[TB_IO_MAX_THREADS];
+static bool ioSignalReady = false;
+#endif
+
+static void io_request(const Pos *pos)
+{
+#ifndef TB_NO_THREADS
+  uint64_t hash = wdl_cache_hash(pos);
+  unsigned slot = (unsigned)(hash % TB_IO_QUEUE);
+  if (atomic_load_explicit(&ioQueuedHash[slot], memory_order_relaxed) == hash)
+    return;
+
+  spin_lock(&ioLock);
+  bool full = ioTail - ioHead == TB_IO_QUEUE;
+  if (!full) {
+    ioQueue[ioTail++ % TB_IO_QUEUE] = *pos;
+    atomic_store_explicit(&ioQueuedHash[slot], hash, memory_order_relaxed);
+  }
+  spin_unlock(&ioLock);
+
+  if (full)
+    atomic_fetch_add(&ioDropped, (uint64_t)1);
+  else
+    io_signal_post();
+#else
+  (void)pos;
+#endif
+}
+
+#ifndef TB_NO_THREADS
+THREAD_FUNC(io_thread)
+{
+  (void)arg;
+  for (;;) {
+    io_signal_wait();
+    if (atomic_load(&ioStop))
+      break;
+
+    spin_lock(&ioLock);
+    Pos pos = ioQueue[ioHead++ % TB_IO_QUEUE];
+    spin_unlock(&ioLock);
+    // queued without a context, see tb_probe_wdl_nonblocking_impl()
+    uint64_t hash = wdl_cache_hash(&pos), queued = hash;
+
+    int success;
+    pos.ctx = enter_default();
+    probe_wdl_cached(&pos, &success);
+    leave_default();
+    atomic_fetch_add(&ioReads, (uint64_t)1);
+
+    atomic_compare_exchange_strong(&ioQueuedHash[hash % TB_IO_QUEUE], &queued,
+                                   (uint64_t)0);
+  }
+  THREAD_RETURN;
+}
+#endif
+
+bool tb_set_io_threads(unsigned threads)
+{
+#ifndef TB_NO_THREADS
+  if (threads > TB_IO_MAX_THREADS)
+    threads = TB_IO_MAX_THREADS;
+  if (!ioSignalReady) {
+#ifndef _WIN32
+    ioPageSize = (unsigned)sysconf(_SC_PAGESIZE);
+#else
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    ioPageSize = si.dwPageSize;
+#endif
+    io_signal_init();
+    ioSignalReady = true;
+  }
+
+  // Probes block again from here on. Positions still queued stay queued,
+  // each with its count, for the next threads.
+  unsigned running = atomic_exchange(&ioThreads, 0u);
+  atomic_store(&ioStop, true);
+  for (unsigned i = 0; i < running; i++)
+    io_signal_post();
+  for (unsigned i = 0; i < running; i++)
+    THREAD_JOIN(ioThread[i]);
+  atomic_store(&ioStop, false);
+
+  unsigned started = 0;
+  while (started < threads && THREAD_CREATE(ioThread[started], io_thread))
+    started++;
+  atomic_store(&ioThreads, started);
+  return started == threads;
+#else
+  return threads == 0;
+#endif
+}
+
+void tb_io_status(struct TbIoStatus *status)
+{
+  status->threads = atomic_load(&ioThreads);
+  status->pending = atomic_load(&ioPendingProbes);
+  status->reads = atomic_load(&ioReads);
+  status->dropped = atomic_load(&ioDropped);
+}
+
+unsigned tb_probe_wdl_nonblocking_impl(
+    uint64_t white,
+    uint64_t black,
+    uint64_t kings,
+    uint64_t queens,
+    uint64_t rooks,
+    uint64_t bishops,
+    uint64_t knights,
+    uint64_t pawns,
+    unsigned ep,
+    bool turn,
+    uint64_t key)
+{
+    if (atomic_load_explicit(&ioThreads, memory_order_relaxed) == 0)
+        return tb_probe_wdl_key_impl(white, black, kings, queens, rooks,
+            bishops, knights, pawns, ep, turn, key);
+
+    Pos pos =
+    {
+        white,
+        black,
+        kings,
+        queens,
+        rooks,
+        bishops,
+        knights,
+        pawns,
+        0,
+        (uint8_t)ep,
+        turn,
+        key,
+        NULL
+    };
+    struct ThreadRecord *tr = thread_record();
+    pos.ctx = enter_default();
+    tr->noWait = true;
+    int success;
+    int v = probe_wdl_cached(&pos, &success);
+    tr->noWait = false;
+    leave_default();
+
+    if (tr->ioPending) {
+        tr->ioPending = false;
+        pos.ctx = NULL;
+        io_request(&pos);
+        atomic_fetch_add(&ioPendingProbes, (uint64_t)1);
+        return TB_RESULT_PENDING;
+    }
+    if (success == 0)
+        return TB_RESULT_FAILED;
+    return (unsigned)(v + 2);
+}
+
+// Integrity check of the table files, see tb_verify(). Each file is first
+// read through in large chunks, which finds read errors and feeds the MD5.
+// Then its header is parsed the way init_table() parses it, with every read
+// bounds checked, and the index and size tables are read again to find
+// entries that point past the data. They are a few percent of the file and
+// usually still in the page cache.
+
+#define TB_VERIFY_CHUNK (4 << 20)
+#define TB_VERIFY_HEADER_BYTES (1 << 20)  // headers are far smaller
+
+// MD5 (RFC 1321), to compare files with published checksums.
+struct Md5 {
+  uint32_t h[4];
+  uint64_t len;
+  uint8_t buf[64];
+};
+
+static const uint32_t Md5K[64] = {
+  0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee,
+  0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+  0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be,
+  0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+  0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa,
+  0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+  0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed,
+  0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+  0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c,
+  0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+  0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05,
+  0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+  0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039,
+  0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+  0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1,
+  0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+};
+
+static const uint8_t Md5R[16] = {
+  7, 12, 17, 22, 5, 9, 14, 20, 4, 11, 16, 23, 6, 10, 15, 21
+};
+
+static void md5_block(uint32_t h[4], const uint8_t *p)
+{
+  uint32_t w[16];
+  for (int i = 0; i < 16; i++)
+    w[i] = read_le_u32((void *)(p + 4 * i));
+  uint32_t a = h[0], b = h[1], c = h[2], d = h[3];
+  for (int i = 0; i < 64; i++) {
+    uint32_t f;
+    int g;
+    if (i < 16) {
+      f = (b & c) | (~b & d);
+      g = i;
+    } else if (i < 32) {
+      f = (d & b) | (~d & c);
+      g = (5 * i + 1) & 15;
+    } else if (i < 48) {
+      f = b ^ c ^ d;
+      g = (3 * i + 5) & 15;
+    } else {
+      f = c ^ (b | ~d);
+      g = (7 * i) & 15;
+    }
+    f += a + Md5K[i] + w[g];
+    int r = Md5R[(i >> 4) * 4 + (i & 3)];
+    a = d;
+    d = c;
+    c = b;
+    b += (f << r) | (f >> (32 - r));
+  }
+  h[0] += a;
+  h[1] += b;
+  h[2] += c;
+  h[3] += d;
+}
+
+static void md5_init(struct Md5 *m)
+{
+  m->h[0] = 0x67452301;
+  m->h[1] = 0xefcdab89;
+  m->h[2] = 0x98badcfe;
+  m->h[3] = 0x10325476;
+  m->len = 0;
+}
+
+static void md5_update(struct Md5 *m, const uint8_t *p, size_t n)
+{
+  size_t have = m->len & 63;
+  m->len += n;
+  if (have) {
+    size_t take = 64 - have < n ? 64 - have : n;
+    memcpy(m->buf + have, p, take);
+    p += take;
+    n -= take;
+    if (have + take < 64)
+      return;
+    md5_block(m->h, m->buf);
+  }
+  for (; n >= 64; p += 64, n -= 64)
+    md5_block(m->h, p);
+  memcpy(m->buf, p, n);
+}
+
+static void md5_final(struct Md5 *m, uint8_t digest[16])
+{
+  uint64_t bits = m->len * 8;
+  uint8_t pad[72] = { 0x80 };
+  size_t n = 64 - ((m->len + 8) & 63);
+  for (int i = 0; i < 8; i++)
+    pad[n + i] = (uint8_t)(bits >> (8 * i));
+  md5_update(m, pad, n + 8);
+  for (int i = 0; i < 16; i++)
+    digest[i] = (uint8_t)(m->h[i / 4] >> (8 * (i & 3)));
+}
+
+// A checksum list, sorted by file name.
+struct Md5Entry {
+  char name[16];
+  uint8_t md5[16];
+};
+
+static int hex_value(char c)
+{
+  return c >= '0' && c <= '9' ? c - '0'
+       : c >= 'a' && c <= 'f' ? c - 'a' + 10
+       : c >= 'A' && c <= 'F' ? c - 'A' + 10 : -1;
+}
+
+static int compare_md5_entry(const void *a, const void *b)
+{
+  return strcmp(((const struct Md5Entry *)a)->name,
+                ((const struct Md5Entry *)b)->name);
+}
+
+// Read an md5sum list. Lines that are not "<md5>  <file>" with a table
+// file name are skipped.
+static struct Md5Entry *load_checksums(const char *file, size_t *count)
+{
+  *count = 0;
+  FILE *f = fopen(file, "r");
+  if (!f)
+    return NULL;
+  size_t room = 0;
+  struct Md5Entry *list = NULL;
+  char line[1024];
+  while (fgets(line, sizeof(line), f)) {
+    struct Md5Entry e;
+    int i;
+    for (i = 0; i < 32; i++) {
+      int hi = hex_value(line[i]), lo = hi < 0 ? -1 : hex_value(line[++i]);
+      if (lo < 0)
+        break;
+      e.md5[i / 2] = (uint8_t)(hi << 4 | lo);
+    }
+    if (i < 32 || (line[32] != ' ' && line[32] != '\t'))
+      continue;
+    char *name = line + 33;
+    while (*name == ' ' || *name == '\t' || *name == '*')
+      name++;
+    name[strcspn(name, "\r\n")] = 0;
+    for (char *s = name; *s; s++)
+      if (*s == '/' || *s == '\\')
+        name = s + 1;
+    if (strlen(name) >= sizeof(e.name))
+      continue;
+    strcpy(e.name, name);
+    if (*count == room) {
+      room = room ? 2 * room : 1024;
+      struct Md5Entry *grown = (struct Md5Entry *)realloc(list, room * sizeof(*list));
+      if (!grown)
+        break;
+      list = grown;
+    }
+    list[(*count)++] = e;
+  }
+  fclose(f);
+  if (list)
+    qsort(list, *count, sizeof(*list), compare_md5_entry);
+  return list;
+}
+
+static size_t read_at(FD fd, uint64_t offset, void *buf, size_t len)
+{
+  size_t done = 0;
+  while (done < len) {
+#ifndef _WIN32
+    ssize_t n = pread(fd, (uint8_t *)buf + done, len - done,
+                      (off_t)(offset + done));
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      break;
+#else
+    OVERLAPPED ov;
+    memset(&ov, 0, sizeof(ov));
+    ov.Offset = (DWORD)(offset + done);
+    ov.OffsetHigh = (DWORD)((offset + done) >> 32);
+    DWORD n;
+    if (!ReadFile(fd, (uint8_t *)buf + done, (DWORD)(len - done), &n, &ov)
+        || n == 0)
+      break;
+#endif
+    done += (size_t)n;
+  }
+  return done;
+}
+
+// Where the index, size and data tables of one pairs data lie in the file.
+struct VerifyPairs {
+  uint64_t tbSize;
+  uint32_t numBlocks, realNumBlocks;
+  uint8_t idxBits, blockSize;
+  uint64_t index, sizes, data;
+};
+
+// Whether the pieces of a header are those of the table's name, for either
+// side.
+static bool header_pieces(const struct BaseEntry *be, const struct EncInfo *ei)
+{
+  int pcs[16] = { 0 };
+  for (int i = 0; i < be->num; i++) {
+    int p = ei->pieces[i];
+    if ((p & 7) == 0 || (p & 7) == 7)
+      return false;
+    pcs[p]++;
+  }
+  return pcs[W_KING] == 1 && pcs[B_KING] == 1
+      && (calc_key_from_pcs(pcs, false) == be->key
+          || calc_key_from_pcs(pcs, true) == be->key);
+}
+
+// The bytes a read at pos of n bytes needs are past the header buffer,
+// which is a short file if the buffer holds all of it.
+#define VERIFY_NEED(n)                                                      \
+  do {                                                                      \
+    if (pos + (n) > len)                                                    \
+      return len == fileSize ? TB_VERIFY_TRUNCATED : TB_VERIFY_HEADER;      \
+  } while (0)
+
+// Check the header of one pairs data, see setup_pairs().
+static unsigned verify_pairs(const uint8_t *buf, size_t len, uint64_t fileSize,
+    size_t *ppos, uint64_t tbSize, struct VerifyPairs *p, uint8_t *flags,
+    int type)
+{
+  size_t pos = *ppos;
+  VERIFY_NEED(2);
+  const uint8_t *data = buf + pos;
+  memset(p, 0, sizeof(*p));
+  p->tbSize = tbSize;
+  *flags = data[0];
+  if (data[0] & 0x80) {
+    *ppos = pos + 2;
+    return type == WDL && data[1] > 4 ? TB_VERIFY_HEADER : TB_VERIFY_OK;
+  }
+
+  VERIFY_NEED(12);
+  p->blockSize = data[1];
+  p->idxBits = data[2];
+  p->realNumBlocks = read_le_u32((void *)(data + 4));
+  p->numBlocks = p->realNumBlocks + data[3];
+  int maxLen = data[8], minLen = data[9];
+#ifdef DECOMP64
+  int longest = 64;
+#else
+  int longest = 32;
+#endif
+  if (p->blockSize >= 32 || p->idxBits == 0 || p->idxBits >= 32
+      || p->numBlocks < p->realNumBlocks || minLen > maxLen
+      || maxLen > longest)
+    return TB_VERIFY_HEADER;
+  int h = maxLen - minLen + 1;
+  VERIFY_NEED(12 + 2 * (size_t)h);
+  uint32_t numSyms = read_le_u16((void *)(data + 10 + 2 * h));
+  if (numSyms == 0 || numSyms >= TB_MAX_SYMS)
+    return TB_VERIFY_HEADER;
+  size_t end = 12 + 2 * (size_t)h + 3 * (size_t)numSyms + (numSyms & 1);
+  VERIFY_NEED(end);
+
+  // Every pair must be made of symbols of the table.
+  const uint8_t *symPat = data + 12 + 2 * h;
+  for (uint32_t s = 0; s < numSyms; s++) {
+    const uint8_t *w = symPat + 3 * s;
+    uint32_t s2 = (w[2] << 4) | (w[1] >> 4);
+    uint32_t s1 = ((w[1] & 0xf) << 8) | w[0];
+    if (s2 != 0x0fff && (s1 >= numSyms || s2 >= numSyms))
+      return TB_VERIFY_HEADER;
+  }
+  *ppos = pos + end;
+  return TB_VERIFY_OK;
+}
+
+// Check the header of a table file of be and find its tables, see
+// init_table(). buf holds the first len bytes of the file.
+static unsigned verify_header(struct BaseEntry *be, int type,
+    const uint8_t *buf, size_t len, uint64_t fileSize,
+    struct VerifyPairs *pairs, int *numPairs)
+{
+  size_t pos = 0;
+  VERIFY_NEED(5);
+  if (read_le_u32((void *)buf) != tbMagic[type])
+    return TB_VERIFY_MAGIC;
+  if (!(buf[4] & 0x02) != !be->hasPawns
+      || (type == WDL && !(buf[4] & 0x01) != be->symmetric))
+    return TB_VERIFY_HEADER;
+  bool split = type != DTZ && (buf[4] & 0x01);
+  bool lossOnly = type == DTM && (buf[4] & 0x04);
+  pos = 5;
+
+  int num = num_tables(be, type);
+  int enc = !be->hasPawns ? PIECE_ENC : type != DTM ? FILE_ENC : RANK_ENC;
+  size_t step = be->num + 1 + (be->hasPawns && be->pawns[1]);
+  struct EncInfo ei[12];
+  uint64_t tbSize[6][2];
+  for (int t = 0; t < num; t++) {
+    VERIFY_NEED(step);
+    tbSize[t][0] = init_enc_info(&ei[t], be, (uint8_t *)buf + pos, 0, t, enc);
+    if (!header_pieces(be, &ei[t]))
+      return TB_VERIFY_HEADER;
+    if (split) {
+      tbSize[t][1] = init_enc_info(&ei[num + t], be, (uint8_t *)buf + pos, 4, t, enc);
+      if (!header_pieces(be, &ei[num + t]))
+        return TB_VERIFY_HEADER;
+    }
+    pos += step;
+  }
+  pos += pos & 1;
+
+  uint8_t flags[6];
+  *numPairs = 0;
+  for (int t = 0; t < num; t++) {
+    unsigned status = verify_pairs(buf, len, fileSize, &pos, tbSize[t][0],
+        &pairs[t], &flags[t], type);
+    if (status == TB_VERIFY_OK && split)
+      status = verify_pairs(buf, len, fileSize, &pos, tbSize[t][1],
+          &pairs[num + t], &flags[t], type);
+    if (status != TB_VERIFY_OK)
+      return status;
+  }
+  *numPairs = split ? 2 * num : num;
+
+  if (type == DTM && !lossOnly) {
+    for (int t = 0; t < num; t++)
+      for (int i = 0; i < (split ? 4 : 2); i++) {
+        VERIFY_NEED(2);
+        pos += 2 + 2 * (size_t)read_le_u16((void *)(buf + pos));
+      }
+  }
+
+  if (type == DTZ) {
+    for (int t = 0; t < num; t++) {
+      if (!(flags[t] & 2))
+        continue;
+      if (!(flags[t] & 16)) {
+        for (int i = 0; i < 4; i++) {
+          VERIFY_NEED(1);
+          pos += 1 + buf[pos];
+        }
+      } else {
+        pos += pos & 1;
+        for (int i = 0; i < 4; i++) {
+          VERIFY_NEED(2);
+          pos += 2 + 2 * (size_t)read_le_u16((void *)(buf + pos));
+        }
+      }
+    }
+    pos += pos & 1;
+  }
+
+  // The index tables of all pairs data, then the size tables, then the
+  // data, each block of it 64-byte aligned; in the order of init_table().
+  uint64_t at = pos;
+  for (int t = 0; t < num; t++)
+    for (int k = 0; k < (split ? 2 : 1); k++) {
+      struct VerifyPairs *p = &pairs[k * num + t];
+      p->index = at;
+      if (p->idxBits)
+        at += 6 * ((p->tbSize + ((uint64_t)1 << p->idxBits) - 1) >> p->idxBits);
+    }
+  for (int t = 0; t < num; t++)
+    for (int k = 0; k < (split ? 2 : 1); k++) {
+      struct VerifyPairs *p = &pairs[k * num + t];
+      p->sizes = at;
+      at += 2 * (uint64_t)p->numBlocks;
+    }
+  for (int t = 0; t < num; t++)
+    for (int k = 0; k < (split ? 2 : 1); k++) {
+      struct VerifyPairs *p = &pairs[k * num + t];
+      at = (at + 0x3f) & ~(uint64_t)0x3f;
+      p->data = at;
+      at += (uint64_t)p->realNumBlocks << p->blockSize;
+    }
+  // A complete file ends in 16 bytes after a multiple of 64, see test_tb().
+  return at > fileSize || (fileSize & 63) != 16 ? TB_VERIFY_TRUNCATED
+                                                : TB_VERIFY_OK;
+}
+
+#undef VERIFY_NEED
 
-  if (litIdx < 0)
-    while (litIdx < 0)
-      litIdx += d->sizeTable[--block] + 1;
-  else
-    while (litIdx > d->sizeTable[block])
-      litIdx -= d->sizeTable[block++] + 1;
+// Check that the index of p only points at blocks that exist, and that
+// the blocks hold every value of the table.
+static unsigned verify_blocks(FD fd, const struct VerifyPairs *p, uint8_t *buf)
+{
+  if (!p->idxBits)
+    return TB_VERIFY_OK;
+  uint64_t numIdx = (p->tbSize + ((uint64_t)1 << p->idxBits) - 1) >> p->idxBits;
+  for (uint64_t i = 0; i < numIdx;) {
+    size_t n = (size_t)(numIdx - i < TB_VERIFY_CHUNK / 6 ? numIdx - i : TB_VERIFY_CHUNK / 6);
+    if (read_at(fd, p->index + 6 * i, buf, 6 * n) != 6 * n)
+      return TB_VERIFY_UNREADABLE;
+    for (size_t k = 0; k < n; k++)
+      if (read_le_u32(buf + 6 * k) >= p->numBlocks)
+        return TB_VERIFY_BLOCKS;
+    i += n;
+  }
 
-  uint32_t *ptr = (uint32_t *)(d->data + ((size_t)block << d->blockSize));
+  uint64_t values = 0;
+  for (uint32_t b = 0; b < p->realNumBlocks;) {
+    size_t n = p->realNumBlocks - b < TB_VERIFY_CHUNK / 2 ? p->realNumBlocks - b : TB_VERIFY_CHUNK / 2;
+    if (read_at(fd, p->sizes + 2 * (uint64_t)b, buf, 2 * n) != 2 * n)
+      return TB_VERIFY_UNREADABLE;
+    for (size_t k = 0; k < n; k++)
+      values += read_le_u16(buf + 2 * k) + 1;
+    b += (uint32_t)n;
+  }
+  return values < p->tbSize ? TB_VERIFY_BLOCKS : TB_VERIFY_OK;
+}
 
-  int m = d->minLen;
-  uint16_t *offset = d->offset;
-  uint64_t *base = d->base - m;
-  uint8_t *symLen = d->symLen;
-  uint32_t sym, bitCnt;
+struct VerifyJob {
+  struct BaseEntry *be;
+  int type;
+  uint64_t size;      // as listed, to check the largest files first
+  struct TbVerifyResult *result;
+};
 
-#ifdef DECOMP64
-  uint64_t code = from_be_u64(*(uint64_t *)ptr);
+static struct TbContext *verifyCtx;
+static struct VerifyJob *verifyJobs;
+static int verifyNumJobs;
+static struct Md5Entry *verifySums;
+static size_t verifyNumSums;
+#ifdef __cplusplus
+static atomic<int> verifyNext(0);
+#else
+static atomic_int verifyNext = 0;
+#endif
+static atomic_flag verifyLock = ATOMIC_FLAG_INIT;
 
-  ptr += 2;
-  bitCnt = 0; // number of "empty bits" in code
-  for (;;) {
-    int l = m;
-    while (code < base[l]) l++;
-    sym = from_le_u16(offset[l]);
-    sym += (uint32_t)((code - base[l]) >> (64 - l));
-    if (litIdx < (int)symLen[sym] + 1) break;
-    litIdx -= (int)symLen[sym] + 1;
-    code <<= l;
-    bitCnt += l;
-    if (bitCnt >= 32) {
-      bitCnt -= 32;
-      uint32_t tmp = from_be_u32(*ptr++);
-      code |= (uint64_t)tmp << bitCnt;
-    }
+static unsigned verify_file(const struct VerifyJob *job, uint8_t *buf)
+{
+  struct TbContext *ctx = verifyCtx;
+  struct TbVerifyResult *r = job->result;
+  FD fd = open_tb(ctx->paths, ctx->numPaths, &ctx->index, job->be->name,
+                  tbSuffix[job->type]);
+  if (fd == FD_ERR)
+    return TB_VERIFY_UNREADABLE;
+  uint64_t size = file_size(fd);
+  r->bytes = size;
+#if defined(POSIX_FADV_SEQUENTIAL) && !defined(_WIN32)
+  posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+  const struct Md5Entry *known = NULL;
+  if (verifySums) {
+    struct Md5Entry key;
+    strcpy(key.name, r->name);
+    known = (const struct Md5Entry *)bsearch(&key, verifySums, verifyNumSums,
+        sizeof(key), compare_md5_entry);
   }
-#else
-  uint32_t next = 0;
-  uint32_t data = *ptr++;
-  uint32_t code = from_be_u32(data);
-  bitCnt = 0; // number of bits in next
-  for (;;) {
-    int l = m;
-    while (code < base[l]) l++;
-    sym = offset[l] + ((code - base[l]) >> (32 - l));
-    if (litIdx < (int)symLen[sym] + 1) break;
-    litIdx -= (int)symLen[sym] + 1;
-    code <<= l;
-    if (bitCnt < l) {
-      if (bitCnt) {
-	code |= (next >> (32 - l));
-	l -= bitCnt;
-      }
-      data = *ptr++;
-      next = from_be_u32(data);
-      bitCnt = 32;
+  r->checksummed = known != NULL;
+
+  // Read the whole file.
+  struct Md5 md5;
+  md5_init(&md5);
+  for (uint64_t at = 0; at < size;) {
+    size_t n = size - at < TB_VERIFY_CHUNK ? (size_t)(size - at) : TB_VERIFY_CHUNK;
+    if (read_at(fd, at, buf, n) != n) {
+      close_tb(fd);
+      return TB_VERIFY_UNREADABLE;
     }
-    code |= (next >> (32 - l));
-    next <<= l;
-    bitCnt -= l;
+    if (known)
+      md5_update(&md5, buf, n);
+    at += n;
   }
-#endif
-  uint8_t *symPat = d->symPat;
-  while (symLen[sym] != 0) {
-    uint8_t *w = symPat + (3 * sym);
-    int s1 = ((w[1] & 0xf) << 8) | w[0];
-    if (litIdx < (int)symLen[s1] + 1)
-      sym = s1;
-    else {
-      litIdx -= (int)symLen[s1] + 1;
-      sym = (w[2] << 4) | (w[1] >> 4);
-    }
+
+  size_t len = size < TB_VERIFY_HEADER_BYTES ? (size_t)size : TB_VERIFY_HEADER_BYTES;
+  struct VerifyPairs pairs[12];
+  int numPairs = 0;
+  unsigned status = read_at(fd, 0, buf, len) != len ? TB_VERIFY_UNREADABLE
+      : verify_header(job->be, job->type, buf, len, size, pairs, &numPairs);
+  for (int i = 0; i < numPairs && status == TB_VERIFY_OK; i++)
+    status = verify_blocks(fd, &pairs[i], buf);
+  close_tb(fd);
+
+  if (status == TB_VERIFY_OK && known) {
+    uint8_t digest[16];
+    md5_final(&md5, digest);
+    if (memcmp(digest, known->md5, sizeof(digest)))
+      status = TB_VERIFY_CHECKSUM;
   }
+  return status;
+}
 
-  return &symPat[3 * sym];
+static void verify_run(void)
+{
+  uint8_t *buf = (uint8_t *)malloc(TB_VERIFY_CHUNK);
+  if (!buf)
+    return;
+  int i;
+  while ((i = atomic_fetch_add(&verifyNext, 1)) < verifyNumJobs) {
+    const struct VerifyJob *job = &verifyJobs[i];
+    uint64_t start = now_micros();
+    job->result->status = verify_file(job, buf);
+    job->result->micros = now_micros() - start;
+  }
+  free(buf);
 }
 
-// p[i] is to contain the square 0-63 (A1-H8) for a piece of type
-// pc[i] ^ flip, where 1 = white pawn, ..., 14 = black king and pc ^ flip
-// flips between white and black if flip == true.
-// Pieces of the same type are guaranteed to be consecutive.
-inline static int fill_squares(const Pos *pos, uint8_t *pc, bool flip, int mirror, int *p,
-    int i)
+#ifndef TB_NO_THREADS
+THREAD_FUNC(verify_thread)
 {
-  Color color = ColorOfPiece(pc[i]);
-  if (flip) color = (Color)(!(int)color);
-  uint64_t bb = pieces_by_type(pos, color, TypeOfPiece(pc[i]));
-  unsigned sq;
-  do {
-    sq = lsb(bb);
-    p[i++] = sq ^ mirror;
-    bb = poplsb(bb);
-  } while (bb);
-  return i;
+  (void)arg;
+  verify_run();
+  THREAD_RETURN;
 }
+#endif
 
-int probe_table(const Pos *pos, int s, int *success, const int type)
+static int compare_job_size(const void *a, const void *b)
 {
-  // Obtain the position's material-signature key
-  uint64_t key = calc_key(pos,false);
+  uint64_t sa = ((const struct VerifyJob *)a)->size;
+  uint64_t sb = ((const struct VerifyJob *)b)->size;
+  return sa < sb ? 1 : sa > sb ? -1 : 0;
+}
 
-  // Test for KvK
-  // Note: Cfish has key == 2ULL for KvK but we have 0
-  if (type == WDL && key == 0ULL)
+size_t tb_verify(const char *path, const char *checksums, unsigned threads,
+    struct TbVerifyResult *results, size_t size)
+{
+  init_once();
+  struct TbContext *ctx = (struct TbContext *)calloc(1, sizeof(*ctx));
+  if (!ctx)
     return 0;
-
-  int hashIdx = key >> (64 - TB_HASHBITS);
-  while (tbHash[hashIdx].key && tbHash[hashIdx].key != key)
-    hashIdx = (hashIdx + 1) & ((1 << TB_HASHBITS) - 1);
-  if (!tbHash[hashIdx].ptr) {
-    *success = 0;
+  ctx->anySize = true;
+  context_load(ctx, path);
+
+  size_t numSums = 0;
+  struct Md5Entry *sums = checksums && *checksums
+                        ? load_checksums(checksums, &numSums) : NULL;
+  int numEntries = ctx->tbNumPiece + ctx->tbNumPawn;
+  int numJobs = ctx->numWdl + ctx->numDtm + ctx->numDtz;
+  struct VerifyJob *jobs = (struct VerifyJob *)calloc(numJobs ? numJobs : 1, sizeof(*jobs));
+  struct TbVerifyResult *all = (struct TbVerifyResult *)calloc(numJobs + numSums + 1, sizeof(*all));
+  bool *listed = (bool *)calloc(numSums + 1, sizeof(*listed));
+  if (!jobs || !all || !listed) {
+    free(sums);
+    free(jobs);
+    free(all);
+    free(listed);
+    context_clear(ctx);
+    free(ctx->pieceEntry);
+    free(ctx->pawnEntry);
+    free(ctx);
     return 0;
   }
 
-  struct BaseEntry *be = tbHash[hashIdx].ptr;
-  if ((type == DTM && !be->hasDtm) || (type == DTZ && !be->hasDtz)) {
-    *success = 0;
-    return 0;
+  int n = 0;
+  for (int i = 0; i < numEntries; i++) {
+    struct BaseEntry *be = context_entry(ctx, i);
+    bool has[3] = { true, be->hasDtm, be->hasDtz };
+    for (int type = 0; type < 3; type++) {
+      if (!has[type] || n == numJobs)
+        continue;
+      struct TbVerifyResult *r = &all[n];
+      // names have 8 characters at most, so this only keeps the compiler
+      // from warning about a truncation that cannot happen
+      if (snprintf(r->name, sizeof(r->name), "%s%s", be->name, tbSuffix[type])
+          >= (int)sizeof(r->name))
+        continue;
+      r->status = TB_VERIFY_UNREADABLE;
+      const struct TbFile *f = find_file(&ctx->index, be->name, tbSuffix[type]);
+      jobs[n].be = be;
+      jobs[n].type = type;
+      jobs[n].size = f ? f->size : 0;
+      jobs[n].result = r;
+      n++;
+    }
   }
+  qsort(jobs, n, sizeof(*jobs), compare_job_size);
 
-  // Use double-checked locking to reduce locking overhead
-  if (!atomic_load_explicit(&be->ready[type], memory_order_acquire)) {
-    LOCK(tbMutex);
-    if (!atomic_load_explicit(&be->ready[type], memory_order_relaxed)) {
-      char str[16];
-      prt_str(pos, str, be->key != key);
-      if (!init_table(be, str, type)) {
-        tbHash[hashIdx].ptr = NULL; // mark as deleted
-        *success = 0;
-        UNLOCK(tbMutex);
-        return 0;
-      }
-      atomic_store_explicit(&be->ready[type], true, memory_order_release);
-    }
-    UNLOCK(tbMutex);
+  spin_lock(&verifyLock);
+  verifyCtx = ctx;
+  verifyJobs = jobs;
+  verifyNumJobs = n;
+  verifySums = sums;
+  verifyNumSums = numSums;
+  atomic_store(&verifyNext, 0);
+
+  // The calling thread checks files as well.
+#ifndef TB_NO_THREADS
+  THREAD_T workers[64];
+  unsigned started = 0;
+  while (started + 1 < threads && started < 64
+         && THREAD_CREATE(workers[started], verify_thread))
+    started++;
+  verify_run();
+  for (unsigned i = 0; i < started; i++)
+    THREAD_JOIN(workers[i]);
+#else
+  (void)threads;
+  verify_run();
+#endif
+
+  verifySums = NULL;
+  spin_unlock(&verifyLock);
+
+  // Files on the checksum list that are not there at all, the usual
+  // outcome of a copy that did not finish, fail as unreadable.
+  size_t total = (size_t)n;
+  for (int i = 0; i < n && sums; i++) {
+    struct Md5Entry key;
+    strcpy(key.name, all[i].name);
+    const struct Md5Entry *e = (const struct Md5Entry *)bsearch(&key, sums,
+        numSums, sizeof(key), compare_md5_entry);
+    if (e)
+      listed[e - sums] = true;
+  }
+  for (size_t i = 0; i < numSums; i++) {
+    if (listed[i])
+      continue;
+    struct TbVerifyResult *r = &all[total++];
+    strcpy(r->name, sums[i].name);
+    r->status = TB_VERIFY_UNREADABLE;
+    r->checksummed = 1;
   }
 
+  for (size_t i = 0; i < size && i < total; i++)
+    results[i] = all[i];
+  free(sums);
+  free(jobs);
+  free(all);
+  free(listed);
+  context_clear(ctx);
+  free(ctx->pieceEntry);
+  free(ctx->pawnEntry);
+  free(ctx);
+  return total;
+}
+
+// Where a position is stored in a table: the encoding, the index and, for
+// DTM/DTZ, what is needed to map the stored value.
+struct ProbeIndex {
+  struct EncInfo *ei;
+  size_t idx;
+  int t;
+  bool bside;
+  uint8_t flags;
+};
+
+// Compute the table index of pos. Returns false if the table only stores
+// the other side to move (DTZ only).
+static bool encode_pos(const Pos *pos, struct BaseEntry *be, uint64_t key,
+    const int type, struct ProbeIndex *pi)
+{
   bool bside, flip;
   if (!be->symmetric) {
     flip = key != be->key;
@@ -1779,33 +5353,71 @@ int probe_table(const Pos *pos, int s, int *success, const int type)
   if (!be->hasPawns) {
     if (type == DTZ) {
       flags = PIECE(be)->dtzFlags;
-      if ((flags & 1) != bside && !be->symmetric) {
-        *success = -1;
-        return 0;
-      }
+      if ((flags & 1) != bside && !be->symmetric)
+        return false;
     }
     ei = type != DTZ ? &ei[bside] : ei;
     for (int i = 0; i < be->num;)
       i = fill_squares(pos, ei->pieces, flip, 0, p, i);
-    idx = encode_piece(p, ei, be);
+    idx = ei->encode(p, ei, be);
   } else {
     int i = fill_squares(pos, ei->pieces, flip, flip ? 0x38 : 0, p, 0);
     t = leading_pawn(p, be, type != DTM ? FILE_ENC : RANK_ENC);
     if (type == DTZ) {
       flags = PAWN(be)->dtzFlags[t];
-      if ((flags & 1) != bside && !be->symmetric) {
-        *success = -1;
-        return 0;
-      }
+      if ((flags & 1) != bside && !be->symmetric)
+        return false;
     }
     ei =  type == WDL ? &ei[t + 4 * bside]
         : type == DTM ? &ei[t + 6 * bside] : &ei[t];
     while (i < be->num)
       i = fill_squares(pos, ei->pieces, flip, flip ? 0x38 : 0, p, i);
-    idx = type != DTM ? encode_pawn_f(p, ei, be) : encode_pawn_r(p, ei, be);
+    idx = ei->encode(p, ei, be);
+  }
+
+  pi->ei = ei;
+  pi->idx = idx;
+  pi->t = t;
+  pi->bside = bside;
+  pi->flags = flags;
+  return true;
+}
+
+static int probe_entry_impl(const Pos *pos, struct BaseEntry *be, uint64_t key,
+    int s, int *success, const int type)
+{
+  struct ProbeIndex pi;
+  if (!encode_pos(pos, be, key, type, &pi)) {
+    *success = -1;
+    return 0;
+  }
+  struct EncInfo *ei = pi.ei;
+  size_t idx = pi.idx;
+  int t = pi.t;
+  bool bside = pi.bside;
+  uint8_t flags = pi.flags;
+
+  if (type == WDL && be->hasBitbase)
+    return be->bitbaseWdl[(ei->bitbase[idx >> 2] >> (2 * (idx & 3))) & 3];
+
+  struct PairsData *d = ei->precomp;
+  if (type == WDL && be->numa)
+    d = numa_pairs(be, ei, thread_node());
+
+  if (threadRecord->noWait && !pairs_resident(d, idx)) {
+    threadRecord->ioPending = true;
+    *success = 0;
+    return 0;
   }
 
-  uint8_t *w = decompress_pairs(ei->precomp, idx);
+  int cached;
+#ifdef TB_STATS
+  uint64_t start = TB_TIMESTAMP();
+  uint8_t *w = decompress_pairs(d, idx, &cached);
+  stats_time(be, type, TB_TIMESTAMP() - start, cached);
+#else
+  uint8_t *w = decompress_pairs(d, idx, &cached);
+#endif
 
   if (type == WDL)
     return (int)w[0] - 2;
@@ -1836,6 +5448,44 @@ int probe_table(const Pos *pos, int s, int *success, const int type)
   return v;
 }
 
+// Probe an already loaded table. key is the material-signature key of pos.
+static int probe_entry(const Pos *pos, struct BaseEntry *be, uint64_t key, int s,
+    int *success, const int type)
+{
+  int v = probe_entry_impl(pos, be, key, s, success, type);
+#ifdef TB_STATS
+  struct TbTableStats *ts = entry_stats(be);
+  ts->probes[type]++;
+  if (*success > 0)
+    ts->successes[type]++;
+  else
+    ts->failures[type]++;
+  ts->depth[statsDepth < TB_STATS_DEPTHS ? statsDepth : TB_STATS_DEPTHS - 1]++;
+#endif
+  return v;
+}
+
+int probe_table(const Pos *pos, int s, int *success, const int type)
+{
+  // The position's material-signature key
+  uint64_t key = pos->key;
+
+  // Test for KvK
+  // Note: Cfish has key == 2ULL for KvK but we have 0
+  if (type == WDL && key == 0ULL)
+    return 0;
+
+  struct BaseEntry *be = lookup_table(pos->ctx, key, type);
+  if (!be) {
+    *success = 0;
+    return 0;
+  }
+
+  int v = probe_entry(pos, be, key, s, success, type);
+  release_entry();
+  return v;
+}
+
 static int probe_wdl_table(const Pos *pos, int *success)
 {
   return probe_table(pos, 0, success, WDL);
@@ -1868,7 +5518,9 @@ static int probe_ab(const Pos *pos, int alpha, int beta, int *success)
       continue;
     if (!do_move(&pos1, pos, move))
       continue; // illegal move
+    STATS_ENTER();
     int v = -probe_ab(&pos1, -beta, -alpha, success);
+    STATS_LEAVE();
     if (*success == 0) return 0;
     if (v > alpha) {
       if (v >= beta)
@@ -1897,7 +5549,10 @@ static int probe_ab(const Pos *pos, int alpha, int beta, int *success)
 //  0 : draw
 //  1 : win, but draw under 50-move rule
 //  2 : win
-int probe_wdl(Pos *pos, int *success)
+//
+// If be != NULL it is the already loaded WDL table for the material-signature
+// key of pos and is probed directly instead of being looked up again.
+static int probe_wdl_entry(Pos *pos, struct BaseEntry *be, uint64_t key, int *success)
 {
   *success = 1;
 
@@ -1918,7 +5573,9 @@ int probe_wdl(Pos *pos, int *success)
       continue;
     if (!do_move(&pos1, pos, move))
       continue; // illegal move
+    STATS_ENTER();
     int v = -probe_ab(&pos1, -2, -bestCap, success);
+    STATS_LEAVE();
     if (*success == 0) return 0;
     if (v > bestCap) {
       if (v == 2) {
@@ -1932,7 +5589,8 @@ int probe_wdl(Pos *pos, int *success)
     }
   }
 
-  int v = probe_wdl_table(pos, success);
+  int v = be ? probe_entry(pos, be, key, 0, success, WDL)
+             : probe_wdl_table(pos, success);
   if (*success == 0) return 0;
 
   // Now max(v, bestCap) is the WDL value of the position without ep rights.
@@ -1979,6 +5637,212 @@ int probe_wdl(Pos *pos, int *success)
   return v;
 }
 
+int probe_wdl(Pos *pos, int *success)
+{
+  return probe_wdl_entry(pos, NULL, 0, success);
+}
+
+struct BatchItem {
+  uint64_t key;
+  size_t index;
+};
+
+static int compare_batch_items(const void *a, const void *b)
+{
+  uint64_t k1 = ((const struct BatchItem *)a)->key;
+  uint64_t k2 = ((const struct BatchItem *)b)->key;
+  return k1 < k2 ? -1 : k1 > k2 ? 1 : 0;
+}
+
+static void batch_pos(Pos *pos, const struct TbPosition *p,
+    struct TbContext *ctx)
+{
+  pos->white = p->white;
+  pos->black = p->black;
+  pos->kings = p->kings;
+  pos->queens = p->queens;
+  pos->rooks = p->rooks;
+  pos->bishops = p->bishops;
+  pos->knights = p->knights;
+  pos->pawns = p->pawns;
+  pos->rule50 = 0;
+  pos->ep = (uint8_t)p->ep;
+  pos->turn = p->turn != 0;
+  pos->key = calc_key(pos, false);
+  pos->ctx = ctx;
+}
+
+size_t tb_probe_wdl_batch(
+    const struct TbPosition *positions,
+    unsigned *results,
+    size_t count)
+{
+  size_t numSuccess = 0;
+  struct BatchItem *items = (struct BatchItem *)malloc(count * sizeof(*items));
+  size_t n = 0;
+  struct TbContext *ctx = enter_default();
+  struct WdlCache *cache = enter_wdl_cache();
+
+  for (size_t i = 0; i < count; i++) {
+    results[i] = TB_RESULT_FAILED;
+    if (positions[i].castling != 0 || positions[i].rule50 != 0)
+      continue;
+    Pos pos;
+    batch_pos(&pos, &positions[i], ctx);
+    int v;
+    if (cache && wdl_cache_probe(cache, wdl_cache_hash(&pos), &v)) {
+      results[i] = (unsigned)(v + 2);
+      numSuccess++;
+    } else if (items) {
+      items[n].key = pos.key;
+      items[n].index = i;
+      n++;
+    } else {
+      // No scratch memory, so probe one position at a time.
+      int success;
+      v = probe_wdl_cached(&pos, &success);
+      if (success != 0) {
+        results[i] = (unsigned)(v + 2);
+        numSuccess++;
+      }
+    }
+  }
+
+  if (!items) {
+    leave_wdl_cache();
+    leave_default();
+    return numSuccess;
+  }
+
+  // Group the positions by material so that each table is looked up (and
+  // loaded if necessary) only once.
+  qsort(items, n, sizeof(*items), compare_batch_items);
+
+  for (size_t i = 0; i < n;) {
+    uint64_t key = items[i].key;
+    struct BaseEntry *be = key != 0ULL ? lookup_table(ctx, key, WDL) : NULL;
+
+    for (; i < n && items[i].key == key; i++) {
+      int success;
+      Pos pos;
+      batch_pos(&pos, &positions[items[i].index], ctx);
+      // Without a table of our own probe_wdl() may still succeed by way
+      // of a winning capture, so let it handle that case.
+      int v = be ? probe_wdl_entry(&pos, be, key, &success)
+                 : probe_wdl(&pos, &success);
+      if (success != 0) {
+        results[items[i].index] = (unsigned)(v + 2);
+        numSuccess++;
+        if (cache)
+          wdl_cache_store(cache, wdl_cache_hash(&pos), v);
+      }
+    }
+    if (be)
+      release_entry();
+  }
+
+  free(items);
+  leave_wdl_cache();
+  leave_default();
+  return numSuccess;
+}
+
+void tb_prefetch(
+    uint64_t white,
+    uint64_t black,
+    uint64_t kings,
+    uint64_t queens,
+    uint64_t rooks,
+    uint64_t bishops,
+    uint64_t knights,
+    uint64_t pawns,
+    unsigned ep,
+    bool turn)
+{
+  tb_prefetch_key(white, black, kings, queens, rooks, bishops, knights, pawns,
+      ep, turn, tb_material_key(white, black, queens, rooks, bishops, knights,
+      pawns));
+}
+
+void tb_prefetch_key(
+    uint64_t white,
+    uint64_t black,
+    uint64_t kings,
+    uint64_t queens,
+    uint64_t rooks,
+    uint64_t bishops,
+    uint64_t knights,
+    uint64_t pawns,
+    unsigned ep,
+    bool turn,
+    uint64_t key)
+{
+  Pos pos =
+  {
+    white,
+    black,
+    kings,
+    queens,
+    rooks,
+    bishops,
+    knights,
+    pawns,
+    0,
+    (uint8_t)ep,
+    turn,
+    key,
+    NULL
+  };
+  pos.ctx = enter_default();
+  if (atomic_load_explicit(&wdlCache, memory_order_relaxed)) {
+    struct WdlCache *c = enter_wdl_cache();
+    if (c)
+      TB_PREFETCH(&c->entry[wdl_cache_hash(&pos) & c->mask]);
+    leave_wdl_cache();
+  }
+
+  if (key == 0ULL) {
+    leave_default();
+    return;
+  }
+
+  // Same walk as lookup_table(), but a table that is not loaded yet is left
+  // alone: prefetching must never block on file I/O.
+  const struct TbHashEntry *tbHash = pos.ctx->tbHash;
+  int hashIdx = key >> (64 - TB_HASHBITS);
+  while (tbHash[hashIdx].key && tbHash[hashIdx].key != key)
+    hashIdx = (hashIdx + 1) & ((1 << TB_HASHBITS) - 1);
+  struct BaseEntry *be = tbHash[hashIdx].ptr;
+  if (!be) {
+    leave_default();
+    return;
+  }
+
+  if (!acquire_entry(be)) {
+    leave_default();
+    return;
+  }
+  struct ProbeIndex pi;
+  if (be->hasBitbase) {
+    if (encode_pos(&pos, be, key, WDL, &pi))
+      TB_PREFETCH(&pi.ei->bitbase[pi.idx >> 2]);
+  } else if (atomic_load(&be->ready[WDL]) && encode_pos(&pos, be, key, WDL, &pi)) {
+    struct PairsData *d = be->numa ? numa_pairs(be, pi.ei, thread_node())
+                                   : pi.ei->precomp;
+    if (d->idxBits) {
+      // The index entry only points near the target, decompress_pairs() may
+      // step a block or two either way, so fetch the first guess.
+      uint32_t block;
+      memcpy(&block, d->indexTable + 6 * (pi.idx >> d->idxBits), sizeof(block));
+      block = from_le_u32(block);
+      TB_PREFETCH(&d->sizeTable[block]);
+      TB_PREFETCH(d->data + ((size_t)block << d->blockSize));
+    }
+  }
+  release_entry();
+  leave_default();
+}
+
 #if 0
 // This will not be called for positions with en passant captures
 static Value probe_dtm_dc(const Pos *pos, int won, int *success)
@@ -2024,7 +5888,8 @@ static Value probe_dtm_loss(const Pos *pos, int *success)
 {
   Value v, best = -TB_VALUE_INFINITE, numEp = 0;
 
-  TbMove moves0[TB_MAX_CAPTURES];
+  // Room for all moves, which the stalemate test below generates.
+  TbMove moves0[TB_MAX_MOVES];
   // Generate at least all legal captures including (under)promotions
   TbMove *end, *m = moves0;
   end = gen_captures(pos, m);
@@ -2047,7 +5912,7 @@ static Value probe_dtm_loss(const Pos *pos, int *success)
 
   // If there are en passant captures, the position without ep rights
   // may be a stalemate. If it is, we must avoid probing the DTM table.
-  if (numEp != 0 && gen_legal(pos, m) == m + numEp)
+  if (numEp != 0 && gen_legal(pos, moves0) == moves0 + numEp)
     return best;
 
   v = -TB_VALUE_MATE + 2 * probe_dtm_table(pos, 0, success);
@@ -2059,14 +5924,14 @@ static Value probe_dtm_win(const Pos *pos, int *success)
   Value v, best = -TB_VALUE_INFINITE;
 
   // Generate all moves
-  TbMove moves0[TB_MAX_CAPTURES];
+  TbMove moves0[TB_MAX_MOVES];
   TbMove *m = moves0;
   TbMove *end = gen_moves(pos, m);
   // Perform a 1-ply search
   Pos pos1;
   for (; m < end; m++) {
     TbMove move = *m;
-    if (do_move(&pos1, pos, move)) {
+    if (!do_move(&pos1, pos, move)) {
       // not legal
       continue;
     }
@@ -2085,7 +5950,7 @@ static Value probe_dtm_win(const Pos *pos, int *success)
   return best;
 }
 
-Value TB_probe_dtm(const Pos *pos, int wdl, int *success)
+static Value TB_probe_dtm(const Pos *pos, int wdl, int *success)
 {
   assert(wdl != 0);
 
@@ -2155,7 +6020,7 @@ Value TB_probe_dtm2(const Pos *pos, int wdl, int *success)
 }
 #endif
 
-static int WdlToDtz[] = { -1, -101, 0, 101, 1 };
+static const int WdlToDtz[] = { -1, -101, 0, 101, 1 };
 
 // Probe the DTZ table for a particular position.
 // If *success != 0, the probe was successful.
@@ -2294,6 +6159,8 @@ static int root_probe_dtz(const Pos *pos, bool hasRepeated, bool useRule50, stru
   for (unsigned i = 0; i < rm->size; i++) {
     struct TbRootMove *m = &(rm->moves[i]);
     m->move = rootMoves[i];
+    m->pv[0] = m->move;
+    m->pvSize = 1;
     do_move(&pos1, pos, m->move);
 
     // Calculate dtz for the current move counting from the root position.
@@ -2342,8 +6209,8 @@ static int root_probe_dtz(const Pos *pos, bool hasRepeated, bool useRule50, stru
 // A return value of 0 means that not all probes were successful.
 int root_probe_wdl(const Pos *pos, bool useRule50, struct TbRootMoves *rm)
 {
-  static int WdlToRank[] = { -1000, -899, 0, 899, 1000 };
-  static Value WdlToValue[] = {
+  static const int WdlToRank[] = { -1000, -899, 0, 899, 1000 };
+  static const Value WdlToValue[] = {
     -TB_VALUE_MATE + TB_MAX_MATE_PLY + 1,
     TB_VALUE_DRAW - 2,
     TB_VALUE_DRAW,
@@ -2361,6 +6228,8 @@ int root_probe_wdl(const Pos *pos, bool useRule50, struct TbRootMoves *rm)
   for (unsigned i = 0; i < rm->size; i++) {
     struct TbRootMove *m = &rm->moves[i];
     m->move = moves[i];
+    m->pv[0] = m->move;
+    m->pvSize = 1;
     do_move(&pos1, pos, m->move);
     v = -probe_wdl(&pos1, &success);
     if (!success) return 0;
@@ -2376,10 +6245,7 @@ int root_probe_wdl(const Pos *pos, bool useRule50, struct TbRootMoves *rm)
 // Use the DTM tables to find mate scores.
 // Either DTZ or WDL must have been probed successfully earlier.
 // A return value of 0 means that not all probes were successful.
-#if defined(__cplusplus) && __cplusplus >= 201703L
-[[maybe_unused]]
-#endif
-int root_probe_dtm(const Pos *pos, struct TbRootMoves *rm)
+static int root_probe_dtm(const Pos *pos, struct TbRootMoves *rm)
 {
   int success;
   Value tmpScore[TB_MAX_MOVES];
@@ -2422,10 +6288,7 @@ int root_probe_dtm(const Pos *pos, struct TbRootMoves *rm)
 }
 
 // Use the DTM tables to complete a PV with mate score.
-#if defined(__cplusplus) && __cplusplus >= 201703L
-[[maybe_unused]]
-#endif
-void tb_expand_mate(Pos *pos, struct TbRootMove *move, Value moveScore, unsigned cardinalityDTM)
+static void tb_expand_mate(Pos *pos, struct TbRootMove *move, Value moveScore, unsigned cardinalityDTM)
 {
   int success = 1, chk = 0;
   Value v = moveScore, w = 0;
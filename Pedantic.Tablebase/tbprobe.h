@@ -26,6 +26,8 @@
 
 #include "tbconfig.h"
 
+#include <stddef.h>
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -82,6 +84,69 @@ extern unsigned tb_probe_root_impl(
     unsigned _ep,
     bool     _turn,
     unsigned *_results);
+extern unsigned tb_probe_wdl_key_impl(
+    uint64_t _white,
+    uint64_t _black,
+    uint64_t _kings,
+    uint64_t _queens,
+    uint64_t _rooks,
+    uint64_t _bishops,
+    uint64_t _knights,
+    uint64_t _pawns,
+    unsigned _ep,
+    bool     _turn,
+    uint64_t _key);
+extern unsigned tb_probe_wdl_nonblocking_impl(
+    uint64_t _white,
+    uint64_t _black,
+    uint64_t _kings,
+    uint64_t _queens,
+    uint64_t _rooks,
+    uint64_t _bishops,
+    uint64_t _knights,
+    uint64_t _pawns,
+    unsigned _ep,
+    bool     _turn,
+    uint64_t _key);
+extern unsigned tb_probe_dtm_impl(
+    uint64_t _white,
+    uint64_t _black,
+    uint64_t _kings,
+    uint64_t _queens,
+    uint64_t _rooks,
+    uint64_t _bishops,
+    uint64_t _knights,
+    uint64_t _pawns,
+    unsigned _ep,
+    bool     _turn,
+    int     *_plies);
+struct TbContext;
+extern unsigned tb_context_probe_wdl_impl(
+    struct TbContext *_ctx,
+    uint64_t _white,
+    uint64_t _black,
+    uint64_t _kings,
+    uint64_t _queens,
+    uint64_t _rooks,
+    uint64_t _bishops,
+    uint64_t _knights,
+    uint64_t _pawns,
+    unsigned _ep,
+    bool     _turn);
+extern unsigned tb_context_probe_root_impl(
+    struct TbContext *_ctx,
+    uint64_t _white,
+    uint64_t _black,
+    uint64_t _kings,
+    uint64_t _queens,
+    uint64_t _rooks,
+    uint64_t _bishops,
+    uint64_t _knights,
+    uint64_t _pawns,
+    unsigned _rule50,
+    unsigned _ep,
+    bool     _turn,
+    unsigned *_results);
 
 /****************************************************************************/
 /* MAIN API                                                                 */
@@ -155,12 +220,19 @@ extern unsigned tb_probe_root_impl(
 #define TB_RESULT_CHECKMATE         TB_SET_WDL(0, TB_WIN)
 #define TB_RESULT_STALEMATE         TB_SET_WDL(0, TB_DRAW)
 #define TB_RESULT_FAILED            0xFFFFFFFF
+#define TB_RESULT_PENDING           0xFFFFFFFE
 
 /*
  * The tablebase can be probed for any position where #pieces <= TB_LARGEST.
  */
 extern unsigned TB_LARGEST;
 
+/*
+ * The DTM tables cover positions where #pieces <= TB_LARGEST_DTM, zero if
+ * there are none.
+ */
+extern unsigned TB_LARGEST_DTM;
+
 /*
  * Initialize the tablebase.
  *
@@ -172,6 +244,17 @@ extern unsigned TB_LARGEST;
  * - true=succes, false=failed.  The TB_LARGEST global will also be
  *   initialized.  If no tablebase files are found, then `true' is returned
  *   and TB_LARGEST is set to zero.
+ *
+ * NOTES:
+ * - tb_init may be called again, with another path, while other threads
+ *   are probing.  The new tables are found first and then replace the old
+ *   ones in one step; probes that started before that finish on the old
+ *   tables, which are unmapped once the last of them returns.  tb_init
+ *   waits for that, but no probe ever waits for tb_init.
+ * - Until tb_init returns, a probe may still use the old tables, and
+ *   TB_LARGEST may briefly disagree with the tables a probe sees.  A probe
+ *   of a position the tables do not cover fails as usual.
+ * - The warm-up is stopped, see tb_warmup.
  */
 bool tb_init(const char *_path);
 
@@ -180,6 +263,367 @@ bool tb_init(const char *_path);
  */
 void tb_free(void);
 
+/*
+ * What the last tb_init found and how long it took.
+ */
+struct TbInitInfo {
+  unsigned wdl, dtm, dtz;   /* table files found */
+  unsigned dirs;            /* directories of the path that could be listed */
+  unsigned files;           /* table files listed in them, by name */
+  uint64_t micros;          /* time taken by tb_init */
+  unsigned bitbases;        /* WDL tables expanded, see tb_set_bitbases */
+  uint64_t bitbaseBytes;    /* memory they take */
+};
+
+/*
+ * Get what the last tb_init found.
+ *
+ * NOTES:
+ * - tb_init lists each directory of the path once and looks for the tables
+ *   in that list.  Only the files of directories that cannot be listed are
+ *   looked for by name.
+ */
+void tb_init_info(struct TbInitInfo *_info);
+
+/*
+ * Set the size of the WDL result cache.
+ *
+ * PARAMETERS:
+ * - size_mb:
+ *   The cache size in megabytes.  Zero disables the cache.
+ *
+ * RETURN:
+ * - true=success, false=failed.  If the cache cannot be allocated it is
+ *   left disabled.
+ *
+ * NOTES:
+ * - The cache sits in front of tb_probe_wdl and tb_probe_wdl_batch.  It is
+ *   keyed by a full position hash and answers a repeated probe without any
+ *   table access.
+ * - The cache is disabled by default, is cleared by tb_init and released
+ *   by tb_free.
+ * - This function is thread safe and may be called while other threads are
+ *   probing.  A cache of a new size replaces the old one, which is freed
+ *   once the probes that were using it have finished with it.  Setting the
+ *   size the cache already has only clears it.
+ */
+bool tb_set_wdl_cache(size_t _size_mb);
+
+/*
+ * Clear the WDL result cache.
+ */
+void tb_clear_wdl_cache(void);
+
+/*
+ * Progress of a warm-up started by tb_warmup.
+ */
+struct TbWarmupStatus {
+  unsigned total;   /* tables to load */
+  unsigned done;    /* tables loaded (or failed to load) so far */
+  uint64_t bytes;   /* bytes faulted into memory so far */
+  bool running;
+  bool cancelled;   /* stopped before all tables were loaded */
+};
+
+/*
+ * Load tables and fault their pages into memory on a background thread.
+ *
+ * PARAMETERS:
+ * - pieces:
+ *   Warm up the WDL and DTZ tables with at most this many pieces.
+ * - budget_mb:
+ *   The index and size tables of each table are always faulted in.  The
+ *   compressed data is faulted in as well until this many megabytes have
+ *   been read.  Zero leaves the data to be paged in on demand.
+ *
+ * RETURN:
+ * - true=success, false=the thread could not be started.
+ *
+ * NOTES:
+ * - Probing is allowed (and thread safe) while the warm-up runs.
+ * - A warm-up that is still running is stopped first, as it is by tb_init
+ *   and tb_free.
+ * - Built with TB_NO_THREADS the warm-up runs before this function returns.
+ */
+bool tb_warmup(unsigned _pieces, size_t _budget_mb);
+
+/*
+ * Stop a running warm-up and wait for its thread to exit.  A warm-up that
+ * is stopped before it has loaded all its tables is then reported as
+ * cancelled; one that had already finished is not.
+ */
+void tb_warmup_stop(void);
+
+/*
+ * Get the progress of the last warm-up.
+ */
+void tb_warmup_status(struct TbWarmupStatus *_status);
+
+/*
+ * Memory residency of the mapped tables.
+ */
+struct TbResidency {
+  uint64_t budget;     /* bytes, zero=unlimited */
+  uint64_t resident;   /* bytes of table files currently mapped */
+  unsigned tables;     /* table files currently mapped */
+  uint64_t loads;      /* table files mapped so far */
+  uint64_t evictions;  /* entries unmapped to stay within the budget */
+  uint64_t remaps;     /* table files mapped again after an eviction */
+};
+
+/*
+ * Limit the memory used by mapped tables.
+ *
+ * PARAMETERS:
+ * - budget_mb:
+ *   The budget in megabytes.  Zero (the default) keeps every table mapped
+ *   until tb_free.
+ *
+ * NOTES:
+ * - When mapping a table takes the total over the budget, the least
+ *   recently probed tables are unmapped.  They are mapped again on demand.
+ * - Tables that are being probed are never unmapped, so this function
+ *   and eviction itself are thread safe.
+ */
+void tb_set_residency_budget(size_t _budget_mb);
+
+/*
+ * Get the current residency of the mapped tables.
+ */
+void tb_residency(struct TbResidency *_residency);
+
+/*
+ * Load small WDL tables into huge-page backed memory.
+ *
+ * PARAMETERS:
+ * - pieces:
+ *   WDL tables with at most this many pieces are copied into anonymous
+ *   memory when they are loaded, instead of being probed through a file
+ *   mapping.  Zero (the default) disables this.
+ * - lock:
+ *   Also lock the copies in memory (mlock/VirtualLock).
+ *
+ * NOTES:
+ * - Explicit huge pages (MAP_HUGETLB, or MEM_LARGE_PAGES on Windows) are
+ *   used when available, otherwise transparent huge pages are requested
+ *   with MADV_HUGEPAGE.  Fewer TLB misses make random probes faster.
+ * - Only tables loaded afterwards are affected, so call this before
+ *   tb_init.
+ */
+void tb_set_huge_pages(unsigned _pieces, bool _lock);
+
+/*
+ * Expand small WDL tables into bitbases.
+ *
+ * PARAMETERS:
+ * - pieces:
+ *   WDL tables with at most this many pieces are decompressed into arrays
+ *   of 2 bits per position when tb_init or tb_context_create finds them.
+ *   Zero (the default) disables this.
+ * - threads:
+ *   The number of threads, the calling one included, that expand the
+ *   tables.
+ *
+ * NOTES:
+ * - A bitbase answers the table lookup of a WDL probe with a shift and a
+ *   mask instead of a Huffman decode.  Captures are still resolved as
+ *   before.  The file of the table is unmapped once it has been expanded.
+ * - A 3-piece table takes 16 KB, a 4-piece table up to 1 MB and a 5-piece
+ *   table up to 60 MB; see tb_init_info for the total.  Tables that use
+ *   all five WDL values stay compressed.
+ * - Only tables found afterwards are affected, so call this before
+ *   tb_init.
+ */
+void tb_set_bitbases(unsigned _pieces, unsigned _threads);
+
+/*
+ * Keep a copy of small WDL tables on each NUMA node.
+ *
+ * PARAMETERS:
+ * - pieces:
+ *   WDL tables with at most this many pieces are copied to every node when
+ *   they are loaded, and each probe reads the copy of the node its thread
+ *   runs on.  Zero (the default) disables this.
+ *
+ * RETURN:
+ * - The number of NUMA nodes.  With one node nothing is copied.
+ *
+ * NOTES:
+ * - A copy holds the table file and its decoding tables, so a probe never
+ *   reads the memory of another node.  The copies are bound to their node
+ *   with mbind (VirtualAllocExNuma on Windows); pin the search threads to
+ *   make the most of them.
+ * - Each table takes its size once per node on top of its mapping, see
+ *   tb_numa_status.  Unmapping a table frees its copies.
+ * - Only tables loaded afterwards are affected, so call this before
+ *   tb_init.
+ */
+unsigned tb_set_numa(unsigned _pieces);
+
+struct TbNumaStatus {
+  unsigned nodes;           /* NUMA nodes found */
+  unsigned tables;          /* WDL tables with a copy on each node */
+  uint64_t bytes;           /* memory the copies take */
+};
+
+/*
+ * Get the current state of the NUMA copies.
+ */
+void tb_numa_status(struct TbNumaStatus *_status);
+
+/*
+ * The outcome of checking one table file, see tb_verify.
+ */
+#define TB_VERIFY_OK            0
+#define TB_VERIFY_UNREADABLE    1   /* cannot be opened or read */
+#define TB_VERIFY_MAGIC         2   /* not a table of its type */
+#define TB_VERIFY_HEADER        3   /* the header does not fit the name */
+#define TB_VERIFY_TRUNCATED     4   /* shorter than the header says */
+#define TB_VERIFY_BLOCKS        5   /* index or size table out of bounds */
+#define TB_VERIFY_CHECKSUM      6   /* MD5 differs from the list */
+
+struct TbVerifyResult {
+  char name[16];            /* e.g. "KQvK.rtbw" */
+  unsigned status;          /* TB_VERIFY_OK, ... */
+  unsigned checksummed;     /* 1 if the file was on the checksum list */
+  uint64_t bytes;           /* file size */
+  uint64_t micros;          /* time taken to read and check it */
+};
+
+/*
+ * Check the table files under a path.
+ *
+ * PARAMETERS:
+ * - path:
+ *   The tablebase PATH string, as for tb_init.
+ * - checksums:
+ *   The name of a file with the MD5 checksums of good table files, in the
+ *   format of md5sum ("<md5>  <file>" per line), or NULL.
+ * - threads:
+ *   The number of threads, the calling one included, that check files.
+ * - results:
+ *   Receives the outcome of the first size files, in the order tb_init
+ *   looks for them.  May be NULL if size is zero.
+ * - size:
+ *   The number of entries results has room for.
+ *
+ * RETURN:
+ * - The number of table files found, plus the files on the checksum list
+ *   that were not found, which may be more than size.
+ *
+ * NOTES:
+ * - Every WDL, DTM and DTZ file that tb_init would find is read through
+ *   once, largest first, so the files are checked at about the speed of
+ *   the disk.  Read errors, a wrong magic number, a header that does not
+ *   match the material of the name, a file shorter than its header says
+ *   and index or size tables that point past the data are reported.
+ * - Files on the checksum list also get their MD5 compared; the list may
+ *   name files with a directory, only the file name counts.  Listed files
+ *   that are not under path come after the files found, as
+ *   TB_VERIFY_UNREADABLE.
+ * - The files are read without mapping them, so checking does not touch
+ *   the tables of tb_init or of any context.  This function is thread
+ *   safe, but calls of it run one at a time.
+ */
+size_t tb_verify(const char *_path, const char *_checksums, unsigned _threads,
+    struct TbVerifyResult *_results, size_t _size);
+
+/*
+ * Start or stop the I/O threads of tb_probe_wdl_nonblocking.
+ *
+ * PARAMETERS:
+ * - threads:
+ *   The number of threads, at most 16.  Zero (the default) stops them, and
+ *   tb_probe_wdl_nonblocking then blocks like tb_probe_wdl_key.
+ *
+ * RETURN:
+ * - true=success, false=not all threads could be started.  Built with
+ *   TB_NO_THREADS only zero succeeds.
+ *
+ * NOTES:
+ * - Probing is allowed while the threads are started or stopped, but this
+ *   function must not be called from several threads at once.
+ * - Positions still waiting when the threads are stopped are read by the
+ *   next ones started.
+ */
+bool tb_set_io_threads(unsigned _threads);
+
+/*
+ * Activity of the I/O threads of tb_probe_wdl_nonblocking.
+ */
+struct TbIoStatus {
+  unsigned threads;   /* I/O threads running */
+  uint64_t pending;   /* probes that returned TB_RESULT_PENDING */
+  uint64_t reads;     /* positions the I/O threads have probed */
+  uint64_t dropped;   /* positions not queued because the queue was full */
+};
+
+/*
+ * Get the activity of the I/O threads.
+ */
+void tb_io_status(struct TbIoStatus *_status);
+
+/*
+ * Probe statistics for one table.  The arrays indexed by type are in the
+ * order WDL, DTM, DTZ.
+ */
+#define TB_STATS_TIME_BUCKETS   32
+#define TB_STATS_DEPTHS         8
+
+struct TbTableStats {
+  char name[16];        /* e.g. "KRPvKR" */
+  uint64_t key;         /* material-signature key */
+  uint64_t probes[3];
+  uint64_t successes[3];
+  uint64_t failures[3];
+  uint64_t loads[3];    /* times the table file was mapped */
+  /* Decompression time: decompress[i] counts block decodes that took
+     [2^i, 2^(i+1)) time stamp ticks (CPU cycles on x86). */
+  uint64_t decompress[TB_STATS_TIME_BUCKETS];
+  /* Capture resolution depth at which the table was probed; zero is a
+     direct probe, the last bucket includes everything deeper. */
+  uint64_t depth[TB_STATS_DEPTHS];
+  /* Probes answered from the calling thread's decoded-block cache, and
+     probes that had to decode their block.  Tables with a single value
+     count as neither. */
+  uint64_t blockHits[3];
+  uint64_t blockMisses[3];
+};
+
+/*
+ * Get the probe statistics of every table that has been probed or loaded.
+ *
+ * PARAMETERS:
+ * - stats:
+ *   Receives the statistics, at most size entries.
+ * - size:
+ *   The size of the stats array.
+ *
+ * RETURN:
+ * - The number of tables with statistics, which may be more than size.
+ *
+ * NOTES:
+ * - Statistics are only collected when the library is built with TB_STATS
+ *   defined.  Otherwise the instrumentation is compiled out and this
+ *   function returns zero.
+ * - The counters are per thread and are added up without stopping the
+ *   probing threads, so the result is a close approximation while a search
+ *   is running.
+ * - Only probes of the default context are counted.  tb_init starts the
+ *   counts over.
+ */
+size_t tb_get_stats(struct TbTableStats *_stats, size_t _size);
+
+/*
+ * Reset the probe statistics to zero.
+ */
+void tb_reset_stats(void);
+
+/*
+ * true if the library was built with TB_STATS.
+ */
+bool tb_stats_enabled(void);
+
 /*
  * Probe the Win-Draw-Loss (WDL) table.
  *
@@ -226,6 +670,221 @@ static inline unsigned tb_probe_wdl(
         _bishops, _knights, _pawns, _ep, _turn);
 }
 
+/*
+ * The material key of a position, as used to find its table.
+ *
+ * PARAMETERS:
+ * - white, black, queens, rooks, bishops, knights, pawns:
+ *   The position (bitboards).  Kings do not count towards the key.
+ *
+ * RETURN:
+ * - A key that is the sum of a constant per piece, by color and type.  An
+ *   engine that needs the key for every probe can therefore keep it up to
+ *   date incrementally: start from this value and add or subtract the
+ *   difference of a lone piece, e.g. tb_material_key(b, 0, 0, 0, 0, 0, b)
+ *   for a white pawn, whenever a piece is captured or promoted.
+ */
+extern uint64_t tb_material_key(
+    uint64_t _white,
+    uint64_t _black,
+    uint64_t _queens,
+    uint64_t _rooks,
+    uint64_t _bishops,
+    uint64_t _knights,
+    uint64_t _pawns);
+
+/*
+ * Probe the Win-Draw-Loss (WDL) table with a known material key.
+ *
+ * PARAMETERS:
+ * - As for tb_probe_wdl, plus:
+ * - key:
+ *   The material key of the position, as returned by tb_material_key.
+ *
+ * RETURN:
+ * - As for tb_probe_wdl.
+ *
+ * NOTES:
+ * - Saves recomputing the key from the bitboards on every probe.  Passing a
+ *   key that does not match the position gives wrong results.
+ * - This function is thread safe assuming TB_NO_THREADS is disabled.
+ */
+static inline unsigned tb_probe_wdl_key(
+    uint64_t _white,
+    uint64_t _black,
+    uint64_t _kings,
+    uint64_t _queens,
+    uint64_t _rooks,
+    uint64_t _bishops,
+    uint64_t _knights,
+    uint64_t _pawns,
+    unsigned _rule50,
+    unsigned _castling,
+    unsigned _ep,
+    bool     _turn,
+    uint64_t _key)
+{
+    if (_castling != 0)
+        return TB_RESULT_FAILED;
+    if (_rule50 != 0)
+        return TB_RESULT_FAILED;
+    return tb_probe_wdl_key_impl(_white, _black, _kings, _queens, _rooks,
+        _bishops, _knights, _pawns, _ep, _turn, _key);
+}
+
+/*
+ * Probe the Win-Draw-Loss (WDL) table without waiting for the disk.
+ *
+ * PARAMETERS:
+ * - As for tb_probe_wdl_key.
+ *
+ * RETURN:
+ * - As for tb_probe_wdl, or TB_RESULT_PENDING if the probe needs a table
+ *   that is not mapped yet or a block that is not in memory.
+ *
+ * NOTES:
+ * - A pending position is queued for the I/O threads, see
+ *   tb_set_io_threads.  They probe it the blocking way, which maps the
+ *   tables and reads the blocks into the page cache (and the result into
+ *   the WDL cache, if it is enabled), so that a later probe of the same
+ *   position succeeds.  Treat TB_RESULT_PENDING as a miss and probe again
+ *   on the next visit.
+ * - Whether a block is in memory is asked of the OS (mincore, or
+ *   QueryWorkingSetEx on Windows) at most once per page and thread until
+ *   the page is found resident.
+ * - Without I/O threads the probe blocks like tb_probe_wdl_key.
+ * - This function is thread safe assuming TB_NO_THREADS is disabled.
+ */
+static inline unsigned tb_probe_wdl_nonblocking(
+    uint64_t _white,
+    uint64_t _black,
+    uint64_t _kings,
+    uint64_t _queens,
+    uint64_t _rooks,
+    uint64_t _bishops,
+    uint64_t _knights,
+    uint64_t _pawns,
+    unsigned _rule50,
+    unsigned _castling,
+    unsigned _ep,
+    bool     _turn,
+    uint64_t _key)
+{
+    if (_castling != 0)
+        return TB_RESULT_FAILED;
+    if (_rule50 != 0)
+        return TB_RESULT_FAILED;
+    return tb_probe_wdl_nonblocking_impl(_white, _black, _kings, _queens,
+        _rooks, _bishops, _knights, _pawns, _ep, _turn, _key);
+}
+
+/*
+ * A position in the form expected by the batched probe API.  The layout is
+ * fixed (80 bytes, no padding) so that callers can hand over arrays of
+ * positions without conversion.
+ */
+struct TbPosition {
+  uint64_t white;
+  uint64_t black;
+  uint64_t kings;
+  uint64_t queens;
+  uint64_t rooks;
+  uint64_t bishops;
+  uint64_t knights;
+  uint64_t pawns;
+  uint32_t rule50;
+  uint32_t castling;
+  uint32_t ep;
+  uint32_t turn;          /* non-zero=white, zero=black */
+};
+
+/*
+ * Probe the Win-Draw-Loss (WDL) table for many positions in one call.
+ *
+ * PARAMETERS:
+ * - positions:
+ *   The positions to probe.
+ * - results:
+ *   Receives one result per position, in the same order as `positions'.
+ * - count:
+ *   The number of positions.
+ *
+ * RETURN:
+ * - The number of successful probes.  Each result is as returned by
+ *   tb_probe_wdl, i.e. one of {TB_LOSS, ..., TB_WIN} or TB_RESULT_FAILED.
+ *
+ * NOTES:
+ * - Positions are grouped by material signature so that the table lookup
+ *   and lazy table loading are done once per table rather than once per
+ *   position.
+ * - This function is thread safe assuming TB_NO_THREADS is disabled.
+ */
+extern size_t tb_probe_wdl_batch(
+    const struct TbPosition *_positions,
+    unsigned *_results,
+    size_t _count);
+
+/*
+ * Prefetch the memory a later tb_probe_wdl of the same position will touch.
+ *
+ * PARAMETERS:
+ * - white, black, kings, queens, rooks, bishops, knights, pawns:
+ *   The position (bitboards).
+ * - ep:
+ *   The en passant square (if exists).  Set to zero if there is no en passant
+ *   square.
+ * - turn:
+ *   true=white, false=black
+ *
+ * NOTES:
+ * - Computes the material key and the table index, then prefetches the WDL
+ *   cache slot and the compressed block that holds the position.  Nothing is
+ *   decompressed.
+ * - A table that has not been loaded yet is not loaded here, and pages that
+ *   are not resident are left to tb_warmup and the residency budget.  The
+ *   call therefore never blocks and costs a few hundred cycles at most.
+ * - Intended to be called right after a move is made in search, so that the
+ *   loads overlap with the work done before the next node's probe.
+ * - This function is thread safe assuming TB_NO_THREADS is disabled.
+ */
+extern void tb_prefetch(
+    uint64_t _white,
+    uint64_t _black,
+    uint64_t _kings,
+    uint64_t _queens,
+    uint64_t _rooks,
+    uint64_t _bishops,
+    uint64_t _knights,
+    uint64_t _pawns,
+    unsigned _ep,
+    bool _turn);
+
+/*
+ * As tb_prefetch, with a known material key.
+ *
+ * PARAMETERS:
+ * - As for tb_prefetch, plus:
+ * - key:
+ *   The material key of the position, as returned by tb_material_key.
+ *
+ * NOTES:
+ * - Saves recomputing the key, as tb_probe_wdl_key does.  A key that does
+ *   not match the position prefetches the wrong memory.
+ * - This function is thread safe assuming TB_NO_THREADS is disabled.
+ */
+extern void tb_prefetch_key(
+    uint64_t _white,
+    uint64_t _black,
+    uint64_t _kings,
+    uint64_t _queens,
+    uint64_t _rooks,
+    uint64_t _bishops,
+    uint64_t _knights,
+    uint64_t _pawns,
+    unsigned _ep,
+    bool _turn,
+    uint64_t _key);
+
 /*
  * Probe the Distance-To-Zero (DTZ) table.
  *
@@ -268,8 +927,9 @@ static inline unsigned tb_probe_wdl(
  * - DTZ tablebases can suggest unnatural moves, especially for losing
  *   positions.  Engines may prefer to traditional search combined with WDL
  *   move filtering using the alternative results array.
- * - This function is NOT thread safe.  For engines this function should only
- *   be called once at the root per search.
+ * - This function is thread safe assuming TB_NO_THREADS is disabled.  All
+ *   scratch space lives on the caller's stack, so independent analyses may
+ *   probe their roots concurrently.
  */
 static inline unsigned tb_probe_root(
     uint64_t _white,
@@ -322,7 +982,9 @@ struct TbRootMoves {
  * predicted principal variation.
  * RETURN VALUE:
  *   non-zero if ok, 0 means not all probes were successful
- *
+ * NOTES:
+ * - This function is thread safe assuming TB_NO_THREADS is disabled, as
+ *   long as each thread passes its own _results structure.
  */
 int tb_probe_root_dtz(
     uint64_t _white,
@@ -351,7 +1013,9 @@ int tb_probe_root_dtz(
  * predicted principal variation.
  * RETURN VALUE:
  *   non-zero if ok, 0 means not all probes were successful
- *
+ * NOTES:
+ * - This function is thread safe assuming TB_NO_THREADS is disabled, as
+ *   long as each thread passes its own _results structure.
  */
 int tb_probe_root_wdl(uint64_t _white,
     uint64_t _black,
@@ -368,6 +1032,226 @@ int tb_probe_root_wdl(uint64_t _white,
     bool useRule50,
     struct TbRootMoves *_results);
 
+/*
+ * Probe the Distance-To-Mate (DTM) tables.
+ *
+ * PARAMETERS:
+ * - white, black, kings, queens, rooks, bishops, knights, pawns:
+ *   The current position (bitboards).
+ * - rule50:
+ *   The 50-move half-move clock.  DTM does not depend on it.
+ * - castling:
+ *   Castling rights.  Set to zero if no castling is possible.
+ * - ep:
+ *   The en passant square (if exists).  Set to zero if there is no en passant
+ *   square.
+ * - turn:
+ *   true=white, false=black
+ * - plies (OUTPUT):
+ *   The number of plies to mate with best play: positive if the side to move
+ *   mates, negative if it is mated, zero if the position is drawn or the side
+ *   to move is checkmated.
+ *
+ * RETURN:
+ * - One of {TB_LOSS, TB_BLESSED_LOSS, TB_DRAW, TB_CURSED_WIN, TB_WIN} as for
+ *   a zero 50-move clock, or TB_RESULT_FAILED if a WDL or DTM table that is
+ *   needed is missing.
+ *
+ * NOTES:
+ * - DTM ignores the 50-move rule: for a cursed win or a blessed loss the
+ *   distance is to a mate that the 50-move rule may prevent.
+ * - Probes several DTM tables per call.  Engines should use it at the root
+ *   or for analysis, not during search.
+ * - This function is thread safe assuming TB_NO_THREADS is disabled.
+ */
+static inline unsigned tb_probe_dtm(
+    uint64_t _white,
+    uint64_t _black,
+    uint64_t _kings,
+    uint64_t _queens,
+    uint64_t _rooks,
+    uint64_t _bishops,
+    uint64_t _knights,
+    uint64_t _pawns,
+    unsigned _rule50,
+    unsigned _castling,
+    unsigned _ep,
+    bool     _turn,
+    int     *_plies)
+{
+    (void)_rule50;
+    *_plies = 0;
+    if (_castling != 0)
+        return TB_RESULT_FAILED;
+    return tb_probe_dtm_impl(_white, _black, _kings, _queens, _rooks,
+        _bishops, _knights, _pawns, _ep, _turn, _plies);
+}
+
+/*
+ * Use the DTM tables to rank and score all root moves by distance to mate.
+ * INPUT: as for tb_probe_root_dtz
+ * OUTPUT: TbRootMoves structure is filled in.  The moves are first ranked by
+ * the DTZ tables, or the WDL tables if DTZ tables are missing, as by
+ * tb_probe_root_dtz.  Then every winning and losing move gets a mate score,
+ * TB_VALUE_MATE - n for a mate in n plies and -TB_VALUE_MATE + n for being
+ * mated in n plies, and its PV is expanded up to the mate.  Winning moves
+ * are ranked by their mate score, so the fastest mate ranks highest, except
+ * that moves ranked 900 by DTZ are ranked 1001, below every mate.  Drawn
+ * moves keep score and rank zero.
+ * RETURN VALUE:
+ *   non-zero if ok, 0 means not all probes were successful
+ * NOTES:
+ * - This function is thread safe assuming TB_NO_THREADS is disabled, as
+ *   long as each thread passes its own _results structure.
+ */
+int tb_probe_root_dtm(
+    uint64_t _white,
+    uint64_t _black,
+    uint64_t _kings,
+    uint64_t _queens,
+    uint64_t _rooks,
+    uint64_t _bishops,
+    uint64_t _knights,
+    uint64_t _pawns,
+    unsigned _rule50,
+    unsigned _castling,
+    unsigned _ep,
+    bool     _turn,
+    bool hasRepeated,
+    bool useRule50,
+    struct TbRootMoves *_results);
+
+/****************************************************************************/
+/* CONTEXTS                                                                 */
+/****************************************************************************/
+
+/*
+ * The functions above all work on one process-wide set of tables, the
+ * default context.  A context is an independent set of tables found under
+ * a path of its own, so that several tablebase configurations can be used
+ * side by side in one process.  Contexts that find the same file share its
+ * mapping.  The WDL cache is shared by all contexts, but each context only
+ * finds the results of its own probes in it.  The residency budget, the
+ * huge page and the bitbase settings apply to all contexts; the warm-up and
+ * the statistics only cover the default context.
+ */
+
+/*
+ * Create a context for the tables under a path.
+ *
+ * PARAMETERS:
+ * - path:
+ *   As for tb_init.
+ *
+ * RETURN:
+ * - The context, or NULL if out of memory.  Release it with
+ *   tb_context_free.
+ */
+extern struct TbContext *tb_context_create(const char *_path);
+
+/*
+ * Free a context and unmap the tables no other context uses.
+ *
+ * NOTES:
+ * - No probe of the context may be running or start afterwards.
+ */
+extern void tb_context_free(struct TbContext *_ctx);
+
+/*
+ * The context can be probed for any position where #pieces <= this value.
+ */
+extern unsigned tb_context_largest(const struct TbContext *_ctx);
+
+/*
+ * As tb_probe_wdl, but probes the tables of a context.
+ */
+static inline unsigned tb_context_probe_wdl(
+    struct TbContext *_ctx,
+    uint64_t _white,
+    uint64_t _black,
+    uint64_t _kings,
+    uint64_t _queens,
+    uint64_t _rooks,
+    uint64_t _bishops,
+    uint64_t _knights,
+    uint64_t _pawns,
+    unsigned _rule50,
+    unsigned _castling,
+    unsigned _ep,
+    bool     _turn)
+{
+    if (_castling != 0)
+        return TB_RESULT_FAILED;
+    if (_rule50 != 0)
+        return TB_RESULT_FAILED;
+    return tb_context_probe_wdl_impl(_ctx, _white, _black, _kings, _queens,
+        _rooks, _bishops, _knights, _pawns, _ep, _turn);
+}
+
+/*
+ * As tb_probe_root, but probes the tables of a context.
+ */
+static inline unsigned tb_context_probe_root(
+    struct TbContext *_ctx,
+    uint64_t _white,
+    uint64_t _black,
+    uint64_t _kings,
+    uint64_t _queens,
+    uint64_t _rooks,
+    uint64_t _bishops,
+    uint64_t _knights,
+    uint64_t _pawns,
+    unsigned _rule50,
+    unsigned _castling,
+    unsigned _ep,
+    bool     _turn,
+    unsigned *_results)
+{
+    if (_castling != 0)
+        return TB_RESULT_FAILED;
+    return tb_context_probe_root_impl(_ctx, _white, _black, _kings, _queens,
+        _rooks, _bishops, _knights, _pawns, _rule50, _ep, _turn, _results);
+}
+
+/*
+ * As tb_probe_root_dtz and tb_probe_root_wdl, but probe the tables of a
+ * context.
+ */
+extern int tb_context_probe_root_dtz(
+    struct TbContext *_ctx,
+    uint64_t _white,
+    uint64_t _black,
+    uint64_t _kings,
+    uint64_t _queens,
+    uint64_t _rooks,
+    uint64_t _bishops,
+    uint64_t _knights,
+    uint64_t _pawns,
+    unsigned _rule50,
+    unsigned _castling,
+    unsigned _ep,
+    bool     _turn,
+    bool hasRepeated,
+    bool useRule50,
+    struct TbRootMoves *_results);
+
+extern int tb_context_probe_root_wdl(
+    struct TbContext *_ctx,
+    uint64_t _white,
+    uint64_t _black,
+    uint64_t _kings,
+    uint64_t _queens,
+    uint64_t _rooks,
+    uint64_t _bishops,
+    uint64_t _knights,
+    uint64_t _pawns,
+    unsigned _rule50,
+    unsigned _castling,
+    unsigned _ep,
+    bool     _turn,
+    bool useRule50,
+    struct TbRootMoves *_results);
+
 /****************************************************************************/
 /* HELPER API                                                               */
 /****************************************************************************/
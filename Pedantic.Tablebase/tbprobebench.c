@@ -0,0 +1,346 @@
+/*
+ * tbprobebench: times the prober by itself on random positions of each
+ * material class and prints the results as JSON, so that builds can be
+ * compared.
+ *
+ *   tbprobebench [options] [path]
+ *
+ *   path               the tablebase path, TB_PATH if not given
+ *   --threads N        threads of the parallel runs, default one per processor
+ *   --positions N      positions per number of men, default 10000
+ *   --men A-B          the numbers of men to time, default 3 to TB_LARGEST
+ *   --rounds N         passes over the positions when warm, default 4
+ *   --seed N           seed of the positions
+ *   --no-drop          leave the table files in the page cache
+ *
+ * For every number of men the WDL probe, the DTZ probe and the root probe
+ * that ranks all moves (tb_probe_root_dtz) are timed, first with one thread
+ * and then with all of them. Each is timed cold, on freshly mapped tables
+ * whose files were dropped from the page cache where the system allows it,
+ * and then warm over the same positions. Root probes use a tenth of the
+ * positions. The positions are legal but random, so most of them are far
+ * from anything a search would probe; probes of tables that are missing
+ * count as failed.
+ */
+
+#include "tbprobe.c"
+#include "tests/tbtest.h"
+
+#define MAX_THREADS 256
+
+static unsigned num_processors(void)
+{
+#ifndef _WIN32
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  return n > 0 ? (unsigned)n : 1;
+#else
+  SYSTEM_INFO si;
+  GetSystemInfo(&si);
+  return si.dwNumberOfProcessors;
+#endif
+}
+
+enum { PROBE_WDL, PROBE_DTZ, PROBE_ROOT };
+static const char *probeNames[] = { "wdl", "dtz", "root" };
+
+// Returns whether the probe found its tables.
+static bool probe(int type, const Pos *pos, struct TbRootMoves *rm)
+{
+  switch (type) {
+    case PROBE_WDL:
+      return tb_probe_wdl(pos->white, pos->black, pos->kings, pos->queens,
+          pos->rooks, pos->bishops, pos->knights, pos->pawns, 0, 0, 0,
+          pos->turn) != TB_RESULT_FAILED;
+    case PROBE_DTZ: {
+      // what tb_probe_root does for each move
+      int success = 1;
+      Pos pos1 = *pos;
+      pos1.ctx = enter_default();
+      probe_dtz(&pos1, &success);
+      leave_default();
+      return success != 0;
+    }
+    default:
+      return tb_probe_root_dtz(pos->white, pos->black, pos->kings,
+          pos->queens, pos->rooks, pos->bishops, pos->knights, pos->pawns, 0,
+          0, 0, pos->turn, false, true, rm) != 0;
+  }
+}
+
+// One timed run: every thread probes its share of the positions, rounds
+// times, and keeps the time of each probe.
+static const Pos *runPositions;
+static int runCount, runRounds, runType;
+static unsigned runThreads;
+static uint32_t *runLatency;                // [round * runCount + i]
+static unsigned long runFailed[MAX_THREADS];
+#ifdef __cplusplus
+static atomic<unsigned> runNext(0);
+#else
+static atomic_uint runNext = 0;
+#endif
+
+static void run_share(unsigned t)
+{
+  struct TbRootMoves *rm = NULL;
+  if (runType == PROBE_ROOT && !(rm = (struct TbRootMoves *)malloc(sizeof(*rm)))) {
+    runFailed[t] = 0;
+    return;
+  }
+  int first = (int)((uint64_t)runCount * t / runThreads);
+  int last = (int)((uint64_t)runCount * (t + 1) / runThreads);
+  unsigned long failed = 0;
+  for (int r = 0; r < runRounds; r++)
+    for (int i = first; i < last; i++) {
+      uint64_t start = now_ns();
+      bool ok = probe(runType, &runPositions[i], rm);
+      uint64_t ns = now_ns() - start;
+      runLatency[(size_t)r * runCount + i] = ns < UINT32_MAX ? (uint32_t)ns : UINT32_MAX;
+      failed += !ok;
+    }
+  runFailed[t] = failed;
+  free(rm);
+}
+
+#ifndef TB_NO_THREADS
+THREAD_FUNC(run_thread)
+{
+  (void)arg;
+  run_share(atomic_fetch_add(&runNext, 1u));
+  THREAD_RETURN;
+}
+#endif
+
+struct RunResult {
+  uint64_t probes;
+  uint64_t failed;
+  double seconds;
+  double mean;
+  uint32_t p50, p90, p99, p999, max;
+};
+
+static int compare_u32(const void *a, const void *b)
+{
+  uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+  return x < y ? -1 : x > y;
+}
+
+static uint32_t percentile(const uint32_t *sorted, size_t n, double q)
+{
+  return sorted[(size_t)(q * (double)(n - 1) + 0.5)];
+}
+
+static struct RunResult run(int type, const Pos *positions, int count,
+    int rounds, unsigned threads)
+{
+  struct RunResult res;
+  memset(&res, 0, sizeof(res));
+  size_t n = (size_t)count * rounds;
+  if (n == 0)
+    return res;
+  runPositions = positions;
+  runCount = count;
+  runRounds = rounds;
+  runType = type;
+  runThreads = threads;
+  runLatency = (uint32_t *)malloc(n * sizeof(*runLatency));
+  if (!runLatency)
+    return res;
+  atomic_store(&runNext, 1u);
+
+  // The calling thread takes the first share, and those of threads that
+  // could not be started.
+  uint64_t start = now_ns();
+  unsigned started = 0;
+#ifndef TB_NO_THREADS
+  THREAD_T workers[MAX_THREADS];
+  while (started + 1 < threads && THREAD_CREATE(workers[started], run_thread))
+    started++;
+#endif
+  run_share(0);
+  for (unsigned t = started + 1; t < threads; t++)
+    run_share(t);
+#ifndef TB_NO_THREADS
+  for (unsigned i = 0; i < started; i++)
+    THREAD_JOIN(workers[i]);
+#endif
+  res.seconds = (now_ns() - start) / 1e9;
+
+  res.probes = n;
+  for (unsigned t = 0; t < threads; t++)
+    res.failed += runFailed[t];
+  double sum = 0;
+  for (size_t i = 0; i < n; i++)
+    sum += runLatency[i];
+  res.mean = sum / (double)n;
+  qsort(runLatency, n, sizeof(*runLatency), compare_u32);
+  res.p50 = percentile(runLatency, n, 0.50);
+  res.p90 = percentile(runLatency, n, 0.90);
+  res.p99 = percentile(runLatency, n, 0.99);
+  res.p999 = percentile(runLatency, n, 0.999);
+  res.max = runLatency[n - 1];
+  free(runLatency);
+  runLatency = NULL;
+  return res;
+}
+
+// Drop the table files of the default context from the page cache. Returns
+// false if the system does not allow it.
+static bool drop_page_cache(void)
+{
+#if defined(POSIX_FADV_DONTNEED) && !defined(_WIN32)
+  struct TbContext *ctx = enter_default();
+  for (unsigned i = 0; ctx->index.mask && i <= ctx->index.mask; i++) {
+    const struct TbFile *f = &ctx->index.files[i];
+    if (!f->name[0])
+      continue;
+    char file[4096];
+    snprintf(file, sizeof(file), "%s/%s", ctx->paths[f->dir], f->name);
+    int fd = open(file, O_RDONLY);
+    if (fd < 0)
+      continue;
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+  }
+  leave_default();
+  return true;
+#else
+  return false;
+#endif
+}
+
+static void print_string(const char *s)
+{
+  putchar('"');
+  for (; *s; s++) {
+    if (*s == '"' || *s == '\\')
+      printf("\\%c", *s);
+    else if ((unsigned char)*s < 0x20)
+      printf("\\u%04x", (unsigned char)*s);
+    else
+      putchar(*s);
+  }
+  putchar('"');
+}
+
+static bool firstRun = true;
+
+static void print_run(unsigned men, int type, const char *phase,
+    unsigned threads, const struct RunResult *res)
+{
+  printf("%s\n    { \"men\": %u, \"probe\": \"%s\", \"phase\": \"%s\", "
+      "\"threads\": %u, \"probes\": %llu, \"failed\": %llu, "
+      "\"seconds\": %.6f, \"probes_per_sec\": %.1f, \"latency_ns\": "
+      "{ \"mean\": %.1f, \"p50\": %u, \"p90\": %u, \"p99\": %u, "
+      "\"p999\": %u, \"max\": %u } }", firstRun ? "" : ",", men,
+      probeNames[type], phase, threads, (unsigned long long)res->probes,
+      (unsigned long long)res->failed, res->seconds,
+      res->seconds > 0 ? res->probes / res->seconds : 0.0, res->mean,
+      res->p50, res->p90, res->p99, res->p999, res->max);
+  firstRun = false;
+  fflush(stdout);
+}
+
+static void usage(void)
+{
+  fprintf(stderr, "usage: tbprobebench [--threads N] [--positions N] "
+      "[--men A-B] [--rounds N] [--seed N] [--no-drop] [path]\n");
+}
+
+int main(int argc, char **argv)
+{
+  const char *path = getenv("TB_PATH");
+  unsigned threads = num_processors();
+  int positions = 10000, rounds = 4;
+  unsigned minMen = 3, maxMen = TB_PIECES;
+  unsigned long long seed = rngState;
+  bool drop = true;
+
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (!strcmp(arg, "--threads") && hasValue)
+      threads = (unsigned)atoi(argv[++i]);
+    else if (!strcmp(arg, "--positions") && hasValue)
+      positions = atoi(argv[++i]);
+    else if (!strcmp(arg, "--men") && hasValue) {
+      const char *range = argv[++i];
+      minMen = maxMen = (unsigned)atoi(range);
+      if (strchr(range, '-'))
+        maxMen = (unsigned)atoi(strchr(range, '-') + 1);
+    } else if (!strcmp(arg, "--rounds") && hasValue)
+      rounds = atoi(argv[++i]);
+    else if (!strcmp(arg, "--seed") && hasValue)
+      seed = strtoull(argv[++i], NULL, 0);
+    else if (!strcmp(arg, "--no-drop"))
+      drop = false;
+    else if (arg[0] != '-')
+      path = arg;
+    else {
+      usage();
+      return EXIT_FAILURE;
+    }
+  }
+  if (threads < 1)
+    threads = 1;
+  if (threads > MAX_THREADS)
+    threads = MAX_THREADS;
+  if (positions < 1)
+    positions = 1;
+  if (rounds < 1)
+    rounds = 1;
+  if (minMen < 3)
+    minMen = 3;
+  rngState = seed ? seed : 1;
+
+  if (!path || !*path || !tb_init(path) || TB_LARGEST < 3) {
+    fprintf(stderr, "tbprobebench: no tables found, give a path or set TB_PATH\n");
+    usage();
+    return EXIT_FAILURE;
+  }
+  if (maxMen > TB_LARGEST)
+    maxMen = TB_LARGEST;
+  struct TbInitInfo info;
+  tb_init_info(&info);
+  bool dropped = drop && drop_page_cache();
+
+  printf("{\n  \"path\": ");
+  print_string(path);
+  printf(",\n  \"tables\": { \"wdl\": %u, \"dtm\": %u, \"dtz\": %u, "
+      "\"largest\": %u },\n", info.wdl, info.dtm, info.dtz, TB_LARGEST);
+  printf("  \"config\": { \"positions\": %d, \"rounds\": %d, \"threads\": %u, "
+      "\"seed\": %llu, \"page_cache_dropped\": %s, \"stats\": %s },\n",
+      positions, rounds, threads, seed, dropped ? "true" : "false",
+      tb_stats_enabled() ? "true" : "false");
+  printf("  \"runs\": [");
+
+  Pos *pos = (Pos *)malloc((size_t)positions * sizeof(*pos));
+  if (!pos) {
+    fprintf(stderr, "tbprobebench: out of memory\n");
+    return EXIT_FAILURE;
+  }
+  for (unsigned men = minMen; men <= maxMen; men++) {
+    for (int i = 0; i < positions; i++)
+      pos[i] = random_pos(men - 2);
+    for (int type = PROBE_WDL; type <= PROBE_ROOT; type++) {
+      int count = type == PROBE_ROOT ? (positions + 9) / 10 : positions;
+      unsigned counts[2] = { 1, threads };
+      for (int k = 0; k < (threads > 1 ? 2 : 1); k++) {
+        // Cold: the tables are mapped again on first use.
+        tb_free();
+        tb_init(path);
+        if (dropped)
+          drop_page_cache();
+        struct RunResult res = run(type, pos, count, 1, counts[k]);
+        print_run(men, type, "cold", counts[k], &res);
+        res = run(type, pos, count, rounds, counts[k]);
+        print_run(men, type, "warm", counts[k], &res);
+      }
+    }
+  }
+  printf("\n  ]\n}\n");
+
+  free(pos);
+  tb_free();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,102 @@
+/*
+ * Checks the slider kernels of tbattacks.c against the prober's built-in
+ * rank/file/diagonal tables, and measures the time per queen lookup.
+ *
+ *   attacks_test           verify only
+ *   attacks_test bench     verify, then time each kernel
+ */
+
+#include "tbprobe.c"
+#include "tbtest.h"
+#include "tbattacks.c"
+
+// Sparse and dense occupancies alike.
+static uint64_t rnd_occ(int i)
+{
+  uint64_t occ = rnd();
+  for (int k = i % 4; k > 0; k--)
+    occ &= rnd();
+  return occ;
+}
+
+static int verify(const char *name)
+{
+  int errors = 0;
+  for (unsigned sq = 0; sq < 64; sq++)
+    for (int i = 0; i < 4000; i++) {
+      uint64_t occ = rnd_occ(i);
+      if (fast_rook_attacks(sq, occ) != rook_attacks(sq, occ) ||
+          fast_bishop_attacks(sq, occ) != bishop_attacks(sq, occ) ||
+          fast_queen_attacks(sq, occ) != queen_attacks(sq, occ)) {
+        if (errors++ < 10)
+          fprintf(stderr, "%s: square %u occupancy 0x%016llx differs\n", name, sq,
+              (unsigned long long)occ);
+      }
+    }
+  return errors;
+}
+
+static uint64_t queen_attacks_builtin(unsigned sq, uint64_t occ)
+{
+  return queen_attacks(sq, occ);
+}
+
+static uint64_t queen_attacks_dispatch(unsigned sq, uint64_t occ)
+{
+  return fast_queen_attacks(sq, occ);
+}
+
+static void bench(const char *name, uint64_t (*attacks)(unsigned, uint64_t))
+{
+  enum { LOOKUPS = 1 << 24, SAMPLES = 1 << 12 };
+  static unsigned sqs[SAMPLES];
+  static uint64_t occs[SAMPLES];
+  for (int i = 0; i < SAMPLES; i++) {
+    sqs[i] = (unsigned)(rnd() >> 58);
+    occs[i] = rnd_occ(i);
+  }
+
+  uint64_t sum = 0;
+  uint64_t t0 = now_ns();
+  for (int i = 0; i < LOOKUPS; i++)
+    sum += attacks(sqs[i & (SAMPLES - 1)], occs[i & (SAMPLES - 1)]);
+  double ns = (double)(now_ns() - t0);
+  printf("%-10s %5.2f ns/lookup [%u]\n", name, ns / LOOKUPS, (unsigned)(sum >> 56));
+}
+
+int main(int argc, char **argv)
+{
+  bool doBench = argc > 1 && strcmp(argv[1], "bench") == 0;
+  int errors = 0;
+
+  tb_init("");
+  tb_attacks_init();
+#ifdef TB_PEXT
+  bool pextSelected = usePext;
+  bool pextAvailable = cpu_has_bmi2();
+  usePext = false;
+#endif
+
+  errors += verify("magic");
+  if (doBench) {
+    bench("built-in", queen_attacks_builtin);
+    bench("magic", queen_attacks_dispatch);
+  }
+#ifdef TB_PEXT
+  if (pextAvailable) {
+    usePext = true;
+    errors += verify("pext");
+    if (doBench)
+      bench("pext", queen_attacks_dispatch);
+  }
+  if (doBench)
+    printf("selected: %s\n", pextSelected ? "pext" : "magic");
+#endif
+
+  tb_free();
+
+  if (errors)
+    return EXIT_FAILURE;
+  printf("all attacks match\n");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,109 @@
+/*
+ * Expands the small WDL tables under TB_PATH into bitbases and checks that
+ * every table lookup through a bitbase returns what the compressed table
+ * holds for the same position.
+ *
+ *   bitbase_test                   verify the 3- and 4-piece tables
+ *   bitbase_test bench [pieces]    verify, then compare probes/s of both
+ *
+ * Needs TB_PATH to point at a directory with the WDL tables; without it
+ * the test is skipped.
+ */
+
+#include "tbprobe.c"
+#include "tbtest.h"
+
+#define POSITIONS   (1 << 16)
+#define ROUNDS      16      // benchmark passes over the positions
+
+static Pos positions[POSITIONS];
+
+// Probes per second over all positions, either the table lookup alone or
+// the full WDL probe with capture resolution.
+static double rate(struct TbContext *ctx, bool full)
+{
+  unsigned sum = 0;
+  uint64_t t0 = now_ns();
+  for (int r = 0; r < ROUNDS; r++)
+    for (int i = 0; i < POSITIONS; i++) {
+      Pos *pos = &positions[i];
+      if (full) {
+        sum += tb_context_probe_wdl(ctx, pos->white, pos->black, pos->kings,
+            pos->queens, pos->rooks, pos->bishops, pos->knights, pos->pawns,
+            0, 0, 0, pos->turn);
+      } else {
+        int success;
+        pos->ctx = ctx;
+        sum += (unsigned)probe_table(pos, 0, &success, WDL);
+      }
+    }
+  double ns = now_ns() - t0;
+  if (sum == 0x12345678)
+    printf("\n");
+  return (double)ROUNDS * POSITIONS / (ns / 1e9);
+}
+
+int main(int argc, char **argv)
+{
+  bool doBench = argc > 1 && strcmp(argv[1], "bench") == 0;
+  unsigned pieces = doBench && argc > 2 ? (unsigned)atoi(argv[2]) : 4;
+  if (pieces < 3 || pieces > TB_PIECES)
+    pieces = 4;
+
+  const char *path = getenv("TB_PATH");
+  if (!path || !*path) {
+    printf("TB_PATH not set, skipping\n");
+    return TEST_SKIPPED;
+  }
+
+  struct TbContext *plain = tb_context_create(path);
+  uint64_t t0 = now_ns();
+  tb_set_bitbases(pieces, 4);
+  struct TbContext *bits = tb_context_create(path);
+  double buildMs = (now_ns() - t0) / 1e6;
+  tb_set_bitbases(0, 1);
+  if (!plain || !bits || plain->largest < 3) {
+    printf("no tables under TB_PATH, skipping\n");
+    tb_context_free(plain);
+    tb_context_free(bits);
+    return TEST_SKIPPED;
+  }
+  printf("%u bitbases of up to %u pieces, %.1f MB, built in %.0f ms\n",
+      bits->numBitbases, pieces, bits->bitbaseBytes / (1024.0 * 1024.0),
+      buildMs);
+
+  // Positions whose table the compressed context has.
+  int errors = 0;
+  unsigned extra = pieces - 2;
+  for (int i = 0; i < POSITIONS;) {
+    Pos pos = random_pos(1 + (unsigned)(rnd() % extra));
+    int success;
+    pos.ctx = plain;
+    int v = probe_table(&pos, 0, &success, WDL);
+    if (!success || pos.key == 0)
+      continue;
+    pos.ctx = bits;
+    int w = probe_table(&pos, 0, &success, WDL);
+    if ((!success || v != w) && errors++ < 10)
+      fprintf(stderr, "0x%016llx: bitbase value %d, table value %d\n",
+          (unsigned long long)pos.key, w, v);
+    positions[i++] = pos;
+  }
+
+  if (doBench) {
+    printf("table lookup: %12.0f probes/s compressed, %12.0f with bitbases\n",
+        rate(plain, false), rate(bits, false));
+    printf("WDL probe:    %12.0f probes/s compressed, %12.0f with bitbases\n",
+        rate(plain, true), rate(bits, true));
+  }
+
+  tb_context_free(plain);
+  tb_context_free(bits);
+
+  if (errors) {
+    fprintf(stderr, "%d bitbase values differ from the tables\n", errors);
+    return EXIT_FAILURE;
+  }
+  printf("all bitbase values match the tables\n");
+  return EXIT_SUCCESS;
+}
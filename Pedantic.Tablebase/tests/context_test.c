@@ -0,0 +1,304 @@
+/*
+ * Checks that tablebase contexts probe their own tables, that contexts which
+ * find the same file share one mapping, and that freeing the contexts unmaps
+ * everything.  The tables are written by the test: KNvK files whose every
+ * position has the same value, a draw in one directory and a (bogus) win in
+ * the other, so that each context can be told apart by its results.  The
+ * same tables check that tb_init finds them through its directory index,
+ * that it expands them into bitbases when asked to, and that a non-blocking
+ * probe leaves mapping them to the I/O threads, and that the WDL cache
+ * keeps the results of each context apart.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#define SEP ";"
+#else
+#define SEP ":"
+#endif
+
+#include "tbprobe.h"
+#include "tbtest.h"
+
+#define SQ(f, r)    ((f) + 8 * (r))
+#define BB(sq)      (1ULL << (sq))
+
+
+static int failures = 0;
+
+#define CHECK(cond)                                                         \
+  do {                                                                      \
+    if (!(cond)) {                                                          \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__,      \
+          #cond);                                                           \
+      failures++;                                                           \
+    }                                                                       \
+  } while (0)
+
+// K(e1)+N(b1) v K(e8), white to move.
+static struct TbPosition knk(void)
+{
+  uint64_t wk = BB(SQ(4, 0)), bk = BB(SQ(4, 7)), n = BB(SQ(1, 0));
+  struct TbPosition pos = {
+    wk | n, bk, wk | bk, 0, 0, 0, n, 0, 0, 0, 0, 1
+  };
+  return pos;
+}
+
+static unsigned probe(struct TbContext *ctx, const struct TbPosition *pos)
+{
+  return tb_context_probe_wdl(ctx, pos->white, pos->black, pos->kings,
+      pos->queens, pos->rooks, pos->bishops, pos->knights, pos->pawns,
+      pos->rule50, pos->castling, pos->ep, pos->turn != 0);
+}
+
+static unsigned mapped_tables(void)
+{
+  struct TbResidency residency;
+  tb_residency(&residency);
+  CHECK(residency.resident == (uint64_t)residency.tables * TEST_TABLE_SIZE);
+  return residency.tables;
+}
+
+static void test_contexts(void)
+{
+  struct TbPosition pos = knk();
+  static struct TbRootMoves rm;
+
+  CHECK(tb_init(""));
+  struct TbContext *a1 = tb_context_create("ctx_draw");
+  struct TbContext *a2 = tb_context_create("ctx_win/../ctx_draw");
+  struct TbContext *b = tb_context_create("ctx_win");
+  struct TbContext *none = tb_context_create("/nonexistent/syzygy");
+  CHECK(a1 && a2 && b && none);
+  if (!a1 || !a2 || !b || !none)
+    return;
+
+  CHECK(tb_context_largest(a1) == 3);
+  CHECK(tb_context_largest(a2) == 3);
+  CHECK(tb_context_largest(b) == 3);
+  CHECK(tb_context_largest(none) == 0);
+  CHECK(TB_LARGEST == 0);
+
+  // each context answers from its own tables, the default one has none
+  CHECK(probe(a1, &pos) == TB_DRAW);
+  CHECK(probe(b, &pos) == TB_WIN);
+  CHECK(probe(a2, &pos) == TB_DRAW);
+  CHECK(probe(none, &pos) == TB_RESULT_FAILED);
+  CHECK(tb_probe_wdl(pos.white, pos.black, pos.kings, pos.queens, pos.rooks,
+      pos.bishops, pos.knights, pos.pawns, 0, 0, 0, true) == TB_RESULT_FAILED);
+
+  // a1 and a2 found the same file under different paths
+  CHECK(mapped_tables() == 2);
+
+  CHECK(tb_context_probe_root_wdl(b, pos.white, pos.black, pos.kings,
+      pos.queens, pos.rooks, pos.bishops, pos.knights, pos.pawns, 0, 0, 0,
+      true, true, &rm));
+  CHECK(rm.size > 0);
+  CHECK(!tb_context_probe_root_wdl(none, pos.white, pos.black, pos.kings,
+      pos.queens, pos.rooks, pos.bishops, pos.knights, pos.pawns, 0, 0, 0,
+      true, true, &rm));
+
+  // the shared mapping lives until its last context is freed
+  tb_context_free(a1);
+  CHECK(mapped_tables() == 2);
+  CHECK(probe(a2, &pos) == TB_DRAW);
+  tb_context_free(a2);
+  CHECK(mapped_tables() == 1);
+  tb_context_free(b);
+  tb_context_free(none);
+  tb_context_free(NULL);
+  CHECK(mapped_tables() == 0);
+}
+
+static void test_default_context(void)
+{
+  struct TbPosition pos = knk();
+
+  // the default context shares mappings with the other contexts as well
+  CHECK(tb_init("ctx_draw"));
+  CHECK(TB_LARGEST == 3);
+  struct TbContext *ctx = tb_context_create("ctx_draw");
+  CHECK(ctx != NULL);
+  CHECK(tb_probe_wdl(pos.white, pos.black, pos.kings, pos.queens, pos.rooks,
+      pos.bishops, pos.knights, pos.pawns, 0, 0, 0, true) == TB_DRAW);
+  CHECK(probe(ctx, &pos) == TB_DRAW);
+  CHECK(mapped_tables() == 1);
+
+  tb_free();
+  CHECK(mapped_tables() == 1);
+  CHECK(probe(ctx, &pos) == TB_DRAW);
+  tb_context_free(ctx);
+  CHECK(mapped_tables() == 0);
+}
+
+static void test_dir_index(void)
+{
+  struct TbPosition pos = knk();
+  struct TbInitInfo info;
+
+  // the first directory of the path that has a table wins
+  CHECK(tb_init("ctx_win" SEP "ctx_draw"));
+  tb_init_info(&info);
+  CHECK(info.dirs == 2 && info.files == 1);
+  CHECK(info.wdl == 1 && info.dtm == 0 && info.dtz == 0);
+  CHECK(tb_probe_wdl(pos.white, pos.black, pos.kings, pos.queens, pos.rooks,
+      pos.bishops, pos.knights, pos.pawns, 0, 0, 0, true) == TB_WIN);
+
+  // missing directories and files of the wrong size are skipped
+  FILE *f = fopen("ctx_short/KBvK.rtbw", "wb");
+  CHECK(f && fputs("short", f) >= 0 && fclose(f) == 0);
+  CHECK(tb_init("/nonexistent/syzygy" SEP "ctx_short" SEP "ctx_draw"));
+  tb_init_info(&info);
+  CHECK(info.dirs == 2 && info.files == 2);
+  CHECK(info.wdl == 1 && TB_LARGEST == 3);
+  CHECK(tb_probe_wdl(pos.white, pos.black, pos.kings, pos.queens, pos.rooks,
+      pos.bishops, pos.knights, pos.pawns, 0, 0, 0, true) == TB_DRAW);
+
+  tb_free();
+  tb_init_info(&info);
+  CHECK(info.dirs == 0 && info.files == 0 && info.wdl == 0);
+}
+
+static void test_bitbases(void)
+{
+  struct TbPosition pos = knk();
+  struct TbInitInfo info;
+
+  // both sides of KNvK, 2 bits for each of 31332 positions
+  tb_set_bitbases(3, 2);
+  CHECK(tb_init("ctx_win"));
+  tb_init_info(&info);
+  CHECK(info.bitbases == 1);
+  CHECK(info.bitbaseBytes == 2 * (31332 / 4));
+  CHECK(tb_probe_wdl(pos.white, pos.black, pos.kings, pos.queens, pos.rooks,
+      pos.bishops, pos.knights, pos.pawns, 0, 0, 0, true) == TB_WIN);
+  CHECK(tb_probe_wdl(pos.white, pos.black, pos.kings, pos.queens, pos.rooks,
+      pos.bishops, pos.knights, pos.pawns, 0, 0, 0, false) == TB_WIN);
+
+  // the table file is not kept mapped, other contexts get bitbases too
+  CHECK(mapped_tables() == 0);
+  struct TbContext *ctx = tb_context_create("ctx_draw");
+  CHECK(ctx != NULL);
+  CHECK(probe(ctx, &pos) == TB_DRAW);
+  CHECK(mapped_tables() == 0);
+  tb_context_free(ctx);
+
+  // tables with more pieces than asked for stay compressed
+  tb_set_bitbases(2, 1);
+  CHECK(tb_init("ctx_win"));
+  tb_init_info(&info);
+  CHECK(info.bitbases == 0 && info.bitbaseBytes == 0);
+  CHECK(tb_probe_wdl(pos.white, pos.black, pos.kings, pos.queens, pos.rooks,
+      pos.bishops, pos.knights, pos.pawns, 0, 0, 0, true) == TB_WIN);
+  CHECK(mapped_tables() == 1);
+
+  tb_set_bitbases(0, 1);
+  tb_free();
+}
+
+static void test_cache(void)
+{
+  struct TbPosition pos = knk();
+
+  // the cache keeps each context's results apart, in either probe order
+  CHECK(tb_set_wdl_cache(1));
+  struct TbContext *draw = tb_context_create("ctx_draw");
+  struct TbContext *win = tb_context_create("ctx_win");
+  CHECK(draw && win);
+  if (!draw || !win)
+    return;
+  for (int pass = 0; pass < 2; pass++) {
+    CHECK(probe(draw, &pos) == TB_DRAW);
+    CHECK(probe(win, &pos) == TB_WIN);
+  }
+  tb_clear_wdl_cache();
+  CHECK(probe(win, &pos) == TB_WIN);
+  CHECK(probe(draw, &pos) == TB_DRAW);
+
+  // and those of the default context from both
+  CHECK(tb_init("ctx_win"));
+  CHECK(tb_probe_wdl(pos.white, pos.black, pos.kings, pos.queens, pos.rooks,
+      pos.bishops, pos.knights, pos.pawns, 0, 0, 0, true) == TB_WIN);
+  CHECK(probe(draw, &pos) == TB_DRAW);
+  CHECK(tb_init("ctx_draw"));
+  CHECK(tb_probe_wdl(pos.white, pos.black, pos.kings, pos.queens, pos.rooks,
+      pos.bishops, pos.knights, pos.pawns, 0, 0, 0, true) == TB_DRAW);
+
+  tb_context_free(draw);
+  tb_context_free(win);
+  CHECK(tb_set_wdl_cache(0));
+  tb_free();
+}
+
+static unsigned probe_nonblocking(const struct TbPosition *pos)
+{
+  return tb_probe_wdl_nonblocking(pos->white, pos->black, pos->kings,
+      pos->queens, pos->rooks, pos->bishops, pos->knights, pos->pawns,
+      pos->rule50, pos->castling, pos->ep, pos->turn != 0,
+      tb_material_key(pos->white, pos->black, pos->queens, pos->rooks,
+          pos->bishops, pos->knights, pos->pawns));
+}
+
+static void test_nonblocking(void)
+{
+  struct TbPosition pos = knk();
+  struct TbIoStatus status;
+
+  // without I/O threads the probe maps the table itself
+  CHECK(tb_init("ctx_draw"));
+  CHECK(probe_nonblocking(&pos) == TB_DRAW);
+  CHECK(mapped_tables() == 1);
+
+  // with them the first probe only queues the position
+  CHECK(tb_init("ctx_win"));
+  CHECK(tb_set_io_threads(2));
+  CHECK(probe_nonblocking(&pos) == TB_RESULT_PENDING);
+  time_t start = time(NULL);
+  unsigned v;
+  while ((v = probe_nonblocking(&pos)) == TB_RESULT_PENDING
+         && time(NULL) - start < 10)
+    ;
+  CHECK(v == TB_WIN);
+  tb_io_status(&status);
+  CHECK(status.threads == 2);
+  CHECK(status.pending >= 1 && status.reads >= 1 && status.dropped == 0);
+
+  // K v K needs no table, castling rights are rejected as before
+  struct TbPosition kk = pos;
+  kk.white &= kk.kings;
+  kk.knights = 0;
+  CHECK(probe_nonblocking(&kk) == TB_DRAW);
+  pos.castling = 1;
+  CHECK(probe_nonblocking(&pos) == TB_RESULT_FAILED);
+
+  CHECK(tb_set_io_threads(0));
+  tb_io_status(&status);
+  CHECK(status.threads == 0);
+  tb_free();
+}
+
+int main(void)
+{
+  make_dir("ctx_short");
+  if (!write_knvk("ctx_draw", 2) || !write_knvk("ctx_win", 4)) {
+    fprintf(stderr, "cannot write the test tables\n");
+    return EXIT_FAILURE;
+  }
+
+  test_contexts();
+  test_default_context();
+  test_dir_index();
+  test_bitbases();
+  test_nonblocking();
+  test_cache();
+
+  if (failures) {
+    fprintf(stderr, "%d check(s) failed\n", failures);
+    return EXIT_FAILURE;
+  }
+  printf("all checks passed\n");
+  return EXIT_SUCCESS;
+}
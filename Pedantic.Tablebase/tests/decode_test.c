@@ -0,0 +1,415 @@
+/*
+ * Checks decompress_pairs against an independent decoder on synthetic
+ * Huffman compressed tables, and the bitbases expanded from them, and
+ * measures the decode time per probe.  Also checks that the residency test
+ * of the non-blocking probe tells pages in memory from pages that are not.
+ *
+ *   decode_test           verify only
+ *   decode_test bench     verify, then time random and clustered probes,
+ *                         and lookups in the bitbase of each table
+ *
+ * The test is built three times: as is, with TB_NO_DECODE_LUT and with
+ * TB_BLOCK_CACHE_SLOTS=0, so running the binaries with `bench' compares the
+ * lookup table decoder with the plain code length scan, and both with the
+ * decoded-block cache.
+ */
+
+#include "tbprobe.c"
+#include "tbtest.h"
+
+#define BLOCK_BITS  6     // 64-byte blocks
+#define IDX_BITS    10
+
+struct Synth {
+  int numSyms, minLen, maxLen;
+  int len[TB_MAX_SYMS];         // code length of each symbol
+  int count[65];                // number of codes of each length
+  uint32_t offset[65];          // first symbol of each length
+  uint64_t base[65];            // first code of each length
+  int symLen[TB_MAX_SYMS];      // literals in each symbol - 1
+  uint8_t symPat[3 * TB_MAX_SYMS];
+
+  size_t tbSize;
+  uint16_t *expect;             // leaf symbol at each index
+  uint8_t *header, *index, *blocks;
+  uint16_t *sizes;
+  struct PairsData *d;
+};
+
+// Random complete prefix code: split random leaves until there are enough.
+static void make_code(struct Synth *s, int maxLen)
+{
+  int n = 1;
+  s->len[0] = 0;
+  while (n < s->numSyms) {
+    int i = (int)(rnd() % (uint64_t)n);
+    if (s->len[i] >= maxLen)
+      continue;
+    s->len[i]++;
+    s->len[n++] = s->len[i];
+  }
+
+  memset(s->count, 0, sizeof(s->count));
+  for (int i = 0; i < n; i++)
+    s->count[s->len[i]]++;
+  s->minLen = 64;
+  s->maxLen = 0;
+  for (int l = 1; l <= 64; l++)
+    if (s->count[l]) {
+      if (l < s->minLen) s->minLen = l;
+      s->maxLen = l;
+    }
+
+  // canonical order: the longest codes have the lowest symbol numbers
+  uint32_t next = 0;
+  for (int l = s->maxLen; l >= s->minLen; l--) {
+    s->offset[l] = next;
+    next += s->count[l];
+  }
+  int k = 0;
+  for (int l = s->maxLen; l >= s->minLen; l--)
+    for (int c = 0; c < s->count[l]; c++)
+      s->len[k++] = l;
+  s->base[s->maxLen] = 0;
+  for (int l = s->maxLen - 1; l >= s->minLen; l--)
+    s->base[l] = (s->base[l + 1] + s->count[l + 1]) / 2;
+}
+
+// Half of the symbols are literals, the rest are pairs of earlier symbols.
+static void make_symbols(struct Synth *s)
+{
+  int order[TB_MAX_SYMS];
+  for (int i = 0; i < s->numSyms; i++)
+    order[i] = i;
+  for (int i = s->numSyms - 1; i > 0; i--) {
+    int j = (int)(rnd() % (uint64_t)(i + 1));
+    int t = order[i]; order[i] = order[j]; order[j] = t;
+  }
+
+  int leaves = s->numSyms / 2;
+  for (int i = 0; i < s->numSyms; i++) {
+    int sym = order[i];
+    uint8_t *w = s->symPat + 3 * sym;
+    uint32_t s1, s2;
+    if (i < leaves) {
+      s1 = (uint32_t)sym;
+      s2 = 0xfff;
+      s->symLen[sym] = 0;
+    } else {
+      do {
+        s1 = (uint32_t)order[rnd() % (uint64_t)i];
+        s2 = (uint32_t)order[rnd() % (uint64_t)i];
+      } while (s->symLen[s1] + s->symLen[s2] + 1 > 40);
+      s->symLen[sym] = s->symLen[s1] + s->symLen[s2] + 1;
+    }
+    w[0] = (uint8_t)s1;
+    w[1] = (uint8_t)((s1 >> 8) | (s2 << 4));
+    w[2] = (uint8_t)(s2 >> 4);
+  }
+}
+
+static int ref_len(const struct Synth *s, uint64_t code)
+{
+  int l = s->minLen;
+  while ((code >> (64 - l)) < s->base[l]) l++;
+  return l;
+}
+
+static int ref_sym(const struct Synth *s, uint64_t code, int l)
+{
+  return (int)(s->offset[l] + (code >> (64 - l)) - s->base[l]);
+}
+
+static size_t expand(const struct Synth *s, int sym, uint16_t *out)
+{
+  if (s->symLen[sym] == 0) {
+    *out = (uint16_t)sym;
+    return 1;
+  }
+  const uint8_t *w = s->symPat + 3 * sym;
+  int s1 = ((w[1] & 0xf) << 8) | w[0];
+  int s2 = (w[2] << 4) | (w[1] >> 4);
+  size_t n = expand(s, s1, out);
+  return n + expand(s, s2, out + n);
+}
+
+static void put_bits(uint8_t *block, int *pos, uint64_t code, int l)
+{
+  for (int i = l - 1; i >= 0; i--, (*pos)++)
+    if ((code >> i) & 1)
+      block[*pos >> 3] |= (uint8_t)(0x80 >> (*pos & 7));
+}
+
+static void make_table(struct Synth *s, int numSyms, int maxLen, size_t tbSize)
+{
+  memset(s, 0, sizeof(*s));
+  s->numSyms = numSyms;
+  s->tbSize = tbSize;
+  make_code(s, maxLen);
+  make_symbols(s);
+
+  // Encode symbols drawn with the probabilities the code implies.
+  size_t maxBlocks = tbSize + 1;
+  s->expect = (uint16_t *)malloc((tbSize + 64) * sizeof(uint16_t));
+  s->blocks = (uint8_t *)calloc((maxBlocks << BLOCK_BITS) + 16, 1);
+  s->sizes = (uint16_t *)malloc(maxBlocks * sizeof(uint16_t));
+  size_t *start = (size_t *)malloc((maxBlocks + 1) * sizeof(size_t));
+  size_t lits = 0, numBlocks = 0;
+  while (lits < tbSize) {
+    uint8_t *block = s->blocks + (numBlocks << BLOCK_BITS);
+    int pos = 0;
+    size_t first = lits;
+    for (;;) {
+      uint64_t code = rnd();
+      int l = ref_len(s, code);
+      if (pos + l > (8 << BLOCK_BITS) || lits - first + s->symLen[ref_sym(s, code, l)] + 1 > 65536)
+        break;
+      put_bits(block, &pos, code >> (64 - l), l);
+      lits += expand(s, ref_sym(s, code, l), s->expect + lits);
+      if (lits >= tbSize)
+        break;
+    }
+    start[numBlocks] = first;
+    s->sizes[numBlocks++] = (uint16_t)(lits - first - 1);
+  }
+  start[numBlocks] = lits;
+
+  size_t numIndices = (tbSize + (1 << IDX_BITS) - 1) >> IDX_BITS;
+  s->index = (uint8_t *)malloc(6 * numIndices);
+  for (size_t k = 0, b = 0; k < numIndices; k++) {
+    size_t c = (k << IDX_BITS) + (1 << (IDX_BITS - 1));
+    while (b + 1 < numBlocks && start[b + 1] <= c)
+      b++;
+    uint32_t block = (uint32_t)b;
+    uint16_t off = (uint16_t)(c - start[b]);
+    memcpy(s->index + 6 * k, &block, 4);
+    memcpy(s->index + 6 * k + 4, &off, 2);
+  }
+  free(start);
+
+  // The header as setup_pairs expects it.
+  int h = s->maxLen - s->minLen + 1;
+  s->header = (uint8_t *)calloc(12 + 2 * h + 3 * numSyms + 1, 1);
+  uint8_t *p = s->header;
+  p[1] = BLOCK_BITS;
+  p[2] = IDX_BITS;
+  uint32_t realNumBlocks = (uint32_t)numBlocks;
+  memcpy(p + 4, &realNumBlocks, 4);
+  p[8] = (uint8_t)s->maxLen;
+  p[9] = (uint8_t)s->minLen;
+  for (int i = 0; i < h; i++) {
+    uint16_t o = (uint16_t)s->offset[s->minLen + i];
+    memcpy(p + 10 + 2 * i, &o, 2);
+  }
+  uint16_t n16 = (uint16_t)numSyms;
+  memcpy(p + 10 + 2 * h, &n16, 2);
+  memcpy(p + 12 + 2 * h, s->symPat, 3 * numSyms);
+
+  uint8_t *ptr = s->header, flags;
+  size_t size[3];
+  s->d = setup_pairs(&ptr, tbSize, size, &flags, WDL);
+  s->d->indexTable = s->index;
+  s->d->sizeTable = s->sizes;
+  s->d->data = s->blocks;
+}
+
+static void free_table(struct Synth *s)
+{
+  // As unload_table() does: the next table may get the same PairsData.
+#if TB_BLOCK_CACHE_SLOTS > 0
+  atomic_fetch_add(&blockEpoch, 1u);
+#endif
+  free(s->d);
+  free(s->header);
+  free(s->index);
+  free(s->sizes);
+  free(s->blocks);
+  free(s->expect);
+}
+
+// Every index in order, then as many at random, so that the decoded-block
+// cache answers from blocks it decoded both just now and long ago.
+static int verify(struct Synth *s)
+{
+  int errors = 0;
+  unsigned long hits = 0;
+  for (size_t n = 0; n < 2 * s->tbSize; n++) {
+    size_t idx = n < s->tbSize ? n : (size_t)(rnd() % s->tbSize);
+    int cached;
+    uint8_t *w = decompress_pairs(s->d, idx, &cached);
+    hits += cached == 1;
+    int sym = (int)((w - s->d->symPat) / 3);
+    if (sym != s->expect[idx] && errors++ < 10)
+      fprintf(stderr, "idx %zu: decoded symbol %d, expected %d\n", idx, sym,
+          s->expect[idx]);
+  }
+#if TB_BLOCK_CACHE_SLOTS > 0
+  if (hits == 0 && errors++ < 10)
+    fprintf(stderr, "no decode was answered by the block cache\n");
+#endif
+  return errors;
+}
+
+// Random probes, and clustered ones: runs of eight probes close together,
+// as a search visits neighbouring positions.
+static void bench(struct Synth *s, const char *name, bool clustered)
+{
+  enum { PROBES = 1 << 22 };
+  size_t *idx = (size_t *)malloc(PROBES * sizeof(size_t));
+  for (size_t i = 0; i < PROBES; i++)
+    idx[i] = clustered && i % 8 != 0
+           ? (idx[i - 1] + (size_t)(rnd() % 64)) % s->tbSize
+           : (size_t)(rnd() % s->tbSize);
+
+  unsigned sum = 0;
+  int cached;
+  unsigned long hits = 0;
+  for (size_t i = 0; i < PROBES / 16; i++)
+    sum += decompress_pairs(s->d, idx[i], &cached)[0];
+  uint64_t t0 = now_ns();
+  for (size_t i = 0; i < PROBES; i++) {
+    sum += decompress_pairs(s->d, idx[i], &cached)[0];
+    hits += cached == 1;
+  }
+  uint64_t t1 = now_ns();
+
+  printf("%-12s syms %4d len %2d-%2d %-9s: %6.1f ns/probe (%s%s) hits %5.1f%% [%u]\n",
+      name, s->numSyms, s->minLen, s->maxLen,
+      clustered ? "clustered" : "random", (double)(t1 - t0) / PROBES,
+#ifndef TB_NO_DECODE_LUT
+      "lut",
+#else
+      "scan",
+#endif
+#if TB_BLOCK_CACHE_SLOTS > 0
+      "+cache",
+#else
+      "",
+#endif
+      100.0 * hits / PROBES, sum & 0xff);
+  free(idx);
+}
+
+// Give the leaves WDL values, four of them, and check that the bitbase
+// expand_wdl() builds holds the value of every index. Then time random
+// bitbase lookups the way bench() times decodes.
+static int check_bitbase(struct Synth *s, const char *name, bool doBench)
+{
+  for (int sym = 0; sym < s->numSyms; sym++)
+    if (s->d->symLen[sym] == 0)
+      s->d->symPat[3 * sym] = (uint8_t)(sym % 4);
+
+  struct BaseEntry be;
+  memset(&be, 0, sizeof(be));
+  int8_t codes[5] = { -1, -1, -1, -1, -1 };
+  int numCodes = 0, errors = 0;
+  size_t size = (s->tbSize + 3) / 4;
+  uint8_t *bits = (uint8_t *)calloc(size, 1);
+  if (!expand_wdl(&be, s->d, bits, codes, &numCodes)) {
+    fprintf(stderr, "%s: bitbase not built\n", name);
+    free(bits);
+    return 1;
+  }
+  for (size_t idx = 0; idx < s->tbSize; idx++) {
+    int v = be.bitbaseWdl[(bits[idx >> 2] >> (2 * (idx & 3))) & 3];
+    if (v != s->expect[idx] % 4 - 2 && errors++ < 10)
+      fprintf(stderr, "idx %zu: bitbase value %d, expected %d\n", idx, v,
+          s->expect[idx] % 4 - 2);
+  }
+
+  // A fifth value is refused.
+  s->d->symPat[3 * s->expect[0]] = 4;
+  memset(bits, 0, size);
+  if (expand_wdl(&be, s->d, bits, codes, &numCodes) && errors++ < 10)
+    fprintf(stderr, "%s: bitbase with five values\n", name);
+  s->d->symPat[3 * s->expect[0]] = (uint8_t)(s->expect[0] % 4);
+
+  if (doBench) {
+    enum { PROBES = 1 << 22 };
+    size_t *idx = (size_t *)malloc(PROBES * sizeof(size_t));
+    for (size_t i = 0; i < PROBES; i++)
+      idx[i] = (size_t)(rnd() % s->tbSize);
+    unsigned sum = 0;
+    uint64_t t0 = now_ns();
+    for (size_t i = 0; i < PROBES; i++)
+      sum += (unsigned)be.bitbaseWdl[(bits[idx[i] >> 2] >> (2 * (idx[i] & 3))) & 3];
+    uint64_t t1 = now_ns();
+    printf("%-12s bitbase %7zu KB     random   : %6.1f ns/probe [%u]\n", name,
+        size / 1024, (double)(t1 - t0) / PROBES, sum & 0xff);
+    free(idx);
+  }
+  free(bits);
+  return errors;
+}
+
+// Every block of a table in ordinary memory is resident, pages of a fresh
+// mapping are not until they are touched.
+static int check_resident(struct Synth *s, const char *name)
+{
+  int errors = 0;
+  thread_record();
+  for (int n = 0; n < 1000; n++) {
+    size_t idx = (size_t)(rnd() % s->tbSize);
+    if (!pairs_resident(s->d, idx) && errors++ < 10)
+      fprintf(stderr, "%s: idx %zu not resident\n", name, idx);
+  }
+
+  size_t size = 4 * (size_t)ioPageSize;
+#ifndef _WIN32
+  uint8_t *fresh = (uint8_t *)mmap(NULL, size, PROT_READ | PROT_WRITE,
+                                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (fresh == MAP_FAILED)
+    return errors;
+#else
+  uint8_t *fresh = (uint8_t *)VirtualAlloc(NULL, size, MEM_COMMIT | MEM_RESERVE,
+                                           PAGE_READWRITE);
+  if (!fresh)
+    return errors;
+#endif
+  if (pages_resident(fresh, size) && errors++ < 10)
+    fprintf(stderr, "%s: untouched pages resident\n", name);
+  fresh[0] = 1;
+  if (!pages_resident(fresh, 1) && errors++ < 10)
+    fprintf(stderr, "%s: touched page not resident\n", name);
+  if (pages_resident(fresh, size) && errors++ < 10)
+    fprintf(stderr, "%s: untouched pages resident\n", name);
+#ifndef _WIN32
+  munmap(fresh, size);
+#else
+  VirtualFree(fresh, 0, MEM_RELEASE);
+#endif
+  return errors;
+}
+
+int main(int argc, char **argv)
+{
+  static const struct { const char *name; int syms, maxLen; size_t size; } tables[] = {
+    { "small",   64,   12, 1 << 18 },
+    { "medium",  1024, 18, 1 << 20 },
+    { "large",   4000, 24, 1 << 21 },
+    { "deep",    4000, 40, 1 << 20 },
+  };
+  bool doBench = argc > 1 && strcmp(argv[1], "bench") == 0;
+  int errors = 0;
+
+  for (size_t t = 0; t < sizeof(tables) / sizeof(tables[0]); t++) {
+    static struct Synth s;
+    make_table(&s, tables[t].syms, tables[t].maxLen, tables[t].size);
+    int e = verify(&s);
+    if (e)
+      fprintf(stderr, "%s: %d mismatches\n", tables[t].name, e);
+    errors += e;
+    if (doBench) {
+      bench(&s, tables[t].name, false);
+      bench(&s, tables[t].name, true);
+    }
+    errors += check_bitbase(&s, tables[t].name, doBench);
+    errors += check_resident(&s, tables[t].name);
+    free_table(&s);
+  }
+
+  if (errors)
+    return EXIT_FAILURE;
+  printf("all decodes match\n");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,208 @@
+/*
+ * Plays won endings out to mate twice: once with the winning side picking
+ * the move tb_probe_root suggests, which is what the engine plays without
+ * DTM tables, and once picking the best move of tb_probe_root_dtm.  The
+ * losing side defends with DTM in both games.  Checks that the DTM games
+ * end in exactly the predicted number of plies and never take longer than
+ * the DTZ games.
+ *
+ *   dtm_test           verify
+ *   dtm_test bench     verify, then print plies to mate and time per probe
+ *
+ * Needs TB_PATH to point at a directory with the WDL, DTZ and DTM tables of
+ * the endings below; without it the test is skipped.
+ */
+
+#include "tbprobe.c"
+#include "tbtest.h"
+
+#define POSITIONS   64      // start positions per ending
+#define MAX_PLIES   300
+
+struct Ending {
+  const char *name;
+  int white[3], black[3];     // piece types besides the kings, 0-terminated
+};
+
+static const struct Ending endings[] = {
+  { "KQvK",  { QUEEN },          { 0 } },
+  { "KRvK",  { ROOK },           { 0 } },
+  { "KQvKR", { QUEEN },          { ROOK } },
+  { "KBNvK", { BISHOP, KNIGHT }, { 0 } },
+  { "KRvKB", { ROOK },           { BISHOP } },
+};
+
+static unsigned num_pieces(const struct Ending *e)
+{
+  unsigned n = 2;
+  for (int i = 0; i < 3; i++)
+    n += (e->white[i] != 0) + (e->black[i] != 0);
+  return n;
+}
+
+static void put(Pos *pos, int type, bool white, uint64_t *occ)
+{
+  unsigned sq;
+  do
+    sq = (unsigned)(rnd() % 64);
+  while (*occ & board(sq));
+  *occ |= board(sq);
+  *(white ? &pos->white : &pos->black) |= board(sq);
+  switch (type) {
+    case KING:   pos->kings |= board(sq); break;
+    case QUEEN:  pos->queens |= board(sq); break;
+    case ROOK:   pos->rooks |= board(sq); break;
+    case BISHOP: pos->bishops |= board(sq); break;
+    default:     pos->knights |= board(sq); break;
+  }
+}
+
+static unsigned probe_dtm(const Pos *pos, int *plies)
+{
+  return tb_probe_dtm(pos->white, pos->black, pos->kings, pos->queens,
+      pos->rooks, pos->bishops, pos->knights, pos->pawns, pos->rule50, 0,
+      pos->ep, pos->turn, plies);
+}
+
+// A position of the ending that white to move wins.
+static Pos won_pos(const struct Ending *e, int *plies)
+{
+  for (;;) {
+    Pos pos;
+    memset(&pos, 0, sizeof(pos));
+    uint64_t occ = 0;
+    put(&pos, KING, true, &occ);
+    put(&pos, KING, false, &occ);
+    for (int i = 0; i < 3; i++) {
+      if (e->white[i])
+        put(&pos, e->white[i], true, &occ);
+      if (e->black[i])
+        put(&pos, e->black[i], false, &occ);
+    }
+    pos.turn = true;
+    if (is_valid(&pos) && is_legal(&pos) && probe_dtm(&pos, plies) == TB_WIN)
+      return pos;
+  }
+}
+
+static double probeNs[2];
+static unsigned long probes[2];
+
+// The highest ranked move of tb_probe_root_dtm, or 0 if the probe failed.
+static TbMove dtm_move(const Pos *pos)
+{
+  static struct TbRootMoves rm;
+  uint64_t t0 = now_ns();
+  int ok = tb_probe_root_dtm(pos->white, pos->black, pos->kings, pos->queens,
+      pos->rooks, pos->bishops, pos->knights, pos->pawns, pos->rule50, 0,
+      pos->ep, pos->turn, false, true, &rm);
+  probeNs[1] += now_ns() - t0;
+  probes[1]++;
+  if (!ok || rm.size == 0)
+    return 0;
+  unsigned best = 0;
+  for (unsigned i = 1; i < rm.size; i++)
+    if (rm.moves[i].tbRank > rm.moves[best].tbRank)
+      best = i;
+  return rm.moves[best].move;
+}
+
+// The move tb_probe_root suggests, or 0 if the probe failed.
+static TbMove dtz_move(const Pos *pos)
+{
+  uint64_t t0 = now_ns();
+  unsigned res = tb_probe_root(pos->white, pos->black, pos->kings,
+      pos->queens, pos->rooks, pos->bishops, pos->knights, pos->pawns,
+      pos->rule50, 0, pos->ep, pos->turn, NULL);
+  probeNs[0] += now_ns() - t0;
+  probes[0]++;
+  if (res == TB_RESULT_FAILED)
+    return 0;
+
+  TbMove moves[TB_MAX_MOVES];
+  TbMove *end = gen_legal(pos, moves);
+  for (TbMove *m = moves; m < end; m++)
+    if (move_from(*m) == TB_GET_FROM(res) && move_to(*m) == TB_GET_TO(res)
+        && move_promotes(*m) == TB_GET_PROMOTES(res))
+      return *m;
+  return 0;
+}
+
+// Plies until white mates, or -1 if a probe failed or no mate was reached.
+static int play_out(Pos pos, bool dtm)
+{
+  for (int ply = 0; ply < MAX_PLIES; ply++) {
+    TbMove moves[TB_MAX_MOVES];
+    if (gen_legal(&pos, moves) == moves)
+      return is_check(&pos) && !pos.turn ? ply : -1;
+    TbMove move = pos.turn && !dtm ? dtz_move(&pos) : dtm_move(&pos);
+    if (!move)
+      return -1;
+    Pos pos1;
+    do_move(&pos1, &pos, move);
+    pos = pos1;
+  }
+  return -1;
+}
+
+int main(int argc, char **argv)
+{
+  bool doBench = argc > 1 && strcmp(argv[1], "bench") == 0;
+  int errors = 0;
+
+  const char *path = getenv("TB_PATH");
+  if (!path || !*path) {
+    printf("TB_PATH not set, skipping\n");
+    return TEST_SKIPPED;
+  }
+  tb_init(path);
+  if (TB_LARGEST_DTM < 3) {
+    printf("no DTM tables under TB_PATH, skipping\n");
+    tb_free();
+    return TEST_SKIPPED;
+  }
+
+  for (size_t k = 0; k < sizeof(endings) / sizeof(endings[0]); k++) {
+    const struct Ending *e = &endings[k];
+    if (num_pieces(e) > TB_LARGEST_DTM)
+      continue;
+
+    long totalPlies[2] = { 0, 0 };
+    int played = 0;
+    probeNs[0] = probeNs[1] = 0;
+    probes[0] = probes[1] = 0;
+    for (int n = 0; n < POSITIONS; n++) {
+      int predicted;
+      Pos pos = won_pos(e, &predicted);
+      int dtz = play_out(pos, false), dtm = play_out(pos, true);
+      if (dtz < 0 || dtm < 0) {
+        // a table of this ending is missing
+        if (n == 0)
+          break;
+        errors++;
+        continue;
+      }
+      if ((dtm != predicted || dtm > dtz) && errors++ < 10)
+        fprintf(stderr, "%s: mate in %d plies with DTM, %d with DTZ, %d "
+            "predicted\n", e->name, dtm, dtz, predicted);
+      totalPlies[0] += dtz;
+      totalPlies[1] += dtm;
+      played++;
+    }
+    if (doBench && played)
+      printf("%-6s DTZ %5.1f plies %8.1f us/probe, DTM %5.1f plies %8.1f "
+          "us/probe\n", e->name, (double)totalPlies[0] / played,
+          probeNs[0] / 1e3 / (probes[0] ? probes[0] : 1),
+          (double)totalPlies[1] / played,
+          probeNs[1] / 1e3 / (probes[1] ? probes[1] : 1));
+  }
+
+  tb_free();
+
+  if (errors) {
+    fprintf(stderr, "%d games differ from the prediction\n", errors);
+    return EXIT_FAILURE;
+  }
+  printf("all DTM mates as predicted\n");
+  return EXIT_SUCCESS;
+}
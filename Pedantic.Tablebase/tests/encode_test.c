@@ -0,0 +1,145 @@
+/*
+ * Checks the specialized index encoders against the generic encode() for
+ * random material layouts of every piece count and encoding type, and
+ * measures the time per encoding.
+ *
+ *   encode_test           verify only
+ *   encode_test bench     verify, then time both
+ */
+
+#include "tbprobe.c"
+#include "tbtest.h"
+
+#define LAYOUTS     64      // material layouts per piece count and encoding
+#define POSITIONS   4096    // positions per layout
+
+static int rnd_int(int lo, int hi)
+{
+  return lo + (int)(rnd() % (uint64_t)(hi - lo + 1));
+}
+
+struct Layout {
+  struct BaseEntry be;
+  struct EncInfo ei;
+  int enc;
+};
+
+// A table header as init_enc_info() reads it: the order nibbles, then one
+// byte per piece. Pawns come first, the other pieces in runs of equal type.
+static void make_layout(struct Layout *l, int num, int enc)
+{
+  uint8_t tb[TB_PIECES + 2];
+
+  memset(l, 0, sizeof(*l));
+  l->enc = enc;
+  l->be.num = (uint8_t)num;
+  if (enc == PIECE_ENC) {
+    l->be.kk_enc = rnd() & 1;
+  } else {
+    l->be.hasPawns = true;
+    l->be.pawns[0] = (uint8_t)rnd_int(1, num - 2);
+    l->be.pawns[1] = (uint8_t)rnd_int(0, num - 2 - l->be.pawns[0]);
+  }
+
+  bool morePawns = enc != PIECE_ENC && l->be.pawns[1] > 0;
+  tb[0] = 0x00;
+  tb[1] = 0x11;
+  int i = 0;
+  for (; i < l->be.pawns[0]; i++)
+    tb[i + 1 + morePawns] = WHITE_PAWN | (WHITE_PAWN << 4);
+  for (; i < l->be.pawns[0] + l->be.pawns[1]; i++)
+    tb[i + 1 + morePawns] = BLACK_PAWN | (BLACK_PAWN << 4);
+  int piece = WHITE_KNIGHT;
+  for (; i < num; i++) {
+    if (rnd() & 1)
+      piece = piece == BLACK_KING ? WHITE_KNIGHT : piece + 1;
+    tb[i + 1 + morePawns] = (uint8_t)(piece | (piece << 4));
+  }
+  init_enc_info(&l->ei, &l->be, tb, 0, rnd_int(0, 3), enc);
+}
+
+// Distinct squares, with the pawns on ranks 2-7 and the leading pawn first.
+static void make_squares(struct Layout *l, int *p)
+{
+  uint64_t used = 0;
+  int pawns = l->be.pawns[0] + l->be.pawns[1];
+  for (int i = 0; i < l->be.num; i++) {
+    int sq;
+    do
+      sq = i < pawns ? rnd_int(8, 55) : rnd_int(0, 63);
+    while (used & (1ULL << sq));
+    used |= 1ULL << sq;
+    p[i] = sq;
+  }
+  if (l->enc != PIECE_ENC)
+    leading_pawn(p, &l->be, l->enc);
+}
+
+static int verify(struct Layout *l)
+{
+  int errors = 0;
+  for (int n = 0; n < POSITIONS; n++) {
+    int p[TB_PIECES], p1[TB_PIECES], p2[TB_PIECES];
+    make_squares(l, p);
+    memcpy(p1, p, sizeof(p));
+    memcpy(p2, p, sizeof(p));
+    size_t expect = encode(p1, &l->ei, &l->be, l->enc);
+    size_t idx = l->ei.encode(p2, &l->ei, &l->be);
+    if (idx != expect && errors++ < 10)
+      fprintf(stderr, "%d pieces, enc %d: index %zu, expected %zu\n",
+          l->be.num, l->enc, idx, expect);
+  }
+  return errors;
+}
+
+static void bench(struct Layout *l, int num, int enc)
+{
+  enum { SAMPLES = 1 << 12, ROUNDS = 256 };
+  static int squares[SAMPLES][TB_PIECES];
+  for (int n = 0; n < SAMPLES; n++)
+    make_squares(l, squares[n]);
+
+  size_t sum = 0;
+  double t[2];
+  for (int kind = 0; kind < 2; kind++) {
+    uint64_t t0 = now_ns();
+    for (int r = 0; r < ROUNDS; r++)
+      for (int n = 0; n < SAMPLES; n++) {
+        int p[TB_PIECES];
+        memcpy(p, squares[n], sizeof(p));
+        sum += kind == 0 ? encode(p, &l->ei, &l->be, l->enc)
+                         : l->ei.encode(p, &l->ei, &l->be);
+      }
+    t[kind] = (now_ns() - t0) / ((double)ROUNDS * SAMPLES);
+  }
+
+  static const char *encName[] = { "piece", "file", "rank" };
+  printf("%d pieces %-5s: generic %5.1f ns, specialized %5.1f ns [%u]\n", num,
+      encName[enc], t[0], t[1], (unsigned)(sum % 251));
+}
+
+int main(int argc, char **argv)
+{
+  bool doBench = argc > 1 && strcmp(argv[1], "bench") == 0;
+  int errors = 0;
+
+  tb_init("");
+
+  for (int num = 3; num <= TB_PIECES; num++)
+    for (int enc = PIECE_ENC; enc <= RANK_ENC; enc++) {
+      static struct Layout l;
+      for (int k = 0; k < LAYOUTS; k++) {
+        make_layout(&l, num, enc);
+        errors += verify(&l);
+      }
+      if (doBench)
+        bench(&l, num, enc);
+    }
+
+  tb_free();
+
+  if (errors)
+    return EXIT_FAILURE;
+  printf("all indices match\n");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,70 @@
+/*
+ * Plays random games from the initial position and checks after every move
+ * that the material key do_move() keeps up to date equals calc_key().
+ */
+
+#include "tbprobe.c"
+#include "tbtest.h"
+
+#define GAMES       2000
+#define MAX_PLIES   400
+
+static Pos initial_pos(void)
+{
+  Pos pos = {
+    0x000000000000FFFFULL, 0xFFFF000000000000ULL,
+    0x1000000000000010ULL, 0x0800000000000008ULL,
+    0x8100000000000081ULL, 0x2400000000000024ULL,
+    0x4200000000000042ULL, 0x00FF00000000FF00ULL,
+    0, 0, true, 0, NULL
+  };
+  pos.key = calc_key(&pos, false);
+  return pos;
+}
+
+int main(void)
+{
+  int errors = 0;
+  unsigned long captures = 0, promotions = 0, enPassant = 0, moves = 0;
+
+  tb_init("");
+
+  for (int g = 0; g < GAMES; g++) {
+    Pos pos = initial_pos();
+    for (int ply = 0; ply < MAX_PLIES; ply++) {
+      TbMove legal[TB_MAX_MOVES];
+      TbMove *end = gen_legal(&pos, legal);
+      if (end == legal || popcount(pos.white | pos.black) == 2)
+        break;
+
+      TbMove move = legal[rnd() % (uint64_t)(end - legal)];
+      Pos pos1;
+      do_move(&pos1, &pos, move);
+      moves++;
+      captures += is_capture(&pos, move);
+      promotions += move_promotes(move) != TB_PROMOTES_NONE;
+      enPassant += is_en_passant(&pos, move);
+
+      if (pos1.key != calc_key(&pos1, false) && errors++ < 10)
+        fprintf(stderr, "game %d ply %d: key 0x%016llx, expected 0x%016llx\n",
+            g, ply, (unsigned long long)pos1.key,
+            (unsigned long long)calc_key(&pos1, false));
+      pos = pos1;
+    }
+  }
+
+  tb_free();
+
+  printf("%lu moves, %lu captures, %lu promotions, %lu en passant\n", moves,
+      captures, promotions, enPassant);
+  if (errors) {
+    fprintf(stderr, "%d keys differ\n", errors);
+    return EXIT_FAILURE;
+  }
+  if (captures == 0 || promotions == 0 || enPassant == 0) {
+    fprintf(stderr, "not every kind of move was played\n");
+    return EXIT_FAILURE;
+  }
+  printf("all keys match\n");
+  return EXIT_SUCCESS;
+}
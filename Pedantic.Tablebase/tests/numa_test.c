@@ -0,0 +1,223 @@
+/*
+ * Copies WDL tables to every NUMA node and checks that a probe from each
+ * node returns what the mapped table holds for the same position.  On a
+ * machine with one node the test pretends there are two, which copies and
+ * probes the tables all the same.
+ *
+ *   numa_test                  verify the 3- and 4-piece tables
+ *   numa_test bench [pieces]   verify, then time probes from a thread
+ *                              pinned to each node, with and without the
+ *                              copies
+ *
+ * With TB_PATH the positions are random ones of the WDL tables there.
+ * Without it the test writes a KNvK table whose every position is a win
+ * and probes that.
+ */
+
+#ifdef __linux__
+#define _GNU_SOURCE
+#endif
+
+#include "tbprobe.c"
+#include "tbtest.h"
+
+#define POSITIONS   (1 << 14)
+#define ROUNDS      16      // benchmark passes over the positions
+
+// K(e1)+N(b1) v K(e8), white to move.
+static Pos knk(void)
+{
+  Pos pos;
+  memset(&pos, 0, sizeof(pos));
+  pos.white = board(4) | board(1);
+  pos.black = board(60);
+  pos.kings = board(4) | board(60);
+  pos.knights = board(1);
+  pos.turn = 1;
+  pos.key = calc_key(&pos, false);
+  return pos;
+}
+
+// Probe as if the calling thread ran on the given node.
+static int probe_on(struct TbContext *ctx, Pos *pos, int node, int *success)
+{
+  struct ThreadRecord *tr = thread_record();
+  *success = 1;
+  tr->node = node;
+  tr->nodeAge = 1;
+  pos->ctx = ctx;
+  return probe_table(pos, 0, success, WDL);
+}
+
+// Pin the calling thread to the processors of a node. Returns false if the
+// node has none, e.g. when the test pretends there are more nodes.
+static bool pin_to_node(unsigned node)
+{
+#if defined(__linux__)
+  char name[64], list[1024];
+  snprintf(name, sizeof(name), "/sys/devices/system/node/node%u/cpulist", node);
+  FILE *f = fopen(name, "r");
+  if (!f)
+    return false;
+  bool ok = fgets(list, sizeof(list), f) != NULL;
+  fclose(f);
+  if (!ok)
+    return false;
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (char *p = list; *p >= '0' && *p <= '9';) {
+    unsigned long first = strtoul(p, &p, 10), last = first;
+    if (*p == '-')
+      last = strtoul(p + 1, &p, 10);
+    for (unsigned long cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++)
+      CPU_SET(cpu, &set);
+    if (*p == ',')
+      p++;
+  }
+  return CPU_COUNT(&set) > 0 && sched_setaffinity(0, sizeof(set), &set) == 0;
+#elif defined(_WIN32)
+  GROUP_AFFINITY affinity;
+  return GetNumaNodeProcessorMaskEx((USHORT)node, &affinity)
+         && affinity.Mask != 0
+         && SetThreadGroupAffinity(GetCurrentThread(), &affinity, NULL);
+#else
+  (void)node;
+  return false;
+#endif
+}
+
+static Pos positions[POSITIONS];
+static int numPositions;
+
+static struct TbContext *benchCtx;
+static unsigned benchNode;
+static bool benchPinned;
+static double benchNs;
+
+THREAD_FUNC(bench_thread)
+{
+  (void)arg;
+  benchPinned = pin_to_node(benchNode);
+  unsigned sum = 0;
+  uint64_t t0 = now_ns();
+  for (int r = 0; r < ROUNDS; r++)
+    for (int i = 0; i < numPositions; i++) {
+      int success = 1;
+      Pos pos = positions[i];
+      pos.ctx = benchCtx;
+      sum += (unsigned)probe_table(&pos, 0, &success, WDL);
+    }
+  benchNs = (now_ns() - t0) / ((double)ROUNDS * numPositions);
+  if (sum == 0x12345678)
+    printf("\n");
+  THREAD_RETURN;
+}
+
+// Time per table lookup of a thread on the given node.
+static double latency(struct TbContext *ctx, unsigned node, bool *pinned)
+{
+  THREAD_T t;
+  benchCtx = ctx;
+  benchNode = node;
+  benchPinned = false;
+  benchNs = 0;
+  if (!THREAD_CREATE(t, bench_thread))
+    return 0;
+  THREAD_JOIN(t);
+  *pinned = benchPinned;
+  return benchNs;
+}
+
+int main(int argc, char **argv)
+{
+  bool doBench = argc > 1 && strcmp(argv[1], "bench") == 0;
+  unsigned pieces = doBench && argc > 2 ? (unsigned)atoi(argv[2]) : 4;
+  if (pieces < 3 || pieces > TB_PIECES)
+    pieces = 4;
+
+  const char *path = getenv("TB_PATH");
+  bool synthetic = !path || !*path;
+  if (synthetic) {
+    if (!write_knvk("numa_tables", 4)) {
+      fprintf(stderr, "cannot write the test table\n");
+      return EXIT_FAILURE;
+    }
+    path = "numa_tables";
+  }
+
+  unsigned realNodes = tb_set_numa(0);
+  if (realNodes < 2)
+    numaNodes = 2;
+
+  struct TbContext *plain = tb_context_create(path);
+  if (!plain || plain->largest < 3) {
+    printf("no tables under TB_PATH, skipping\n");
+    tb_context_free(plain);
+    return TEST_SKIPPED;
+  }
+
+  // Positions whose table the plain context has, which loads the tables
+  // there without copies.
+  unsigned extra = pieces - 2;
+  numPositions = synthetic ? 1 : POSITIONS;
+  for (int i = 0; i < numPositions;) {
+    Pos pos = synthetic ? knk() : random_pos(1 + (unsigned)(rnd() % extra));
+    int success = 1;
+    pos.ctx = plain;
+    probe_table(&pos, 0, &success, WDL);
+    if (success && pos.key != 0)
+      positions[i++] = pos;
+  }
+
+  tb_set_numa(pieces);
+  struct TbContext *copied = tb_context_create(path);
+  int errors = 0;
+  for (int i = 0; i < numPositions; i++)
+    // a node past the last one probes the mapping
+    for (unsigned node = 0; node <= numaNodes; node++) {
+      int s1, s2;
+      Pos pos = positions[i];
+      int v = probe_on(plain, &pos, (int)node, &s1);
+      int w = probe_on(copied, &pos, (int)node, &s2);
+      if ((!s1 || !s2 || v != w) && errors++ < 10)
+        fprintf(stderr, "0x%016llx, node %u: copy value %d, table value %d\n",
+            (unsigned long long)pos.key, node, w, v);
+    }
+
+  struct TbNumaStatus status;
+  tb_numa_status(&status);
+  printf("%u nodes%s, %u tables copied, %.1f MB\n", numaNodes,
+      realNodes < 2 ? " (pretended)" : "", status.tables,
+      status.bytes / (1024.0 * 1024.0));
+  if (status.tables == 0 || status.bytes == 0) {
+    fprintf(stderr, "no tables were copied\n");
+    errors++;
+  }
+
+  if (doBench) {
+    for (unsigned node = 0; node < numaNodes; node++) {
+      bool pinned = false;
+      double mapped = latency(plain, node, &pinned);
+      double local = latency(copied, node, &pinned);
+      printf("node %u%s: %8.1f ns/probe from the mapping, %8.1f from the "
+          "node's copy\n", node, pinned ? "" : " (not pinned)", mapped, local);
+    }
+  }
+
+  tb_context_free(plain);
+  tb_context_free(copied);
+  tb_numa_status(&status);
+  if (status.tables != 0 || status.bytes != 0) {
+    fprintf(stderr, "%u copies left after freeing the contexts\n",
+        status.tables);
+    errors++;
+  }
+  tb_set_numa(0);
+
+  if (errors) {
+    fprintf(stderr, "%d copy values differ from the tables\n", errors);
+    return EXIT_FAILURE;
+  }
+  printf("all copies match the tables\n");
+  return EXIT_SUCCESS;
+}
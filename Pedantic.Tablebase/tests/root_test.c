@@ -0,0 +1,162 @@
+/*
+ * Runs the root probes from many threads at once and checks every result
+ * against a serial run of the same positions.
+ *
+ *   root_test                  verify with 8 threads
+ *   root_test bench [threads]  verify, then time 1, 2, 4, ... threads
+ *
+ * Without TB_PATH the positions are K v K, which still takes every root
+ * probe through move generation and the WDL/DTZ probes. With TB_PATH the
+ * positions have up to TB_LARGEST pieces.
+ */
+
+#include "tbprobe.c"
+#include "tbtest.h"
+
+#define POSITIONS   2048
+#define ROUNDS      4       // passes over the positions per thread
+#define MAX_THREADS 64
+
+static Pos positions[POSITIONS];
+static uint64_t expected[POSITIONS];
+
+static unsigned numThreads;
+static atomic_uint nextThread;
+static atomic_uint errors;
+
+static uint64_t mix(uint64_t h, uint64_t x)
+{
+  h ^= x + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+  return h;
+}
+
+// All three root probes of one position folded into one value.
+static uint64_t probe_all(const Pos *pos, struct TbRootMoves *rm)
+{
+  unsigned results[TB_MAX_MOVES + 1];
+  uint64_t h = tb_probe_root_impl(pos->white, pos->black, pos->kings,
+      pos->queens, pos->rooks, pos->bishops, pos->knights, pos->pawns,
+      pos->rule50, pos->ep, pos->turn, results);
+  if (h != TB_RESULT_FAILED)
+    for (unsigned *r = results; *r != TB_RESULT_FAILED; r++)
+      h = mix(h, *r);
+
+  for (int kind = 0; kind < 2; kind++) {
+    int ok = kind == 0
+        ? tb_probe_root_dtz(pos->white, pos->black, pos->kings, pos->queens,
+            pos->rooks, pos->bishops, pos->knights, pos->pawns, pos->rule50,
+            0, pos->ep, pos->turn, false, true, rm)
+        : tb_probe_root_wdl(pos->white, pos->black, pos->kings, pos->queens,
+            pos->rooks, pos->bishops, pos->knights, pos->pawns, pos->rule50,
+            0, pos->ep, pos->turn, true, rm);
+    h = mix(h, (uint64_t)ok);
+    if (!ok)
+      continue;
+    h = mix(h, rm->size);
+    for (unsigned i = 0; i < rm->size; i++) {
+      const struct TbRootMove *m = &rm->moves[i];
+      h = mix(h, m->move);
+      h = mix(h, (uint64_t)(uint32_t)m->tbRank << 32 | (uint32_t)m->tbScore);
+      for (unsigned k = 0; k < m->pvSize; k++)
+        h = mix(h, m->pv[k]);
+    }
+  }
+  return h;
+}
+
+THREAD_FUNC(probe_thread)
+{
+  (void)arg;
+  unsigned t = atomic_fetch_add(&nextThread, 1);
+  struct TbRootMoves *rm = (struct TbRootMoves *)malloc(sizeof(*rm));
+
+  // Every thread probes every position, each starting at its own offset.
+  for (unsigned n = 0; n < ROUNDS * POSITIONS; n++) {
+    unsigned i = (n + t * (POSITIONS / numThreads)) % POSITIONS;
+    uint64_t h = probe_all(&positions[i], rm);
+    if (h != expected[i] && atomic_fetch_add(&errors, 1) < 10)
+      fprintf(stderr, "thread %u, position %u: 0x%016llx, expected 0x%016llx\n",
+          t, i, (unsigned long long)h, (unsigned long long)expected[i]);
+  }
+
+  free(rm);
+  THREAD_RETURN;
+}
+
+// Returns the time taken in nanoseconds.
+static double run_threads(unsigned threads)
+{
+  THREAD_T t[MAX_THREADS];
+  numThreads = threads;
+  atomic_store(&nextThread, 0);
+  uint64_t t0 = now_ns();
+  unsigned started = 0;
+  for (; started < threads; started++)
+    if (!THREAD_CREATE(t[started], probe_thread)) {
+      fprintf(stderr, "cannot start thread %u\n", started);
+      atomic_fetch_add(&errors, 1);
+      break;
+    }
+  for (unsigned i = 0; i < started; i++)
+    THREAD_JOIN(t[i]);
+  return now_ns() - t0;
+}
+
+int main(int argc, char **argv)
+{
+  bool doBench = argc > 1 && strcmp(argv[1], "bench") == 0;
+  unsigned maxThreads = doBench && argc > 2 ? (unsigned)atoi(argv[2]) : 8;
+  if (maxThreads < 1 || maxThreads > MAX_THREADS)
+    maxThreads = 8;
+
+  const char *path = getenv("TB_PATH");
+  tb_init(path && *path ? path : "");
+  unsigned extra = TB_LARGEST > 2 ? TB_LARGEST - 2 : 0;
+  if (extra > 3)
+    extra = 3;
+
+  struct TbRootMoves *rm = (struct TbRootMoves *)malloc(sizeof(*rm));
+  for (int i = 0; i < POSITIONS; i++) {
+    // kings plus up to `extra' other pieces
+    positions[i] = random_pos(extra ? (unsigned)(rnd() % (extra + 1)) : 0);
+    expected[i] = probe_all(&positions[i], rm);
+  }
+  free(rm);
+
+  // once as configured, once more with the WDL cache shared by the threads
+  run_threads(maxThreads);
+  tb_set_wdl_cache(1);
+  run_threads(maxThreads);
+  tb_set_wdl_cache(0);
+
+  // The second run must have taken over the records of the first.
+  unsigned records = 0;
+  for (struct ThreadRecord *tr = atomic_load(&threadRecords); tr; tr = tr->next)
+    records++;
+  if (records > maxThreads + 1) {
+    fprintf(stderr, "%u thread records for %u threads\n", records, maxThreads);
+    atomic_fetch_add(&errors, 1);
+  }
+
+  if (doBench) {
+    double base = 0;
+    for (unsigned threads = 1; threads <= maxThreads; threads *= 2) {
+      double ns = run_threads(threads);
+      double rate = threads * (double)ROUNDS * POSITIONS / (ns / 1e9);
+      if (threads == 1)
+        base = rate;
+      printf("%2u threads: %10.0f positions/s, speedup %5.2f\n", threads, rate,
+          rate / base);
+    }
+  }
+
+  tb_free();
+
+  if (atomic_load(&errors)) {
+    fprintf(stderr, "%u results differ from the serial run\n",
+        atomic_load(&errors));
+    return EXIT_FAILURE;
+  }
+  printf("all %u-thread results match the serial run\n", maxThreads);
+  return EXIT_SUCCESS;
+}
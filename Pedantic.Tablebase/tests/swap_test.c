@@ -0,0 +1,131 @@
+/*
+ * Swaps the default tables back and forth with tb_init while other threads
+ * keep probing them.  The tables are written by the test: KNvK files whose
+ * every position is a draw in one directory and a (bogus) win in the other.
+ * A probe may see either set while tb_init runs, but must never fail, and
+ * once tb_init has returned every new probe must see the new set.  The
+ * last run also resizes the WDL cache between the swaps.
+ *
+ *   swap_test              verify with 4 threads
+ *   swap_test [threads]    verify with the given number of threads
+ */
+
+#include "tbprobe.c"
+#include "tbtest.h"
+
+#define SWAPS       100
+#define MAX_THREADS 64
+
+// tb_init calls begun and returned. Even counts have the draw tables.
+static atomic_uint begun, done;
+static atomic_bool stop;
+static atomic_uint errors;
+static atomic_ulong probes;
+
+// K(e1)+N(b1) v K(e8), white to move.
+static const struct TbPosition knk = {
+  0x12, 0x1000000000000000ULL, 0x1000000000000010ULL, 0, 0, 0, 0x2, 0,
+  0, 0, 0, 1
+};
+
+static unsigned wdl_of(unsigned swaps)
+{
+  return swaps % 2 == 0 ? TB_DRAW : TB_WIN;
+}
+
+THREAD_FUNC(probe_thread)
+{
+  (void)arg;
+  unsigned n = 0;
+  while (!atomic_load(&stop)) {
+    unsigned before = atomic_load(&done);
+    unsigned result;
+    if (n++ & 1) {
+      unsigned results[1];
+      tb_probe_wdl_batch(&knk, results, 1);
+      result = results[0];
+    } else
+      result = tb_probe_wdl(knk.white, knk.black, knk.kings, knk.queens,
+          knk.rooks, knk.bishops, knk.knights, knk.pawns, 0, 0, 0, true);
+    // Unless a swap began meanwhile, only the tables of the last completed
+    // tb_init may answer.
+    bool swapped = atomic_load(&begun) != before;
+    if (result != wdl_of(before) && (!swapped || result != wdl_of(before + 1))
+        && atomic_fetch_add(&errors, 1) < 10)
+      fprintf(stderr, "probe returned %u after %u swaps\n", result, before);
+    atomic_fetch_add(&probes, 1ul);
+  }
+  THREAD_RETURN;
+}
+
+// Returns false if a swap went wrong.
+static bool run(unsigned threads, bool resizeCache)
+{
+  THREAD_T t[MAX_THREADS];
+
+  tb_init("swap_draw");
+  atomic_store(&begun, 0u);
+  atomic_store(&done, 0u);
+  atomic_store(&stop, false);
+  unsigned started = 0;
+  for (; started < threads; started++)
+    if (!THREAD_CREATE(t[started], probe_thread)) {
+      fprintf(stderr, "cannot start thread %u\n", started);
+      atomic_fetch_add(&errors, 1);
+      break;
+    }
+
+  for (unsigned i = 1; i <= SWAPS; i++) {
+    if (resizeCache)
+      tb_set_wdl_cache(1 + (i & 1));
+    atomic_store(&begun, i);
+    tb_init(wdl_of(i) == TB_WIN ? "swap_win" : "swap_draw");
+    if (TB_LARGEST != 3 && atomic_fetch_add(&errors, 1) < 10)
+      fprintf(stderr, "TB_LARGEST is %u\n", TB_LARGEST);
+    atomic_store(&done, i);
+    // let the threads probe the new tables for a while
+    unsigned long n = atomic_load(&probes);
+    while (started && atomic_load(&probes) < n + 4 * started)
+      TB_YIELD();
+  }
+
+  atomic_store(&stop, true);
+  for (unsigned i = 0; i < started; i++)
+    THREAD_JOIN(t[i]);
+  tb_free();
+
+  struct TbResidency residency;
+  tb_residency(&residency);
+  if (residency.tables != 0) {
+    fprintf(stderr, "%u tables still mapped\n", residency.tables);
+    return false;
+  }
+  return atomic_load(&errors) == 0;
+}
+
+int main(int argc, char **argv)
+{
+  unsigned threads = argc > 1 ? (unsigned)atoi(argv[1]) : 4;
+  if (threads < 1 || threads > MAX_THREADS)
+    threads = 4;
+
+  if (!write_knvk("swap_draw", 2) || !write_knvk("swap_win", 4)) {
+    fprintf(stderr, "cannot write the test tables\n");
+    return EXIT_FAILURE;
+  }
+
+  // once without and once with the WDL cache in front of the tables, then
+  // with a cache that keeps changing size
+  bool ok = run(threads, false);
+  tb_set_wdl_cache(1);
+  ok = run(threads, false) && ok;
+  ok = run(threads, true) && ok;
+
+  if (!ok) {
+    fprintf(stderr, "%u probes went wrong\n", atomic_load(&errors));
+    return EXIT_FAILURE;
+  }
+  printf("%lu probes across %d swaps, all as expected\n",
+      atomic_load(&probes), 3 * SWAPS);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,315 @@
+/*
+ * Smoke tests for the native prober library.  Everything except the tests at
+ * the end runs without table files; set TB_PATH to a Syzygy directory that
+ * holds at least the 3-piece tables to run those as well.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "tbprobe.h"
+
+#define SQ(f, r)    ((f) + 8 * (r))
+#define BB(sq)      (1ULL << (sq))
+
+static int failures = 0;
+
+#define CHECK(cond)                                                         \
+  do {                                                                      \
+    if (!(cond)) {                                                          \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__,      \
+          #cond);                                                           \
+      failures++;                                                           \
+    }                                                                       \
+  } while (0)
+
+// K(e1)+Q(d1) v K(e8), or just the kings if queen is false.
+static struct TbPosition make_pos(bool queen, bool wtm)
+{
+  uint64_t wk = BB(SQ(4, 0)), bk = BB(SQ(4, 7));
+  uint64_t q = queen ? BB(SQ(3, 0)) : 0;
+  struct TbPosition pos = {
+    wk | q, bk, wk | bk, q, 0, 0, 0, 0, 0, 0, 0, wtm ? 1u : 0u
+  };
+  return pos;
+}
+
+static unsigned probe(const struct TbPosition *pos)
+{
+  return tb_probe_wdl(pos->white, pos->black, pos->kings, pos->queens,
+      pos->rooks, pos->bishops, pos->knights, pos->pawns, pos->rule50,
+      pos->castling, pos->ep, pos->turn != 0);
+}
+
+static void test_no_tables(void)
+{
+  CHECK(tb_init("/nonexistent/syzygy"));
+  CHECK(TB_LARGEST == 0);
+
+  // K v K is a draw without any table
+  struct TbPosition kk = make_pos(false, true);
+  CHECK(probe(&kk) == TB_DRAW);
+  kk.turn = 0;
+  CHECK(probe(&kk) == TB_DRAW);
+
+  // castling rights and a non-zero clock are rejected up front
+  kk.castling = TB_CASTLING_K;
+  CHECK(probe(&kk) == TB_RESULT_FAILED);
+  kk.castling = 0;
+  kk.rule50 = 10;
+  CHECK(probe(&kk) == TB_RESULT_FAILED);
+
+  struct TbPosition kqk = make_pos(true, true);
+  CHECK(probe(&kqk) == TB_RESULT_FAILED);
+}
+
+static void test_batch(void)
+{
+  struct TbPosition positions[4] = {
+    make_pos(false, true), make_pos(true, true),
+    make_pos(false, false), make_pos(true, false)
+  };
+  unsigned results[4];
+
+  CHECK(tb_probe_wdl_batch(positions, results, 4) == 2);
+  for (int i = 0; i < 4; i++)
+    CHECK(results[i] == probe(&positions[i]));
+  CHECK(tb_probe_wdl_batch(positions, results, 0) == 0);
+}
+
+static uint64_t material_key(const struct TbPosition *pos)
+{
+  return tb_material_key(pos->white, pos->black, pos->queens, pos->rooks,
+      pos->bishops, pos->knights, pos->pawns);
+}
+
+static unsigned probe_key(const struct TbPosition *pos)
+{
+  return tb_probe_wdl_key(pos->white, pos->black, pos->kings, pos->queens,
+      pos->rooks, pos->bishops, pos->knights, pos->pawns, pos->rule50,
+      pos->castling, pos->ep, pos->turn != 0, material_key(pos));
+}
+
+static void test_key(void)
+{
+  struct TbPosition kk = make_pos(false, true), kqk = make_pos(true, true);
+
+  // kings count nothing, and the key is a sum over the pieces
+  CHECK(material_key(&kk) == 0);
+  uint64_t q = BB(SQ(3, 0)), q2 = BB(SQ(2, 0));
+  CHECK(tb_material_key(q | q2, 0, q | q2, 0, 0, 0, 0) ==
+      2 * tb_material_key(q, 0, q, 0, 0, 0, 0));
+  CHECK(tb_material_key(q, 0, q, 0, 0, 0, 0) != tb_material_key(0, q, q, 0, 0, 0, 0));
+
+  CHECK(probe_key(&kk) == probe(&kk));
+  CHECK(probe_key(&kqk) == probe(&kqk));
+  kk.rule50 = 1;
+  CHECK(probe_key(&kk) == TB_RESULT_FAILED);
+}
+
+static void prefetch(const struct TbPosition *pos)
+{
+  tb_prefetch(pos->white, pos->black, pos->kings, pos->queens, pos->rooks,
+      pos->bishops, pos->knights, pos->pawns, pos->ep, pos->turn != 0);
+  tb_prefetch_key(pos->white, pos->black, pos->kings, pos->queens, pos->rooks,
+      pos->bishops, pos->knights, pos->pawns, pos->ep, pos->turn != 0,
+      material_key(pos));
+}
+
+static void test_prefetch(void)
+{
+  // a prefetch never fails and never changes what a probe returns
+  struct TbPosition kk = make_pos(false, true), kqk = make_pos(true, false);
+  prefetch(&kk);
+  prefetch(&kqk);
+  CHECK(probe(&kk) == TB_DRAW);
+  CHECK(probe(&kqk) == TB_RESULT_FAILED);
+
+  CHECK(tb_set_wdl_cache(1));
+  prefetch(&kk);
+  prefetch(&kqk);
+  CHECK(probe(&kk) == TB_DRAW);
+  CHECK(tb_set_wdl_cache(0));
+}
+
+static void test_cache(void)
+{
+  struct TbPosition positions[2] = { make_pos(false, true), make_pos(true, true) };
+  unsigned results[2];
+
+  CHECK(tb_set_wdl_cache(1));
+  for (int pass = 0; pass < 2; pass++) {
+    CHECK(probe(&positions[0]) == TB_DRAW);
+    CHECK(probe(&positions[1]) == TB_RESULT_FAILED);
+    CHECK(tb_probe_wdl_batch(positions, results, 2) == 1);
+    CHECK(results[0] == TB_DRAW && results[1] == TB_RESULT_FAILED);
+  }
+  tb_clear_wdl_cache();
+  CHECK(probe(&positions[0]) == TB_DRAW);
+  CHECK(tb_set_wdl_cache(0));
+}
+
+static void test_warmup(void)
+{
+  struct TbWarmupStatus status;
+
+  CHECK(tb_warmup(5, 16));
+  tb_warmup_stop();
+  tb_warmup_status(&status);
+  CHECK(!status.running && !status.cancelled);
+  CHECK(status.total == 0 && status.done == 0);
+}
+
+static void test_residency(void)
+{
+  struct TbResidency residency;
+
+  tb_set_residency_budget(64);
+  tb_residency(&residency);
+  CHECK(residency.budget == 64ULL * 1024 * 1024);
+  CHECK(residency.tables == 0 && residency.resident == 0);
+  tb_set_residency_budget(0);
+  tb_residency(&residency);
+  CHECK(residency.budget == 0);
+}
+
+static void test_stats(void)
+{
+#ifdef TB_STATS
+  CHECK(tb_stats_enabled());
+#else
+  CHECK(!tb_stats_enabled());
+  CHECK(tb_get_stats(NULL, 0) == 0);
+#endif
+  tb_reset_stats();
+}
+
+static void test_root(void)
+{
+  static struct TbRootMoves rm;
+  struct TbPosition kk = make_pos(false, true);
+
+  // every root move carries a PV that starts with the move itself
+  CHECK(tb_probe_root_wdl(kk.white, kk.black, kk.kings, kk.queens, kk.rooks,
+      kk.bishops, kk.knights, kk.pawns, 0, 0, 0, true, true, &rm));
+  CHECK(rm.size == 5);
+  for (unsigned i = 0; i < rm.size; i++) {
+    CHECK(rm.moves[i].pvSize == 1);
+    CHECK(rm.moves[i].pv[0] == rm.moves[i].move);
+    CHECK(rm.moves[i].tbRank == 0);
+  }
+}
+
+static unsigned probe_dtm(const struct TbPosition *pos, int *plies)
+{
+  return tb_probe_dtm(pos->white, pos->black, pos->kings, pos->queens,
+      pos->rooks, pos->bishops, pos->knights, pos->pawns, pos->rule50,
+      pos->castling, pos->ep, pos->turn != 0, plies);
+}
+
+static void test_dtm(void)
+{
+  static struct TbRootMoves rm;
+  int plies = -1;
+
+  CHECK(TB_LARGEST_DTM == 0);
+
+  // K v K, checkmate and stalemate need no table
+  struct TbPosition kk = make_pos(false, true);
+  CHECK(probe_dtm(&kk, &plies) == TB_DRAW && plies == 0);
+  uint64_t wk = BB(SQ(6, 5)), q = BB(SQ(6, 6)), bk = BB(SQ(7, 7));
+  struct TbPosition mate = { wk | q, bk, wk | bk, q, 0, 0, 0, 0, 0, 0, 0, 0 };
+  plies = -1;
+  CHECK(probe_dtm(&mate, &plies) == TB_LOSS && plies == 0);
+  struct TbPosition stalemate = mate;
+  stalemate.white = wk | BB(SQ(5, 6));
+  stalemate.queens = BB(SQ(5, 6));
+  CHECK(probe_dtm(&stalemate, &plies) == TB_DRAW);
+
+  struct TbPosition kqk = make_pos(true, true);
+  CHECK(probe_dtm(&kqk, &plies) == TB_RESULT_FAILED);
+  kqk.castling = TB_CASTLING_K;
+  CHECK(probe_dtm(&kqk, &plies) == TB_RESULT_FAILED);
+
+  // drawn root moves keep a zero score and a one move PV
+  CHECK(tb_probe_root_dtm(kk.white, kk.black, kk.kings, kk.queens, kk.rooks,
+      kk.bishops, kk.knights, kk.pawns, 0, 0, 0, true, false, true, &rm));
+  CHECK(rm.size == 5);
+  for (unsigned i = 0; i < rm.size; i++)
+    CHECK(rm.moves[i].tbScore == 0 && rm.moves[i].pvSize == 1);
+  CHECK(!tb_probe_root_dtm(kqk.white, kqk.black, kqk.kings, kqk.queens,
+      kqk.rooks, kqk.bishops, kqk.knights, kqk.pawns, 0, 0, 0, true, false,
+      true, &rm));
+}
+
+static void test_tables(const char *path)
+{
+  CHECK(tb_init(path));
+  CHECK(TB_LARGEST >= 3);
+
+  struct TbPosition kqk = make_pos(true, true);
+  CHECK(probe(&kqk) == TB_WIN);
+  kqk.turn = 0;
+  CHECK(probe(&kqk) == TB_LOSS);
+
+  struct TbPosition positions[2] = { make_pos(true, true), make_pos(true, false) };
+  unsigned results[2];
+  CHECK(tb_probe_wdl_batch(positions, results, 2) == 2);
+  CHECK(results[0] == TB_WIN && results[1] == TB_LOSS);
+  prefetch(&positions[0]);
+  CHECK(probe(&positions[0]) == TB_WIN);
+  CHECK(probe_key(&positions[0]) == TB_WIN);
+
+  kqk.turn = 1;
+  unsigned root = tb_probe_root(kqk.white, kqk.black, kqk.kings, kqk.queens,
+      kqk.rooks, kqk.bishops, kqk.knights, kqk.pawns, 0, 0, 0, true, NULL);
+  CHECK(root != TB_RESULT_FAILED);
+  CHECK(TB_GET_WDL(root) == TB_WIN);
+
+  if (TB_LARGEST_DTM >= 3) {
+    // every move of the expanded PV keeps the mate distance exact
+    static struct TbRootMoves rm;
+    int plies;
+    CHECK(probe_dtm(&kqk, &plies) == TB_WIN && plies > 0);
+    CHECK(tb_probe_root_dtm(kqk.white, kqk.black, kqk.kings, kqk.queens,
+        kqk.rooks, kqk.bishops, kqk.knights, kqk.pawns, 0, 0, 0, true, false,
+        true, &rm));
+    int best = 0;
+    for (unsigned i = 0; i < rm.size; i++)
+      if (rm.moves[i].tbScore > best)
+        best = rm.moves[i].tbScore;
+    CHECK(best == TB_VALUE_MATE - plies);
+    for (unsigned i = 0; i < rm.size; i++)
+      if (rm.moves[i].tbScore == best)
+        CHECK(rm.moves[i].pvSize == (unsigned)plies);
+  }
+}
+
+int main(void)
+{
+  test_no_tables();
+  test_batch();
+  test_root();
+  test_dtm();
+  test_key();
+  test_prefetch();
+  test_cache();
+  test_warmup();
+  test_residency();
+  test_stats();
+
+  const char *path = getenv("TB_PATH");
+  if (path && *path)
+    test_tables(path);
+  else
+    printf("TB_PATH not set, skipping the table tests\n");
+
+  tb_free();
+
+  if (failures) {
+    fprintf(stderr, "%d check(s) failed\n", failures);
+    return EXIT_FAILURE;
+  }
+  printf("all checks passed\n");
+  return EXIT_SUCCESS;
+}
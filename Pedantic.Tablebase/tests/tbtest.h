@@ -0,0 +1,120 @@
+/*
+ * Helpers shared by the tests and tbprobebench: a random number generator,
+ * a nanosecond clock, and writers for the small table files that the tests
+ * make up for themselves.
+ */
+
+#ifndef TBTEST_H
+#define TBTEST_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#define make_dir(d) _mkdir(d)
+#else
+#include <sys/stat.h>
+#define make_dir(d) mkdir(d, 0755)
+#endif
+
+#define TEST_TABLE_SIZE 80  // table files are 64 * n + 16 bytes long
+#define TEST_SKIPPED    77  // exit code of a test without the tables it needs
+
+// xorshift64*, the same sequence in every test unless it is reseeded
+static uint64_t rngState = 0x9e3779b97f4a7c15ULL;
+
+static inline uint64_t rnd(void)
+{
+  rngState ^= rngState >> 12;
+  rngState ^= rngState << 25;
+  rngState ^= rngState >> 27;
+  return rngState * 0x2545f4914f6cdd1dULL;
+}
+
+static inline uint64_t now_ns(void)
+{
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// Write size bytes of data to dir/file, making dir if need be.
+static inline bool write_file(const char *dir, const char *file,
+    const void *data, size_t size)
+{
+  char name[256];
+  make_dir(dir);
+  snprintf(name, sizeof(name), "%s/%s", dir, file);
+  FILE *f = fopen(name, "wb");
+  if (!f)
+    return false;
+  bool ok = fwrite(data, 1, size, f) == size;
+  return fclose(f) == 0 && ok;
+}
+
+// A split KNvK WDL table where both sides to move have the constant value
+// wdl (0 = loss ... 4 = win).
+static inline void knvk_table(unsigned char data[TEST_TABLE_SIZE],
+    unsigned char wdl)
+{
+  static const unsigned char header[] = {
+    0x71, 0xe8, 0x23, 0x5d,     // magic
+    0x01,                       // split
+    0x00, 0x66, 0xee, 0x22,     // order, then white king, black king, knight
+    0x00,                       // padding to an even offset
+    0x80, 0x00, 0x80, 0x00      // two single-value blocks
+  };
+  for (size_t i = 0; i < TEST_TABLE_SIZE; i++)
+    data[i] = i < sizeof(header) ? header[i] : 0;
+  data[11] = data[13] = wdl;
+}
+
+// dir/KNvK.rtbw as made by knvk_table().
+static inline bool write_knvk(const char *dir, unsigned char wdl)
+{
+  unsigned char data[TEST_TABLE_SIZE];
+  knvk_table(data, wdl);
+  return write_file(dir, "KNvK.rtbw", data, sizeof(data));
+}
+
+// For the files that include tbprobe.c, which defines TB_PIECES and Pos.
+#ifdef TB_PIECES
+// Kings plus `extra' other pieces, with the side not to move not in check.
+static inline Pos random_pos(unsigned extra)
+{
+  for (;;) {
+    Pos pos;
+    memset(&pos, 0, sizeof(pos));
+    uint64_t occ = 0;
+    for (unsigned i = 0; i < extra + 2; i++) {
+      unsigned type = i < 2 ? KING : (unsigned)(rnd() % 5) + PAWN;
+      unsigned sq;
+      do
+        sq = type == PAWN ? 8 + (unsigned)(rnd() % 48) : (unsigned)(rnd() % 64);
+      while (occ & board(sq));
+      occ |= board(sq);
+      if (i == 0 || (i > 1 && (rnd() & 1)))
+        pos.white |= board(sq);
+      else
+        pos.black |= board(sq);
+      switch (type) {
+        case KING:   pos.kings |= board(sq); break;
+        case QUEEN:  pos.queens |= board(sq); break;
+        case ROOK:   pos.rooks |= board(sq); break;
+        case BISHOP: pos.bishops |= board(sq); break;
+        case KNIGHT: pos.knights |= board(sq); break;
+        default:     pos.pawns |= board(sq); break;
+      }
+    }
+    pos.turn = rnd() & 1;
+    pos.key = calc_key(&pos, false);
+    if (is_valid(&pos) && is_legal(&pos))
+      return pos;
+  }
+}
+#endif
+
+#endif
@@ -0,0 +1,231 @@
+/*
+ * Checks tb_verify on table files written by the test: a good KNvK table and
+ * copies of it with a wrong magic number, the pieces of another ending and
+ * too few bytes, each in a directory of its own.  The checksum list, the
+ * MD5 and the index and size table checks are tested on their own as well.
+ *
+ * With TB_PATH every table file there is checked as well, against the
+ * md5sum list TB_CHECKSUMS if that is set, and the bad files and the
+ * throughput are printed.
+ */
+
+#include "tbprobe.c"
+#include "tbtest.h"
+
+static int failures = 0;
+
+#define CHECK(cond)                                                         \
+  do {                                                                      \
+    if (!(cond)) {                                                          \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__,      \
+          #cond);                                                           \
+      failures++;                                                           \
+    }                                                                       \
+  } while (0)
+
+// A split KNvK WDL table where every position is a win, see knvk_table().
+static uint8_t knvk[TEST_TABLE_SIZE];
+
+static void md5_hex(const void *data, size_t size, char hex[33])
+{
+  struct Md5 m;
+  uint8_t digest[16];
+  md5_init(&m);
+  md5_update(&m, (const uint8_t *)data, size);
+  md5_final(&m, digest);
+  for (int i = 0; i < 16; i++)
+    snprintf(hex + 2 * i, 3, "%02x", digest[i]);
+}
+
+static void test_md5(void)
+{
+  char hex[33];
+  md5_hex("", 0, hex);
+  CHECK(!strcmp(hex, "d41d8cd98f00b204e9800998ecf8427e"));
+  md5_hex("abc", 3, hex);
+  CHECK(!strcmp(hex, "900150983cd24fb0d6963f7d28e17f72"));
+
+  // a million bytes fed in uneven pieces
+  static uint8_t a[1000000];
+  memset(a, 'a', sizeof(a));
+  struct Md5 m;
+  uint8_t digest[16];
+  md5_init(&m);
+  for (size_t at = 0, n = 1; at < sizeof(a); at += n, n = n * 3 % 1021 + 1)
+    md5_update(&m, a + at, at + n > sizeof(a) ? sizeof(a) - at : n);
+  md5_final(&m, digest);
+  for (int i = 0; i < 16; i++)
+    snprintf(hex + 2 * i, 3, "%02x", digest[i]);
+  CHECK(!strcmp(hex, "7707d6ae4e027c70eea2a935c2296f21"));
+}
+
+// The status tb_verify gives the only table file under dir.
+static unsigned verify_one(const char *dir, const char *checksums,
+    struct TbVerifyResult *r)
+{
+  memset(r, 0, sizeof(*r));
+  size_t n = tb_verify(dir, checksums, 2, r, 1);
+  CHECK(n == 1);
+  return n == 1 ? r->status : 0xff;
+}
+
+static void test_files(void)
+{
+  struct TbVerifyResult r;
+  uint8_t data[TEST_TABLE_SIZE];
+
+  CHECK(verify_one("verify_good", NULL, &r) == TB_VERIFY_OK);
+  CHECK(!strcmp(r.name, "KNvK.rtbw"));
+  CHECK(r.bytes == TEST_TABLE_SIZE && !r.checksummed);
+
+  memcpy(data, knvk, sizeof(data));
+  data[0] = 0xd7;               // the magic number of DTZ
+  CHECK(write_file("verify_magic", "KNvK.rtbw", data, sizeof(data)));
+  CHECK(verify_one("verify_magic", NULL, &r) == TB_VERIFY_MAGIC);
+
+  memcpy(data, knvk, sizeof(data));
+  data[8] = 0x44;               // a rook for the knight
+  CHECK(write_file("verify_pieces", "KNvK.rtbw", data, sizeof(data)));
+  CHECK(verify_one("verify_pieces", NULL, &r) == TB_VERIFY_HEADER);
+
+  // files of the wrong size are found and reported, not skipped
+  CHECK(write_file("verify_short", "KNvK.rtbw", knvk, 40));
+  CHECK(verify_one("verify_short", NULL, &r) == TB_VERIFY_TRUNCATED);
+  CHECK(r.bytes == 40);
+  CHECK(write_file("verify_short", "KNvK.rtbw", knvk, 3));
+  CHECK(verify_one("verify_short", NULL, &r) == TB_VERIFY_TRUNCATED);
+
+  // nothing to check
+  CHECK(tb_verify("/nonexistent/syzygy", NULL, 2, &r, 1) == 0);
+}
+
+static void test_checksums(void)
+{
+  struct TbVerifyResult r, two[2];
+  char hex[33], line[128];
+
+  // only the file name of the list counts
+  md5_hex(knvk, sizeof(knvk), hex);
+  snprintf(line, sizeof(line), "%s  syzygy/3-4-5/KNvK.rtbw\n", hex);
+  CHECK(write_file("verify_sums", "good.md5", line, strlen(line)));
+  CHECK(verify_one("verify_good", "verify_sums/good.md5", &r) == TB_VERIFY_OK);
+  CHECK(r.checksummed);
+
+  // a listed file that is not there fails after the files found
+  snprintf(line, sizeof(line), "0123456789abcdef0123456789abcdef  KQvK.rtbw\n"
+      "%s  KNvK.rtbw\n", hex);
+  CHECK(write_file("verify_sums", "more.md5", line, strlen(line)));
+  memset(two, 0, sizeof(two));
+  CHECK(tb_verify("verify_good", "verify_sums/more.md5", 2, two, 2) == 2);
+  CHECK(!strcmp(two[0].name, "KNvK.rtbw") && two[0].status == TB_VERIFY_OK);
+  CHECK(!strcmp(two[1].name, "KQvK.rtbw")
+      && two[1].status == TB_VERIFY_UNREADABLE && two[1].checksummed);
+
+  hex[0] = hex[0] == '0' ? '1' : '0';
+  snprintf(line, sizeof(line), "%s *KNvK.rtbw\n", hex);
+  CHECK(write_file("verify_sums", "bad.md5", line, strlen(line)));
+  CHECK(verify_one("verify_good", "verify_sums/bad.md5", &r)
+      == TB_VERIFY_CHECKSUM);
+  CHECK(r.checksummed);
+
+  // a missing list checks no checksums
+  CHECK(verify_one("verify_good", "verify_sums/none.md5", &r)
+      == TB_VERIFY_OK);
+  CHECK(!r.checksummed);
+}
+
+// Index entries of 4 values each, two blocks of which one is real.
+static unsigned check_blocks(uint32_t block, uint16_t values)
+{
+  uint8_t data[16] = { 0 };
+  data[0] = (uint8_t)block;
+  data[6] = 0;
+  data[12] = (uint8_t)(values - 1);
+  data[13] = (uint8_t)((values - 1) >> 8);
+  CHECK(write_file("verify_blocks", "KNvK.rtbw", data, sizeof(data)));
+
+  char *paths[1] = { (char *)"verify_blocks" };
+  struct TbDirIndex index;
+  memset(&index, 0, sizeof(index));
+  FD fd = open_tb(paths, 1, &index, "KNvK", ".rtbw");
+  CHECK(fd != FD_ERR);
+  if (fd == FD_ERR)
+    return TB_VERIFY_UNREADABLE;
+
+  struct VerifyPairs p;
+  memset(&p, 0, sizeof(p));
+  p.tbSize = 8;
+  p.idxBits = 2;
+  p.numBlocks = 2;
+  p.realNumBlocks = 1;
+  p.index = 0;
+  p.sizes = 12;
+  static uint8_t buf[TB_VERIFY_CHUNK];
+  unsigned status = verify_blocks(fd, &p, buf);
+  close_tb(fd);
+  return status;
+}
+
+static void test_blocks(void)
+{
+  CHECK(check_blocks(0, 8) == TB_VERIFY_OK);
+  CHECK(check_blocks(1, 8) == TB_VERIFY_OK);
+  CHECK(check_blocks(2, 8) == TB_VERIFY_BLOCKS);
+  CHECK(check_blocks(0, 7) == TB_VERIFY_BLOCKS);
+}
+
+static const char *statusNames[] = {
+  "ok", "unreadable", "magic", "header", "truncated", "blocks", "checksum"
+};
+
+static void verify_path(const char *path)
+{
+  size_t size = 8192;         // more than the 7-piece set has files
+  struct TbVerifyResult *results =
+      (struct TbVerifyResult *)calloc(size, sizeof(*results));
+  unsigned threads = 8;
+  uint64_t start = now_micros();
+  size_t n = tb_verify(path, getenv("TB_CHECKSUMS"), threads, results, size);
+  if (n > size)
+    n = size;
+  double seconds = (now_micros() - start) / 1e6;
+
+  uint64_t bytes = 0;
+  int bad = 0;
+  for (size_t i = 0; i < n; i++) {
+    bytes += results[i].bytes;
+    if (results[i].status != TB_VERIFY_OK) {
+      bad++;
+      printf("%-16s %s\n", results[i].name, statusNames[results[i].status]);
+    }
+  }
+  printf("%zu files, %d bad, %.1f MB in %.2f s with %u threads, %.0f MB/s\n",
+      n, bad, bytes / (1024.0 * 1024.0), seconds, threads,
+      bytes / (1024.0 * 1024.0) / (seconds > 0 ? seconds : 1e-6));
+  free(results);
+}
+
+int main(void)
+{
+  knvk_table(knvk, 4);
+  if (!write_file("verify_good", "KNvK.rtbw", knvk, sizeof(knvk))) {
+    fprintf(stderr, "cannot write the test tables\n");
+    return EXIT_FAILURE;
+  }
+
+  test_md5();
+  test_files();
+  test_checksums();
+  test_blocks();
+
+  const char *path = getenv("TB_PATH");
+  if (path && *path)
+    verify_path(path);
+
+  if (failures) {
+    fprintf(stderr, "%d check(s) failed\n", failures);
+    return EXIT_FAILURE;
+  }
+  printf("all checks passed\n");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,112 @@
+using Pedantic.Chess;
+using Pedantic.Tablebase;
+
+namespace Pedantic.UnitTests
+{
+#if USE_TB
+    [TestClass]
+    public class SyzygyTests
+    {
+        private const string TB_PATH = "c:/tb/syzygy/3-4-5-6";
+
+        [ClassInitialize]
+        public static void ClassInitialize(TestContext context)
+        {
+            Syzygy.Initialize(TB_PATH);
+        }
+
+        private static readonly string[] fens =
+        {
+            "7k/6p1/8/8/8/8/1K6/R7 w - - 0 18",
+            "8/8/8/4k3/8/8/3QK3/8 b - - 0 1",
+            "8/8/8/4k3/8/8/3RK3/8 w - - 0 1",
+            "8/8/2k5/8/8/8/3BK3/7N w - - 0 1",
+            "8/8/8/4k3/8/8/3QK3/8 w - - 0 1",
+            "8/5p2/8/4k3/8/8/2P1K3/8 w - - 0 1"
+        };
+
+        [TestMethod]
+        public void ProbeWdlBatchTest()
+        {
+            TbPosition[] positions = new TbPosition[fens.Length];
+            TbResult[] expected = new TbResult[fens.Length];
+
+            for (int n = 0; n < fens.Length; n++)
+            {
+                Board board = new(fens[n]);
+                positions[n] = ToTbPosition(board);
+                expected[n] = Syzygy.ProbeWdl(positions[n].white, positions[n].black, positions[n].kings,
+                    positions[n].queens, positions[n].rooks, positions[n].bishops, positions[n].knights,
+                    positions[n].pawns, 0, 0, positions[n].ep, positions[n].turn != 0);
+            }
+
+            TbResult[] results = new TbResult[fens.Length];
+            int successes = Syzygy.ProbeWdlBatch(positions, results);
+
+            Assert.AreEqual(expected.Count(r => r != TbResult.TbFailure), successes);
+            CollectionAssert.AreEqual(expected, results);
+        }
+
+        [TestMethod]
+        public void ProbeRootDtzNoAllocTest()
+        {
+            TbRootMoveInfo[] infos = new TbRootMoveInfo[256];
+            TbMove[] pv = new TbMove[4096];
+
+            foreach (string fen in fens)
+            {
+                Board board = new(fen);
+                TbPosition pos = ToTbPosition(board);
+                TbRootMove[] rootMoves = Array.Empty<TbRootMove>();
+
+                int expected = Syzygy.ProbeRootDtz(pos.white, pos.black, pos.kings, pos.queens, pos.rooks,
+                    pos.bishops, pos.knights, pos.pawns, 0, 0, pos.ep, pos.turn != 0, false, true, ref rootMoves);
+                int result = Syzygy.ProbeRootDtz(pos.white, pos.black, pos.kings, pos.queens, pos.rooks,
+                    pos.bishops, pos.knights, pos.pawns, 0, 0, pos.ep, pos.turn != 0, false, true, infos, pv,
+                    out int count);
+
+                Assert.AreEqual(expected, result);
+                Assert.AreEqual(rootMoves.Length, count);
+                for (int n = 0; n < count; n++)
+                {
+                    Assert.AreEqual(rootMoves[n].move, infos[n].move);
+                    Assert.AreEqual(rootMoves[n].tbRank, infos[n].tbRank);
+                    Assert.AreEqual(rootMoves[n].tbScore, infos[n].tbScore);
+                    CollectionAssert.AreEqual(rootMoves[n].pv, pv[infos[n].pvStart..(infos[n].pvStart + infos[n].pvLength)]);
+                }
+            }
+        }
+
+        [TestMethod]
+        public void MaterialKeyTest()
+        {
+            foreach (string fen in fens)
+            {
+                Board board = new(fen);
+                TbPosition pos = ToTbPosition(board);
+                ulong expected = Syzygy.MaterialKey(pos.white, pos.black, pos.queens, pos.rooks, pos.bishops,
+                    pos.knights, pos.pawns);
+
+                Assert.AreEqual(expected, board.TbMaterialKey);
+                Assert.AreEqual(Syzygy.ProbeWdl(pos.white, pos.black, pos.kings, pos.queens, pos.rooks,
+                    pos.bishops, pos.knights, pos.pawns, 0, 0, pos.ep, pos.turn != 0),
+                    Syzygy.ProbeWdl(pos.white, pos.black, pos.kings, pos.queens, pos.rooks, pos.bishops,
+                    pos.knights, pos.pawns, 0, 0, pos.ep, pos.turn != 0, board.TbMaterialKey));
+            }
+        }
+
+        private static TbPosition ToTbPosition(Board board)
+        {
+            return new TbPosition(board.Units(Color.White), board.Units(Color.Black),
+                board.Pieces(Color.White, Piece.King)   | board.Pieces(Color.Black, Piece.King),
+                board.Pieces(Color.White, Piece.Queen)  | board.Pieces(Color.Black, Piece.Queen),
+                board.Pieces(Color.White, Piece.Rook)   | board.Pieces(Color.Black, Piece.Rook),
+                board.Pieces(Color.White, Piece.Bishop) | board.Pieces(Color.Black, Piece.Bishop),
+                board.Pieces(Color.White, Piece.Knight) | board.Pieces(Color.Black, Piece.Knight),
+                board.Pieces(Color.White, Piece.Pawn)   | board.Pieces(Color.Black, Piece.Pawn),
+                0, 0, (uint)(board.EnPassantValidated != Index.NONE ? board.EnPassantValidated : 0),
+                board.SideToMove == Color.White);
+        }
+    }
+#endif
+}
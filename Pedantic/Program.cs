@@ -142,6 +142,18 @@ namespace Pedantic
                 name: "--progress",
                 description: "Specifies whether to use Ply or Phase to calculate game progress.",
                 getDefaultValue: () => ProgressType.Ply);
+            var tbPathOption = new Option<string>(
+                name: "--path",
+                description: "The Syzygy tablebase path, directories separated as for SyzygyPath.",
+                getDefaultValue: () => string.Empty);
+            var checksumsOption = new Option<string?>(
+                name: "--checksums",
+                description: "A file of MD5 checksums of the table files, in the format of md5sum.",
+                getDefaultValue: () => null);
+            var threadsOption = new Option<int>(
+                name: "--threads",
+                description: "The number of threads that read table files, 0 for one per processor.",
+                getDefaultValue: () => 0);
 
             var uciCommand = new Command("uci", "Start the pedantic application in UCI mode (default).")
             {
@@ -181,13 +193,21 @@ namespace Pedantic
 
             var weightsCommand = new Command("weights", "Display the default weights used by evaluation.");
 
+            var verifyCommand = new Command("verify", "Check the integrity of Syzygy tablebase files.")
+            {
+                tbPathOption,
+                checksumsOption,
+                threadsOption
+            };
+
             var rootCommand = new RootCommand("The pedantic chess engine.")
             {
                 uciCommand,
                 perftCommand,
                 labelCommand,
                 learnCommand,
-                weightsCommand
+                weightsCommand,
+                verifyCommand
             };
 
             uciCommand.SetHandler(RunUci, commandFileOption, errorFileOption, randomSearchOption, statsOption, magicOption);
@@ -196,6 +216,10 @@ namespace Pedantic
             learnCommand.SetHandler(RunLearn, dataFileOption, sampleOption, iterOption, saveOption, resetOption, maxTimeOption, 
                 evalPctOption, progressOption);
             weightsCommand.SetHandler(RunWeights);
+            verifyCommand.SetHandler(context => context.ExitCode = RunVerify(
+                context.ParseResult.GetValueForOption(tbPathOption)!,
+                context.ParseResult.GetValueForOption(checksumsOption),
+                context.ParseResult.GetValueForOption(threadsOption)));
             rootCommand.SetHandler(async () => await RunUci(null, null, false, false, false));
             return rootCommand.InvokeAsync(args).Result;
         }
@@ -296,6 +320,15 @@ namespace Pedantic
                     Console.WriteLine(@"option name SyzygyPath type string default <empty>");
                     Console.WriteLine(@"option name SyzygyProbeRoot type check default true");
                     Console.WriteLine($@"option name SyzygyProbeDepth type spin default 2 min 0 max {Constants.MAX_PLY - 1}");
+                    Console.WriteLine($@"option name SyzygyCache type spin default {UciOptions.DEFAULT_SYZYGY_CACHE} min 0 max {UciOptions.MAX_SYZYGY_CACHE}");
+                    Console.WriteLine($@"option name SyzygyWarmup type spin default {UciOptions.DEFAULT_SYZYGY_WARMUP} min 0 max 7");
+                    Console.WriteLine($@"option name SyzygyWarmupBudget type spin default {UciOptions.DEFAULT_SYZYGY_WARMUP_BUDGET} min 0 max {UciOptions.MAX_SYZYGY_WARMUP_BUDGET}");
+                    Console.WriteLine($@"option name SyzygyMemory type spin default {UciOptions.DEFAULT_SYZYGY_MEMORY} min 0 max {UciOptions.MAX_SYZYGY_MEMORY}");
+                    Console.WriteLine($@"option name SyzygyHugePages type spin default {UciOptions.DEFAULT_SYZYGY_HUGE_PAGES} min 0 max 7");
+                    Console.WriteLine(@"option name SyzygyLockPages type check default false");
+                    Console.WriteLine($@"option name SyzygyBitbases type spin default {UciOptions.DEFAULT_SYZYGY_BITBASES} min 0 max 5");
+                    Console.WriteLine($@"option name SyzygyIoThreads type spin default {UciOptions.DEFAULT_SYZYGY_IO_THREADS} min 0 max {UciOptions.MAX_SYZYGY_IO_THREADS}");
+                    Console.WriteLine($@"option name SyzygyNuma type spin default {UciOptions.DEFAULT_SYZYGY_NUMA} min 0 max 5");
                     Console.WriteLine($@"option name UCI_AnalyseMode type check default false");
                     Console.WriteLine($@"option name UCI_EngineAbout type string default {APP_NAME_VER} by {AUTHOR}, see {PROGRAM_URL}");
                     Console.WriteLine(@"uciok");
@@ -346,6 +379,18 @@ namespace Pedantic
                     Bench(tokens);
                     break;
 
+                case "tbstatus":
+                    TbStatus();
+                    break;
+
+                case "tbbench":
+                    TbBench(tokens);
+                    break;
+
+                case "tbstats":
+                    TbStats(tokens);
+                    break;
+
                 default:
                     Uci.Default.Log($@"Unexpected input: '{input}'");
                     return;
@@ -483,14 +528,21 @@ namespace Pedantic
                                 }
                                 else
                                 {
-                                    bool result = Syzygy.Initialize(path);
+                                    bool result = Syzygy.Initialize(path, UciOptions.SyzygyCache);
                                     if (!result)
                                     {
                                         Uci.Default.Log($"Could not locate valid Syzygy tablebase files at '{path}'.");
                                     }
                                     else
                                     {
+                                        TbInitInfo info = Syzygy.InitInfo;
+                                        Uci.Default.Log($"Found {info.wdl} WDL, {info.dtm} DTM and {info.dtz} DTZ tablebase files in {info.micros / 1000.0:F1} ms.");
+                                        if (info.bitbases > 0)
+                                        {
+                                            Uci.Default.Log($"Expanded {info.bitbases} WDL tables into bitbases of {info.bitbaseBytes / (1024.0 * 1024.0):F1} MB.");
+                                        }
                                         UciOptions.SyzygyPath = path;
+                                        StartSyzygyWarmup();
                                     }
                                 }
                             }
@@ -510,10 +562,339 @@ namespace Pedantic
                             UciOptions.SyzygyProbeDepth = Math.Max(Math.Min(probeDepth, Constants.MAX_PLY - 1), 0);
                         }
                         break;
+
+                    case "SyzygyCache":
+                        if (tokens[3] == "value" && int.TryParse(tokens[4], out int cacheMb))
+                        {
+                            UciOptions.SyzygyCache = cacheMb;
+                            // The cache can be resized under live probes, the tables stay loaded.
+                            if (Syzygy.IsInitialized && !Syzygy.SetCacheSize(UciOptions.SyzygyCache))
+                            {
+                                Uci.Default.Log("Could not allocate the Syzygy cache.");
+                            }
+                        }
+                        break;
+
+                    case "SyzygyHugePages":
+                        if (tokens[3] == "value" && int.TryParse(tokens[4], out int hugePages))
+                        {
+                            UciOptions.SyzygyHugePages = hugePages;
+                            Syzygy.SetHugePages(UciOptions.SyzygyHugePages, UciOptions.SyzygyLockPages);
+                            RestartSyzygy();
+                        }
+                        break;
+
+                    case "SyzygyLockPages":
+                        if (tokens[3] == "value" && bool.TryParse(tokens[4], out bool lockPages))
+                        {
+                            UciOptions.SyzygyLockPages = lockPages;
+                            Syzygy.SetHugePages(UciOptions.SyzygyHugePages, UciOptions.SyzygyLockPages);
+                            RestartSyzygy();
+                        }
+                        break;
+
+                    case "SyzygyBitbases":
+                        if (tokens[3] == "value" && int.TryParse(tokens[4], out int bitbasePieces))
+                        {
+                            UciOptions.SyzygyBitbases = bitbasePieces;
+                            Syzygy.SetBitbases(UciOptions.SyzygyBitbases);
+                            RestartSyzygy();
+                        }
+                        break;
+
+                    case "SyzygyIoThreads":
+                        if (tokens[3] == "value" && int.TryParse(tokens[4], out int ioThreads))
+                        {
+                            UciOptions.SyzygyIoThreads = ioThreads;
+                            if (!Syzygy.SetIoThreads(UciOptions.SyzygyIoThreads))
+                            {
+                                Uci.Default.Log("Could not start all Syzygy I/O threads.");
+                            }
+                        }
+                        break;
+
+                    case "SyzygyNuma":
+                        if (tokens[3] == "value" && int.TryParse(tokens[4], out int numaPieces))
+                        {
+                            UciOptions.SyzygyNuma = numaPieces;
+                            int nodes = Syzygy.SetNuma(UciOptions.SyzygyNuma);
+                            if (UciOptions.SyzygyNuma > 0 && nodes < 2)
+                            {
+                                Uci.Default.Log("Only one NUMA node, SyzygyNuma has no effect.");
+                            }
+                            RestartSyzygy();
+                        }
+                        break;
+
+                    case "SyzygyWarmup":
+                        if (tokens[3] == "value" && int.TryParse(tokens[4], out int warmupPieces))
+                        {
+                            UciOptions.SyzygyWarmup = warmupPieces;
+                            StartSyzygyWarmup();
+                        }
+                        break;
+
+                    case "SyzygyWarmupBudget":
+                        if (tokens[3] == "value" && int.TryParse(tokens[4], out int warmupBudget))
+                        {
+                            UciOptions.SyzygyWarmupBudget = warmupBudget;
+                        }
+                        break;
+
+                    case "SyzygyMemory":
+                        if (tokens[3] == "value" && int.TryParse(tokens[4], out int memoryMb))
+                        {
+                            UciOptions.SyzygyMemory = memoryMb;
+                            Syzygy.SetResidencyBudget(UciOptions.SyzygyMemory);
+                        }
+                        break;
                 }
             }
         }
 
+        private static void TbStatus()
+        {
+            TbResidency residency = Syzygy.Residency;
+            string budget = residency.budget == 0 ? "unlimited" : $"{residency.budget / (1024 * 1024)} MB";
+            Uci.Default.Log($"Syzygy resident: {residency.tables} tables, {residency.resident / (1024 * 1024)} MB, budget {budget}");
+            Uci.Default.Log($"Syzygy loads: {residency.loads}, evictions: {residency.evictions}, remaps: {residency.remaps}");
+            TbIoStatus io = Syzygy.IoStatus;
+            Uci.Default.Log($"Syzygy I/O threads: {io.threads}, pending probes: {io.pending}, reads: {io.reads}, dropped: {io.dropped}");
+            TbNumaStatus numa = Syzygy.NumaStatus;
+            Uci.Default.Log($"Syzygy NUMA nodes: {numa.nodes}, tables copied: {numa.tables}, {numa.bytes / (1024 * 1024)} MB");
+        }
+
+        private static void TbStats(string[] tokens)
+        {
+            if (!Syzygy.StatisticsEnabled)
+            {
+                Uci.Default.Log("Syzygy statistics require a build with TB_STATS defined.");
+                return;
+            }
+
+            if (tokens.Length > 1 && tokens[1] == "reset")
+            {
+                Syzygy.ResetStatistics();
+                return;
+            }
+
+            string[] types = { "wdl", "dtm", "dtz" };
+            TbTableStatistics[] stats = Syzygy.GetStatistics();
+            foreach (TbTableStatistics table in stats.OrderByDescending(t => t.probes[0] + t.probes[1] + t.probes[2]))
+            {
+                StringBuilder sb = new(table.name);
+                for (int type = 0; type < types.Length; type++)
+                {
+                    if (table.probes[type] > 0 || table.loads[type] > 0)
+                    {
+                        sb.Append($" {types[type]} probes {table.probes[type]} ok {table.successes[type]} fail {table.failures[type]} loads {table.loads[type]}");
+                    }
+                }
+                ulong blockHits = table.blockHits.Aggregate(0ul, (sum, n) => sum + n);
+                ulong blockProbes = blockHits + table.blockMisses.Aggregate(0ul, (sum, n) => sum + n);
+                if (blockProbes > 0)
+                {
+                    sb.Append($" block-hits {100.0 * blockHits / blockProbes:F1}%");
+                }
+                sb.Append($" decode-median 2^{MedianBucket(table.decompress)} ticks depth");
+                for (int d = 0; d < table.depth.Length; d++)
+                {
+                    if (table.depth[d] > 0)
+                    {
+                        sb.Append($" {d}:{table.depth[d]}");
+                    }
+                }
+                Uci.Default.Log(sb.ToString());
+            }
+
+            static int MedianBucket(ulong[] histogram)
+            {
+                ulong total = 0;
+                foreach (ulong count in histogram)
+                {
+                    total += count;
+                }
+
+                ulong seen = 0;
+                for (int n = 0; n < histogram.Length; n++)
+                {
+                    seen += histogram[n];
+                    if (seen * 2 >= total && seen > 0)
+                    {
+                        return n;
+                    }
+                }
+                return 0;
+            }
+        }
+
+        private static void TbBench(string[] tokens)
+        {
+            if (!Syzygy.IsInitialized || Syzygy.TbLargest < 3)
+            {
+                Uci.Default.Log("tbbench requires SyzygyPath to be set.");
+                return;
+            }
+
+            TryParse(tokens, "pieces", out int pieces, Math.Min((int)Syzygy.TbLargest, 5));
+            TryParse(tokens, "count", out int count, 100000);
+            TryParse(tokens, "passes", out int passes, 5);
+            pieces = Math.Clamp(pieces, 3, (int)Syzygy.TbLargest);
+            count = Math.Max(count, 1);
+            passes = Math.Max(passes, 1);
+
+            TbPosition[] positions = TbBenchPositions(pieces, count);
+
+            // The first pass loads the tables and faults their pages in, the rest show the steady state.
+            for (int pass = 0; pass < passes; pass++)
+            {
+                Syzygy.ClearCache();
+                int hits = 0;
+                Stopwatch watch = Stopwatch.StartNew();
+                foreach (TbPosition pos in positions)
+                {
+                    TbResult result = Syzygy.ProbeWdl(pos.white, pos.black, pos.kings, pos.queens, pos.rooks, 
+                        pos.bishops, pos.knights, pos.pawns, 0, 0, pos.ep, pos.turn != 0);
+                    if (result != TbResult.TbFailure)
+                    {
+                        hits++;
+                    }
+                }
+                watch.Stop();
+                double pps = count / Math.Max(watch.Elapsed.TotalSeconds, 1e-9);
+                Uci.Default.Log($"tbbench pass {pass + 1} pieces {pieces} probes {count} hits {hits} time {watch.ElapsedMilliseconds} pps {pps:F0}");
+            }
+        }
+
+        private static TbPosition[] TbBenchPositions(int pieces, int count)
+        {
+            // Fixed seed so that runs with different settings probe the same positions.
+            Random random = new(pieces);
+            TbPosition[] positions = new TbPosition[count];
+            const string pieceChars = "QRBNP";
+            char[] squares = new char[64];
+            StringBuilder sb = new();
+
+            for (int n = 0; n < count;)
+            {
+                Array.Fill(squares, '\0');
+                Place('K');
+                Place('k');
+                for (int p = 2; p < pieces; p++)
+                {
+                    char piece = pieceChars[random.Next(pieceChars.Length)];
+                    Place(random.Next(2) == 0 ? piece : char.ToLower(piece));
+                }
+
+                sb.Clear();
+                for (int rank = 7; rank >= 0; rank--)
+                {
+                    int empty = 0;
+                    for (int file = 0; file < 8; file++)
+                    {
+                        char ch = squares[rank * 8 + file];
+                        if (ch == '\0')
+                        {
+                            empty++;
+                            continue;
+                        }
+                        if (empty > 0)
+                        {
+                            sb.Append(empty);
+                            empty = 0;
+                        }
+                        sb.Append(ch);
+                    }
+                    if (empty > 0)
+                    {
+                        sb.Append(empty);
+                    }
+                    if (rank > 0)
+                    {
+                        sb.Append('/');
+                    }
+                }
+                sb.Append(random.Next(2) == 0 ? " w - - 0 1" : " b - - 0 1");
+
+                Board board = new(sb.ToString());
+                if (board.IsChecked(board.SideToMove))
+                {
+                    // the side to move could capture the king
+                    continue;
+                }
+
+                positions[n++] = new TbPosition(board.Units(Color.White), board.Units(Color.Black),
+                    board.Pieces(Color.White, Piece.King)   | board.Pieces(Color.Black, Piece.King),
+                    board.Pieces(Color.White, Piece.Queen)  | board.Pieces(Color.Black, Piece.Queen),
+                    board.Pieces(Color.White, Piece.Rook)   | board.Pieces(Color.Black, Piece.Rook),
+                    board.Pieces(Color.White, Piece.Bishop) | board.Pieces(Color.Black, Piece.Bishop),
+                    board.Pieces(Color.White, Piece.Knight) | board.Pieces(Color.Black, Piece.Knight),
+                    board.Pieces(Color.White, Piece.Pawn)   | board.Pieces(Color.Black, Piece.Pawn),
+                    0, 0, 0, board.SideToMove == Color.White);
+            }
+
+            return positions;
+
+            void Place(char piece)
+            {
+                int sq;
+                do
+                {
+                    sq = random.Next(64);
+                } 
+                while (squares[sq] != '\0' || (char.ToUpper(piece) == 'P' && (sq < 8 || sq >= 56)));
+                squares[sq] = piece;
+            }
+        }
+
+        private static void RestartSyzygy()
+        {
+            if (Syzygy.IsInitialized)
+            {
+                Syzygy.Initialize(UciOptions.SyzygyPath, UciOptions.SyzygyCache);
+                StartSyzygyWarmup();
+            }
+        }
+
+        private static void StartSyzygyWarmup()
+        {
+            if (!Syzygy.IsInitialized || UciOptions.SyzygyWarmup == 0)
+            {
+                return;
+            }
+
+            if (!Syzygy.Warmup(UciOptions.SyzygyWarmup, UciOptions.SyzygyWarmupBudget))
+            {
+                Uci.Default.Log("Could not start Syzygy warm-up.");
+                return;
+            }
+
+            Task.Run(async () =>
+            {
+                Stopwatch watch = Stopwatch.StartNew();
+                TbWarmupStatus status = Syzygy.WarmupStatus;
+                uint reported = uint.MaxValue;
+                while (status.running)
+                {
+                    if (status.done != reported)
+                    {
+                        Uci.Default.Log($"Syzygy warm-up: {status.done}/{status.total} tables, {status.bytes / (1024 * 1024)} MB");
+                        reported = status.done;
+                    }
+                    await Task.Delay(1000);
+                    status = Syzygy.WarmupStatus;
+                }
+                if (status.cancelled)
+                {
+                    Uci.Default.Log($"Syzygy warm-up cancelled: {status.done}/{status.total} tables, {status.bytes / (1024 * 1024)} MB in {watch.ElapsedMilliseconds} ms");
+                }
+                else
+                {
+                    Uci.Default.Log($"Syzygy warm-up complete: {status.done}/{status.total} tables, {status.bytes / (1024 * 1024)} MB in {watch.ElapsedMilliseconds} ms");
+                }
+            });
+        }
+
         private static void Go(string[] tokens)
         {
             TryParse(tokens, "depth", out int maxDepth, Constants.MAX_PLY - 1);
@@ -1066,6 +1447,32 @@ namespace Pedantic
             PrintSolution(weights);
         }
 
+        private static int RunVerify(string path, string? checksums, int threads)
+        {
+            Stopwatch clock = new();
+            clock.Start();
+            TbVerifyResult[] results = Syzygy.Verify(path, checksums, threads);
+            clock.Stop();
+
+            ulong totalBytes = 0;
+            int failed = 0, checksummed = 0;
+            foreach (TbVerifyResult result in results)
+            {
+                double mb = result.bytes / (1024.0 * 1024.0);
+                double rate = result.micros > 0 ? mb * 1.0e6 / result.micros : 0.0;
+                string status = result.status.ToString().ToLowerInvariant();
+                Console.WriteLine($"{result.name,-16} {status,-10} {mb,10:F1} MB {rate,8:F0} MB/s{(result.checksummed ? " md5" : string.Empty)}");
+                totalBytes += result.bytes;
+                failed += result.status != TbVerifyStatus.Ok ? 1 : 0;
+                checksummed += result.checksummed ? 1 : 0;
+            }
+
+            double totalMb = totalBytes / (1024.0 * 1024.0);
+            double seconds = Math.Max(clock.Elapsed.TotalSeconds, 1.0e-3);
+            Console.WriteLine($"{results.Length} files, {failed} failed, {checksummed} checksummed, {totalMb:F1} MB in {seconds:F1} s, {totalMb / seconds:F0} MB/s");
+            return failed > 0 ? 1 : 0;
+        }
+
         private static int indentLevel = 0;
     }
 }
\ No newline at end of file